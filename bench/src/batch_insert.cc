@@ -0,0 +1,88 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <alex.rom23@mail.ru> wrote this file.  As long as you retain this notice you
+ * can do whatever you want with this stuff. If we meet some day, and you think
+ * this stuff is worth it, you can buy me a beer in return.   Alex Romanov
+ * ----------------------------------------------------------------------------
+ */
+
+// Merge of a sorted batch of m keys into the tree of n keys: per-key insert against union.
+
+#include "myset.hpp"
+#include <algorithm>
+#include <benchmark/benchmark.h>
+#include <random>
+#include <vector>
+
+namespace
+{
+
+// Even keys of the tree and sorted odd keys of the batch, so every batch key is new.
+struct workload
+{
+    std::vector<int> tree_keys;
+    std::vector<int> batch;
+
+    workload (std::size_t n, std::size_t m)
+    {
+        for ( std::size_t i = 0; i < n; i++ )
+            tree_keys.push_back (static_cast<int> (2 * i));
+
+        std::mt19937 gen {42};
+        std::uniform_int_distribution<int> dist (0, static_cast<int> (n + m));
+        for ( std::size_t i = 0; i < m; i++ )
+            batch.push_back (2 * dist (gen) + 1);
+
+        std::sort (batch.begin (), batch.end ());
+        batch.erase (std::unique (batch.begin (), batch.end ()), batch.end ());
+    }
+};
+
+template <typename Insert> void run (benchmark::State &state, Insert insert)
+{
+    workload load (static_cast<std::size_t> (state.range (0)),
+                   static_cast<std::size_t> (state.range (1)));
+
+    for ( auto _ : state )
+    {
+        state.PauseTiming ();
+        rethinking_stl::set<int> tree (load.tree_keys.begin (), load.tree_keys.end ());
+        state.ResumeTiming ();
+
+        insert (tree, load.batch);
+        benchmark::DoNotOptimize (tree.size ());
+
+        state.PauseTiming ();
+        tree.clear ();
+        state.ResumeTiming ();
+    }
+
+    state.SetItemsProcessed (state.iterations () * static_cast<int64_t> (load.batch.size ()));
+}
+
+void BM_per_key_insert (benchmark::State &state)
+{
+    run (state, [] (auto &tree, const auto &batch) {
+        for ( auto key : batch )
+            tree.insert (key);
+    });
+}
+
+void BM_insert_sorted_batch (benchmark::State &state)
+{
+    run (state, [] (auto &tree, const auto &batch) {
+        tree.insert_sorted_batch (batch.begin (), batch.end ());
+    });
+}
+
+void batch_sizes (benchmark::internal::Benchmark *bench)
+{
+    for ( int64_t m = 16; m <= (1 << 20); m *= 8 )
+        bench->Args ({1 << 20, m});
+}
+
+}   // namespace
+
+BENCHMARK (BM_per_key_insert)->Apply (batch_sizes)->Unit (benchmark::kMicrosecond);
+BENCHMARK (BM_insert_sorted_batch)->Apply (batch_sizes)->Unit (benchmark::kMicrosecond);
@@ -0,0 +1,105 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <alex.rom23@mail.ru> wrote this file.  As long as you retain this notice you
+ * can do whatever you want with this stuff. If we meet some day, and you think
+ * this stuff is worth it, you can buy me a beer in return.   Alex Romanov
+ * ----------------------------------------------------------------------------
+ */
+
+// Batch of random select and rank queries: one query at a time against one walk per batch.
+
+#include "myset.hpp"
+#include <benchmark/benchmark.h>
+#include <random>
+#include <vector>
+
+namespace
+{
+
+constexpr int tree_size = 1 << 20;
+
+struct workload
+{
+    rethinking_stl::set<int> tree;
+    std::vector<std::size_t> ranks;
+    std::vector<int> keys;
+
+    explicit workload (std::size_t m)
+    {
+        std::vector<int> tree_keys;
+        for ( int i = 0; i < tree_size; i++ )
+            tree_keys.push_back (2 * i);
+        tree.assign (tree_keys.begin (), tree_keys.end ());
+
+        std::mt19937 gen {42};
+        std::uniform_int_distribution<std::size_t> rank_dist (1, tree_size);
+        std::uniform_int_distribution<int> key_dist (0, 2 * tree_size);
+        for ( std::size_t i = 0; i < m; i++ )
+        {
+            ranks.push_back (rank_dist (gen));
+            keys.push_back (key_dist (gen));
+        }
+    }
+};
+
+void BM_os_select_loop (benchmark::State &state)
+{
+    workload load (static_cast<std::size_t> (state.range (0)));
+    std::vector<int> answers (load.ranks.size ());
+
+    for ( auto _ : state )
+    {
+        for ( std::size_t i = 0; i < load.ranks.size (); i++ )
+            answers[i] = load.tree.os_select (load.ranks[i]);
+        benchmark::DoNotOptimize (answers.data ());
+    }
+    state.SetItemsProcessed (state.iterations () * state.range (0));
+}
+
+void BM_os_select_batch (benchmark::State &state)
+{
+    workload load (static_cast<std::size_t> (state.range (0)));
+    std::vector<int> answers (load.ranks.size ());
+
+    for ( auto _ : state )
+    {
+        load.tree.os_select_batch (load.ranks, answers);
+        benchmark::DoNotOptimize (answers.data ());
+    }
+    state.SetItemsProcessed (state.iterations () * state.range (0));
+}
+
+void BM_rank_loop (benchmark::State &state)
+{
+    workload load (static_cast<std::size_t> (state.range (0)));
+    std::vector<std::size_t> answers (load.keys.size ());
+
+    for ( auto _ : state )
+    {
+        for ( std::size_t i = 0; i < load.keys.size (); i++ )
+            answers[i] = load.tree.get_number_less_then (load.keys[i]);
+        benchmark::DoNotOptimize (answers.data ());
+    }
+    state.SetItemsProcessed (state.iterations () * state.range (0));
+}
+
+void BM_rank_batch (benchmark::State &state)
+{
+    workload load (static_cast<std::size_t> (state.range (0)));
+    std::vector<std::size_t> answers (load.keys.size ());
+
+    for ( auto _ : state )
+    {
+        load.tree.rank_batch (load.keys, answers);
+        benchmark::DoNotOptimize (answers.data ());
+    }
+    state.SetItemsProcessed (state.iterations () * state.range (0));
+}
+
+}   // namespace
+
+BENCHMARK (BM_os_select_loop)->RangeMultiplier (8)->Range (1 << 6, 1 << 18);
+BENCHMARK (BM_os_select_batch)->RangeMultiplier (8)->Range (1 << 6, 1 << 18);
+BENCHMARK (BM_rank_loop)->RangeMultiplier (8)->Range (1 << 6, 1 << 18);
+BENCHMARK (BM_rank_batch)->RangeMultiplier (8)->Range (1 << 6, 1 << 18);
@@ -0,0 +1,139 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <alex.rom23@mail.ru> wrote this file.  As long as you retain this notice you
+ * can do whatever you want with this stuff. If we meet some day, and you think
+ * this stuff is worth it, you can buy me a beer in return.   Alex Romanov
+ * ----------------------------------------------------------------------------
+ */
+
+// Select and rank from many threads with one update per 50 or per 4 reads: the tree behind a
+// mutex, behind a shared mutex, the set with lock-free readers and the lock-free skip list.
+
+#include "concurrent_set.hpp"
+#include "myset.hpp"
+#include "skip_list.hpp"
+#include <benchmark/benchmark.h>
+#include <mutex>
+#include <random>
+#include <shared_mutex>
+
+namespace
+{
+
+constexpr int tree_size = 1 << 18;
+
+/* Even keys are in the set, writers insert and erase odd ones, so the size stays the same. */
+template <typename Set> void fill (Set &set)
+{
+    for ( int i = 0; i < tree_size; i++ )
+        set.insert (2 * i);
+}
+
+template <typename Mutex> struct locked_tree
+{
+    rethinking_stl::set<int> tree;
+    mutable Mutex mutex;
+
+    locked_tree () { fill (tree); }
+
+    int os_select (std::size_t i) const
+    {
+        std::shared_lock lock (mutex);
+        return tree.os_select (i);
+    }
+
+    std::size_t rank (int key) const
+    {
+        std::shared_lock lock (mutex);
+        return tree.get_number_less_then (key);
+    }
+
+    void insert (int key)
+    {
+        std::lock_guard lock (mutex);
+        tree.insert (key);
+    }
+
+    void erase (int key)
+    {
+        std::lock_guard lock (mutex);
+        tree.erase (key);
+    }
+};
+
+/* std::mutex has no lock_shared, readers take it exclusively. */
+struct exclusive_mutex : std::mutex
+{
+    void lock_shared () { lock (); }
+    void unlock_shared () { unlock (); }
+};
+
+struct concurrent_tree
+{
+    rethinking_stl::concurrent_order_statistic_set<int> tree;
+
+    concurrent_tree () { fill (tree); }
+
+    int os_select (std::size_t i) const { return tree.os_select (i); }
+
+    std::size_t rank (int key) const { return tree.get_number_less_then (key); }
+
+    void insert (int key) { tree.insert (key); }
+
+    void erase (int key) { tree.erase (key); }
+};
+
+struct skip_list
+{
+    rethinking_stl::indexable_skip_list<int> list;
+
+    skip_list () { fill (list); }
+
+    int os_select (std::size_t i) const { return list.os_select (i); }
+
+    std::size_t rank (int key) const { return list.get_number_less_then (key); }
+
+    void insert (int key) { list.insert (key); }
+
+    void erase (int key) { list.erase (key); }
+};
+
+using mutex_tree        = locked_tree<exclusive_mutex>;
+using shared_mutex_tree = locked_tree<std::shared_mutex>;
+
+template <typename Container> void BM_reads_and_writes (benchmark::State &state)
+{
+    /* Built by the first thread, the others wait for the initialization of the static. */
+    static Container container;
+
+    std::mt19937 gen (static_cast<unsigned> (state.thread_index ()) + 1);
+    std::uniform_int_distribution<int> key_dist (0, 2 * tree_size - 1);
+    std::uniform_int_distribution<std::size_t> rank_dist (1, tree_size);
+    auto reads_per_write = state.range (0);
+
+    for ( auto _ : state )
+    {
+        for ( std::int64_t i = 0; i < reads_per_write; i++ )
+            benchmark::DoNotOptimize (i % 2 ? container.os_select (rank_dist (gen))
+                                            : static_cast<int> (container.rank (key_dist (gen))));
+
+        auto key = 2 * key_dist (gen) + 1;
+        container.insert (key);
+        container.erase (key);
+    }
+    state.SetItemsProcessed (state.iterations () * (reads_per_write + 2));
+}
+
+/* Reads per update and threads. */
+void workloads (benchmark::internal::Benchmark *bench)
+{
+    bench->Arg (50)->Arg (4)->ThreadRange (1, 8)->UseRealTime ();
+}
+
+}   // namespace
+
+BENCHMARK_TEMPLATE (BM_reads_and_writes, mutex_tree)->Apply (workloads);
+BENCHMARK_TEMPLATE (BM_reads_and_writes, shared_mutex_tree)->Apply (workloads);
+BENCHMARK_TEMPLATE (BM_reads_and_writes, concurrent_tree)->Apply (workloads);
+BENCHMARK_TEMPLATE (BM_reads_and_writes, skip_list)->Apply (workloads);
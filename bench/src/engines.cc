@@ -0,0 +1,149 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <alex.rom23@mail.ru> wrote this file.  As long as you retain this notice you
+ * can do whatever you want with this stuff. If we meet some day, and you think
+ * this stuff is worth it, you can buy me a beer in return.   Alex Romanov
+ * ----------------------------------------------------------------------------
+ */
+
+// Insert, erase, select and rank on the storage engines of the set.
+
+#include "myset.hpp"
+#include <benchmark/benchmark.h>
+#include <map>
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace
+{
+
+constexpr std::size_t batch_size = 1 << 14;
+
+template <typename Engine>
+using engine_set = rethinking_stl::set<int, std::less<int>, std::allocator<int>, Engine>;
+
+struct workload
+{
+    std::vector<int> tree_keys;
+    std::vector<int> keys;
+    std::vector<std::size_t> ranks;
+
+    explicit workload (int n)
+    {
+        std::mt19937 gen {42};
+        std::uniform_int_distribution<int> key_dist (0, 4 * n);
+        std::uniform_int_distribution<std::size_t> rank_dist (1, static_cast<std::size_t> (n));
+
+        for ( int i = 0; i < n; i++ )
+            tree_keys.push_back (key_dist (gen));
+        for ( std::size_t i = 0; i < batch_size; i++ )
+        {
+            keys.push_back (key_dist (gen));
+            ranks.push_back (rank_dist (gen));
+        }
+    }
+};
+
+workload &get_workload (int n)
+{
+    static std::map<int, std::unique_ptr<workload>> loads;
+    auto &load = loads[n];
+    if ( !load )
+        load = std::make_unique<workload> (n);
+    return *load;
+}
+
+/* Trees are built once per engine and size by inserting the keys one by one. */
+template <typename Engine> engine_set<Engine> &get_tree (int n)
+{
+    static std::map<int, std::unique_ptr<engine_set<Engine>>> trees;
+    auto &tree = trees[n];
+    if ( !tree )
+    {
+        tree = std::make_unique<engine_set<Engine>> ();
+        for ( auto key : get_workload (n).tree_keys )
+            tree->insert (key);
+    }
+    return *tree;
+}
+
+template <typename Engine> void BM_insert_erase (benchmark::State &state)
+{
+    auto n     = static_cast<int> (state.range (0));
+    auto &load = get_workload (n);
+    auto &tree = get_tree<Engine> (n);
+
+    /* Keys which were not in the tree are inserted and erased back. */
+    for ( auto _ : state )
+    {
+        for ( auto key : load.keys )
+            if ( tree.insert (key).second )
+                tree.erase (key);
+    }
+    state.SetItemsProcessed (state.iterations () * batch_size);
+}
+
+template <typename Engine> void BM_number_less_then (benchmark::State &state)
+{
+    auto n     = static_cast<int> (state.range (0));
+    auto &load = get_workload (n);
+    auto &tree = get_tree<Engine> (n);
+    std::size_t sum = 0;
+
+    for ( auto _ : state )
+        for ( auto key : load.keys )
+            benchmark::DoNotOptimize (sum += tree.get_number_less_then (key));
+    state.SetItemsProcessed (state.iterations () * batch_size);
+}
+
+template <typename Engine> void BM_os_select (benchmark::State &state)
+{
+    auto n     = static_cast<int> (state.range (0));
+    auto &load = get_workload (n);
+    auto &tree = get_tree<Engine> (n);
+    long sum   = 0;
+
+    for ( auto _ : state )
+        for ( auto rank : load.ranks )
+            benchmark::DoNotOptimize (sum += tree.os_select (std::min (rank, tree.size ())));
+    state.SetItemsProcessed (state.iterations () * batch_size);
+}
+
+using rethinking_stl::avl_tree_engine;
+using rethinking_stl::btree_engine;
+using rethinking_stl::compact_avl_tree_engine;
+using rethinking_stl::instrumented_avl_tree_engine;
+
+}   // namespace
+
+BENCHMARK_TEMPLATE (BM_insert_erase, avl_tree_engine)
+    ->RangeMultiplier (32)
+    ->Range (1 << 10, 1 << 20);
+BENCHMARK_TEMPLATE (BM_insert_erase, compact_avl_tree_engine)
+    ->RangeMultiplier (32)
+    ->Range (1 << 10, 1 << 20);
+BENCHMARK_TEMPLATE (BM_insert_erase, btree_engine)->RangeMultiplier (32)->Range (1 << 10, 1 << 20);
+BENCHMARK_TEMPLATE (BM_insert_erase, instrumented_avl_tree_engine)
+    ->RangeMultiplier (32)
+    ->Range (1 << 10, 1 << 20);
+
+BENCHMARK_TEMPLATE (BM_number_less_then, avl_tree_engine)
+    ->RangeMultiplier (32)
+    ->Range (1 << 10, 1 << 20);
+BENCHMARK_TEMPLATE (BM_number_less_then, compact_avl_tree_engine)
+    ->RangeMultiplier (32)
+    ->Range (1 << 10, 1 << 20);
+BENCHMARK_TEMPLATE (BM_number_less_then, btree_engine)
+    ->RangeMultiplier (32)
+    ->Range (1 << 10, 1 << 20);
+BENCHMARK_TEMPLATE (BM_number_less_then, instrumented_avl_tree_engine)
+    ->RangeMultiplier (32)
+    ->Range (1 << 10, 1 << 20);
+
+BENCHMARK_TEMPLATE (BM_os_select, avl_tree_engine)->RangeMultiplier (32)->Range (1 << 10, 1 << 20);
+BENCHMARK_TEMPLATE (BM_os_select, compact_avl_tree_engine)
+    ->RangeMultiplier (32)
+    ->Range (1 << 10, 1 << 20);
+BENCHMARK_TEMPLATE (BM_os_select, btree_engine)->RangeMultiplier (32)->Range (1 << 10, 1 << 20);
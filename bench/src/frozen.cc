@@ -0,0 +1,106 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <alex.rom23@mail.ru> wrote this file.  As long as you retain this notice you
+ * can do whatever you want with this stuff. If we meet some day, and you think
+ * this stuff is worth it, you can buy me a beer in return.   Alex Romanov
+ * ----------------------------------------------------------------------------
+ */
+
+// Rank and select queries on the tree against its frozen Eytzinger snapshot.
+
+#include "myset.hpp"
+#include <benchmark/benchmark.h>
+#include <map>
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace
+{
+
+constexpr std::size_t batch_size = 1 << 14;
+
+struct workload
+{
+    rethinking_stl::set<int> tree;
+    rethinking_stl::frozen_order_statistic_set<int> frozen;
+    std::vector<int> keys;
+    std::vector<std::size_t> ranks;
+
+    explicit workload (int n)
+    {
+        std::vector<int> tree_keys;
+        for ( int i = 0; i < n; i++ )
+            tree_keys.push_back (2 * i);
+        tree.assign (tree_keys.begin (), tree_keys.end ());
+        frozen = tree.freeze ();
+
+        std::mt19937 gen {42};
+        std::uniform_int_distribution<int> key_dist (0, 2 * n);
+        std::uniform_int_distribution<std::size_t> rank_dist (1, static_cast<std::size_t> (n));
+        for ( std::size_t i = 0; i < batch_size; i++ )
+        {
+            keys.push_back (key_dist (gen));
+            ranks.push_back (rank_dist (gen));
+        }
+    }
+};
+
+workload &get_workload (int n)
+{
+    static std::map<int, std::unique_ptr<workload>> loads;
+    auto &load = loads[n];
+    if ( !load )
+        load = std::make_unique<workload> (n);
+    return *load;
+}
+
+template <typename Set> void number_less_then (benchmark::State &state, const Set &set)
+{
+    auto &load = get_workload (static_cast<int> (state.range (0)));
+    std::size_t sum = 0;
+
+    for ( auto _ : state )
+        for ( auto key : load.keys )
+            benchmark::DoNotOptimize (sum += set.get_number_less_then (key));
+    state.SetItemsProcessed (state.iterations () * batch_size);
+}
+
+template <typename Set> void os_select (benchmark::State &state, const Set &set)
+{
+    auto &load = get_workload (static_cast<int> (state.range (0)));
+    long sum   = 0;
+
+    for ( auto _ : state )
+        for ( auto rank : load.ranks )
+            benchmark::DoNotOptimize (sum += set.os_select (rank));
+    state.SetItemsProcessed (state.iterations () * batch_size);
+}
+
+void BM_tree_number_less_then (benchmark::State &state)
+{
+    number_less_then (state, get_workload (static_cast<int> (state.range (0))).tree);
+}
+
+void BM_frozen_number_less_then (benchmark::State &state)
+{
+    number_less_then (state, get_workload (static_cast<int> (state.range (0))).frozen);
+}
+
+void BM_tree_os_select (benchmark::State &state)
+{
+    os_select (state, get_workload (static_cast<int> (state.range (0))).tree);
+}
+
+void BM_frozen_os_select (benchmark::State &state)
+{
+    os_select (state, get_workload (static_cast<int> (state.range (0))).frozen);
+}
+
+}   // namespace
+
+BENCHMARK (BM_tree_number_less_then)->RangeMultiplier (16)->Range (1 << 10, 1 << 22);
+BENCHMARK (BM_frozen_number_less_then)->RangeMultiplier (16)->Range (1 << 10, 1 << 22);
+BENCHMARK (BM_tree_os_select)->RangeMultiplier (16)->Range (1 << 10, 1 << 22);
+BENCHMARK (BM_frozen_os_select)->RangeMultiplier (16)->Range (1 << 10, 1 << 22);
@@ -0,0 +1,168 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <alex.rom23@mail.ru> wrote this file.  As long as you retain this notice you
+ * can do whatever you want with this stuff. If we meet some day, and you think
+ * this stuff is worth it, you can buy me a beer in return.   Alex Romanov
+ * ----------------------------------------------------------------------------
+ */
+
+// Random lookups one at a time against interleaved descents in groups of different sizes.
+
+#include "myset.hpp"
+#include <benchmark/benchmark.h>
+#include <map>
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace
+{
+
+using tree_type = rethinking_stl::set<int>;
+
+constexpr std::size_t batch_size = 1 << 14;
+
+struct workload
+{
+    tree_type tree;
+    std::vector<int> keys;
+    std::vector<std::size_t> ranks;
+
+    explicit workload (int n)
+    {
+        std::vector<int> tree_keys;
+        for ( int i = 0; i < n; i++ )
+            tree_keys.push_back (2 * i);
+        tree.assign (tree_keys.begin (), tree_keys.end ());
+
+        std::mt19937 gen {42};
+        std::uniform_int_distribution<int> key_dist (0, 2 * n);
+        std::uniform_int_distribution<std::size_t> rank_dist (1, static_cast<std::size_t> (n));
+        for ( std::size_t i = 0; i < batch_size; i++ )
+        {
+            keys.push_back (key_dist (gen));
+            ranks.push_back (rank_dist (gen));
+        }
+    }
+};
+
+// Trees are big, so each size is built once for all benchmarks.
+workload &get_workload (int n)
+{
+    static std::map<int, std::unique_ptr<workload>> loads;
+    auto &load = loads[n];
+    if ( !load )
+        load = std::make_unique<workload> (n);
+    return *load;
+}
+
+void BM_lower_bound_loop (benchmark::State &state)
+{
+    auto &load = get_workload (static_cast<int> (state.range (0)));
+    std::vector<tree_type::iterator> answers (batch_size);
+
+    for ( auto _ : state )
+    {
+        for ( std::size_t i = 0; i < batch_size; i++ )
+            answers[i] = load.tree.lower_bound (load.keys[i]);
+        benchmark::DoNotOptimize (answers.data ());
+    }
+    state.SetItemsProcessed (state.iterations () * batch_size);
+}
+
+template <std::size_t Group> void BM_lower_bound_interleaved (benchmark::State &state)
+{
+    auto &load = get_workload (static_cast<int> (state.range (0)));
+    std::vector<tree_type::iterator> answers (batch_size);
+
+    for ( auto _ : state )
+    {
+        load.tree.lower_bound_interleaved<Group> (load.keys, answers);
+        benchmark::DoNotOptimize (answers.data ());
+    }
+    state.SetItemsProcessed (state.iterations () * batch_size);
+}
+
+void BM_os_select_loop (benchmark::State &state)
+{
+    auto &load = get_workload (static_cast<int> (state.range (0)));
+    std::vector<int> answers (batch_size);
+
+    for ( auto _ : state )
+    {
+        for ( std::size_t i = 0; i < batch_size; i++ )
+            answers[i] = load.tree.os_select (load.ranks[i]);
+        benchmark::DoNotOptimize (answers.data ());
+    }
+    state.SetItemsProcessed (state.iterations () * batch_size);
+}
+
+template <std::size_t Group> void BM_os_select_interleaved (benchmark::State &state)
+{
+    auto &load = get_workload (static_cast<int> (state.range (0)));
+    std::vector<int> answers (batch_size);
+
+    for ( auto _ : state )
+    {
+        load.tree.os_select_interleaved<Group> (load.ranks, answers);
+        benchmark::DoNotOptimize (answers.data ());
+    }
+    state.SetItemsProcessed (state.iterations () * batch_size);
+}
+
+void BM_rank_loop (benchmark::State &state)
+{
+    auto &load = get_workload (static_cast<int> (state.range (0)));
+    std::vector<std::size_t> answers (batch_size);
+
+    for ( auto _ : state )
+    {
+        for ( std::size_t i = 0; i < batch_size; i++ )
+            answers[i] = load.tree.rank (load.keys[i]);
+        benchmark::DoNotOptimize (answers.data ());
+    }
+    state.SetItemsProcessed (state.iterations () * batch_size);
+}
+
+template <std::size_t Group> void BM_rank_interleaved (benchmark::State &state)
+{
+    auto &load = get_workload (static_cast<int> (state.range (0)));
+    std::vector<std::size_t> answers (batch_size);
+
+    for ( auto _ : state )
+    {
+        load.tree.rank_interleaved<Group> (load.keys, answers);
+        benchmark::DoNotOptimize (answers.data ());
+    }
+    state.SetItemsProcessed (state.iterations () * batch_size);
+}
+
+// Tree fitting in L2 and tree much bigger then the last level cache.
+void tree_sizes (benchmark::internal::Benchmark *bench)
+{
+    bench->Arg (1 << 14)->Arg (1 << 23);
+}
+
+}   // namespace
+
+BENCHMARK (BM_lower_bound_loop)->Apply (tree_sizes);
+BENCHMARK_TEMPLATE (BM_lower_bound_interleaved, 1)->Apply (tree_sizes);
+BENCHMARK_TEMPLATE (BM_lower_bound_interleaved, 4)->Apply (tree_sizes);
+BENCHMARK_TEMPLATE (BM_lower_bound_interleaved, 8)->Apply (tree_sizes);
+BENCHMARK_TEMPLATE (BM_lower_bound_interleaved, 16)->Apply (tree_sizes);
+BENCHMARK_TEMPLATE (BM_lower_bound_interleaved, 32)->Apply (tree_sizes);
+
+BENCHMARK (BM_os_select_loop)->Apply (tree_sizes);
+BENCHMARK_TEMPLATE (BM_os_select_interleaved, 1)->Apply (tree_sizes);
+BENCHMARK_TEMPLATE (BM_os_select_interleaved, 4)->Apply (tree_sizes);
+BENCHMARK_TEMPLATE (BM_os_select_interleaved, 8)->Apply (tree_sizes);
+BENCHMARK_TEMPLATE (BM_os_select_interleaved, 16)->Apply (tree_sizes);
+BENCHMARK_TEMPLATE (BM_os_select_interleaved, 32)->Apply (tree_sizes);
+
+BENCHMARK (BM_rank_loop)->Apply (tree_sizes);
+BENCHMARK_TEMPLATE (BM_rank_interleaved, 1)->Apply (tree_sizes);
+BENCHMARK_TEMPLATE (BM_rank_interleaved, 4)->Apply (tree_sizes);
+BENCHMARK_TEMPLATE (BM_rank_interleaved, 8)->Apply (tree_sizes);
+BENCHMARK_TEMPLATE (BM_rank_interleaved, 16)->Apply (tree_sizes);
+BENCHMARK_TEMPLATE (BM_rank_interleaved, 32)->Apply (tree_sizes);
@@ -0,0 +1,89 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <alex.rom23@mail.ru> wrote this file.  As long as you retain this notice you
+ * can do whatever you want with this stuff. If we meet some day, and you think
+ * this stuff is worth it, you can buy me a beer in return.   Alex Romanov
+ * ----------------------------------------------------------------------------
+ */
+
+// Response times with many repeated values: inserts into the multiset, std::multiset and the
+// pb_ds order statistics tree of (time, sequence number) pairs, and percentiles of the multiset
+// and of the pb_ds tree.
+
+#include "myset.hpp"
+#include <benchmark/benchmark.h>
+#include <ext/pb_ds/assoc_container.hpp>
+#include <ext/pb_ds/tree_policy.hpp>
+#include <random>
+#include <set>
+#include <utility>
+#include <vector>
+
+namespace
+{
+
+constexpr int samples = 1 << 20;
+
+using pbds_tree = __gnu_pbds::tree<std::pair<int, int>, __gnu_pbds::null_type,
+                                   std::less<std::pair<int, int>>, __gnu_pbds::rb_tree_tag,
+                                   __gnu_pbds::tree_order_statistics_node_update>;
+
+/* Milliseconds, a few thousands of distinct values. */
+std::vector<int> response_times ()
+{
+    std::mt19937 gen (1);
+    std::lognormal_distribution<double> dist (3.0, 1.0);
+    std::vector<int> res (samples);
+    for ( auto &time : res )
+        time = static_cast<int> (dist (gen));
+    return res;
+}
+
+void insert (rethinking_stl::multiset<int> &set, int time, int) { set.insert (time); }
+void insert (std::multiset<int> &set, int time, int) { set.insert (time); }
+void insert (pbds_tree &set, int time, int i) { set.insert ({time, i}); }
+
+template <typename Set> void BM_insert (benchmark::State &state)
+{
+    auto times = response_times ();
+    for ( auto _ : state )
+    {
+        Set set;
+        for ( int i = 0; i < samples; i++ )
+            insert (set, times[i], i);
+        benchmark::DoNotOptimize (set.size ());
+    }
+    state.SetItemsProcessed (state.iterations () * samples);
+}
+
+void BM_percentiles_multiset (benchmark::State &state)
+{
+    rethinking_stl::multiset<int> set;
+    for ( auto time : response_times () )
+        set.insert (time);
+
+    for ( auto _ : state )
+        for ( auto p : {50, 90, 99} )
+            benchmark::DoNotOptimize (set.os_select (set.size () / 100 * p + 1));
+}
+
+void BM_percentiles_pbds (benchmark::State &state)
+{
+    pbds_tree set;
+    auto times = response_times ();
+    for ( int i = 0; i < samples; i++ )
+        set.insert ({times[i], i});
+
+    for ( auto _ : state )
+        for ( auto p : {50, 90, 99} )
+            benchmark::DoNotOptimize (set.find_by_order (set.size () / 100 * p)->first);
+}
+
+}   // namespace
+
+BENCHMARK_TEMPLATE (BM_insert, rethinking_stl::multiset<int>)->Unit (benchmark::kMillisecond);
+BENCHMARK_TEMPLATE (BM_insert, std::multiset<int>)->Unit (benchmark::kMillisecond);
+BENCHMARK_TEMPLATE (BM_insert, pbds_tree)->Unit (benchmark::kMillisecond);
+BENCHMARK (BM_percentiles_multiset);
+BENCHMARK (BM_percentiles_pbds);
@@ -0,0 +1,100 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <alex.rom23@mail.ru> wrote this file.  As long as you retain this notice you
+ * can do whatever you want with this stuff. If we meet some day, and you think
+ * this stuff is worth it, you can buy me a beer in return.   Alex Romanov
+ * ----------------------------------------------------------------------------
+ */
+
+// Export and sum of all keys of a tree: iterators against to_vector and parallel_reduce on one
+// and on all threads.
+
+#include "myset.hpp"
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <functional>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+constexpr int tree_size = 1 << 22;
+
+using tree_type = rethinking_stl::set<int>;
+
+/* Random insertion order, so the nodes are spread over the slabs. */
+const tree_type &tree ()
+{
+    static const tree_type tree_ = [] {
+        std::vector<int> keys (tree_size);
+        for ( int i = 0; i < tree_size; i++ )
+            keys[i] = i;
+        std::shuffle (keys.begin (), keys.end (), std::mt19937 (1));
+
+        tree_type res;
+        for ( auto key : keys )
+            res.insert (key);
+        return res;
+    }();
+    return tree_;
+}
+
+const long threads_arg = static_cast<long> (std::thread::hardware_concurrency ());
+
+void BM_iterator_export (benchmark::State &state)
+{
+    auto &set = tree ();
+    for ( auto _ : state )
+    {
+        std::vector<int> keys (set.begin (), set.end ());
+        benchmark::DoNotOptimize (keys.data ());
+    }
+    state.SetItemsProcessed (state.iterations () * tree_size);
+}
+
+void BM_to_vector (benchmark::State &state)
+{
+    auto &set = tree ();
+    for ( auto _ : state )
+    {
+        auto keys = set.to_vector (static_cast<unsigned> (state.range (0)));
+        benchmark::DoNotOptimize (keys.data ());
+    }
+    state.SetItemsProcessed (state.iterations () * tree_size);
+}
+
+void BM_iterator_sum (benchmark::State &state)
+{
+    auto &set = tree ();
+    for ( auto _ : state )
+    {
+        long long sum = 0;
+        for ( auto key : set )
+            sum += key;
+        benchmark::DoNotOptimize (sum);
+    }
+    state.SetItemsProcessed (state.iterations () * tree_size);
+}
+
+void BM_parallel_reduce (benchmark::State &state)
+{
+    auto &set = tree ();
+    for ( auto _ : state )
+    {
+        auto sum = set.parallel_reduce (
+            0LL, std::plus<long long> (), [] (int key) { return static_cast<long long> (key); },
+            static_cast<unsigned> (state.range (0)));
+        benchmark::DoNotOptimize (sum);
+    }
+    state.SetItemsProcessed (state.iterations () * tree_size);
+}
+
+}   // namespace
+
+BENCHMARK (BM_iterator_export)->Unit (benchmark::kMillisecond);
+BENCHMARK (BM_to_vector)->Arg (1)->Arg (threads_arg)->Unit (benchmark::kMillisecond);
+BENCHMARK (BM_iterator_sum)->Unit (benchmark::kMillisecond);
+BENCHMARK (BM_parallel_reduce)->Arg (1)->Arg (threads_arg)->Unit (benchmark::kMillisecond);
@@ -0,0 +1,151 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <alex.rom23@mail.ru> wrote this file.  As long as you retain this notice you
+ * can do whatever you want with this stuff. If we meet some day, and you think
+ * this stuff is worth it, you can buy me a beer in return.   Alex Romanov
+ * ----------------------------------------------------------------------------
+ */
+
+// Hardware performance counters around benchmark regions
+
+#pragma once
+
+#include <benchmark/benchmark.h>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace perf
+{
+
+struct event_desc
+{
+    const char *name;
+    std::uint32_t type;
+    std::uint64_t config;
+};
+
+constexpr std::uint64_t cache_read_miss (std::uint64_t cache)
+{
+    return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+}
+
+inline constexpr std::array<event_desc, 5> events = {{
+    {"cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {"instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {"L1d-misses", PERF_TYPE_HW_CACHE, cache_read_miss (PERF_COUNT_HW_CACHE_L1D)},
+    {"LLC-misses", PERF_TYPE_HW_CACHE, cache_read_miss (PERF_COUNT_HW_CACHE_LL)},
+    {"branch-misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+}};
+
+//====================================counters====================================
+/*
+ * Counters of the calling thread in user space, accumulated over the regions between
+ * start () and stop (). Every event is opened on its own, so the ones the CPU or the kernel
+ * don't provide (virtual machines, perf_event_paranoid, containers without the syscall) are
+ * just missing from the report. When the kernel multiplexes the counters, the values are
+ * scaled by the share of time they were running.
+ */
+class counters
+{
+    struct reading
+    {
+        std::uint64_t value;
+        std::uint64_t time_enabled;
+        std::uint64_t time_running;
+    };
+
+    std::array<int, events.size ()> m_fds_;
+    std::array<double, events.size ()> m_totals_ {};
+
+    static int s_open_ (const event_desc &event)
+    {
+        perf_event_attr attr;
+        std::memset (&attr, 0, sizeof (attr));
+        attr.size           = sizeof (attr);
+        attr.type           = event.type;
+        attr.config         = event.config;
+        attr.disabled       = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv     = 1;
+        attr.read_format    = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+        return static_cast<int> (::syscall (SYS_perf_event_open, &attr, 0, -1, -1, 0));
+    }
+
+  public:
+    counters ()
+    {
+        for ( std::size_t i = 0; i < events.size (); i++ )
+            m_fds_[i] = s_open_ (events[i]);
+    }
+
+    counters (const counters &)            = delete;
+    counters &operator= (const counters &) = delete;
+
+    ~counters ()
+    {
+        for ( auto fd : m_fds_ )
+            if ( fd >= 0 )
+                ::close (fd);
+    }
+
+    bool available () const noexcept
+    {
+        for ( auto fd : m_fds_ )
+            if ( fd >= 0 )
+                return true;
+        return false;
+    }
+
+    void start () noexcept
+    {
+        for ( auto fd : m_fds_ )
+            if ( fd >= 0 )
+            {
+                ::ioctl (fd, PERF_EVENT_IOC_RESET, 0);
+                ::ioctl (fd, PERF_EVENT_IOC_ENABLE, 0);
+            }
+    }
+
+    void stop () noexcept
+    {
+        for ( std::size_t i = 0; i < events.size (); i++ )
+        {
+            if ( m_fds_[i] < 0 )
+                continue;
+            ::ioctl (m_fds_[i], PERF_EVENT_IOC_DISABLE, 0);
+
+            reading read_;
+            if ( ::read (m_fds_[i], &read_, sizeof (read_)) != sizeof (read_) )
+                continue;
+            if ( read_.time_running )
+                m_totals_[i] += static_cast<double> (read_.value) * read_.time_enabled /
+                                read_.time_running;
+        }
+    }
+
+    // Add the counters divided by the number of operations to the benchmark report.
+    void report (benchmark::State &state, std::uint64_t operations) const
+    {
+        if ( !available () )
+        {
+            state.SetLabel ("no perf counters");
+            return;
+        }
+
+        for ( std::size_t i = 0; i < events.size (); i++ )
+            if ( m_fds_[i] >= 0 )
+                state.counters[std::string (events[i].name) + "/op"] =
+                    m_totals_[i] / static_cast<double> (operations ? operations : 1);
+    }
+};
+
+}   // namespace perf
@@ -0,0 +1,170 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <alex.rom23@mail.ru> wrote this file.  As long as you retain this notice you
+ * can do whatever you want with this stuff. If we meet some day, and you think
+ * this stuff is worth it, you can buy me a beer in return.   Alex Romanov
+ * ----------------------------------------------------------------------------
+ */
+
+// Hardware counters per operation of the set: cycles, instructions, cache and branch misses.
+
+#include "myset.hpp"
+#include "perf_counters.hpp"
+#include <benchmark/benchmark.h>
+#include <map>
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace
+{
+
+constexpr std::size_t batch_size = 1 << 12;
+
+template <typename Engine>
+using engine_set = rethinking_stl::set<int, std::less<int>, std::allocator<int>, Engine>;
+
+/* Tree of even keys, the batch keys to insert are distinct odd ones, so they are always new. */
+template <typename Engine> struct workload
+{
+    engine_set<Engine> tree;
+    std::vector<int> new_keys;
+    std::vector<int> keys;
+    std::vector<std::size_t> ranks;
+
+    explicit workload (int n)
+    {
+        std::mt19937 gen {42};
+        std::vector<int> tree_keys;
+        for ( int i = 0; i < n; i++ )
+            tree_keys.push_back (2 * i);
+        std::shuffle (tree_keys.begin (), tree_keys.end (), gen);
+        for ( auto key : tree_keys )
+            tree.insert (key);
+
+        /* Neighbours of the first shuffled keys, so no key of the batch repeats. */
+        for ( std::size_t i = 0; i < batch_size; i++ )
+            new_keys.push_back (tree_keys[i] + 1);
+
+        std::uniform_int_distribution<int> key_dist (0, n - 1);
+        std::uniform_int_distribution<std::size_t> rank_dist (1, static_cast<std::size_t> (n));
+        for ( std::size_t i = 0; i < batch_size; i++ )
+        {
+            keys.push_back (2 * key_dist (gen));
+            ranks.push_back (rank_dist (gen));
+        }
+    }
+};
+
+template <typename Engine> workload<Engine> &get_workload (int n)
+{
+    static std::map<int, std::unique_ptr<workload<Engine>>> loads;
+    auto &load = loads[n];
+    if ( !load )
+        load = std::make_unique<workload<Engine>> (n);
+    return *load;
+}
+
+/* Counters cover only the calls of the operation, restoring the tree is not counted. */
+template <typename Engine> void BM_insert (benchmark::State &state)
+{
+    auto &load = get_workload<Engine> (static_cast<int> (state.range (0)));
+    perf::counters counters;
+
+    for ( auto _ : state )
+    {
+        counters.start ();
+        for ( auto key : load.new_keys )
+            load.tree.insert (key);
+        counters.stop ();
+
+        state.PauseTiming ();
+        for ( auto key : load.new_keys )
+            load.tree.erase (key);
+        state.ResumeTiming ();
+    }
+    counters.report (state, state.iterations () * batch_size);
+}
+
+template <typename Engine> void BM_erase (benchmark::State &state)
+{
+    auto &load = get_workload<Engine> (static_cast<int> (state.range (0)));
+    perf::counters counters;
+
+    for ( auto _ : state )
+    {
+        state.PauseTiming ();
+        for ( auto key : load.new_keys )
+            load.tree.insert (key);
+        state.ResumeTiming ();
+
+        counters.start ();
+        for ( auto key : load.new_keys )
+            load.tree.erase (key);
+        counters.stop ();
+    }
+    counters.report (state, state.iterations () * batch_size);
+}
+
+template <typename Engine> void BM_find (benchmark::State &state)
+{
+    auto &load = get_workload<Engine> (static_cast<int> (state.range (0)));
+    perf::counters counters;
+
+    for ( auto _ : state )
+    {
+        counters.start ();
+        for ( auto key : load.keys )
+            benchmark::DoNotOptimize (load.tree.find (key));
+        counters.stop ();
+    }
+    counters.report (state, state.iterations () * batch_size);
+}
+
+template <typename Engine> void BM_os_select (benchmark::State &state)
+{
+    auto &load = get_workload<Engine> (static_cast<int> (state.range (0)));
+    perf::counters counters;
+
+    for ( auto _ : state )
+    {
+        counters.start ();
+        for ( auto rank : load.ranks )
+            benchmark::DoNotOptimize (load.tree.os_select (rank));
+        counters.stop ();
+    }
+    counters.report (state, state.iterations () * batch_size);
+}
+
+template <typename Engine> void BM_get_number_less_then (benchmark::State &state)
+{
+    auto &load = get_workload<Engine> (static_cast<int> (state.range (0)));
+    perf::counters counters;
+
+    for ( auto _ : state )
+    {
+        counters.start ();
+        for ( auto key : load.keys )
+            benchmark::DoNotOptimize (load.tree.get_number_less_then (key));
+        counters.stop ();
+    }
+    counters.report (state, state.iterations () * batch_size);
+}
+
+using rethinking_stl::avl_tree_engine;
+using rethinking_stl::btree_engine;
+using rethinking_stl::compact_avl_tree_engine;
+
+}   // namespace
+
+#define PROFILE_BENCHMARKS(Engine)                                                                 \
+    BENCHMARK_TEMPLATE (BM_insert, Engine)->Arg (1 << 14)->Arg (1 << 22);                          \
+    BENCHMARK_TEMPLATE (BM_erase, Engine)->Arg (1 << 14)->Arg (1 << 22);                           \
+    BENCHMARK_TEMPLATE (BM_find, Engine)->Arg (1 << 14)->Arg (1 << 22);                            \
+    BENCHMARK_TEMPLATE (BM_os_select, Engine)->Arg (1 << 14)->Arg (1 << 22);                       \
+    BENCHMARK_TEMPLATE (BM_get_number_less_then, Engine)->Arg (1 << 14)->Arg (1 << 22)
+
+PROFILE_BENCHMARKS (avl_tree_engine);
+PROFILE_BENCHMARKS (compact_avl_tree_engine);
+PROFILE_BENCHMARKS (btree_engine);
@@ -0,0 +1,66 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <alex.rom23@mail.ru> wrote this file.  As long as you retain this notice you
+ * can do whatever you want with this stuff. If we meet some day, and you think
+ * this stuff is worth it, you can buy me a beer in return.   Alex Romanov
+ * ----------------------------------------------------------------------------
+ */
+
+// Union of two trees of n keys, every other key of the second one is present in the first: the
+// keys inserted one by one against set_union on one and on several threads.
+
+#include "myset.hpp"
+#include <benchmark/benchmark.h>
+#include <thread>
+
+namespace
+{
+
+using tree_type = rethinking_stl::set<int>;
+
+void fill (tree_type &first, tree_type &second, int n)
+{
+    for ( int i = 0; i < n; i++ )
+    {
+        first.insert (2 * i);
+        second.insert (3 * i);
+    }
+}
+
+void BM_insert (benchmark::State &state)
+{
+    for ( auto _ : state )
+    {
+        state.PauseTiming ();
+        tree_type first, second;
+        fill (first, second, static_cast<int> (state.range (0)));
+        state.ResumeTiming ();
+
+        for ( auto key : second )
+            first.insert (key);
+        benchmark::DoNotOptimize (first.size ());
+    }
+}
+
+void BM_set_union (benchmark::State &state)
+{
+    auto threads = static_cast<unsigned> (state.range (1));
+    for ( auto _ : state )
+    {
+        state.PauseTiming ();
+        tree_type first, second;
+        fill (first, second, static_cast<int> (state.range (0)));
+        state.ResumeTiming ();
+
+        first.set_union (second, threads);
+        benchmark::DoNotOptimize (first.size ());
+    }
+}
+
+}   // namespace
+
+BENCHMARK (BM_insert)->RangeMultiplier (16)->Range (1 << 12, 1 << 20);
+BENCHMARK (BM_set_union)
+    ->ArgsProduct ({benchmark::CreateRange (1 << 12, 1 << 20, 16),
+                    {1, static_cast<long> (std::thread::hardware_concurrency ())}});
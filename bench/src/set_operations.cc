@@ -0,0 +1,336 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <alex.rom23@mail.ru> wrote this file.  As long as you retain this notice you
+ * can do whatever you want with this stuff. If we meet some day, and you think
+ * this stuff is worth it, you can buy me a beer in return.   Alex Romanov
+ * ----------------------------------------------------------------------------
+ */
+
+// All set operations on the engines of the set, std::set and pb_ds order statistics tree.
+
+#include "myset.hpp"
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <ext/pb_ds/assoc_container.hpp>
+#include <ext/pb_ds/tree_policy.hpp>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace
+{
+
+constexpr std::size_t batch_size = 1 << 10;
+
+// Keys of the workload, all distributions are generated from 64-bit values.
+enum distribution
+{
+    uniform,   /* random keys inserted in random order */
+    sorted,    /* increasing keys */
+    clustered, /* 64 dense runs of keys in random order */
+};
+
+template <typename Key> Key make_key (std::uint64_t value);
+
+template <> int make_key<int> (std::uint64_t value) { return static_cast<int> (value); }
+
+template <> std::int64_t make_key<std::int64_t> (std::uint64_t value)
+{
+    return static_cast<std::int64_t> (value * 1000003 + (std::uint64_t {1} << 40));
+}
+
+template <> std::string make_key<std::string> (std::uint64_t value)
+{
+    char buffer[24];
+    std::snprintf (buffer, sizeof (buffer), "%012llu", static_cast<unsigned long long> (value));
+    return buffer;
+}
+
+template <typename Key> struct workload
+{
+    std::vector<Key> keys;        /* in the order of insertion */
+    std::vector<Key> erase_order; /* the same keys shuffled */
+    std::vector<Key> queries;     /* about half of them are in the set */
+    std::vector<std::size_t> ranks;
+
+    workload (std::size_t n, distribution dist)
+    {
+        std::mt19937_64 gen {42};
+        std::vector<std::uint64_t> values;
+
+        switch ( dist )
+        {
+        case uniform:
+            values.resize (2 * n);
+            std::iota (values.begin (), values.end (), 0);
+            std::shuffle (values.begin (), values.end (), gen);
+            values.resize (n);
+            break;
+        case sorted:
+            for ( std::size_t i = 0; i < n; i++ )
+                values.push_back (2 * i);
+            break;
+        case clustered:
+            for ( std::size_t cluster = 0, done = 0; cluster < 64; cluster++ )
+            {
+                std::size_t next  = n * (cluster + 1) / 64;
+                std::size_t start = std::uniform_int_distribution<std::size_t> (0, n) (gen);
+                for ( std::size_t i = done; i < next; i++ )
+                    values.push_back (2 * n * cluster + start + (i - done));
+                done = next;
+            }
+            std::shuffle (values.begin (), values.end (), gen);
+            break;
+        }
+
+        for ( auto value : values )
+            keys.push_back (make_key<Key> (value));
+        erase_order = keys;
+        std::shuffle (erase_order.begin (), erase_order.end (), gen);
+
+        auto max_value = *std::max_element (values.begin (), values.end ());
+        std::uniform_int_distribution<std::size_t> pick (0, n - 1);
+        std::uniform_int_distribution<std::uint64_t> any (0, max_value + 1);
+        for ( std::size_t i = 0; i < batch_size; i++ )
+        {
+            queries.push_back (i % 2 ? keys[pick (gen)] : make_key<Key> (any (gen)));
+            ranks.push_back (pick (gen) + 1);
+        }
+    }
+};
+
+template <typename Key> const workload<Key> &get_workload (std::size_t n, distribution dist)
+{
+    static std::map<std::pair<std::size_t, int>, std::unique_ptr<workload<Key>>> loads;
+    auto &load = loads[{n, dist}];
+    if ( !load )
+        load = std::make_unique<workload<Key>> (n, dist);
+    return *load;
+}
+
+//=================================containers=================================
+
+template <typename Key, typename Engine> struct my_set
+{
+    using key_type = Key;
+    rethinking_stl::set<Key, std::less<Key>, std::allocator<Key>, Engine> set;
+
+    Key os_select (std::size_t i) const { return set.os_select (i); }
+
+    std::size_t rank (const Key &key) const { return set.get_number_less_then (key); }
+};
+
+/* Order statistics by walking the iterators, but without copying the set like compare.sh. */
+template <typename Key> struct std_set
+{
+    using key_type = Key;
+    std::set<Key> set;
+
+    Key os_select (std::size_t i) const { return *std::next (set.begin (), i - 1); }
+
+    std::size_t rank (const Key &key) const
+    {
+        return std::distance (set.begin (), set.lower_bound (key));
+    }
+};
+
+template <typename Key> struct pbds_tree
+{
+    using key_type = Key;
+    __gnu_pbds::tree<Key, __gnu_pbds::null_type, std::less<Key>, __gnu_pbds::rb_tree_tag,
+                     __gnu_pbds::tree_order_statistics_node_update>
+        set;
+
+    Key os_select (std::size_t i) const { return *set.find_by_order (i - 1); }
+
+    std::size_t rank (const Key &key) const { return set.order_of_key (key); }
+};
+
+template <typename Key> using avl_set     = my_set<Key, rethinking_stl::avl_tree_engine>;
+template <typename Key> using compact_set = my_set<Key, rethinking_stl::compact_avl_tree_engine>;
+template <typename Key> using btree_set   = my_set<Key, rethinking_stl::btree_engine>;
+
+/* Containers for the queries are built once for every size and distribution. */
+template <typename Container> Container &get_container (const benchmark::State &state)
+{
+    using key_type = typename Container::key_type;
+
+    auto n    = static_cast<std::size_t> (state.range (0));
+    auto dist = static_cast<distribution> (state.range (1));
+
+    static std::map<std::pair<std::size_t, int>, std::unique_ptr<Container>> containers;
+    auto &container = containers[{n, dist}];
+    if ( !container )
+    {
+        container = std::make_unique<Container> ();
+        for ( auto &key : get_workload<key_type> (n, dist).keys )
+            container->set.insert (key);
+    }
+    return *container;
+}
+
+template <typename Container> const auto &get_load (const benchmark::State &state)
+{
+    return get_workload<typename Container::key_type> (static_cast<std::size_t> (state.range (0)),
+                                                       static_cast<distribution> (state.range (1)));
+}
+
+//=================================operations=================================
+
+template <typename Container> void BM_insert (benchmark::State &state)
+{
+    auto &load = get_load<Container> (state);
+
+    for ( auto _ : state )
+    {
+        state.PauseTiming ();
+        auto container = std::make_unique<Container> ();
+        state.ResumeTiming ();
+
+        for ( auto &key : load.keys )
+            container->set.insert (key);
+
+        state.PauseTiming ();
+        container.reset ();
+        state.ResumeTiming ();
+    }
+    state.SetItemsProcessed (state.iterations () * load.keys.size ());
+}
+
+template <typename Container> void BM_erase (benchmark::State &state)
+{
+    auto &load = get_load<Container> (state);
+
+    for ( auto _ : state )
+    {
+        state.PauseTiming ();
+        auto container = std::make_unique<Container> ();
+        for ( auto &key : load.keys )
+            container->set.insert (key);
+        state.ResumeTiming ();
+
+        for ( auto &key : load.erase_order )
+            container->set.erase (key);
+
+        state.PauseTiming ();
+        container.reset ();
+        state.ResumeTiming ();
+    }
+    state.SetItemsProcessed (state.iterations () * load.keys.size ());
+}
+
+template <typename Container> void BM_find (benchmark::State &state)
+{
+    auto &load      = get_load<Container> (state);
+    auto &container = get_container<Container> (state);
+
+    for ( auto _ : state )
+        for ( auto &key : load.queries )
+            benchmark::DoNotOptimize (container.set.find (key) != container.set.end ());
+    state.SetItemsProcessed (state.iterations () * batch_size);
+}
+
+template <typename Container> void BM_lower_bound (benchmark::State &state)
+{
+    auto &load      = get_load<Container> (state);
+    auto &container = get_container<Container> (state);
+
+    for ( auto _ : state )
+        for ( auto &key : load.queries )
+            benchmark::DoNotOptimize (container.set.lower_bound (key) != container.set.end ());
+    state.SetItemsProcessed (state.iterations () * batch_size);
+}
+
+template <typename Container> void BM_upper_bound (benchmark::State &state)
+{
+    auto &load      = get_load<Container> (state);
+    auto &container = get_container<Container> (state);
+
+    for ( auto _ : state )
+        for ( auto &key : load.queries )
+            benchmark::DoNotOptimize (container.set.upper_bound (key) != container.set.end ());
+    state.SetItemsProcessed (state.iterations () * batch_size);
+}
+
+template <typename Container> void BM_os_select (benchmark::State &state)
+{
+    auto &load      = get_load<Container> (state);
+    auto &container = get_container<Container> (state);
+
+    for ( auto _ : state )
+        for ( auto rank : load.ranks )
+            benchmark::DoNotOptimize (container.os_select (rank));
+    state.SetItemsProcessed (state.iterations () * batch_size);
+}
+
+template <typename Container> void BM_get_number_less_then (benchmark::State &state)
+{
+    auto &load      = get_load<Container> (state);
+    auto &container = get_container<Container> (state);
+
+    for ( auto _ : state )
+        for ( auto &key : load.queries )
+            benchmark::DoNotOptimize (container.rank (key));
+    state.SetItemsProcessed (state.iterations () * batch_size);
+}
+
+template <typename Container> void BM_iterate (benchmark::State &state)
+{
+    auto &container = get_container<Container> (state);
+
+    for ( auto _ : state )
+        for ( auto &key : container.set )
+            benchmark::DoNotOptimize (&key);
+    state.SetItemsProcessed (state.iterations () * container.set.size ());
+}
+
+//================================registration================================
+
+void all_sizes (benchmark::internal::Benchmark *bench)
+{
+    bench->ArgNames ({"n", "dist"});
+    for ( int dist : {uniform, sorted, clustered} )
+        for ( int n : {1 << 10, 1 << 14, 1 << 18} )
+            bench->Args ({n, dist});
+}
+
+/* Select and rank walk the std::set iterators in linear time. */
+void linear_sizes (benchmark::internal::Benchmark *bench)
+{
+    bench->ArgNames ({"n", "dist"});
+    for ( int dist : {uniform, sorted, clustered} )
+        for ( int n : {1 << 10, 1 << 14} )
+            bench->Args ({n, dist});
+}
+
+}   // namespace
+
+#define SET_BENCHMARKS(Container, order_statistics_sizes)                                          \
+    BENCHMARK_TEMPLATE (BM_insert, Container)->Apply (all_sizes);                                  \
+    BENCHMARK_TEMPLATE (BM_erase, Container)->Apply (all_sizes);                                   \
+    BENCHMARK_TEMPLATE (BM_find, Container)->Apply (all_sizes);                                    \
+    BENCHMARK_TEMPLATE (BM_lower_bound, Container)->Apply (all_sizes);                             \
+    BENCHMARK_TEMPLATE (BM_upper_bound, Container)->Apply (all_sizes);                             \
+    BENCHMARK_TEMPLATE (BM_os_select, Container)->Apply (order_statistics_sizes);                  \
+    BENCHMARK_TEMPLATE (BM_get_number_less_then, Container)->Apply (order_statistics_sizes);       \
+    BENCHMARK_TEMPLATE (BM_iterate, Container)->Apply (all_sizes)
+
+#define SET_BENCHMARKS_FOR_KEY(Key)                                                                \
+    SET_BENCHMARKS (avl_set<Key>, all_sizes);                                                      \
+    SET_BENCHMARKS (compact_set<Key>, all_sizes);                                                  \
+    SET_BENCHMARKS (btree_set<Key>, all_sizes);                                                    \
+    SET_BENCHMARKS (pbds_tree<Key>, all_sizes);                                                    \
+    SET_BENCHMARKS (std_set<Key>, linear_sizes)
+
+SET_BENCHMARKS_FOR_KEY (int);
+SET_BENCHMARKS_FOR_KEY (std::int64_t);
+SET_BENCHMARKS_FOR_KEY (std::string);
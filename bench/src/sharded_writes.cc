@@ -0,0 +1,83 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <alex.rom23@mail.ru> wrote this file.  As long as you retain this notice you
+ * can do whatever you want with this stuff. If we meet some day, and you think
+ * this stuff is worth it, you can buy me a beer in return.   Alex Romanov
+ * ----------------------------------------------------------------------------
+ */
+
+// Inserts and erases of random keys from many threads: the tree behind a mutex and the key
+// range sharded set.
+
+#include "myset.hpp"
+#include "sharded_set.hpp"
+#include <benchmark/benchmark.h>
+#include <mutex>
+#include <random>
+
+namespace
+{
+
+constexpr int tree_size = 1 << 20;
+
+/* Even keys are in the set, writers insert and erase odd ones, so the size stays the same. */
+template <typename Set> void fill (Set &set)
+{
+    for ( int i = 0; i < tree_size; i++ )
+        set.insert (2 * i);
+}
+
+struct mutex_tree
+{
+    rethinking_stl::set<int> tree;
+    std::mutex mutex;
+
+    mutex_tree () { fill (tree); }
+
+    void insert (int key)
+    {
+        std::lock_guard lock (mutex);
+        tree.insert (key);
+    }
+
+    void erase (int key)
+    {
+        std::lock_guard lock (mutex);
+        tree.erase (key);
+    }
+};
+
+template <std::size_t Capacity> struct sharded_tree
+{
+    rethinking_stl::sharded_order_statistic_set<int> tree {Capacity};
+
+    sharded_tree () { fill (tree); }
+
+    void insert (int key) { tree.insert (key); }
+
+    void erase (int key) { tree.erase (key); }
+};
+
+template <typename Container> void BM_writes (benchmark::State &state)
+{
+    /* Built by the first thread, the others wait for the initialization of the static. */
+    static Container container;
+
+    std::mt19937 gen (static_cast<unsigned> (state.thread_index ()) + 1);
+    std::uniform_int_distribution<int> key_dist (0, tree_size - 1);
+
+    for ( auto _ : state )
+    {
+        auto key = 2 * key_dist (gen) + 1;
+        container.insert (key);
+        container.erase (key);
+    }
+    state.SetItemsProcessed (state.iterations () * 2);
+}
+
+}   // namespace
+
+BENCHMARK_TEMPLATE (BM_writes, mutex_tree)->ThreadRange (1, 32)->UseRealTime ();
+BENCHMARK_TEMPLATE (BM_writes, sharded_tree<1 << 12>)->ThreadRange (1, 32)->UseRealTime ();
+BENCHMARK_TEMPLATE (BM_writes, sharded_tree<1 << 16>)->ThreadRange (1, 32)->UseRealTime ();
@@ -0,0 +1,74 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <alex.rom23@mail.ru> wrote this file.  As long as you retain this notice you
+ * can do whatever you want with this stuff. If we meet some day, and you think
+ * this stuff is worth it, you can buy me a beer in return.   Alex Romanov
+ * ----------------------------------------------------------------------------
+ */
+
+// Updates of the mutable tree and of the persistent set, and of the persistent set which takes
+// a snapshot every N updates and keeps the last one.
+
+#include "myset.hpp"
+#include "persistent_set.hpp"
+#include <benchmark/benchmark.h>
+#include <optional>
+#include <random>
+
+namespace
+{
+
+constexpr int tree_size = 1 << 20;
+
+/* Even keys are in the set, odd ones are inserted and erased, so the size stays the same. */
+template <typename Set> void fill (Set &set)
+{
+    for ( int i = 0; i < tree_size; i++ )
+        set.insert (2 * i);
+}
+
+using persistent_set = rethinking_stl::persistent_order_statistic_set<int>;
+
+template <typename Set> void BM_updates (benchmark::State &state)
+{
+    Set set;
+    fill (set);
+
+    std::mt19937 gen (1);
+    std::uniform_int_distribution<int> key_dist (0, tree_size - 1);
+    for ( auto _ : state )
+    {
+        auto key = 2 * key_dist (gen) + 1;
+        set.insert (key);
+        set.erase (key);
+    }
+    state.SetItemsProcessed (state.iterations () * 2);
+}
+
+void BM_updates_with_snapshots (benchmark::State &state)
+{
+    persistent_set set;
+    fill (set);
+    std::optional<persistent_set::version> last;
+
+    std::mt19937 gen (1);
+    std::uniform_int_distribution<int> key_dist (0, tree_size - 1);
+    std::int64_t updates = 0;
+    for ( auto _ : state )
+    {
+        auto key = 2 * key_dist (gen) + 1;
+        set.insert (key);
+        set.erase (key);
+        if ( (updates += 2) % state.range (0) == 0 )
+            last = set.snapshot ();
+    }
+    state.SetItemsProcessed (state.iterations () * 2);
+    state.counters["nodes/key"] = static_cast<double> (set.nodes ()) / set.size ();
+}
+
+}   // namespace
+
+BENCHMARK_TEMPLATE (BM_updates, rethinking_stl::set<int>);
+BENCHMARK_TEMPLATE (BM_updates, persistent_set);
+BENCHMARK (BM_updates_with_snapshots)->RangeMultiplier (16)->Range (16, 1 << 16);
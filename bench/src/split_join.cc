@@ -0,0 +1,63 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <alex.rom23@mail.ru> wrote this file.  As long as you retain this notice you
+ * can do whatever you want with this stuff. If we meet some day, and you think
+ * this stuff is worth it, you can buy me a beer in return.   Alex Romanov
+ * ----------------------------------------------------------------------------
+ */
+
+// Moving the upper half of a tree of n keys to another tree and back: rebuild from the keys
+// against split_at_rank and join.
+
+#include "myset.hpp"
+#include <benchmark/benchmark.h>
+#include <vector>
+
+namespace
+{
+
+using tree_type = rethinking_stl::set<int>;
+
+tree_type make_tree (std::size_t n)
+{
+    std::vector<int> keys;
+    for ( std::size_t i = 0; i < n; i++ )
+        keys.push_back (static_cast<int> (i));
+    return tree_type (keys.begin (), keys.end ());
+}
+
+void BM_rebuild (benchmark::State &state)
+{
+    auto tree = make_tree (static_cast<std::size_t> (state.range (0)));
+
+    for ( auto _ : state )
+    {
+        /* What the partitions did before: copy the keys out and build both trees anew. */
+        std::vector<int> keys (tree.begin (), tree.end ());
+        auto middle = keys.begin () + static_cast<std::ptrdiff_t> (keys.size () / 2);
+        tree_type upper;
+        upper.assign (middle, keys.end ());
+        tree.assign (keys.begin (), middle);
+        benchmark::DoNotOptimize (upper.size ());
+
+        tree.insert_sorted_batch (upper.begin (), upper.end ());
+    }
+}
+
+void BM_split_join (benchmark::State &state)
+{
+    auto tree = make_tree (static_cast<std::size_t> (state.range (0)));
+
+    for ( auto _ : state )
+    {
+        auto upper = tree.split_at_rank (tree.size () / 2);
+        benchmark::DoNotOptimize (upper.size ());
+        tree.join (upper);
+    }
+}
+
+}   // namespace
+
+BENCHMARK (BM_rebuild)->RangeMultiplier (16)->Range (1 << 10, 1 << 22);
+BENCHMARK (BM_split_join)->RangeMultiplier (16)->Range (1 << 10, 1 << 22);
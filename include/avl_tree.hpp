@@ -12,14 +12,29 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <cassert>
 #include <cstddef>
+#include <cstdint>
 #include <fstream>
+#include <future>
+#include <initializer_list>
 #include <iostream>
 #include <iterator>
 #include <memory>
+#include <numeric>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <thread>
 #include <tuple>
+#include <type_traits>
 #include <utility>
+#include <vector>
+
+#include "node_pool.hpp"
+#include "tree_stats.hpp"
 
 namespace rethinking_stl
 {
@@ -32,13 +47,13 @@ template <typename Val_> struct do_avl_tree_node_
     using size_type     = std::size_t;
     using node_ptr_     = do_avl_tree_node_<Val_> *;
     using self_         = do_avl_tree_node_<Val_>;
-    using owning_ptr_   = typename std::unique_ptr<self_>;
 
-    height_diff_t m_bf_  = 0;
-    size_type m_size_    = 1;
-    node_ptr_ m_parent_  = nullptr;
-    owning_ptr_ m_left_  = nullptr;
-    owning_ptr_ m_right_ = nullptr;
+    /* Children are owned by the node pool of the tree, not by the node itself. */
+    height_diff_t m_bf_ = 0;
+    size_type m_size_   = 1;
+    node_ptr_ m_parent_ = nullptr;
+    node_ptr_ m_left_   = nullptr;
+    node_ptr_ m_right_  = nullptr;
     value_type m_key_;
 
     do_avl_tree_node_ (value_type val_) : m_key_ {val_} {}
@@ -46,9 +61,9 @@ template <typename Val_> struct do_avl_tree_node_
 
     static size_type size (node_ptr_ node_) { return (node_ ? node_->m_size_ : 0); }
 
-    node_ptr_ m_left () noexcept { return m_left_.get (); }
+    node_ptr_ m_left () noexcept { return m_left_; }
 
-    node_ptr_ m_right () noexcept { return m_right_.get (); }
+    node_ptr_ m_right () noexcept { return m_right_; }
 
     node_ptr_ m_minimum_ () noexcept
     {
@@ -66,10 +81,6 @@ template <typename Val_> struct do_avl_tree_node_
         return x_;
     }
 
-    node_ptr_ m_predecessor_for_erase_ () noexcept;
-
-    node_ptr_ m_successor_for_erase_ () noexcept;
-
     node_ptr_ dynamic_order_avl_tree_increment_ () noexcept;
     node_ptr_ dynamic_order_avl_tree_decrement_ () noexcept;
 
@@ -110,16 +121,80 @@ template <class Compare_> struct do_avl_tree_key_compare_
     }
 };
 
+// Height of perfectly balanced tree with n_ nodes.
+inline int perfect_tree_height_ (std::size_t n_) noexcept
+{
+    int height_ = 0;
+    for ( ; n_; n_ >>= 1 )
+        height_++;
+    return height_;
+}
+
+/*
+ * Call build_ (first, n) with n strictly increasing keys of [first_, last_). Already sorted
+ * forward ranges are passed as is, otherwise keys are sorted and deduplicated in a buffer.
+ */
+template <typename Key_, typename It_, typename Compare_, typename Build_>
+void with_sorted_unique_range_ (It_ first_, It_ last_, Compare_ comp_, Build_ build_)
+{
+    using category_ = typename std::iterator_traits<It_>::iterator_category;
+
+    if constexpr ( std::is_base_of_v<std::forward_iterator_tag, category_> )
+    {
+        auto not_increasing_ = [&comp_] (const auto &k1_, const auto &k2_) {
+            return !comp_ (k1_, k2_);
+        };
+        if ( std::adjacent_find (first_, last_, not_increasing_) == last_ )
+        {
+            build_ (first_, static_cast<std::size_t> (std::distance (first_, last_)));
+            return;
+        }
+    }
+
+    std::vector<Key_> keys_ (first_, last_);
+    std::sort (keys_.begin (), keys_.end (), comp_);
+
+    /* Sorted keys are equivalent iff the first one is not less then the second. */
+    auto equivalent_ = [&comp_] (const Key_ &k1_, const Key_ &k2_) { return !comp_ (k1_, k2_); };
+    keys_.erase (std::unique (keys_.begin (), keys_.end (), equivalent_), keys_.end ());
+
+    build_ (keys_.cbegin (), keys_.size ());
+}
+
+/*
+ * Indices of the batch of n_ queries sorted by comp_. Batched queries walk the tree with the
+ * sorted batch and split it at every node, so each node is visited once per batch.
+ */
+template <typename Compare_>
+std::vector<std::size_t> sorted_batch_order_ (std::size_t n_, Compare_ comp_)
+{
+    std::vector<std::size_t> order_ (n_);
+    std::iota (order_.begin (), order_.end (), std::size_t {0});
+    std::sort (order_.begin (), order_.end (), comp_);
+    return order_;
+}
+
+// Hint the cache about the node which is going to be visited soon.
+template <typename Node_> inline void prefetch_node_ (const Node_ *node_) noexcept
+{
+#if defined(__GNUC__) || defined(__clang__)
+    /* Node may cross the cache line boundary, links and key are at its end. */
+    __builtin_prefetch (node_);
+    __builtin_prefetch (reinterpret_cast<const char *> (node_ + 1) - 1);
+#else
+    (void)node_;
+#endif
+}
+
 // Helper type to manage deafault initialization of node count and header.
 template <typename Val_> struct do_avl_tree_header_
 {
-    using node_ptr_   = typename do_avl_tree_node_<Val_>::node_ptr_;
-    using owning_ptr_ = typename do_avl_tree_node_<Val_>::owning_ptr_;
-    using node_       = do_avl_tree_node_<Val_>;
+    using node_ptr_ = typename do_avl_tree_node_<Val_>::node_ptr_;
+    using node_     = do_avl_tree_node_<Val_>;
 
-    owning_ptr_ m_header_  = nullptr;
-    node_ptr_ m_leftmost_  = nullptr;
-    node_ptr_ m_rightmost_ = nullptr;
+    std::unique_ptr<node_> m_header_ = nullptr;
+    node_ptr_ m_leftmost_            = nullptr;
+    node_ptr_ m_rightmost_           = nullptr;
 
     do_avl_tree_header_ ()
     {
@@ -127,30 +202,49 @@ template <typename Val_> struct do_avl_tree_header_
         m_reset_ ();
     }
 
+    /* Only forgets the tree, nodes themselves are released by the node pool. */
     void m_reset_ () noexcept
     {
         m_header_->m_parent_ = nullptr;
+        m_header_->m_left_   = nullptr;
         m_leftmost_          = nullptr;
         m_rightmost_         = nullptr;
-        /* delete tree of unique pointers if any*/
-        m_header_->m_left_.release ();
+    }
+
+    void swap (do_avl_tree_header_ &other_) noexcept
+    {
+        std::swap (m_header_, other_.m_header_);
+        std::swap (m_leftmost_, other_.m_leftmost_);
+        std::swap (m_rightmost_, other_.m_rightmost_);
     }
 };
 
+// Read only snapshot of the set, see frozen_set.hpp.
+template <typename Key_, typename Compare_, typename Allocator_> class frozen_order_statistic_set;
+
 //=================================dynamic_order_avl_tree_=======================================
-template <typename Key_, class Compare_ = std::less<Key_>> struct dynamic_order_avl_tree_
+/*
+ * Stats_ is the statistics policy: no_tree_stats compiles every counter away, tree_stats counts
+ * comparisons, descents, rotations and backtracks of the hot paths and enables stats ().
+ */
+template <typename Key_, class Compare_ = std::less<Key_>, class Allocator_ = std::allocator<Key_>,
+          class Stats_ = no_tree_stats>
+struct dynamic_order_avl_tree_
 {
     using key_compare_ = do_avl_tree_key_compare_<Compare_>;
     using header_      = do_avl_tree_header_<Key_>;
-    using self_        = dynamic_order_avl_tree_<Key_, Compare_>;
+    using self_        = dynamic_order_avl_tree_<Key_, Compare_, Allocator_, Stats_>;
 
-    using node_ptr_   = typename do_avl_tree_node_<Key_>::node_ptr_;
-    using owning_ptr_ = typename do_avl_tree_node_<Key_>::owning_ptr_;
+    using node_ptr_ = typename do_avl_tree_node_<Key_>::node_ptr_;
 
-    using node_ = do_avl_tree_node_<Key_>;
+    using node_      = do_avl_tree_node_<Key_>;
+    using node_pool_ = rethinking_stl::node_pool_<node_, Allocator_>;
 
     key_compare_ m_compare_struct_;
     header_ m_header_struct_;
+    node_pool_ m_node_pool_;
+    /* Queries are const, but they are counted too. */
+    [[no_unique_address]] mutable Stats_ m_stats_;
 
     struct do_avl_tree_iterator_
     {
@@ -219,6 +313,7 @@ template <typename Key_, class Compare_ = std::less<Key_>> struct dynamic_order_
 
     using iterator         = do_avl_tree_iterator_;
     using reverse_iterator = std::reverse_iterator<iterator>;
+    using allocator_type   = Allocator_;
 
     using size_type     = typename node_::size_type;
     using height_diff_t = typename node_::height_diff_t;
@@ -240,9 +335,328 @@ template <typename Key_, class Compare_ = std::less<Key_>> struct dynamic_order_
 
     static value_type &s_key_ (node_ptr_ node_) { return static_cast<node_ptr_> (node_)->m_key_; }
 
+    // Destroy keys of all nodes in subtree. Memory itself is released by the node pool.
+    void m_destroy_subtree_ (node_ptr_ node_) noexcept;
+
+    // Destroy all nodes of subtree and give them back to the node pool one by one.
+    void m_free_subtree_ (node_ptr_ node_) noexcept;
+
+    // Build perfectly balanced subtree of n_ strictly increasing keys starting from first_.
+    template <typename It_> node_ptr_ m_build_subtree_ (It_ &first_, size_type n_);
+
+    // Hang the subtree under the header and find leftmost and rightmost nodes.
+    void m_set_root_ (node_ptr_ root_) noexcept
+    {
+        auto header_     = m_header_struct_.m_header_.get ();
+        header_->m_left_ = root_;
+        if ( !root_ )
+        {
+            m_begin_ () = m_end_ () = nullptr;
+            m_stats_.m_reset_sizes_ ();
+            return;
+        }
+
+        root_->m_parent_ = header_;
+        m_begin_ ()      = root_->m_minimum_ ();
+        m_end_ ()        = root_->m_maximum_ ();
+        m_stats_.m_forget_sizes_ ();
+    }
+
+    // Depth of the node, the root is at depth 0.
+    static size_type s_depth_ (node_ptr_ node_) noexcept
+    {
+        size_type depth_ = 0;
+        for ( ; node_->m_parent_->m_parent_; node_ = node_->m_parent_ )
+            depth_++;
+        return depth_;
+    }
+
+    // Sum of subtree sizes for the statistics after the tree is rebuilt, linear in its size.
+    std::uint64_t m_sum_sizes_ () const noexcept
+    {
+        std::uint64_t sum_ = 0;
+        for ( auto pos_ = begin (); pos_ != end (); ++pos_ )
+            sum_ += pos_.m_node_->m_size_;
+        return sum_;
+    }
+
+    /*
+     * Call the fix_ method of the node with balance factor about to become -2 or 2. Rotations
+     * change only the sizes of the rotated nodes, so the sum of sizes is updated by them.
+     */
+    node_ptr_ m_fix_imbalance_ (node_ptr_ node_, node_ptr_ (node_::*fix_) ())
+    {
+        if constexpr ( !Stats_::enabled )
+            return (node_->*fix_) ();
+        else
+        {
+            bool left_heavy_ = node_->m_bf_ < 0;
+            auto child_      = (left_heavy_ ? node_->m_left_ : node_->m_right_);
+            bool double_     = (left_heavy_ ? child_->m_bf_ > 0 : child_->m_bf_ < 0);
+            auto inner_      = (left_heavy_ ? child_->m_right_ : child_->m_left_);
+
+            auto sum_ = [&] () {
+                auto res_ = node_->m_size_ + child_->m_size_;
+                return static_cast<std::int64_t> (double_ ? res_ + inner_->m_size_ : res_);
+            };
+
+            auto before_ = sum_ ();
+            auto res_    = (node_->*fix_) ();
+            m_stats_.m_rotation_ (double_);
+            m_stats_.m_add_sizes_ (sum_ () - before_);
+            return res_;
+        }
+    }
+
+    // Replace the contents of empty tree with n_ strictly increasing keys.
+    template <typename It_> void m_build_ (It_ first_, size_type n_)
+    {
+        auto root_ = m_build_subtree_ (first_, n_);
+        if ( root_ )
+            m_set_root_ (root_);
+    }
+
+    /*
+     * Join based algorithms. Subtrees are detached from the header and carry their height, so
+     * heights of the children are restored from the balance factors without extra memory.
+     * Parent link of the returned root is left as is and has to be set by the caller.
+     */
+    struct subtree_
+    {
+        node_ptr_ m_root_ = nullptr;
+        int m_height_     = 0;
+    };
+
+    // Height of the subtree by descent along the higher children.
+    static int s_height_ (node_ptr_ node_) noexcept;
+
+    // Make node_ the root of left_ and right_ as is.
+    static subtree_ s_make_ (subtree_ left_, node_ptr_ node_, subtree_ right_) noexcept;
+
+    // Return children of the root with their heights.
+    static std::pair<subtree_, subtree_> s_expose_ (subtree_ tree_) noexcept;
+
+    static subtree_ s_rotate_left_ (subtree_ tree_) noexcept;
+    static subtree_ s_rotate_right_ (subtree_ tree_) noexcept;
+
+    // Make node_ the root of left_ and right_ with heights differing at most by two and
+    // restore balance with single or double rotation.
+    static subtree_ s_link_ (subtree_ left_, node_ptr_ node_, subtree_ right_) noexcept;
+
+    static subtree_ s_join_right_ (subtree_ left_, node_ptr_ node_, subtree_ right_) noexcept;
+    static subtree_ s_join_left_ (subtree_ left_, node_ptr_ node_, subtree_ right_) noexcept;
+
+    // Balanced tree of keys of left_, node_ and right_ in O(|h(left_) - h(right_)| + 1).
+    // All keys of left_ have to be less then the key of node_ and keys of right_ greater.
+    static subtree_ s_join_ (subtree_ left_, node_ptr_ node_, subtree_ right_) noexcept;
+
+    // Split tree_ into keys less then key_, node with key_ (nullptr if none) and greater keys.
+    std::tuple<subtree_, node_ptr_, subtree_> m_split_ (subtree_ tree_, const value_type &key_);
+
+    /*
+     * Nodes dropped by the set operations, linked through their parent pointers. The running
+     * tasks only collect them, the pool frees them on the calling thread afterwards.
+     */
+    struct drop_list_
+    {
+        node_ptr_ m_first_ = nullptr;
+        node_ptr_ m_last_  = nullptr;
+
+        // Drop the node together with its subtree.
+        void m_push_ (node_ptr_ node_) noexcept
+        {
+            node_->m_parent_ = m_first_;
+            m_first_         = node_;
+            m_last_          = (m_last_ ? m_last_ : node_);
+        }
+
+        // Drop the node alone, its children stay in the tree.
+        void m_push_node_ (node_ptr_ node_) noexcept
+        {
+            node_->m_left_ = node_->m_right_ = nullptr;
+            m_push_ (node_);
+        }
+
+        void m_append_ (drop_list_ other_) noexcept
+        {
+            if ( !other_.m_first_ )
+                return;
+            other_.m_last_->m_parent_ = m_first_;
+            m_first_                  = other_.m_first_;
+            m_last_                   = (m_last_ ? m_last_ : other_.m_last_);
+        }
+    };
+
+    /* Trees smaller then this are not worth another task. */
+    static constexpr size_type s_parallel_grain_ = size_type {1} << 14;
+
+    // Threads the set operations may start besides the calling one. A task gives its thread
+    // back when it ends, so the later forks of uneven splits keep all threads_ busy without
+    // running more of them at a time.
+    using spare_threads_ = std::atomic<unsigned>;
+
+    static bool s_take_thread_ (spare_threads_ &spare_) noexcept
+    {
+        auto free_ = spare_.load (std::memory_order_relaxed);
+        while ( free_ && !spare_.compare_exchange_weak (free_, free_ - 1) )
+        {
+        }
+        return free_;
+    }
+
+    // Run both halves of the recursion, the second one as another task if there is a spare
+    // thread and the trees are big enough.
+    template <typename Left_, typename Right_>
+    static auto s_fork_ (spare_threads_ &spare_, size_type size_, Left_ left_, Right_ right_)
+    {
+        if ( size_ >= s_parallel_grain_ && s_take_thread_ (spare_) )
+        {
+            auto run_ = [&spare_, &right_] {
+                struct give_back_
+                {
+                    spare_threads_ &m_spare_;
+                    ~give_back_ () { m_spare_.fetch_add (1); }
+                } give_back_ {spare_};
+                return right_ ();
+            };
+
+            std::future<decltype (right_ ())> task_;
+            try
+            {
+                task_ = std::async (std::launch::async, run_);
+            }
+            catch ( ... )
+            {
+                /* No thread for the task, it runs here. */
+                spare_.fetch_add (1);
+            }
+            if ( task_.valid () )
+            {
+                auto res_ = left_ ();
+                return std::pair (res_, task_.get ());
+            }
+        }
+
+        auto res_ = left_ ();
+        return std::pair (res_, right_ ());
+    }
+
+    // Call task_ (i, first, last) for the i_th of the equal ranges of ranks [first, last) the
+    // keys are cut into, each range but the first as another task. Ranges are at least
+    // s_parallel_grain_ keys, there is one range per thread at most.
+    template <typename Task_> void m_for_each_range_ (unsigned threads_, Task_ task_) const
+    {
+        auto size_  = size ();
+        auto count_ = std::clamp<size_type> (size_ / s_parallel_grain_, 1, std::max (threads_, 1u));
+        auto first_ = [size_, count_] (size_type i) {
+            return size_ / count_ * i + std::min (i, size_ % count_);
+        };
+
+        std::vector<std::future<void>> tasks_;
+        tasks_.reserve (count_);
+        for ( size_type i = 1; i < count_; i++ )
+        {
+            try
+            {
+                tasks_.push_back (
+                    std::async (std::launch::async, task_, i, first_ (i), first_ (i + 1)));
+            }
+            catch ( ... )
+            {
+                /* No thread for the task, it runs here. */
+                task_ (i, first_ (i), first_ (i + 1));
+            }
+        }
+
+        task_ (size_type {0}, first_ (0), first_ (1));
+        for ( auto &task : tasks_ )
+            task.get ();
+    }
+
+    // Call visit_ for the keys with ranks [first_, last_) in order. The walk keeps the ancestors
+    // to come back to on its own stack instead of climbing the parent links.
+    template <typename Visit_>
+    void m_walk_ (size_type first_, size_type last_, Visit_ &visit_) const
+    {
+        if ( first_ >= last_ )
+            return;
+
+        auto count_ = last_ - first_;
+        std::vector<node_ptr_> stack_;
+        stack_.reserve (static_cast<std::size_t> (s_height_ (m_root_ ())));
+
+        /* Descend to the first key and keep the nodes where the walk turned left. */
+        for ( auto node_ = m_root_ (); node_; )
+        {
+            auto left_size_ = node_::size (node_->m_left_);
+            if ( first_ <= left_size_ )
+                stack_.push_back (node_);
+            if ( first_ == left_size_ )
+                break;
+
+            if ( first_ < left_size_ )
+                node_ = node_->m_left_;
+            else
+            {
+                first_ -= left_size_ + 1;
+                node_   = node_->m_right_;
+            }
+        }
+
+        for ( ; count_; count_-- )
+        {
+            auto node_ = stack_.back ();
+            stack_.pop_back ();
+            visit_ (static_cast<const value_type &> (s_key_ (node_)));
+            for ( auto child_ = node_->m_right_; child_; child_ = child_->m_left_ )
+                stack_.push_back (child_);
+        }
+    }
+
+    // Free the dropped subtrees.
+    void m_free_ (drop_list_ dropped_) noexcept;
+
+    // Union of the trees in O(m log (n / m + 1)) for m <= n. Nodes of batch_ with keys already
+    // present in tree_ are dropped, so nodes of tree_ and iterators to them stay valid.
+    subtree_ m_union_ (subtree_ tree_, subtree_ batch_, spare_threads_ &spare_,
+                       drop_list_ &dropped_);
+
+    // Keys of tree_ which are (not) present in other_, the other nodes of tree_ are dropped.
+    // other_ is only read.
+    template <bool Keep_>
+    subtree_ m_filter_ (subtree_ tree_, subtree_ other_, spare_threads_ &spare_,
+                        drop_list_ &dropped_);
+
+    // Join of two trees without a middle node.
+    static subtree_ s_join2_ (subtree_ left_, subtree_ right_) noexcept;
+
+    // Split tree_ into its k_ smallest keys and the rest.
+    static std::pair<subtree_, subtree_> s_split_at_rank_ (subtree_ tree_, size_type k_) noexcept;
+
   public:
     dynamic_order_avl_tree_ () : m_compare_struct_ (Compare_ {}), m_header_struct_ () {}
-    dynamic_order_avl_tree_ (const Compare_ &comp_) : m_compare_struct_ (comp_), m_header_struct_ ()
+    dynamic_order_avl_tree_ (const Compare_ &comp_, const Allocator_ &alloc_ = Allocator_ ())
+        : m_compare_struct_ (comp_), m_header_struct_ (), m_node_pool_ (alloc_)
+    {
+    }
+
+    explicit dynamic_order_avl_tree_ (const Allocator_ &alloc_)
+        : m_compare_struct_ (Compare_ {}), m_header_struct_ (), m_node_pool_ (alloc_)
+    {
+    }
+
+    template <std::input_iterator It_>
+    dynamic_order_avl_tree_ (It_ first_, It_ last_, const Compare_ &comp_ = Compare_ (),
+                             const Allocator_ &alloc_ = Allocator_ ())
+        : dynamic_order_avl_tree_ (comp_, alloc_)
+    {
+        assign (first_, last_);
+    }
+
+    dynamic_order_avl_tree_ (std::initializer_list<value_type> keys_,
+                             const Compare_ &comp_ = Compare_ (),
+                             const Allocator_ &alloc_ = Allocator_ ())
+        : dynamic_order_avl_tree_ (keys_.begin (), keys_.end (), comp_, alloc_)
     {
     }
 
@@ -250,11 +664,34 @@ template <typename Key_, class Compare_ = std::less<Key_>> struct dynamic_order_
     self_ &operator= (const self_ &other)        = delete;
 
     dynamic_order_avl_tree_ (self_ &&other) noexcept
-        : m_compare_struct_ (std::move (other.m_compare_struct_.m_key_compare_))
+        : m_compare_struct_ (std::move (other.m_compare_struct_.m_key_compare_)),
+          m_node_pool_ (std::move (other.m_node_pool_)), m_stats_ (std::move (other.m_stats_))
+    {
+        m_header_struct_.swap (other.m_header_struct_);
+        other.m_stats_ = Stats_ ();
+    }
+
+    self_ &operator= (self_ &&other) noexcept
     {
-        m_header_struct_.m_header_ = std::move (other.m_header_struct_.m_header_);
-        std::swap (m_header_struct_.m_leftmost_, other.m_header_struct_.m_leftmost_);
-        std::swap (m_header_struct_.m_rightmost_, other.m_header_struct_.m_rightmost_);
+        std::swap (m_compare_struct_.m_key_compare_, other.m_compare_struct_.m_key_compare_);
+        m_header_struct_.swap (other.m_header_struct_);
+        m_node_pool_.swap (other.m_node_pool_);
+        std::swap (m_stats_, other.m_stats_);
+        return *this;
+    }
+
+    ~dynamic_order_avl_tree_ () { clear (); }
+
+    allocator_type get_allocator () const noexcept
+    {
+        return allocator_type (m_node_pool_.get_allocator ());
+    }
+
+    // Read only copy of the set for query heavy phases. Needs frozen_set.hpp.
+    frozen_order_statistic_set<Key_, Compare_, Allocator_> freeze () const
+    {
+        return frozen_order_statistic_set<Key_, Compare_, Allocator_> (
+            begin (), end (), m_compare_struct_.m_key_compare_, get_allocator ());
     }
 
     // Accessors.
@@ -275,76 +712,199 @@ template <typename Key_, class Compare_ = std::less<Key_>> struct dynamic_order_
 
     bool empty () const noexcept { return (size () == 0); }
 
-    template <typename F>
-    std::tuple<node_ptr_, node_ptr_, bool> m_trav_bin_search_ (value_type key_, F step_);
+    // Descend to the node with key_. Return it (nullptr if there is no such node), the last
+    // visited node and whether key_ is less then the key of the last visited node.
+    std::tuple<node_ptr_, node_ptr_, bool> m_trav_bin_search_ (const value_type &key_) const;
 
     // Insert/erase.
 
   private:
-    // Insert node in AVL tree without rebalancing.
-    node_ptr_ m_insert_node_ (owning_ptr_ to_insert_);
+    // Insert node in AVL tree without rebalancing. Return the node with the same key if any.
+    std::pair<node_ptr_, bool> m_insert_node_ (const value_type &key_);
 
     // create node, insert and rebalance tree
-    iterator m_insert_ (const value_type &key_)
+    std::pair<iterator, bool> m_insert_ (const value_type &key_)
     {
-        auto to_insert_             = new node_ (key_);
-        auto to_insert_base_unique_ = owning_ptr_ (static_cast<node_ptr_> (to_insert_));
-
-        auto res = m_insert_node_ (std::move (to_insert_base_unique_));
-        m_rebalance_after_insert_ (res);
+        auto [res, inserted] = m_insert_node_ (key_);
+        if ( inserted )
+        {
+            /* The new leaf and all its ancestors grow by one. */
+            if constexpr ( Stats_::enabled )
+                m_stats_.m_add_sizes_ (static_cast<std::int64_t> (s_depth_ (res) + 1));
+            m_rebalance_after_insert_ (res);
+        }
 
-        return iterator (res, this);
+        return {iterator (res, this), inserted};
     }
 
-    // Rebalance subtree after insert.
+    // Update sizes on the way to the root and rebalance subtree after insert.
     void m_rebalance_after_insert_ (node_ptr_ leaf_);
 
-    node_ptr_ m_erase_pos_ (iterator to_erase_pos_) { return m_erase_pos_impl_ (to_erase_pos_); }
+    void m_erase_pos_ (iterator to_erase_pos_) { m_erase_pos_impl_ (to_erase_pos_); }
 
     // Rebalance tree for erase.
     void m_rebalance_for_erase_ (node_ptr_ node_);
 
     // erase node from the container.
-    node_ptr_ m_erase_pos_impl_ (iterator pos_);
+    void m_erase_pos_impl_ (iterator pos_);
 
   public:
     iterator find (const value_type &key_)
     {
-        auto [found, prev, prev_greater] = m_trav_bin_search_ (key_, [] (node_ptr_ &) {});
+        auto [found, prev, prev_greater] = m_trav_bin_search_ (key_);
         return iterator (found, this);
     }
 
-    iterator m_find_for_erase_ (const value_type &key_)
+    // Return the position of the key and false if it's already inserted.
+    std::pair<iterator, bool> insert (const value_type &key_) { return m_insert_ (key_); }
+
+    // Return number of erased elements.
+    size_type erase (const value_type &key_)
     {
-        auto [found, prev, prev_greater] =
-            m_trav_bin_search_ (key_, [] (node_ptr_ &node_) { node_->m_size_--; });
-        auto node_ = found;
+        auto [found, prev, prev_greater] = m_trav_bin_search_ (key_);
+        if ( !found )
+            return 0;
 
-        if ( node_ )
-            return iterator (node_, this);
+        m_erase_pos_ (iterator (found, this));
+        return 1;
+    }
 
-        m_trav_bin_search_ (key_, [] (node_ptr_ &node_) { node_->m_size_++; });
-        throw std::out_of_range ("No element with requested key for erase.");
+    void erase (iterator pos_)
+    {
+        if ( pos_ != end () )
+            m_erase_pos_ (pos_);
+    }
+
+    /*
+     * Insert keys of the range in O(m log (n / m + 1)) instead of O(m log n) for m keys by
+     * union with the balanced tree built of the batch. Unsorted ranges are sorted first.
+     * Return number of inserted keys.
+     */
+    template <typename It_> size_type insert_sorted_batch (It_ first_, It_ last_)
+    {
+        auto old_size_ = size ();
+        with_sorted_unique_range_<value_type> (
+            first_, last_, m_compare_struct_.m_key_compare_, [this] (auto sorted_, size_type n_) {
+                /* All nodes are created before the tree is touched, union itself can't throw
+                 * unless the comparator does. */
+                auto batch_ = subtree_ {m_build_subtree_ (sorted_, n_), perfect_tree_height_ (n_)};
+                auto tree_  = subtree_ {m_root_ (), s_height_ (m_root_ ())};
+                drop_list_ dropped_;
+                spare_threads_ spare_ (0);
+                m_set_root_ (m_union_ (tree_, batch_, spare_, dropped_).m_root_);
+                m_free_ (dropped_);
+            });
+        return size () - old_size_;
+    }
+
+    // Replace the contents with the keys of the range in linear time if it's sorted.
+    template <typename It_> void assign (It_ first_, It_ last_)
+    {
+        clear ();
+        with_sorted_unique_range_<value_type> (
+            first_, last_, m_compare_struct_.m_key_compare_,
+            [this] (auto sorted_, size_type n_) { m_build_ (sorted_, n_); });
     }
 
-    iterator insert (const value_type &key_) { return m_insert_ (key_); }
+    /*
+     * Split and join in O(log n). Nodes are relinked, not copied, so iterators stay valid and
+     * point into the tree which keeps the key afterwards. Split and joined trees share the slabs
+     * of their node pools and reuse the nodes freed by each other, the slabs go back to the
+     * allocator with the last of them.
+     */
+    // Keep the keys less then key_ and return the tree of the others.
+    self_ split (const value_type &key_);
+
+    // Keep the k_ smallest keys and return the tree of the others.
+    self_ split_at_rank (size_type k_);
+
+    // Move all keys of other_ here and leave it empty. Keys of other_ have to be all greater or
+    // all less then the keys of the tree, otherwise std::invalid_argument is thrown. Trees have
+    // to use equal allocators.
+    void join (self_ &other_);
+
+    /*
+     * Set algebra by split and join in O(m log (n / m + 1)) for trees of m <= n keys. Halves
+     * of the recursion run as parallel tasks on at most threads_ threads at a time. Nodes of
+     * the tree and iterators to its remaining keys stay valid. Trees have to use equal
+     * allocators, the comparator has to be safe to call from several threads.
+     */
+    // Move the keys of other_ which are not here yet into the tree and leave other_ empty.
+    void set_union (self_ &other_, unsigned threads_ = std::thread::hardware_concurrency ());
+
+    // Keep the keys which are present in other_ too.
+    void set_intersection (const self_ &other_,
+                           unsigned threads_ = std::thread::hardware_concurrency ());
+
+    // Erase the keys which are present in other_.
+    void set_difference (const self_ &other_,
+                         unsigned threads_ = std::thread::hardware_concurrency ());
 
-    bool erase (const value_type &key_)
+    /*
+     * Walks of the whole tree on up to threads_ threads. Subtree sizes cut the keys into equal
+     * ranges of ranks, each range is walked by its own task. The tree must not be changed
+     * meanwhile.
+     */
+    // Call func_ for every key. Ranges are visited at the same time, so func_ has to be safe to
+    // call from several threads, keys within a range come in order.
+    template <typename Func_>
+    void parallel_for_each (Func_ func_,
+                            unsigned threads_ = std::thread::hardware_concurrency ()) const
     {
-        auto to_erase_pos_ = m_find_for_erase_ (key_);
-        return m_erase_pos_ (to_erase_pos_);
+        m_for_each_range_ (threads_, [this, &func_] (size_type, size_type first_, size_type last_) {
+            m_walk_ (first_, last_, func_);
+        });
     }
 
-    void erase (iterator pos_)   // ???
+    // Fold init_ and transform_ (key) of all keys with reduce_, which has to be associative. The
+    // ranges are folded separately and their results are folded in the order of the keys.
+    template <typename T_, typename Reduce_, typename Transform_>
+    T_ parallel_reduce (T_ init_, Reduce_ reduce_, Transform_ transform_,
+                        unsigned threads_ = std::thread::hardware_concurrency ()) const
     {
-        if ( pos_ != end () )
-        {
-            m_trav_bin_search_ (*pos_, [] (node_ptr_ &node_) { node_->m_size_--; });
-            m_erase_pos_ (pos_);
-        }
+        std::vector<std::optional<T_>> partial_ (std::max (threads_, 1u));
+        m_for_each_range_ (threads_, [&, this] (size_type i, size_type first_, size_type last_) {
+            auto fold_ = [&res_ = partial_[i], &reduce_, &transform_] (const value_type &key_) {
+                if ( res_ )
+                    res_ = reduce_ (std::move (*res_), transform_ (key_));
+                else
+                    res_.emplace (transform_ (key_));
+            };
+            m_walk_ (first_, last_, fold_);
+        });
+
+        for ( auto &res_ : partial_ )
+            if ( res_ )
+                init_ = reduce_ (std::move (init_), std::move (*res_));
+        return init_;
     }
 
-    void clear () noexcept { m_header_struct_.m_reset_ (); }
+    // Keys in order. Every range is copied straight to its place, so value_type has to be
+    // default constructible.
+    std::vector<value_type>
+    to_vector (unsigned threads_ = std::thread::hardware_concurrency ()) const
+    {
+        std::vector<value_type> res_ (size ());
+        m_for_each_range_ (threads_, [this, &res_] (size_type, size_type first_, size_type last_) {
+            auto out_  = res_.begin () + static_cast<std::ptrdiff_t> (first_);
+            auto copy_ = [&out_] (const value_type &key_) { *out_++ = key_; };
+            m_walk_ (first_, last_, copy_);
+        });
+        return res_;
+    }
+
+    void clear () noexcept
+    {
+        /* Whole slabs go back to the allocator at once, unless the trees split from this one
+         * keep nodes in them. Then the nodes go back one by one for the other trees to reuse. */
+        if ( m_node_pool_.shared () )
+            m_free_subtree_ (m_root_ ());
+        else
+            m_destroy_subtree_ (m_root_ ());
+        m_header_struct_.m_reset_ ();
+        m_stats_.m_reset_sizes_ ();
+        m_node_pool_.m_release_ ();
+    }
 
     // Set operations.
     iterator lower_bound (const value_type &k_) { return m_lower_bound_ (m_root_ (), nullptr, k_); }
@@ -352,28 +912,48 @@ template <typename Key_, class Compare_ = std::less<Key_>> struct dynamic_order_
     iterator upper_bound (const value_type &k_) { return m_upper_bound_ (m_root_ (), nullptr, k_); }
 
     // return key value of ith smallest element in AVL-tree
-    value_type m_os_select_ (size_type i);
+    value_type m_os_select_ (size_type i) const;
 
     // return the rank of the node with matching key_
     size_type m_get_rank_of_ (iterator pos_);
 
-    // Return number of elements with the key less then the given one.
-    size_type m_get_number_less_then_ (value_type key_)
-    {
-        if ( empty () )
-            return 0;
+    // Number of keys less then key_ (not greater if Inclusive_) by one descent from the root.
+    template <bool Inclusive_> size_type m_count_before_ (const value_type &key_) const;
 
-        auto min_key_ = s_key_ (m_begin_ ());
+    // Answer select queries [first_, last_) of the batch sorted by rank in subtree of node_.
+    // Ranks of the subtree start after offset_.
+    void m_select_batch_ (node_ptr_ node_, const size_type *first_, const size_type *last_,
+                          size_type offset_, std::span<const size_type> ranks_,
+                          std::span<value_type> keys_) const;
 
-        if ( this->m_compare_struct_.m_key_compare_ (key_, min_key_) || key_ == min_key_ )
-            return 0;
+    // Answer rank queries [first_, last_) of the batch sorted by key in subtree of node_.
+    // less_ keys of the tree are less then all keys of the subtree.
+    void m_rank_batch_ (node_ptr_ node_, const size_type *first_, const size_type *last_,
+                        size_type less_, std::span<const value_type> keys_,
+                        std::span<size_type> ranks_) const;
 
-        /* Previous element exists. */
-        auto closest_left_ = --upper_bound (key_);
+    // State of one descent of the interleaved batch.
+    struct descent_
+    {
+        node_ptr_ m_node_;
+        size_type m_query_;
+        size_type m_acc_;     /* rank accumulated or left to find */
+        node_ptr_ m_result_;
+    };
 
-        auto rank_ = m_get_rank_of_ (closest_left_);
+    /*
+     * Run descents of n_ independent queries Group_ at a time in lock-step. step_ moves the
+     * descent one level down and returns false when it has written the answer. The next node of
+     * every descent is prefetched before switching to another one, so up to Group_ cache misses
+     * are in flight instead of one.
+     */
+    template <std::size_t Group_, typename Start_, typename Step_>
+    void m_interleave_ (size_type n_, Start_ start_, Step_ step_) const;
 
-        return (*closest_left_ == key_ ? rank_ - 1 : rank_);
+    // Return number of elements with the key less then the given one.
+    size_type m_get_number_less_then_ (value_type key_) const
+    {
+        return m_count_before_<false> (key_);
     }
 
   public:
@@ -384,9 +964,201 @@ template <typename Key_, class Compare_ = std::less<Key_>> struct dynamic_order_
 
     bool operator!= (const dynamic_order_avl_tree_ &other_) const { return !(*this == other_); }
 
-    value_type os_select (size_type i) { return m_os_select_ (i); }
+    value_type os_select (size_type i) const { return m_os_select_ (i); }
+
+    size_type get_number_less_then (value_type key_) const
+    {
+        return m_get_number_less_then_ (key_);
+    }
+
+    // Counters of the tree since its construction, only with the tree_stats policy. Height is
+    // found by one descent, the average depth is kept up to date by the updates. After the tree
+    // is rebuilt by a batch, split, join or set operation the first call walks it once.
+    avl_tree_stats stats () const noexcept
+        requires Stats_::enabled
+    {
+        return m_stats_.m_snapshot_ (size (), s_height_ (m_root_ ()),
+                                     [this] { return m_sum_sizes_ (); });
+    }
+
+    /*
+     * keys_[i] = os_select (ranks_[i]) for the whole batch. The batch is sorted and answered in
+     * one walk, so the upper levels shared by the queries are visited once. All ranks are
+     * checked before anything is written.
+     */
+    void os_select_batch (std::span<const size_type> ranks_, std::span<value_type> keys_) const
+    {
+        if ( ranks_.size () != keys_.size () )
+            throw std::invalid_argument ("Sizes of queries and answers differ.");
+
+        for ( auto i : ranks_ )
+            if ( i > size () || !i )
+                throw std::out_of_range ("i is greater then the size of the tree or zero.");
+
+        auto by_rank_ = [&ranks_] (size_type a_, size_type b_) { return ranks_[a_] < ranks_[b_]; };
+        auto order_   = sorted_batch_order_ (ranks_.size (), by_rank_);
+        m_select_batch_ (m_root_ (), order_.data (), order_.data () + order_.size (), 0, ranks_,
+                         keys_);
+    }
+
+    // ranks_[i] = rank (keys_[i]) for the whole batch in one walk like os_select_batch.
+    void rank_batch (std::span<const value_type> keys_, std::span<size_type> ranks_) const
+    {
+        if ( ranks_.size () != keys_.size () )
+            throw std::invalid_argument ("Sizes of queries and answers differ.");
+
+        auto &comp_  = m_compare_struct_.m_key_compare_;
+        auto by_key_ = [&keys_, &comp_] (size_type a_, size_type b_) {
+            return comp_ (keys_[a_], keys_[b_]);
+        };
+        auto order_ = sorted_batch_order_ (keys_.size (), by_key_);
+        m_rank_batch_ (m_root_ (), order_.data (), order_.data () + order_.size (), 0, keys_,
+                       ranks_);
+    }
+
+    /*
+     * Interleaved lookups: unlike the *_batch queries the batch is not sorted, queries are
+     * answered by Group_ independent descents in lock-step. It pays off on trees which don't fit
+     * in the cache, where a single descent is a chain of dependent cache misses.
+     */
+    template <std::size_t Group_ = 16>
+    void lower_bound_interleaved (std::span<const value_type> keys_,
+                                  std::span<iterator> positions_) const
+    {
+        if ( keys_.size () != positions_.size () )
+            throw std::invalid_argument ("Sizes of queries and answers differ.");
+
+        if ( empty () )
+        {
+            std::fill (positions_.begin (), positions_.end (), end ());
+            return;
+        }
+
+        auto &comp_ = m_compare_struct_.m_key_compare_;
+        m_interleave_<Group_> (
+            keys_.size (), [] (descent_ &) {},
+            [this, &comp_, &keys_, &positions_] (descent_ &state_) {
+                auto x_ = state_.m_node_;
+                if ( !comp_ (s_key_ (x_), keys_[state_.m_query_]) )
+                {
+                    state_.m_result_ = x_;
+                    state_.m_node_   = x_->m_left_;
+                }
+                else
+                    state_.m_node_ = x_->m_right_;
+
+                if ( state_.m_node_ )
+                    return true;
+                positions_[state_.m_query_] = iterator (state_.m_result_, this);
+                return false;
+            });
+    }
+
+    template <std::size_t Group_ = 16>
+    void find_interleaved (std::span<const value_type> keys_, std::span<iterator> positions_) const
+    {
+        lower_bound_interleaved<Group_> (keys_, positions_);
+
+        auto &comp_ = m_compare_struct_.m_key_compare_;
+        for ( size_type i = 0; i < keys_.size (); i++ )
+            if ( positions_[i] != end () && comp_ (keys_[i], *positions_[i]) )
+                positions_[i] = end ();
+    }
+
+    // keys_[i] = os_select (ranks_[i]) by interleaved descents. All ranks are checked first.
+    template <std::size_t Group_ = 16>
+    void os_select_interleaved (std::span<const size_type> ranks_,
+                                std::span<value_type> keys_) const
+    {
+        if ( ranks_.size () != keys_.size () )
+            throw std::invalid_argument ("Sizes of queries and answers differ.");
+
+        for ( auto i : ranks_ )
+            if ( i > size () || !i )
+                throw std::out_of_range ("i is greater then the size of the tree or zero.");
+
+        auto start_ = [&ranks_] (descent_ &state_) { state_.m_acc_ = ranks_[state_.m_query_]; };
+        m_interleave_<Group_> (ranks_.size (), start_, [&keys_] (descent_ &state_) {
+            auto x_ = state_.m_node_;
+
+            /* The rank of node is the size of left subtree plus 1. */
+            size_type rank_ = node_::size (x_->m_left_) + 1;
+            if ( state_.m_acc_ == rank_ )
+            {
+                keys_[state_.m_query_] = s_key_ (x_);
+                return false;
+            }
+
+            if ( state_.m_acc_ < rank_ )
+                state_.m_node_ = x_->m_left_;
+            else
+            {
+                state_.m_acc_ -= rank_;
+                state_.m_node_ = x_->m_right_;
+            }
+            return true;
+        });
+    }
+
+    // ranks_[i] = rank (keys_[i]) by interleaved descents.
+    template <std::size_t Group_ = 16>
+    void rank_interleaved (std::span<const value_type> keys_, std::span<size_type> ranks_) const
+    {
+        if ( ranks_.size () != keys_.size () )
+            throw std::invalid_argument ("Sizes of queries and answers differ.");
+
+        if ( empty () )
+        {
+            std::fill (ranks_.begin (), ranks_.end (), size_type {0});
+            return;
+        }
+
+        auto &comp_ = m_compare_struct_.m_key_compare_;
+        m_interleave_<Group_> (
+            keys_.size (), [] (descent_ &) {},
+            [&comp_, &keys_, &ranks_] (descent_ &state_) {
+                auto x_ = state_.m_node_;
+                if ( comp_ (s_key_ (x_), keys_[state_.m_query_]) )
+                {
+                    state_.m_acc_ += node_::size (x_->m_left_) + 1;
+                    state_.m_node_ = x_->m_right_;
+                }
+                else
+                    state_.m_node_ = x_->m_left_;
+
+                if ( state_.m_node_ )
+                    return true;
+                ranks_[state_.m_query_] = state_.m_acc_;
+                return false;
+            });
+    }
+
+    // Number of keys less then key_, that is the 0-based position key_ would have in the set.
+    size_type rank (const value_type &key_) const { return m_count_before_<false> (key_); }
+
+    size_type count_less (const value_type &key_) const { return m_count_before_<false> (key_); }
+
+    size_type count_less_equal (const value_type &key_) const
+    {
+        return m_count_before_<true> (key_);
+    }
+
+    // Number of keys in the closed range [lo_, hi_], zero if hi_ is less then lo_.
+    size_type count_in_range (const value_type &lo_, const value_type &hi_) const
+    {
+        if ( m_compare_struct_.m_key_compare_ (hi_, lo_) )
+            return 0;
+        return m_count_before_<true> (hi_) - m_count_before_<false> (lo_);
+    }
 
-    size_type get_number_less_then (value_type key_) { return m_get_number_less_then_ (key_); }
+    // Return k_th smallest key among the keys not less then key_, so select_from (key_, 1) is
+    // the lower bound of key_. Throws std::out_of_range if there are less then k_ such keys.
+    value_type select_from (const value_type &key_, size_type k_) const
+    {
+        if ( !k_ )
+            throw std::out_of_range ("k is zero.");
+        return m_os_select_ (m_count_before_<false> (key_) + k_);
+    }
 
     void dump (std::string filename) const
     {
@@ -423,78 +1195,6 @@ template <typename Key_, class Compare_ = std::less<Key_>> struct dynamic_order_
     }
 };
 
-template <typename Val_>
-typename do_avl_tree_node_<Val_>::node_ptr_
-do_avl_tree_node_<Val_>::m_predecessor_for_erase_ () noexcept
-{
-    auto curr_ = this;
-
-    if ( m_left_ )
-    {
-        /*
-         * Move down until we find it.
-         * Also have to decrease ich node size.
-         */
-
-        curr_ = m_left ();
-        while ( curr_->m_right_ )
-        {
-            curr_->m_size_--;
-            curr_ = curr_->m_right ();
-        }
-        return curr_;
-    }
-
-    /* move up until we find it or reach the root. */
-    for ( ; curr_->m_parent_->m_parent_ && curr_->is_left_child_ (); curr_ = curr_->m_parent_ )
-    {
-        ;
-    }
-
-    auto parent_ = curr_->m_parent_;
-
-    if ( !parent_->m_parent_ ) /* curr_ is a root */
-        return nullptr;
-
-    return parent_;
-}
-
-template <typename Val_>
-typename do_avl_tree_node_<Val_>::node_ptr_
-do_avl_tree_node_<Val_>::m_successor_for_erase_ () noexcept
-{
-    auto curr_ = this;
-
-    if ( m_right_ )
-    {
-        /*
-         * Move down until we find it.
-         * Also have to decrease ich node size.
-         */
-
-        curr_ = m_right ();
-        while ( curr_->m_left_ )
-        {
-            curr_->m_size_--;
-            curr_ = curr_->m_left ();
-        }
-        return curr_;
-    }
-
-    /* move up until we find it or reach the root. */
-    for ( ; curr_->m_parent_->m_parent_ && !curr_->is_left_child_ (); curr_ = curr_->m_parent_ )
-    {
-        ;
-    }
-
-    auto parent_ = curr_->m_parent_;
-
-    if ( !parent_->m_parent_ ) /* curr_ is a root */
-        return nullptr;
-
-    return parent_;
-}
-
 template <typename Val_>
 typename do_avl_tree_node_<Val_>::node_ptr_
 do_avl_tree_node_<Val_>::dynamic_order_avl_tree_increment_ () noexcept
@@ -724,26 +1424,21 @@ typename do_avl_tree_node_<Val_>::node_ptr_ do_avl_tree_node_<Val_>::rotate_left
 {
     auto node_       = this;
     auto parent_     = this->m_parent_;
-    auto rchild_ptr_ = node_->m_right_.release ();
+    auto rchild_ptr_ = node_->m_right_;
 
-    node_->m_right_ = std::move (rchild_ptr_->m_left_);
+    node_->m_right_ = rchild_ptr_->m_left_;
 
     if ( node_->m_right_ )
         node_->m_right_->m_parent_ = node_;
 
     rchild_ptr_->m_parent_ = parent_;
     if ( node_->is_left_child_ () && parent_ )
-    {
-        rchild_ptr_->m_left_ = std::move (parent_->m_left_);
-        parent_->m_left_     = owning_ptr_ (rchild_ptr_);
-    }
+        parent_->m_left_ = rchild_ptr_;
     else if ( parent_ )
-    {
-        rchild_ptr_->m_left_ = std::move (parent_->m_right_);
-        parent_->m_right_    = owning_ptr_ (rchild_ptr_);
-    }
+        parent_->m_right_ = rchild_ptr_;
 
-    node_->m_parent_ = rchild_ptr_;
+    rchild_ptr_->m_left_ = node_;
+    node_->m_parent_     = rchild_ptr_;
 
     /* update rchild's and node's sizes (the only sizes changed) */
     rchild_ptr_->m_size_ = node_->m_size_;
@@ -757,27 +1452,21 @@ typename do_avl_tree_node_<Val_>::node_ptr_ do_avl_tree_node_<Val_>::rotate_righ
 {
     auto node_       = this;
     auto parent_     = this->m_parent_;
-    auto lchild_ptr_ = node_->m_left_.release ();
+    auto lchild_ptr_ = node_->m_left_;
 
-    node_->m_left_ = std::move (lchild_ptr_->m_right_);
+    node_->m_left_ = lchild_ptr_->m_right_;
 
     if ( node_->m_left_ )
         node_->m_left_->m_parent_ = node_;
 
     lchild_ptr_->m_parent_ = parent_;
     if ( node_->is_left_child_ () && parent_ )
-    {
-        lchild_ptr_->m_right_ = std::move (parent_->m_left_);
-        parent_->m_left_      = owning_ptr_ (lchild_ptr_);
-    }
+        parent_->m_left_ = lchild_ptr_;
     else if ( parent_ )
-    {
-
-        lchild_ptr_->m_right_ = std::move (parent_->m_right_);
-        parent_->m_right_     = owning_ptr_ (lchild_ptr_);
-    }
+        parent_->m_right_ = lchild_ptr_;
 
-    node_->m_parent_ = lchild_ptr_;
+    lchild_ptr_->m_right_ = node_;
+    node_->m_parent_      = lchild_ptr_;
 
     /* update rchild's and node's sizes (the only sizes changed) */
     lchild_ptr_->m_size_ = node_->m_size_;
@@ -786,9 +1475,9 @@ typename do_avl_tree_node_<Val_>::node_ptr_ do_avl_tree_node_<Val_>::rotate_righ
     return lchild_ptr_;
 }
 
-template <typename Key_, typename Comp_>
-typename dynamic_order_avl_tree_<Key_, Comp_>::value_type
-dynamic_order_avl_tree_<Key_, Comp_>::m_os_select_ (size_type i)
+template <typename Key_, typename Comp_, typename Alloc_, typename Stats_>
+typename dynamic_order_avl_tree_<Key_, Comp_, Alloc_, Stats_>::value_type
+dynamic_order_avl_tree_<Key_, Comp_, Alloc_, Stats_>::m_os_select_ (size_type i) const
 {
     if ( i > size () || !i )
         throw std::out_of_range ("i is greater then the size of the tree or zero.");
@@ -798,8 +1487,11 @@ dynamic_order_avl_tree_<Key_, Comp_>::m_os_select_ (size_type i)
     /* The rank of node is the size of left subtree plus 1. */
     size_t rank_ = node_::size (curr_->m_left ()) + 1;
 
+    auto stats_ = m_stats_.m_descent_ ();
+    stats_.m_visit_ ();
     while ( rank_ != i )
     {
+        stats_.m_visit_ ();
         if ( i < rank_ )
             curr_ = curr_->m_left ();
         else
@@ -814,9 +1506,128 @@ dynamic_order_avl_tree_<Key_, Comp_>::m_os_select_ (size_type i)
 
     return s_key_ (curr_);
 }
-template <typename Key_, typename Comp_>
-typename dynamic_order_avl_tree_<Key_, Comp_>::size_type
-dynamic_order_avl_tree_<Key_, Comp_>::m_get_rank_of_ (iterator pos_)
+template <typename Key_, typename Comp_, typename Alloc_, typename Stats_>
+template <bool Inclusive_>
+typename dynamic_order_avl_tree_<Key_, Comp_, Alloc_, Stats_>::size_type
+dynamic_order_avl_tree_<Key_, Comp_, Alloc_, Stats_>::m_count_before_ (const value_type &key_) const
+{
+    auto &comp_     = m_compare_struct_.m_key_compare_;
+    size_type less_ = 0;
+
+    /* Every time we go right the left subtree and the node itself are counted. */
+    auto stats_ = m_stats_.m_descent_ ();
+    for ( auto x_ = m_root_ (); x_; )
+    {
+        stats_.m_visit_ ();
+        stats_.m_compare_ ();
+        bool counted_ = (Inclusive_ ? !comp_ (key_, s_key_ (x_)) : comp_ (s_key_ (x_), key_));
+        if ( counted_ )
+        {
+            less_ += node_::size (x_->m_left_) + 1;
+            x_ = x_->m_right_;
+        }
+        else
+            x_ = x_->m_left_;
+    }
+
+    return less_;
+}
+
+template <typename Key_, typename Comp_, typename Alloc_, typename Stats_>
+void dynamic_order_avl_tree_<Key_, Comp_, Alloc_, Stats_>::m_select_batch_ (
+    node_ptr_ node_, const size_type *first_, const size_type *last_, size_type offset_,
+    std::span<const size_type> ranks_, std::span<value_type> keys_) const
+{
+    /* Ranks are valid, so the node exists while there are queries. Right part is a loop. */
+    while ( first_ != last_ )
+    {
+        size_type rank_ = offset_ + node_::size (node_->m_left_) + 1;
+
+        auto before_ = [&ranks_, rank_] (size_type q_) { return ranks_[q_] < rank_; };
+        auto middle_ = std::partition_point (first_, last_, before_);
+        if ( first_ != middle_ )
+            m_select_batch_ (node_->m_left_, first_, middle_, offset_, ranks_, keys_);
+
+        for ( first_ = middle_; first_ != last_ && ranks_[*first_] == rank_; ++first_ )
+            keys_[*first_] = s_key_ (node_);
+
+        node_   = node_->m_right_;
+        offset_ = rank_;
+    }
+}
+
+template <typename Key_, typename Comp_, typename Alloc_, typename Stats_>
+void dynamic_order_avl_tree_<Key_, Comp_, Alloc_, Stats_>::m_rank_batch_ (
+    node_ptr_ node_, const size_type *first_, const size_type *last_, size_type less_,
+    std::span<const value_type> keys_, std::span<size_type> ranks_) const
+{
+    auto &comp_ = m_compare_struct_.m_key_compare_;
+
+    for ( ; node_ && first_ != last_; node_ = node_->m_right_ )
+    {
+        /* Keys not greater then the key of the node go left, the rest go right. */
+        auto middle_ = std::partition_point (first_, last_, [&keys_, &comp_, node_] (size_type q_) {
+            return !comp_ (s_key_ (node_), keys_[q_]);
+        });
+        if ( first_ != middle_ )
+            m_rank_batch_ (node_->m_left_, first_, middle_, less_, keys_, ranks_);
+
+        less_ += node_::size (node_->m_left_) + 1;
+        first_ = middle_;
+    }
+
+    for ( ; first_ != last_; ++first_ )
+        ranks_[*first_] = less_;
+}
+
+template <typename Key_, typename Comp_, typename Alloc_, typename Stats_>
+template <std::size_t Group_, typename Start_, typename Step_>
+void dynamic_order_avl_tree_<Key_, Comp_, Alloc_, Stats_>::m_interleave_ (size_type n_,
+                                                                          Start_ start_,
+                                                                          Step_ step_) const
+{
+    static_assert (Group_ > 0, "Group of descents can't be empty.");
+
+    std::array<descent_, Group_> group_;
+    size_type next_   = 0;
+    size_type active_ = 0;
+
+    /* Every descent starts from the root, callers answer queries to empty tree themselves. */
+    auto root_ = m_root_ ();
+    assert (root_ || !n_);
+
+    auto fill_ = [&] (descent_ &state_) {
+        state_ = descent_ {root_, next_++, 0, nullptr};
+        start_ (state_);
+    };
+
+    for ( ; active_ < Group_ && next_ < n_; active_++ )
+        fill_ (group_[active_]);
+
+    while ( active_ )
+    {
+        for ( size_type slot_ = 0; slot_ < active_; )
+        {
+            auto &state_ = group_[slot_];
+            if ( step_ (state_) )
+            {
+                prefetch_node_ (state_.m_node_);
+                slot_++;
+            }
+            else if ( next_ < n_ )
+            {
+                fill_ (state_);
+                slot_++;
+            }
+            else
+                state_ = group_[--active_];
+        }
+    }
+}
+
+template <typename Key_, typename Comp_, typename Alloc_, typename Stats_>
+typename dynamic_order_avl_tree_<Key_, Comp_, Alloc_, Stats_>::size_type
+dynamic_order_avl_tree_<Key_, Comp_, Alloc_, Stats_>::m_get_rank_of_ (iterator pos_)
 {
     if ( pos_ == end () )
         throw std::out_of_range ("Element with the given key is not inserted.");
@@ -836,84 +1647,73 @@ dynamic_order_avl_tree_<Key_, Comp_>::m_get_rank_of_ (iterator pos_)
     return rank_;
 }
 
-template <typename Key_, typename Comp_>
-template <typename F>
-std::tuple<typename dynamic_order_avl_tree_<Key_, Comp_>::node_ptr_,
-           typename dynamic_order_avl_tree_<Key_, Comp_>::node_ptr_, bool>
-dynamic_order_avl_tree_<Key_, Comp_>::m_trav_bin_search_ (value_type key_, F step_)
+template <typename Key_, typename Comp_, typename Alloc_, typename Stats_>
+std::tuple<typename dynamic_order_avl_tree_<Key_, Comp_, Alloc_, Stats_>::node_ptr_,
+           typename dynamic_order_avl_tree_<Key_, Comp_, Alloc_, Stats_>::node_ptr_, bool>
+dynamic_order_avl_tree_<Key_, Comp_, Alloc_, Stats_>::m_trav_bin_search_ (
+    const value_type &key_) const
 {
     using res_ = std::tuple<node_ptr_, node_ptr_, bool>;
 
-    auto prev_ = m_root_ ();
-    auto curr_ = prev_;
-    if ( !curr_ )
-        return res_ (nullptr, nullptr, false);
+    auto prev_ = m_header_struct_.m_header_.get ();
+    auto curr_ = m_root_ ();
 
-    bool key_less_ {};
+    bool key_less_ = true;
 
-    while ( curr_ && s_key_ (curr_) != key_ )
+    auto stats_ = m_stats_.m_descent_ ();
+    while ( curr_ )
     {
+        stats_.m_visit_ ();
         key_less_ = this->m_compare_struct_.m_key_compare_ (key_, s_key_ (curr_));
-        step_ (curr_);
+        /* Equality is checked only if the key is not less. */
+        stats_.m_compare_ (key_less_ ? 1 : 2);
+        if ( !key_less_ && !this->m_compare_struct_.m_key_compare_ (s_key_ (curr_), key_) )
+            break;
+
         prev_ = curr_;
-        if ( key_less_ )
-            curr_ = curr_->m_left ();
-        else
-            curr_ = curr_->m_right ();
+        curr_ = (key_less_ ? curr_->m_left () : curr_->m_right ());
     }
 
-    if ( curr_ == m_root_ () )
-        step_ (curr_);
-
     return res_ (curr_, prev_, key_less_);
 }
 
-template <typename Key_, typename Comp_>
-typename dynamic_order_avl_tree_<Key_, Comp_>::node_ptr_
-dynamic_order_avl_tree_<Key_, Comp_>::m_insert_node_ (owning_ptr_ to_insert_)
+template <typename Key_, typename Comp_, typename Alloc_, typename Stats_>
+std::pair<typename dynamic_order_avl_tree_<Key_, Comp_, Alloc_, Stats_>::node_ptr_, bool>
+dynamic_order_avl_tree_<Key_, Comp_, Alloc_, Stats_>::m_insert_node_ (const value_type &key_)
 {
-    auto to_insert_ptr_ = to_insert_.get ();
-    if ( empty () )
-    {
-        m_header_struct_.m_header_->m_left_ = std::move (to_insert_);
-        to_insert_ptr_->m_parent_           = m_header_struct_.m_header_.get ();
-
-        m_header_struct_.m_leftmost_  = to_insert_ptr_;
-        m_header_struct_.m_rightmost_ = to_insert_ptr_;
+    /* Find right position in the tree, nothing is changed until the key is known to be new. */
+    auto [found, prev, prev_greater] = m_trav_bin_search_ (key_);
 
-        return to_insert_ptr_;
-    }
+    if ( found )
+        return {found, false};
 
-    /* Find right position in the tree */
-    auto [found, prev, prev_greater] =
-        m_trav_bin_search_ (s_key_ (to_insert_ptr_), [] (node_ptr_ &node_) { node_->m_size_++; });
+    auto to_insert_       = m_node_pool_.m_create_ (key_);
+    to_insert_->m_parent_ = prev;
 
-    if ( found )
+    if ( prev == m_header_struct_.m_header_.get () )
     {
-        m_trav_bin_search_ (s_key_ (to_insert_ptr_), [] (node_ptr_ &node_) { node_->m_size_--; });
-        throw std::out_of_range ("Element already inserted");
+        prev->m_left_                 = to_insert_;
+        m_header_struct_.m_leftmost_  = to_insert_;
+        m_header_struct_.m_rightmost_ = to_insert_;
     }
-    to_insert_->m_parent_ = prev;
-
-    if ( prev == m_header_struct_.m_header_.get () || prev_greater )
+    else if ( prev_greater )
     {
-        prev->m_left_ = std::move (to_insert_);
+        prev->m_left_ = to_insert_;
         if ( prev == m_header_struct_.m_leftmost_ )
-            m_header_struct_.m_leftmost_ = to_insert_ptr_;
+            m_header_struct_.m_leftmost_ = to_insert_;
     }
     else
     {
-        prev->m_right_ = std::move (to_insert_);
+        prev->m_right_ = to_insert_;
         if ( prev == m_header_struct_.m_rightmost_ )
-            m_header_struct_.m_rightmost_ = to_insert_ptr_;
+            m_header_struct_.m_rightmost_ = to_insert_;
     }
 
-    return to_insert_ptr_;
+    return {to_insert_, true};
 }
 
-template <typename Key_, typename Comp_>
-typename dynamic_order_avl_tree_<Key_, Comp_>::node_ptr_
-dynamic_order_avl_tree_<Key_, Comp_>::m_erase_pos_impl_ (iterator pos_)
+template <typename Key_, typename Comp_, typename Alloc_, typename Stats_>
+void dynamic_order_avl_tree_<Key_, Comp_, Alloc_, Stats_>::m_erase_pos_impl_ (iterator pos_)
 {
     auto to_erase_    = pos_.m_node_;
     node_ptr_ target_ = nullptr;
@@ -925,43 +1725,497 @@ dynamic_order_avl_tree_<Key_, Comp_>::m_erase_pos_impl_ (iterator pos_)
 
         /* Change leftmost or rightmost if needed */
         if ( m_begin_ () == target_ )
-            m_begin_ () = target_->m_successor_for_erase_ ();
+            m_begin_ () = target_->dynamic_order_avl_tree_increment_ ();
         if ( m_end_ () == target_ )
-            m_end_ () = target_->m_predecessor_for_erase_ ();
+            m_end_ () = target_->dynamic_order_avl_tree_decrement_ ();
     }
     else
     {
-        target_ =
-            to_erase_->m_successor_for_erase_ (); /* to_erase_->m_right_ exist, thus move down */
+        target_ = to_erase_->m_right_->m_minimum_ (); /* to_erase_->m_right_ exist, move down */
         std::swap (s_key_ (target_), s_key_ (to_erase_));
+
+        /* Successor's key now lives in to_erase_ */
+        if ( m_end_ () == target_ )
+            m_end_ () = to_erase_;
     }
 
-    target_->m_size_--;
+    /* The node and its ancestors shrink by one, then the node leaves with its size. */
+    if constexpr ( Stats_::enabled )
+        m_stats_.m_add_sizes_ (-static_cast<std::int64_t> (s_depth_ (target_) + target_->m_size_));
+
+    /* The only sizes changed are on the path from the removed node to the root. */
+    for ( auto node_ = target_; node_->m_parent_; node_ = node_->m_parent_ )
+        node_->m_size_--;
 
     /* rebalancing target subtree */
     m_rebalance_for_erase_ (target_);
 
-    auto child_u_ptr_ = std::move (target_->m_left_ ? target_->m_left_ : target_->m_right_);
+    auto child_ = (target_->m_left_ ? target_->m_left_ : target_->m_right_);
 
-    if ( child_u_ptr_ )
-        child_u_ptr_->m_parent_ = target_->m_parent_;
+    if ( child_ )
+        child_->m_parent_ = target_->m_parent_;
 
     auto t_parent_ = target_->m_parent_;
 
     if ( target_->is_left_child_ () )
-        t_parent_->m_left_ = std::move (child_u_ptr_);
+        t_parent_->m_left_ = child_;
     else
-        t_parent_->m_right_ = std::move (child_u_ptr_);
+        t_parent_->m_right_ = child_;
+
+    m_node_pool_.m_destroy_ (target_);
+}
+
+template <typename Key_, typename Comp_, typename Alloc_, typename Stats_>
+template <typename It_>
+typename dynamic_order_avl_tree_<Key_, Comp_, Alloc_, Stats_>::node_ptr_
+dynamic_order_avl_tree_<Key_, Comp_, Alloc_, Stats_>::m_build_subtree_ (It_ &first_, size_type n_)
+{
+    if ( !n_ )
+        return nullptr;
+
+    /* Nodes are created in order, so neighbours in the tree are neighbours in the slab. */
+    size_type left_size_  = (n_ - 1) / 2;
+    size_type right_size_ = n_ - 1 - left_size_;
+
+    auto left_       = m_build_subtree_ (first_, left_size_);
+    node_ptr_ node_  = nullptr;
+    node_ptr_ right_ = nullptr;
+    try
+    {
+        node_ = m_node_pool_.m_create_ (*first_);
+        ++first_;
+        right_ = m_build_subtree_ (first_, right_size_);
+    }
+    catch ( ... )
+    {
+        /* Nothing is linked into the tree yet, so the built part is freed here. */
+        m_free_subtree_ (left_);
+        if ( node_ )
+            m_node_pool_.m_destroy_ (node_);
+        throw;
+    }
+
+    node_->m_left_  = left_;
+    node_->m_right_ = right_;
+    node_->m_size_  = n_;
+    node_->m_bf_    = perfect_tree_height_ (right_size_) - perfect_tree_height_ (left_size_);
+
+    if ( left_ )
+        left_->m_parent_ = node_;
+    if ( right_ )
+        right_->m_parent_ = node_;
+
+    return node_;
+}
+
+template <typename Key_, typename Comp_, typename Alloc_, typename Stats_>
+int dynamic_order_avl_tree_<Key_, Comp_, Alloc_, Stats_>::s_height_ (node_ptr_ node_) noexcept
+{
+    int height_ = 0;
+    for ( ; node_; height_++ )
+        node_ = (node_->m_bf_ < 0 ? node_->m_left_ : node_->m_right_);
+    return height_;
+}
+
+template <typename Key_, typename Comp_, typename Alloc_, typename Stats_>
+typename dynamic_order_avl_tree_<Key_, Comp_, Alloc_, Stats_>::subtree_
+dynamic_order_avl_tree_<Key_, Comp_, Alloc_, Stats_>::s_make_ (subtree_ left_, node_ptr_ node_,
+                                                               subtree_ right_) noexcept
+{
+    node_->m_left_  = left_.m_root_;
+    node_->m_right_ = right_.m_root_;
+    node_->m_size_  = node_::size (left_.m_root_) + node_::size (right_.m_root_) + 1;
+    node_->m_bf_    = right_.m_height_ - left_.m_height_;
+
+    if ( left_.m_root_ )
+        left_.m_root_->m_parent_ = node_;
+    if ( right_.m_root_ )
+        right_.m_root_->m_parent_ = node_;
+
+    return {node_, std::max (left_.m_height_, right_.m_height_) + 1};
+}
+
+template <typename Key_, typename Comp_, typename Alloc_, typename Stats_>
+std::pair<typename dynamic_order_avl_tree_<Key_, Comp_, Alloc_, Stats_>::subtree_,
+          typename dynamic_order_avl_tree_<Key_, Comp_, Alloc_, Stats_>::subtree_>
+dynamic_order_avl_tree_<Key_, Comp_, Alloc_, Stats_>::s_expose_ (subtree_ tree_) noexcept
+{
+    /* Balance factor may be out of [-1, 1] only in the middle of s_link_. */
+    auto bf_ = tree_.m_root_->m_bf_;
+    return {{tree_.m_root_->m_left_, tree_.m_height_ - 1 - std::max (bf_, 0)},
+            {tree_.m_root_->m_right_, tree_.m_height_ - 1 + std::min (bf_, 0)}};
+}
+
+template <typename Key_, typename Comp_, typename Alloc_, typename Stats_>
+typename dynamic_order_avl_tree_<Key_, Comp_, Alloc_, Stats_>::subtree_
+dynamic_order_avl_tree_<Key_, Comp_, Alloc_, Stats_>::s_rotate_left_ (subtree_ tree_) noexcept
+{
+    auto [left_, right_]      = s_expose_ (tree_);
+    auto [right_l_, right_r_] = s_expose_ (right_);
+    return s_make_ (s_make_ (left_, tree_.m_root_, right_l_), right_.m_root_, right_r_);
+}
+
+template <typename Key_, typename Comp_, typename Alloc_, typename Stats_>
+typename dynamic_order_avl_tree_<Key_, Comp_, Alloc_, Stats_>::subtree_
+dynamic_order_avl_tree_<Key_, Comp_, Alloc_, Stats_>::s_rotate_right_ (subtree_ tree_) noexcept
+{
+    auto [left_, right_]    = s_expose_ (tree_);
+    auto [left_l_, left_r_] = s_expose_ (left_);
+    return s_make_ (left_l_, left_.m_root_, s_make_ (left_r_, tree_.m_root_, right_));
+}
+
+template <typename Key_, typename Comp_, typename Alloc_, typename Stats_>
+typename dynamic_order_avl_tree_<Key_, Comp_, Alloc_, Stats_>::subtree_
+dynamic_order_avl_tree_<Key_, Comp_, Alloc_, Stats_>::s_link_ (subtree_ left_, node_ptr_ node_,
+                                                               subtree_ right_) noexcept
+{
+    if ( right_.m_height_ > left_.m_height_ + 1 )
+    {
+        auto [right_l_, right_r_] = s_expose_ (right_);
+        if ( right_l_.m_height_ > right_r_.m_height_ )
+            right_ = s_rotate_right_ (right_);
+        return s_rotate_left_ (s_make_ (left_, node_, right_));
+    }
+
+    if ( left_.m_height_ > right_.m_height_ + 1 )
+    {
+        auto [left_l_, left_r_] = s_expose_ (left_);
+        if ( left_r_.m_height_ > left_l_.m_height_ )
+            left_ = s_rotate_left_ (left_);
+        return s_rotate_right_ (s_make_ (left_, node_, right_));
+    }
+
+    return s_make_ (left_, node_, right_);
+}
+
+template <typename Key_, typename Comp_, typename Alloc_, typename Stats_>
+typename dynamic_order_avl_tree_<Key_, Comp_, Alloc_, Stats_>::subtree_
+dynamic_order_avl_tree_<Key_, Comp_, Alloc_, Stats_>::s_join_right_ (subtree_ left_,
+                                                                     node_ptr_ node_,
+                                                                     subtree_ right_) noexcept
+{
+    /* Descend along the right spine of the higher left_ to the subtree as high as right_. */
+    auto [left_l_, left_r_] = s_expose_ (left_);
+    if ( left_r_.m_height_ <= right_.m_height_ + 1 )
+        return s_link_ (left_l_, left_.m_root_, s_make_ (left_r_, node_, right_));
+
+    return s_link_ (left_l_, left_.m_root_, s_join_right_ (left_r_, node_, right_));
+}
+
+template <typename Key_, typename Comp_, typename Alloc_, typename Stats_>
+typename dynamic_order_avl_tree_<Key_, Comp_, Alloc_, Stats_>::subtree_
+dynamic_order_avl_tree_<Key_, Comp_, Alloc_, Stats_>::s_join_left_ (subtree_ left_, node_ptr_ node_,
+                                                                    subtree_ right_) noexcept
+{
+    auto [right_l_, right_r_] = s_expose_ (right_);
+    if ( right_l_.m_height_ <= left_.m_height_ + 1 )
+        return s_link_ (s_make_ (left_, node_, right_l_), right_.m_root_, right_r_);
+
+    return s_link_ (s_join_left_ (left_, node_, right_l_), right_.m_root_, right_r_);
+}
+
+template <typename Key_, typename Comp_, typename Alloc_, typename Stats_>
+typename dynamic_order_avl_tree_<Key_, Comp_, Alloc_, Stats_>::subtree_
+dynamic_order_avl_tree_<Key_, Comp_, Alloc_, Stats_>::s_join_ (subtree_ left_, node_ptr_ node_,
+                                                               subtree_ right_) noexcept
+{
+    if ( left_.m_height_ > right_.m_height_ + 1 )
+        return s_join_right_ (left_, node_, right_);
+    if ( right_.m_height_ > left_.m_height_ + 1 )
+        return s_join_left_ (left_, node_, right_);
+    return s_make_ (left_, node_, right_);
+}
+
+template <typename Key_, typename Comp_, typename Alloc_, typename Stats_>
+std::tuple<typename dynamic_order_avl_tree_<Key_, Comp_, Alloc_, Stats_>::subtree_,
+           typename dynamic_order_avl_tree_<Key_, Comp_, Alloc_, Stats_>::node_ptr_,
+           typename dynamic_order_avl_tree_<Key_, Comp_, Alloc_, Stats_>::subtree_>
+dynamic_order_avl_tree_<Key_, Comp_, Alloc_, Stats_>::m_split_ (subtree_ tree_,
+                                                                const value_type &key_)
+{
+    if ( !tree_.m_root_ )
+        return {subtree_ {}, nullptr, subtree_ {}};
+
+    auto root_           = tree_.m_root_;
+    auto [left_, right_] = s_expose_ (tree_);
+
+    if ( m_compare_struct_.m_key_compare_ (key_, s_key_ (root_)) )
+    {
+        auto [less_, found_, greater_] = m_split_ (left_, key_);
+        return {less_, found_, s_join_ (greater_, root_, right_)};
+    }
+
+    if ( m_compare_struct_.m_key_compare_ (s_key_ (root_), key_) )
+    {
+        auto [less_, found_, greater_] = m_split_ (right_, key_);
+        return {s_join_ (left_, root_, less_), found_, greater_};
+    }
+
+    return {left_, root_, right_};
+}
+
+template <typename Key_, typename Comp_, typename Alloc_, typename Stats_>
+void dynamic_order_avl_tree_<Key_, Comp_, Alloc_, Stats_>::m_free_ (drop_list_ dropped_) noexcept
+{
+    /* The list itself is the stack of the walk: children of a freed node are pushed on it. */
+    for ( auto node_ = dropped_.m_first_; node_; )
+    {
+        auto next_ = node_->m_parent_;
+        for ( auto child_ : {node_->m_left_, node_->m_right_} )
+            if ( child_ )
+            {
+                child_->m_parent_ = next_;
+                next_             = child_;
+            }
+        m_node_pool_.m_destroy_ (node_);
+        node_ = next_;
+    }
+}
+
+template <typename Key_, typename Comp_, typename Alloc_, typename Stats_>
+typename dynamic_order_avl_tree_<Key_, Comp_, Alloc_, Stats_>::subtree_
+dynamic_order_avl_tree_<Key_, Comp_, Alloc_, Stats_>::m_union_ (subtree_ tree_, subtree_ batch_,
+                                                                spare_threads_ &spare_,
+                                                                drop_list_ &dropped_)
+{
+    if ( !tree_.m_root_ )
+        return batch_;
+    if ( !batch_.m_root_ )
+        return tree_;
+
+    /* Split the big tree by the root of the small one, so the work is spent on the batch. */
+    auto size_  = node_::size (tree_.m_root_) + node_::size (batch_.m_root_);
+    auto pivot_ = batch_.m_root_;
+    subtree_ batch_l_, batch_r_, less_, greater_;
+    node_ptr_ found_;
+    std::tie (batch_l_, batch_r_)       = s_expose_ (batch_);
+    std::tie (less_, found_, greater_) = m_split_ (tree_, s_key_ (pivot_));
+
+    /* The halves share no nodes, so they can be merged at the same time. */
+    drop_list_ right_dropped_;
+    auto [left_, right_] = s_fork_ (
+        spare_, size_, [&] { return m_union_ (less_, batch_l_, spare_, dropped_); },
+        [&] { return m_union_ (greater_, batch_r_, spare_, right_dropped_); });
+    dropped_.m_append_ (right_dropped_);
+
+    if ( found_ )
+    {
+        dropped_.m_push_node_ (pivot_);
+        pivot_ = found_;
+    }
+    return s_join_ (left_, pivot_, right_);
+}
+
+template <typename Key_, typename Comp_, typename Alloc_, typename Stats_>
+template <bool Keep_>
+typename dynamic_order_avl_tree_<Key_, Comp_, Alloc_, Stats_>::subtree_
+dynamic_order_avl_tree_<Key_, Comp_, Alloc_, Stats_>::m_filter_ (subtree_ tree_, subtree_ other_,
+                                                                 spare_threads_ &spare_,
+                                                                 drop_list_ &dropped_)
+{
+    if ( !tree_.m_root_ )
+        return tree_;
+    if ( !other_.m_root_ )
+    {
+        if constexpr ( !Keep_ )
+            return tree_;
+        dropped_.m_push_ (tree_.m_root_);
+        return subtree_ {};
+    }
+
+    /* Split the tree by the root of other_, which is only read. */
+    auto size_ = node_::size (tree_.m_root_) + node_::size (other_.m_root_);
+    subtree_ other_l_, other_r_, less_, greater_;
+    node_ptr_ found_;
+    std::tie (other_l_, other_r_)       = s_expose_ (other_);
+    std::tie (less_, found_, greater_) = m_split_ (tree_, s_key_ (other_.m_root_));
+
+    drop_list_ right_dropped_;
+    auto [left_, right_] = s_fork_ (
+        spare_, size_, [&] { return m_filter_<Keep_> (less_, other_l_, spare_, dropped_); },
+        [&] { return m_filter_<Keep_> (greater_, other_r_, spare_, right_dropped_); });
+    dropped_.m_append_ (right_dropped_);
+
+    if ( found_ && Keep_ )
+        return s_join_ (left_, found_, right_);
+    if ( found_ )
+        dropped_.m_push_node_ (found_);
+    return s_join2_ (left_, right_);
+}
+
+template <typename Key_, typename Comp_, typename Alloc_, typename Stats_>
+typename dynamic_order_avl_tree_<Key_, Comp_, Alloc_, Stats_>::subtree_
+dynamic_order_avl_tree_<Key_, Comp_, Alloc_, Stats_>::s_join2_ (subtree_ left_,
+                                                                subtree_ right_) noexcept
+{
+    if ( !right_.m_root_ )
+        return left_;
+
+    /* The least node of the right tree joins the two. */
+    auto [middle_, rest_] = s_split_at_rank_ (right_, 1);
+    return s_join_ (left_, middle_.m_root_, rest_);
+}
+
+template <typename Key_, typename Comp_, typename Alloc_, typename Stats_>
+void dynamic_order_avl_tree_<Key_, Comp_, Alloc_, Stats_>::set_union (self_ &other_,
+                                                                      unsigned threads_)
+{
+    if ( this == &other_ || other_.empty () )
+        return;
+
+    m_node_pool_.m_adopt_ (other_.m_node_pool_);
+    auto tree_   = subtree_ {m_root_ (), s_height_ (m_root_ ())};
+    auto others_ = subtree_ {other_.m_root_ (), s_height_ (other_.m_root_ ())};
+    other_.m_header_struct_.m_reset_ ();
+    other_.m_stats_.m_reset_sizes_ ();
+
+    drop_list_ dropped_;
+    spare_threads_ spare_ (threads_ > 1 ? threads_ - 1 : 0);
+    m_set_root_ (m_union_ (tree_, others_, spare_, dropped_).m_root_);
+    m_free_ (dropped_);
+}
+
+template <typename Key_, typename Comp_, typename Alloc_, typename Stats_>
+void dynamic_order_avl_tree_<Key_, Comp_, Alloc_, Stats_>::set_intersection (const self_ &other_,
+                                                                             unsigned threads_)
+{
+    if ( this == &other_ )
+        return;
+
+    auto tree_   = subtree_ {m_root_ (), s_height_ (m_root_ ())};
+    auto others_ = subtree_ {other_.m_root_ (), s_height_ (other_.m_root_ ())};
+    drop_list_ dropped_;
+    spare_threads_ spare_ (threads_ > 1 ? threads_ - 1 : 0);
+    m_set_root_ (m_filter_<true> (tree_, others_, spare_, dropped_).m_root_);
+    m_free_ (dropped_);
+}
+
+template <typename Key_, typename Comp_, typename Alloc_, typename Stats_>
+void dynamic_order_avl_tree_<Key_, Comp_, Alloc_, Stats_>::set_difference (const self_ &other_,
+                                                                           unsigned threads_)
+{
+    if ( this == &other_ )
+    {
+        clear ();
+        return;
+    }
+
+    auto tree_   = subtree_ {m_root_ (), s_height_ (m_root_ ())};
+    auto others_ = subtree_ {other_.m_root_ (), s_height_ (other_.m_root_ ())};
+    drop_list_ dropped_;
+    spare_threads_ spare_ (threads_ > 1 ? threads_ - 1 : 0);
+    m_set_root_ (m_filter_<false> (tree_, others_, spare_, dropped_).m_root_);
+    m_free_ (dropped_);
+}
+
+template <typename Key_, typename Comp_, typename Alloc_, typename Stats_>
+std::pair<typename dynamic_order_avl_tree_<Key_, Comp_, Alloc_, Stats_>::subtree_,
+          typename dynamic_order_avl_tree_<Key_, Comp_, Alloc_, Stats_>::subtree_>
+dynamic_order_avl_tree_<Key_, Comp_, Alloc_, Stats_>::s_split_at_rank_ (subtree_ tree_,
+                                                                        size_type k_) noexcept
+{
+    if ( !tree_.m_root_ )
+        return {subtree_ {}, subtree_ {}};
+
+    auto root_           = tree_.m_root_;
+    auto [left_, right_] = s_expose_ (tree_);
+    auto left_size_      = node_::size (left_.m_root_);
+
+    if ( k_ < left_size_ )
+    {
+        auto [first_, rest_] = s_split_at_rank_ (left_, k_);
+        return {first_, s_join_ (rest_, root_, right_)};
+    }
+
+    if ( k_ > left_size_ )
+    {
+        auto [first_, rest_] = s_split_at_rank_ (right_, k_ - left_size_ - 1);
+        return {s_join_ (left_, root_, first_), rest_};
+    }
+
+    return {left_, s_join_ (subtree_ {}, root_, right_)};
+}
+
+template <typename Key_, typename Comp_, typename Alloc_, typename Stats_>
+typename dynamic_order_avl_tree_<Key_, Comp_, Alloc_, Stats_>::self_
+dynamic_order_avl_tree_<Key_, Comp_, Alloc_, Stats_>::split (const value_type &key_)
+{
+    return split_at_rank (m_count_before_<false> (key_));
+}
+
+template <typename Key_, typename Comp_, typename Alloc_, typename Stats_>
+typename dynamic_order_avl_tree_<Key_, Comp_, Alloc_, Stats_>::self_
+dynamic_order_avl_tree_<Key_, Comp_, Alloc_, Stats_>::split_at_rank (size_type k_)
+{
+    self_ res_ (m_compare_struct_.m_key_compare_, get_allocator ());
+    if ( k_ >= size () )
+        return res_;
+
+    /* The whole tree goes, no slabs need to be shared. */
+    if ( !k_ )
+    {
+        res_ = std::move (*this);
+        return res_;
+    }
+
+    m_node_pool_.m_share_ (res_.m_node_pool_, size () - k_);
+    auto [first_, rest_] = s_split_at_rank_ (subtree_ {m_root_ (), s_height_ (m_root_ ())}, k_);
+    m_set_root_ (first_.m_root_);
+    res_.m_set_root_ (rest_.m_root_);
+    return res_;
+}
+
+template <typename Key_, typename Comp_, typename Alloc_, typename Stats_>
+void dynamic_order_avl_tree_<Key_, Comp_, Alloc_, Stats_>::join (self_ &other_)
+{
+    if ( other_.empty () || this == &other_ )
+        return;
+    if ( empty () )
+    {
+        *this = std::move (other_);
+        return;
+    }
+
+    auto &comp_  = m_compare_struct_.m_key_compare_;
+    bool append_ = comp_ (s_key_ (m_end_ ()), s_key_ (other_.m_begin_ ()));
+    if ( !append_ && !comp_ (s_key_ (other_.m_end_ ()), s_key_ (m_begin_ ())) )
+        throw std::invalid_argument ("Keys of the joined trees overlap.");
+
+    m_node_pool_.m_adopt_ (other_.m_node_pool_);
+    auto tree_   = subtree_ {m_root_ (), s_height_ (m_root_ ())};
+    auto others_ = subtree_ {other_.m_root_ (), s_height_ (other_.m_root_ ())};
+    other_.m_header_struct_.m_reset_ ();
+    other_.m_stats_.m_reset_sizes_ ();
+
+    /* The least node of the right tree joins the two. */
+    auto [left_, right_]  = (append_ ? std::pair (tree_, others_) : std::pair (others_, tree_));
+    auto [middle_, rest_] = s_split_at_rank_ (right_, 1);
+    m_set_root_ (s_join_ (left_, middle_.m_root_, rest_).m_root_);
+}
+
+template <typename Key_, typename Comp_, typename Alloc_, typename Stats_>
+void dynamic_order_avl_tree_<Key_, Comp_, Alloc_, Stats_>::m_destroy_subtree_ (
+    node_ptr_ node_) noexcept
+{
+    /* Trivial keys leave nothing to destroy, so the whole tree is dropped with its slabs. */
+    if constexpr ( !std::is_trivially_destructible_v<value_type> )
+        m_free_subtree_ (node_);
+}
 
-    return target_;
+template <typename Key_, typename Comp_, typename Alloc_, typename Stats_>
+void dynamic_order_avl_tree_<Key_, Comp_, Alloc_, Stats_>::m_free_subtree_ (
+    node_ptr_ node_) noexcept
+{
+    free_subtree_ (m_node_pool_, node_);
 }
 
-template <typename Key_, typename Comp_>
-void dynamic_order_avl_tree_<Key_, Comp_>::m_rebalance_after_insert_ (node_ptr_ node_)
+template <typename Key_, typename Comp_, typename Alloc_, typename Stats_>
+void dynamic_order_avl_tree_<Key_, Comp_, Alloc_, Stats_>::m_rebalance_after_insert_ (
+    node_ptr_ node_)
 {
 
     /*
-     * 1. update the balance factor of parent node;
+     * 1. update the size and the balance factor of parent node;
      * 2. rebalance if the balance factor of parent node temporarily becomes +2 or -2;
      * 3. terminate if the height of that parent subtree remains unchanged.
      */
@@ -969,15 +2223,22 @@ void dynamic_order_avl_tree_<Key_, Comp_>::m_rebalance_after_insert_ (node_ptr_
     auto curr_   = node_;
     auto parent_ = curr_->m_parent_;
 
+    /* Levels climbed, for the statistics. */
+    std::uint64_t steps_ = 0;
+
     while ( curr_ != m_root_ () )
     {
+        steps_++;
+        parent_->m_size_++;
+
         int &bf_ = parent_->m_bf_;
         if ( curr_->is_left_child_ () ) /* The height of left subtree of parent subtree increases */
         {
             if ( bf_ == 1 )
             {
                 /* The height of parent subtree remains unchanged, thus backtracking terminate. */
-                bf_ = 0;
+                bf_   = 0;
+                curr_ = parent_;
                 break;
             }
             else if ( bf_ == 0 )
@@ -991,7 +2252,7 @@ void dynamic_order_avl_tree_<Key_, Comp_>::m_rebalance_after_insert_ (node_ptr_
             else if ( bf_ == -1 )
             {
                 /* The balance factor becomes -2, thus need to fix imbalance. */
-                parent_->m_fix_left_imbalance_insert_ ();
+                curr_ = m_fix_imbalance_ (parent_, &node_::m_fix_left_imbalance_insert_);
                 break;
             }
             else
@@ -1002,7 +2263,8 @@ void dynamic_order_avl_tree_<Key_, Comp_>::m_rebalance_after_insert_ (node_ptr_
             if ( bf_ == -1 )
             {
                 /* The height of parent subtree remains unchanged, thus backtracking terminate. */
-                bf_ = 0;
+                bf_   = 0;
+                curr_ = parent_;
                 break;
             }
             else if ( bf_ == 0 )
@@ -1019,7 +2281,7 @@ void dynamic_order_avl_tree_<Key_, Comp_>::m_rebalance_after_insert_ (node_ptr_
                  * The balance factor becomes 2, thus need to fix imbalance.
                  * After fixing parent tree has the same height, thus backtracking terminate.
                  */
-                parent_->m_fix_right_imbalance_insert_ ();
+                curr_ = m_fix_imbalance_ (parent_, &node_::m_fix_right_imbalance_insert_);
                 break;
             }
             else
@@ -1028,10 +2290,16 @@ void dynamic_order_avl_tree_<Key_, Comp_>::m_rebalance_after_insert_ (node_ptr_
         curr_   = parent_;
         parent_ = curr_->m_parent_;
     }
+    m_stats_.m_backtrack_ (steps_);
+
+    /* Heights above are the same, but sizes still grow up to the root. */
+    /* Only the header has no parent. */
+    for ( auto node_ = curr_->m_parent_; node_->m_parent_; node_ = node_->m_parent_ )
+        node_->m_size_++;
 }
 
-template <typename Key_, typename Comp_>
-void dynamic_order_avl_tree_<Key_, Comp_>::m_rebalance_for_erase_ (node_ptr_ node_)
+template <typename Key_, typename Comp_, typename Alloc_, typename Stats_>
+void dynamic_order_avl_tree_<Key_, Comp_, Alloc_, Stats_>::m_rebalance_for_erase_ (node_ptr_ node_)
 {
 
     /*
@@ -1044,8 +2312,11 @@ void dynamic_order_avl_tree_<Key_, Comp_>::m_rebalance_for_erase_ (node_ptr_ nod
     auto curr_   = node_;
     auto parent_ = node_->m_parent_;
 
+    std::uint64_t steps_ = 0;
+
     while ( curr_ != m_root_ () )
     {
+        steps_++;
         auto &parent_bf_ = parent_->m_bf_;
 
         if ( curr_
@@ -1063,8 +2334,10 @@ void dynamic_order_avl_tree_<Key_, Comp_>::m_rebalance_for_erase_ (node_ptr_ nod
             else if ( parent_bf_ == 1 )
             {
                 /* The balance factor becomes 2, thus need to fix imbalance. */
-                parent_->m_fix_right_imbalance_erase_ ();
-                break;
+                parent_ = m_fix_imbalance_ (parent_, &node_::m_fix_right_imbalance_erase_);
+                /* Height of the rotated subtree decreases unless it stays unbalanced. */
+                if ( parent_->m_bf_ )
+                    break;
             }
             else
                 throw std::out_of_range ("Unexpected value of bf.");
@@ -1083,24 +2356,30 @@ void dynamic_order_avl_tree_<Key_, Comp_>::m_rebalance_for_erase_ (node_ptr_ nod
             else if ( parent_bf_ == -1 )
             {
                 /* The balance factor becomes -2, thus need to fix imbalance. */
-                parent_->m_fix_left_imbalance_erase_ ();
-                break;
+                parent_ = m_fix_imbalance_ (parent_, &node_::m_fix_left_imbalance_erase_);
+                /* Height of the rotated subtree decreases unless it stays unbalanced. */
+                if ( parent_->m_bf_ )
+                    break;
             }
         }
 
         curr_   = parent_;
         parent_ = curr_->m_parent_;
     }
+    m_stats_.m_backtrack_ (steps_);
 }
 
 // Accessors.
-template <typename Key_, typename Comp_>
-typename dynamic_order_avl_tree_<Key_, Comp_>::iterator
-dynamic_order_avl_tree_<Key_, Comp_>::m_lower_bound_ (node_ptr_ x_, node_ptr_ y_,
-                                                      const value_type &k_)
+template <typename Key_, typename Comp_, typename Alloc_, typename Stats_>
+typename dynamic_order_avl_tree_<Key_, Comp_, Alloc_, Stats_>::iterator
+dynamic_order_avl_tree_<Key_, Comp_, Alloc_, Stats_>::m_lower_bound_ (node_ptr_ x_, node_ptr_ y_,
+                                                                      const value_type &k_)
 {
+    auto stats_ = m_stats_.m_descent_ ();
     while ( x_ )
     {
+        stats_.m_visit_ ();
+        stats_.m_compare_ ();
         bool key_bigger_ = this->m_compare_struct_.m_key_compare_ (s_key_ (x_), k_);
         if ( !key_bigger_ )
         {
@@ -1113,13 +2392,16 @@ dynamic_order_avl_tree_<Key_, Comp_>::m_lower_bound_ (node_ptr_ x_, node_ptr_ y_
     return iterator (y_, this);
 }
 
-template <typename Key_, typename Comp_>
-typename dynamic_order_avl_tree_<Key_, Comp_>::iterator
-dynamic_order_avl_tree_<Key_, Comp_>::m_upper_bound_ (node_ptr_ x_, node_ptr_ y_,
-                                                      const value_type &k_)
+template <typename Key_, typename Comp_, typename Alloc_, typename Stats_>
+typename dynamic_order_avl_tree_<Key_, Comp_, Alloc_, Stats_>::iterator
+dynamic_order_avl_tree_<Key_, Comp_, Alloc_, Stats_>::m_upper_bound_ (node_ptr_ x_, node_ptr_ y_,
+                                                                      const value_type &k_)
 {
+    auto stats_ = m_stats_.m_descent_ ();
     while ( x_ )
     {
+        stats_.m_visit_ ();
+        stats_.m_compare_ ();
         bool key_less_ = this->m_compare_struct_.m_key_compare_ (k_, s_key_ (x_));
         if ( key_less_ )
         {
@@ -0,0 +1,1160 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <alex.rom23@mail.ru> wrote this file.  As long as you retain this notice you
+ * can do whatever you want with this stuff. If we meet some day, and you think
+ * this stuff is worth it, you can buy me a beer in return.   Alex Romanov
+ * ----------------------------------------------------------------------------
+ */
+
+// order statistic b+ tree implementation header
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#include "avl_tree.hpp"
+#include "node_pool.hpp"
+
+namespace rethinking_stl
+{
+
+//==============================in-node search==============================
+
+// Keys which are compared with SIMD instructions inside the nodes.
+template <typename Key_, typename Compare_>
+inline constexpr bool btree_simd_keys_ =
+    std::is_same_v<Key_, std::int32_t> && std::is_same_v<Compare_, std::less<Key_>>;
+
+#if defined(__SSE2__)
+// Number of the first n_ keys less then key_ (not greater if Inclusive_). Reads whole vectors
+// within capacity_ and the keys behind the last one one by one.
+template <bool Inclusive_>
+inline std::uint32_t btree_simd_count_before_ (const std::int32_t *keys_, std::size_t capacity_,
+                                               std::uint32_t n_, std::int32_t key_) noexcept
+{
+    std::uint32_t count_ = 0;
+    std::size_t i_       = 0;
+
+    /* Lanes past n_ are masked out of the comparison results. */
+    auto valid_ = [n_] (std::size_t i_, unsigned lanes_) {
+        return (n_ - i_ >= lanes_ ? (1u << lanes_) - 1 : (1u << (n_ - i_)) - 1);
+    };
+
+#if defined(__AVX2__)
+    auto key8_ = _mm256_set1_epi32 (key_);
+    for ( ; i_ + 8 <= capacity_ && i_ < n_; i_ += 8 )
+    {
+        auto keys8_   = _mm256_loadu_si256 (reinterpret_cast<const __m256i *> (keys_ + i_));
+        auto greater_ = (Inclusive_ ? _mm256_cmpgt_epi32 (keys8_, key8_)
+                                    : _mm256_cmpgt_epi32 (key8_, keys8_));
+        auto bits_     = _mm256_movemask_ps (_mm256_castsi256_ps (greater_));
+        unsigned mask_ = static_cast<unsigned> (bits_);
+        if constexpr ( Inclusive_ )
+            mask_ = ~mask_;
+        count_ += std::popcount (mask_ & valid_ (i_, 8));
+    }
+#endif
+
+    auto key4_ = _mm_set1_epi32 (key_);
+    for ( ; i_ + 4 <= capacity_ && i_ < n_; i_ += 4 )
+    {
+        auto keys4_   = _mm_loadu_si128 (reinterpret_cast<const __m128i *> (keys_ + i_));
+        auto greater_ = (Inclusive_ ? _mm_cmpgt_epi32 (keys4_, key4_)
+                                     : _mm_cmpgt_epi32 (key4_, keys4_));
+        unsigned mask_ = static_cast<unsigned> (_mm_movemask_ps (_mm_castsi128_ps (greater_)));
+        if constexpr ( Inclusive_ )
+            mask_ = ~mask_;
+        count_ += std::popcount (mask_ & valid_ (i_, 4));
+    }
+
+    for ( ; i_ < n_; i_++ )
+        count_ += (Inclusive_ ? keys_[i_] <= key_ : keys_[i_] < key_);
+    return count_;
+}
+#endif
+
+// Number of the first n_ sorted keys less then key_ (not greater if Inclusive_).
+template <bool Inclusive_, typename Key_, std::size_t N_, typename Compare_>
+std::uint32_t btree_count_before_ (const std::array<Key_, N_> &keys_, std::uint32_t n_,
+                                   const Key_ &key_, const Compare_ &comp_)
+{
+#if defined(__SSE2__)
+    if constexpr ( btree_simd_keys_<Key_, Compare_> )
+        return btree_simd_count_before_<Inclusive_> (keys_.data (), N_, n_, key_);
+#endif
+
+    /* Nodes are small, so the branchless scan beats the binary search. */
+    std::uint32_t count_ = 0;
+    for ( std::uint32_t i_ = 0; i_ < n_; i_++ )
+        count_ += (Inclusive_ ? !comp_ (key_, keys_[i_]) : comp_ (keys_[i_], key_));
+    return count_;
+}
+
+// Sum of the first n_ subtree sizes.
+template <std::size_t N_>
+std::size_t btree_sum_sizes_ (const std::array<std::uint32_t, N_> &sizes_, std::uint32_t n_)
+{
+#if defined(__SSE2__)
+    if constexpr ( N_ % 4 == 0 )
+    {
+        auto sum_   = _mm_setzero_si128 ();
+        auto n4_    = _mm_set1_epi32 (static_cast<int> (n_));
+        auto lanes_ = _mm_setr_epi32 (0, 1, 2, 3);
+        for ( std::size_t i_ = 0; i_ < N_ && i_ < n_; i_ += 4 )
+        {
+            auto from_   = reinterpret_cast<const __m128i *> (sizes_.data () + i_);
+            auto sizes4_ = _mm_and_si128 (_mm_loadu_si128 (from_), _mm_cmplt_epi32 (lanes_, n4_));
+            sum_         = _mm_add_epi32 (sum_, sizes4_);
+            lanes_       = _mm_add_epi32 (lanes_, _mm_set1_epi32 (4));
+        }
+
+        sum_ = _mm_add_epi32 (sum_, _mm_shuffle_epi32 (sum_, _MM_SHUFFLE (1, 0, 3, 2)));
+        sum_ = _mm_add_epi32 (sum_, _mm_shuffle_epi32 (sum_, _MM_SHUFFLE (2, 3, 0, 1)));
+        return static_cast<std::uint32_t> (_mm_cvtsi128_si32 (sum_));
+    }
+#endif
+
+    std::size_t sum_ = 0;
+    for ( std::uint32_t i_ = 0; i_ < n_; i_++ )
+        sum_ += sizes_[i_];
+    return sum_;
+}
+
+// Return the child holding the i_th (from 1) key of the node and reduce i_ by the sizes of
+// the children before it. Sizes of the unused children have to be zero.
+template <std::size_t N_>
+std::uint32_t btree_find_rank_ (const std::array<std::uint32_t, N_> &sizes_, std::size_t &i_)
+{
+#if defined(__SSE2__)
+    if constexpr ( N_ % 4 == 0 )
+    {
+        /* Sizes are unsigned, flip the sign bits to compare them as signed. */
+        auto sign_   = _mm_set1_epi32 (std::numeric_limits<std::int32_t>::min ());
+        auto target_ = _mm_xor_si128 (_mm_set1_epi32 (static_cast<int> (i_)), sign_);
+        auto carry_  = _mm_setzero_si128 ();
+
+        for ( std::size_t c_ = 0; c_ < N_; c_ += 4 )
+        {
+            /* Inclusive prefix sums of four sizes plus the sum of all before them. */
+            auto sums_ = _mm_loadu_si128 (reinterpret_cast<const __m128i *> (sizes_.data () + c_));
+            sums_      = _mm_add_epi32 (sums_, _mm_slli_si128 (sums_, 4));
+            sums_      = _mm_add_epi32 (sums_, _mm_slli_si128 (sums_, 8));
+            sums_      = _mm_add_epi32 (sums_, carry_);
+
+            auto less_     = _mm_cmplt_epi32 (_mm_xor_si128 (sums_, sign_), target_);
+            auto bits_     = _mm_movemask_ps (_mm_castsi128_ps (less_));
+            unsigned mask_ = ~static_cast<unsigned> (bits_) & 0xF;
+            if ( mask_ )
+            {
+                alignas (16) std::uint32_t prefix_[4];
+                _mm_store_si128 (reinterpret_cast<__m128i *> (prefix_), sums_);
+
+                auto lane_  = static_cast<std::uint32_t> (std::countr_zero (mask_));
+                auto child_ = static_cast<std::uint32_t> (c_) + lane_;
+                i_        -= prefix_[lane_] - sizes_[child_];
+                return child_;
+            }
+
+            carry_ = _mm_shuffle_epi32 (sums_, _MM_SHUFFLE (3, 3, 3, 3));
+        }
+
+        assert (false && "Rank is greater then the size of the node.");
+        return N_ - 1;
+    }
+#endif
+
+    std::uint32_t child_ = 0;
+    for ( ; i_ > sizes_[child_]; child_++ )
+        i_ -= sizes_[child_];
+    return child_;
+}
+
+//===============================btree nodes===============================
+/*
+ * Nodes link each other by 32-bit indices of their pools, 0 is no node. A leaf keeps its keys
+ * first, the links and the count follow, and fills one cache line for 4-byte keys.
+ */
+template <typename Key_, std::size_t Capacity_> struct alignas (64) btree_leaf_
+{
+    std::array<Key_, Capacity_> m_keys_ {};
+    std::uint32_t m_prev_  = 0;
+    std::uint32_t m_next_  = 0;
+    std::uint32_t m_count_ = 0;
+};
+
+/*
+ * Child c holds the keys in [m_keys_[c - 1], m_keys_[c]), so there are m_count_ - 1 separators.
+ *
+ * A descent compares the keys and reads the count, sums the sizes for ranks and takes one
+ * child. For 4-byte keys and 16 children each of them is one cache line of the aligned node.
+ */
+template <typename Key_, std::size_t Fanout_> struct alignas (64) btree_inner_
+{
+    std::array<Key_, Fanout_ - 1> m_keys_ {};
+    std::uint32_t m_count_ = 0;
+    std::array<std::uint32_t, Fanout_> m_sizes_ {}; /* zero for the unused children */
+    std::array<std::uint32_t, Fanout_> m_children_ {};
+};
+
+//=================================order_btree_=======================================
+/*
+ * B+ tree with the size of every child subtree stored next to the child link, so select and
+ * rank take one descent. Keys live only in the leaves, which are linked for iteration.
+ * A leaf with its links is a cache line for int keys, inner nodes hold 16 children in three
+ * lines: keys with the count, sizes and child indices. Sizes are 32-bit like in the compact
+ * engine. Nodes don't move, so iterators keep pointers to the leaves.
+ */
+template <typename Key_, class Compare_ = std::less<Key_>, class Allocator_ = std::allocator<Key_>>
+struct order_btree_
+{
+    static_assert (std::is_default_constructible_v<Key_>, "Nodes keep arrays of keys.");
+
+    using key_compare_ = do_avl_tree_key_compare_<Compare_>;
+    using self_        = order_btree_<Key_, Compare_, Allocator_>;
+    using count_type   = std::uint32_t;
+
+    /* Keys fill the line of a leaf up to its links and count. */
+    static constexpr std::size_t s_leaf_capacity_ =
+        std::max<std::size_t> (8, (64 - 3 * sizeof (std::uint32_t)) / sizeof (Key_));
+    static constexpr std::size_t s_fanout_ = 16;
+
+    /* Nodes except the root are at least half full. */
+    static constexpr count_type s_min_leaf_  = s_leaf_capacity_ / 2;
+    static constexpr count_type s_min_inner_ = s_fanout_ / 2;
+
+    /* Tree of 2^32 keys with half full nodes is less then 11 levels high. */
+    static constexpr std::size_t s_max_height_ = 32;
+
+    using leaf_node_  = btree_leaf_<Key_, s_leaf_capacity_>;
+    using inner_node_ = btree_inner_<Key_, s_fanout_>;
+    using leaf_pool_  = indexed_node_pool_<leaf_node_, Allocator_>;
+    using inner_pool_ = indexed_node_pool_<inner_node_, Allocator_>;
+    using node_index_ = std::uint32_t; /* of a leaf or an inner node by the height */
+
+    static constexpr node_index_ s_null_ = 0;
+
+    key_compare_ m_compare_struct_;
+    leaf_pool_ m_leaf_pool_;
+    inner_pool_ m_inner_pool_;
+
+    node_index_ m_root_   = s_null_;
+    std::size_t m_height_ = 0; /* number of inner levels above the leaves */
+    std::size_t m_size_   = 0;
+    node_index_ m_first_  = s_null_;
+    node_index_ m_last_   = s_null_;
+
+    leaf_node_ *m_leaf_ (node_index_ x_) const noexcept { return m_leaf_pool_.m_at_ (x_); }
+    inner_node_ *m_inner_ (node_index_ x_) const noexcept { return m_inner_pool_.m_at_ (x_); }
+
+    // Inner nodes visited by a descent and the children taken.
+    struct path_
+    {
+        std::array<inner_node_ *, s_max_height_> m_nodes_;
+        std::array<count_type, s_max_height_> m_children_;
+    };
+
+    struct btree_iterator_
+    {
+        using value_type = Key_;
+        using reference  = const Key_ &;
+        using pointer    = const Key_ *;
+
+        using iterator_category = std::bidirectional_iterator_tag;
+        using difference_type   = std::ptrdiff_t;
+
+        using self_ = btree_iterator_;
+
+        btree_iterator_ () noexcept : m_leaf_ (nullptr), m_pos_ (0), m_tree_ (nullptr) {}
+
+        btree_iterator_ (leaf_node_ *leaf_, count_type pos_, const order_btree_ *tree_) noexcept
+            : m_leaf_ (leaf_), m_pos_ (pos_), m_tree_ (tree_)
+        {
+        }
+
+        reference operator* () const { return m_leaf_->m_keys_[m_pos_]; }
+
+        pointer operator->() const { return &m_leaf_->m_keys_[m_pos_]; }
+
+        self_ &operator++ () noexcept   // pre-increment
+        {
+            if ( ++m_pos_ == m_leaf_->m_count_ )
+            {
+                m_leaf_ = m_tree_->m_leaf_at_ (m_leaf_->m_next_);
+                m_pos_  = 0;
+            }
+            return *this;
+        }
+
+        self_ operator++ (int) noexcept   // post-increment
+        {
+            self_ tmp_ = *this;
+            ++*this;
+            return tmp_;
+        }
+
+        self_ &operator-- () noexcept   // pre-decrement
+        {
+            if ( !m_leaf_ || !m_pos_ )
+            {
+                m_leaf_ = m_tree_->m_leaf_at_ (m_leaf_ ? m_leaf_->m_prev_ : m_tree_->m_last_);
+                m_pos_  = m_leaf_->m_count_;
+            }
+            m_pos_--;
+            return *this;
+        }
+
+        self_ operator-- (int) noexcept   // post-decrement
+        {
+            self_ tmp_ = *this;
+            --*this;
+            return tmp_;
+        }
+
+        bool operator== (const self_ &other_) const noexcept
+        {
+            return m_leaf_ == other_.m_leaf_ && m_pos_ == other_.m_pos_;
+        }
+
+        bool operator!= (const self_ &other_) const noexcept { return !(*this == other_); }
+
+        leaf_node_ *m_leaf_;
+        count_type m_pos_;
+        const order_btree_ *m_tree_;
+    };
+
+  public:
+    using value_type = Key_;
+    using pointer    = value_type *;
+    using reference  = value_type &;
+
+    using iterator         = btree_iterator_;
+    using reverse_iterator = std::reverse_iterator<iterator>;
+    using allocator_type   = Allocator_;
+
+    using size_type = std::size_t;
+
+  private:
+    bool m_less_ (const value_type &k1_, const value_type &k2_) const
+    {
+        return m_compare_struct_.m_key_compare_ (k1_, k2_);
+    }
+
+    // Leaf of the index, nullptr for s_null_.
+    leaf_node_ *m_leaf_at_ (node_index_ x_) const noexcept
+    {
+        return (x_ ? m_leaf_pool_.m_at_ (x_) : nullptr);
+    }
+
+    // Child of the inner node to descend for key_.
+    count_type m_child_for_ (const inner_node_ *node_, const value_type &key_) const
+    {
+        return btree_count_before_<true> (node_->m_keys_, node_->m_count_ - 1, key_,
+                                          m_compare_struct_.m_key_compare_);
+    }
+
+    // Descend to the leaf for key_ and record the path, return the index of the leaf.
+    node_index_ m_descend_ (const value_type &key_, path_ &path_) const;
+
+    // Position of the first key not less then key_ (greater if Upper_).
+    template <bool Upper_> iterator m_bound_ (const value_type &key_) const;
+
+    static size_type s_size_of_ (const inner_node_ *node_)
+    {
+        return btree_sum_sizes_ (node_->m_sizes_, node_->m_count_);
+    }
+
+    // Insert child_ with size_ after child c_ of not full node_, sep_ is its smallest key.
+    static void s_insert_child_ (inner_node_ *node_, count_type c_, const value_type &sep_,
+                                 node_index_ child_, size_type size_);
+
+    // Remove child c_ > 0 of node_ together with the separator before it.
+    static void s_erase_child_ (inner_node_ *node_, count_type c_);
+
+    // Merge or redistribute the children c_ and c_ + 1 of parent_ on the level above leaves.
+    void m_fix_leaves_ (inner_node_ *parent_, count_type c_);
+
+    // Merge or redistribute the inner children c_ and c_ + 1 of parent_.
+    void m_fix_inners_ (inner_node_ *parent_, count_type c_);
+
+    void m_destroy_subtree_ (node_index_ node_, std::size_t height_) noexcept;
+
+    // Replace the contents of empty tree with n_ strictly increasing keys.
+    template <typename It_> void m_build_ (It_ first_, size_type n_);
+
+    void m_reset_ () noexcept
+    {
+        m_root_   = s_null_;
+        m_height_ = 0;
+        m_size_   = 0;
+        m_first_  = s_null_;
+        m_last_   = s_null_;
+    }
+
+  public:
+    order_btree_ () : m_compare_struct_ (Compare_ {}) {}
+
+    order_btree_ (const Compare_ &comp_, const Allocator_ &alloc_ = Allocator_ ())
+        : m_compare_struct_ (comp_), m_leaf_pool_ (alloc_), m_inner_pool_ (alloc_)
+    {
+    }
+
+    explicit order_btree_ (const Allocator_ &alloc_) : order_btree_ (Compare_ {}, alloc_) {}
+
+    template <std::input_iterator It_>
+    order_btree_ (It_ first_, It_ last_, const Compare_ &comp_ = Compare_ (),
+                  const Allocator_ &alloc_ = Allocator_ ())
+        : order_btree_ (comp_, alloc_)
+    {
+        assign (first_, last_);
+    }
+
+    order_btree_ (std::initializer_list<value_type> keys_, const Compare_ &comp_ = Compare_ (),
+                  const Allocator_ &alloc_ = Allocator_ ())
+        : order_btree_ (keys_.begin (), keys_.end (), comp_, alloc_)
+    {
+    }
+
+    order_btree_ (const self_ &other) = delete;
+    self_ &operator= (const self_ &other) = delete;
+
+    order_btree_ (self_ &&other) noexcept
+        : m_compare_struct_ (std::move (other.m_compare_struct_.m_key_compare_)),
+          m_leaf_pool_ (std::move (other.m_leaf_pool_)),
+          m_inner_pool_ (std::move (other.m_inner_pool_)), m_root_ (other.m_root_),
+          m_height_ (other.m_height_), m_size_ (other.m_size_), m_first_ (other.m_first_),
+          m_last_ (other.m_last_)
+    {
+        other.m_reset_ ();
+    }
+
+    self_ &operator= (self_ &&other) noexcept
+    {
+        std::swap (m_compare_struct_.m_key_compare_, other.m_compare_struct_.m_key_compare_);
+        m_leaf_pool_.swap (other.m_leaf_pool_);
+        m_inner_pool_.swap (other.m_inner_pool_);
+        std::swap (m_root_, other.m_root_);
+        std::swap (m_height_, other.m_height_);
+        std::swap (m_size_, other.m_size_);
+        std::swap (m_first_, other.m_first_);
+        std::swap (m_last_, other.m_last_);
+        return *this;
+    }
+
+    ~order_btree_ () { clear (); }
+
+    allocator_type get_allocator () const noexcept
+    {
+        return allocator_type (m_leaf_pool_.get_allocator ());
+    }
+
+    // Read only copy of the set for query heavy phases. Needs frozen_set.hpp.
+    frozen_order_statistic_set<Key_, Compare_, Allocator_> freeze () const
+    {
+        return frozen_order_statistic_set<Key_, Compare_, Allocator_> (
+            begin (), end (), m_compare_struct_.m_key_compare_, get_allocator ());
+    }
+
+    // Accessors.
+
+    iterator begin () const noexcept { return iterator (m_leaf_at_ (m_first_), 0, this); }
+
+    iterator end () const noexcept { return iterator (nullptr, 0, this); }
+
+    reverse_iterator rbegin () const noexcept { return reverse_iterator (end ()); }
+
+    reverse_iterator rend () const noexcept { return reverse_iterator (begin ()); }
+
+    size_type size () const noexcept { return m_size_; }
+
+    bool empty () const noexcept { return !m_size_; }
+
+    // Number of inner levels above the leaves.
+    size_type height () const noexcept { return m_height_; }
+
+    // Insert/erase.
+
+    // Return the position of the key and false if it's already inserted.
+    std::pair<iterator, bool> insert (const value_type &key_);
+
+    // Return number of erased elements.
+    size_type erase (const value_type &key_);
+
+    void erase (iterator pos_)
+    {
+        if ( pos_ != end () )
+            erase (*pos_);
+    }
+
+    // Replace the contents with the keys of the range in linear time if it's sorted.
+    template <typename It_> void assign (It_ first_, It_ last_)
+    {
+        clear ();
+        with_sorted_unique_range_<value_type> (
+            first_, last_, m_compare_struct_.m_key_compare_,
+            [this] (auto sorted_, size_type n_) { m_build_ (sorted_, n_); });
+    }
+
+    void clear () noexcept
+    {
+        if ( m_root_ )
+            m_destroy_subtree_ (m_root_, m_height_);
+        m_reset_ ();
+        m_leaf_pool_.m_release_ ();
+        m_inner_pool_.m_release_ ();
+    }
+
+    // Set operations.
+
+    iterator find (const value_type &key_) const
+    {
+        auto pos_ = lower_bound (key_);
+        return (pos_ == end () || m_less_ (key_, *pos_) ? end () : pos_);
+    }
+
+    iterator lower_bound (const value_type &k_) const { return m_bound_<false> (k_); }
+
+    iterator upper_bound (const value_type &k_) const { return m_bound_<true> (k_); }
+
+    // return key value of ith smallest element in the tree
+    value_type m_os_select_ (size_type i) const;
+
+    // Number of keys less then key_ (not greater if Inclusive_) by one descent from the root.
+    template <bool Inclusive_> size_type m_count_before_ (const value_type &key_) const;
+
+    // Return number of elements with the key less then the given one.
+    size_type m_get_number_less_then_ (const value_type &key_) const
+    {
+        return m_count_before_<false> (key_);
+    }
+
+    bool operator== (const order_btree_ &other_) const
+    {
+        return size () == other_.size () && std::equal (begin (), end (), other_.begin ());
+    }
+
+    bool operator!= (const order_btree_ &other_) const { return !(*this == other_); }
+
+    value_type os_select (size_type i) const { return m_os_select_ (i); }
+
+    size_type get_number_less_then (const value_type &key_) const
+    {
+        return m_get_number_less_then_ (key_);
+    }
+
+    // Number of keys less then key_, that is the 0-based position key_ would have in the set.
+    size_type rank (const value_type &key_) const { return m_count_before_<false> (key_); }
+
+    size_type count_less (const value_type &key_) const { return m_count_before_<false> (key_); }
+
+    size_type count_less_equal (const value_type &key_) const
+    {
+        return m_count_before_<true> (key_);
+    }
+
+    // Number of keys in the closed range [lo_, hi_], zero if hi_ is less then lo_.
+    size_type count_in_range (const value_type &lo_, const value_type &hi_) const
+    {
+        if ( m_less_ (hi_, lo_) )
+            return 0;
+        return m_count_before_<true> (hi_) - m_count_before_<false> (lo_);
+    }
+
+    // Return k_th smallest key among the keys not less then key_, so select_from (key_, 1) is
+    // the lower bound of key_. Throws std::out_of_range if there are less then k_ such keys.
+    value_type select_from (const value_type &key_, size_type k_) const
+    {
+        if ( !k_ )
+            throw std::out_of_range ("k is zero.");
+        return m_os_select_ (m_count_before_<false> (key_) + k_);
+    }
+};
+
+template <typename Key_, typename Comp_, typename Alloc_>
+typename order_btree_<Key_, Comp_, Alloc_>::node_index_
+order_btree_<Key_, Comp_, Alloc_>::m_descend_ (const value_type &key_, path_ &path_) const
+{
+    auto node_ = m_root_;
+    for ( std::size_t depth_ = 0; depth_ < m_height_; depth_++ )
+    {
+        auto inner_               = m_inner_ (node_);
+        auto child_               = m_child_for_ (inner_, key_);
+        path_.m_nodes_[depth_]    = inner_;
+        path_.m_children_[depth_] = child_;
+        node_                     = inner_->m_children_[child_];
+    }
+    return node_;
+}
+
+template <typename Key_, typename Comp_, typename Alloc_>
+template <bool Upper_>
+typename order_btree_<Key_, Comp_, Alloc_>::iterator
+order_btree_<Key_, Comp_, Alloc_>::m_bound_ (const value_type &key_) const
+{
+    if ( !m_root_ )
+        return end ();
+
+    path_ path_;
+    auto leaf_ = m_leaf_ (m_descend_ (key_, path_));
+    auto pos_  = btree_count_before_<Upper_> (leaf_->m_keys_, leaf_->m_count_, key_,
+                                              m_compare_struct_.m_key_compare_);
+
+    /* All keys of the leaf are less, the bound is the first key of the next one. */
+    if ( pos_ == leaf_->m_count_ )
+        return iterator (m_leaf_at_ (leaf_->m_next_), 0, this);
+    return iterator (leaf_, pos_, this);
+}
+
+template <typename Key_, typename Comp_, typename Alloc_>
+template <bool Inclusive_>
+typename order_btree_<Key_, Comp_, Alloc_>::size_type
+order_btree_<Key_, Comp_, Alloc_>::m_count_before_ (const value_type &key_) const
+{
+    if ( !m_root_ )
+        return 0;
+
+    size_type less_ = 0;
+    auto node_      = m_root_;
+
+    /* Children before the taken one are less then key_. */
+    for ( std::size_t depth_ = 0; depth_ < m_height_; depth_++ )
+    {
+        auto inner_ = m_inner_ (node_);
+        auto child_ = m_child_for_ (inner_, key_);
+        less_     += btree_sum_sizes_ (inner_->m_sizes_, child_);
+        node_       = inner_->m_children_[child_];
+    }
+
+    auto leaf_ = m_leaf_ (node_);
+    return less_ + btree_count_before_<Inclusive_> (leaf_->m_keys_, leaf_->m_count_, key_,
+                                                    m_compare_struct_.m_key_compare_);
+}
+
+template <typename Key_, typename Comp_, typename Alloc_>
+typename order_btree_<Key_, Comp_, Alloc_>::value_type
+order_btree_<Key_, Comp_, Alloc_>::m_os_select_ (size_type i) const
+{
+    if ( i > size () || !i )
+        throw std::out_of_range ("i is greater then the size of the tree or zero.");
+
+    auto node_ = m_root_;
+    for ( std::size_t depth_ = 0; depth_ < m_height_; depth_++ )
+    {
+        auto inner_ = m_inner_ (node_);
+        node_       = inner_->m_children_[btree_find_rank_ (inner_->m_sizes_, i)];
+    }
+
+    return m_leaf_ (node_)->m_keys_[i - 1];
+}
+
+template <typename Key_, typename Comp_, typename Alloc_>
+void order_btree_<Key_, Comp_, Alloc_>::s_insert_child_ (inner_node_ *node_, count_type c_,
+                                                          const value_type &sep_,
+                                                          node_index_ child_, size_type size_)
+{
+    auto n_ = node_->m_count_;
+    assert (n_ < s_fanout_);
+
+    std::move_backward (node_->m_keys_.begin () + c_, node_->m_keys_.begin () + n_ - 1,
+                        node_->m_keys_.begin () + n_);
+    std::move_backward (node_->m_children_.begin () + c_ + 1, node_->m_children_.begin () + n_,
+                        node_->m_children_.begin () + n_ + 1);
+    std::move_backward (node_->m_sizes_.begin () + c_ + 1, node_->m_sizes_.begin () + n_,
+                        node_->m_sizes_.begin () + n_ + 1);
+
+    node_->m_keys_[c_]         = sep_;
+    node_->m_children_[c_ + 1] = child_;
+    node_->m_sizes_[c_ + 1]    = static_cast<count_type> (size_);
+    node_->m_count_++;
+}
+
+template <typename Key_, typename Comp_, typename Alloc_>
+void order_btree_<Key_, Comp_, Alloc_>::s_erase_child_ (inner_node_ *node_, count_type c_)
+{
+    auto n_ = node_->m_count_;
+    assert (c_ > 0 && c_ < n_);
+
+    std::move (node_->m_keys_.begin () + c_, node_->m_keys_.begin () + n_ - 1,
+               node_->m_keys_.begin () + c_ - 1);
+    std::move (node_->m_children_.begin () + c_ + 1, node_->m_children_.begin () + n_,
+               node_->m_children_.begin () + c_);
+    std::move (node_->m_sizes_.begin () + c_ + 1, node_->m_sizes_.begin () + n_,
+               node_->m_sizes_.begin () + c_);
+
+    node_->m_sizes_[n_ - 1]    = 0;
+    node_->m_children_[n_ - 1] = s_null_;
+    node_->m_count_--;
+}
+
+template <typename Key_, typename Comp_, typename Alloc_>
+std::pair<typename order_btree_<Key_, Comp_, Alloc_>::iterator, bool>
+order_btree_<Key_, Comp_, Alloc_>::insert (const value_type &key_)
+{
+    if ( !m_root_ )
+    {
+        auto leaf_i_      = m_leaf_pool_.m_create_ ();
+        auto leaf_        = m_leaf_ (leaf_i_);
+        leaf_->m_keys_[0] = key_;
+        leaf_->m_count_   = 1;
+        m_root_           = leaf_i_;
+        m_first_          = m_last_ = leaf_i_;
+        m_size_           = 1;
+        return {iterator (leaf_, 0, this), true};
+    }
+
+    path_ path_;
+    auto leaf_i_ = m_descend_ (key_, path_);
+    auto leaf_   = m_leaf_ (leaf_i_);
+    auto pos_  = btree_count_before_<false> (leaf_->m_keys_, leaf_->m_count_, key_,
+                                             m_compare_struct_.m_key_compare_);
+
+    if ( pos_ < leaf_->m_count_ && !m_less_ (key_, leaf_->m_keys_[pos_]) )
+        return {iterator (leaf_, pos_, this), false};
+
+    if ( m_size_ == std::numeric_limits<count_type>::max () )
+        throw std::length_error ("Too many keys for 32-bit subtree sizes.");
+
+    /*
+     * Create all nodes the splits need before the tree is changed, so running out of memory
+     * leaves it intact. Full nodes split from the leaf up to the first not full ancestor.
+     */
+    node_index_ new_leaf_i_ = s_null_;
+    std::array<node_index_, s_max_height_ + 1> new_inners_ {};
+    std::size_t splits_ = 0;
+
+    if ( leaf_->m_count_ == s_leaf_capacity_ )
+    {
+        new_leaf_i_ = m_leaf_pool_.m_create_ ();
+        try
+        {
+            for ( auto depth_ = m_height_;
+                  splits_ < m_height_ && path_.m_nodes_[depth_ - 1]->m_count_ == s_fanout_;
+                  depth_-- )
+                new_inners_[splits_++] = m_inner_pool_.m_create_ ();
+            /* Split of the root grows the tree. */
+            if ( splits_ == m_height_ )
+                new_inners_[splits_++] = m_inner_pool_.m_create_ ();
+        }
+        catch ( ... )
+        {
+            m_leaf_pool_.m_destroy_ (new_leaf_i_);
+            for ( std::size_t i_ = 0; i_ < splits_; i_++ )
+                m_inner_pool_.m_destroy_ (new_inners_[i_]);
+            throw;
+        }
+    }
+
+    for ( std::size_t depth_ = 0; depth_ < m_height_; depth_++ )
+        path_.m_nodes_[depth_]->m_sizes_[path_.m_children_[depth_]]++;
+    m_size_++;
+
+    if ( !new_leaf_i_ )
+    {
+        auto keys_ = leaf_->m_keys_.begin ();
+        std::move_backward (keys_ + pos_, keys_ + leaf_->m_count_, keys_ + leaf_->m_count_ + 1);
+        leaf_->m_keys_[pos_] = key_;
+        leaf_->m_count_++;
+        return {iterator (leaf_, pos_, this), true};
+    }
+
+    /* Split the leaf with the new key into two halves. */
+    auto new_leaf_ = m_leaf_ (new_leaf_i_);
+    std::array<value_type, s_leaf_capacity_ + 1> keys_;
+    std::move (leaf_->m_keys_.begin (), leaf_->m_keys_.begin () + pos_, keys_.begin ());
+    keys_[pos_] = key_;
+    std::move (leaf_->m_keys_.begin () + pos_, leaf_->m_keys_.end (), keys_.begin () + pos_ + 1);
+
+    constexpr count_type left_n_ = (s_leaf_capacity_ + 1) / 2;
+    std::move (keys_.begin (), keys_.begin () + left_n_, leaf_->m_keys_.begin ());
+    std::move (keys_.begin () + left_n_, keys_.end (), new_leaf_->m_keys_.begin ());
+    leaf_->m_count_     = left_n_;
+    new_leaf_->m_count_ = s_leaf_capacity_ + 1 - left_n_;
+
+    new_leaf_->m_prev_ = leaf_i_;
+    new_leaf_->m_next_ = leaf_->m_next_;
+    (leaf_->m_next_ ? m_leaf_ (leaf_->m_next_)->m_prev_ : m_last_) = new_leaf_i_;
+    leaf_->m_next_ = new_leaf_i_;
+
+    auto res_ = (pos_ < left_n_ ? iterator (leaf_, pos_, this)
+                                : iterator (new_leaf_, pos_ - left_n_, this));
+
+    /* Hang the right half on the parent, splitting the full parents on the way up. */
+    value_type sep_       = new_leaf_->m_keys_[0];
+    node_index_ right_    = new_leaf_i_;
+    size_type left_size_  = leaf_->m_count_;
+    size_type right_size_ = new_leaf_->m_count_;
+    std::size_t next_new_ = 0;
+
+    for ( auto depth_ = m_height_; depth_ > 0; depth_-- )
+    {
+        auto parent_ = path_.m_nodes_[depth_ - 1];
+        auto c_      = path_.m_children_[depth_ - 1];
+
+        parent_->m_sizes_[c_] = static_cast<count_type> (left_size_);
+        if ( parent_->m_count_ < s_fanout_ )
+        {
+            s_insert_child_ (parent_, c_, sep_, right_, right_size_);
+            return {res_, true};
+        }
+
+        /* Gather children of the full parent and the new one and split them in halves. */
+        std::array<node_index_, s_fanout_ + 1> children_;
+        std::array<count_type, s_fanout_ + 1> sizes_;
+        std::array<value_type, s_fanout_> seps_;
+
+        std::copy (parent_->m_children_.begin (), parent_->m_children_.begin () + c_ + 1,
+                   children_.begin ());
+        std::copy (parent_->m_sizes_.begin (), parent_->m_sizes_.begin () + c_ + 1,
+                   sizes_.begin ());
+        std::move (parent_->m_keys_.begin (), parent_->m_keys_.begin () + c_, seps_.begin ());
+        children_[c_ + 1] = right_;
+        sizes_[c_ + 1]    = static_cast<count_type> (right_size_);
+        seps_[c_]         = sep_;
+        std::copy (parent_->m_children_.begin () + c_ + 1, parent_->m_children_.end (),
+                   children_.begin () + c_ + 2);
+        std::copy (parent_->m_sizes_.begin () + c_ + 1, parent_->m_sizes_.end (),
+                   sizes_.begin () + c_ + 2);
+        std::move (parent_->m_keys_.begin () + c_, parent_->m_keys_.begin () + s_fanout_ - 1,
+                   seps_.begin () + c_ + 1);
+
+        constexpr count_type left_c_  = (s_fanout_ + 1) / 2;
+        constexpr count_type right_c_ = s_fanout_ + 1 - left_c_;
+        auto sibling_i_               = new_inners_[next_new_++];
+        auto sibling_                 = m_inner_ (sibling_i_);
+
+        std::copy (children_.begin (), children_.begin () + left_c_, parent_->m_children_.begin ());
+        std::copy (sizes_.begin (), sizes_.begin () + left_c_, parent_->m_sizes_.begin ());
+        std::move (seps_.begin (), seps_.begin () + left_c_ - 1, parent_->m_keys_.begin ());
+        std::fill (parent_->m_children_.begin () + left_c_, parent_->m_children_.end (), s_null_);
+        std::fill (parent_->m_sizes_.begin () + left_c_, parent_->m_sizes_.end (), 0);
+        parent_->m_count_ = left_c_;
+
+        std::copy (children_.begin () + left_c_, children_.end (), sibling_->m_children_.begin ());
+        std::copy (sizes_.begin () + left_c_, sizes_.end (), sibling_->m_sizes_.begin ());
+        std::move (seps_.begin () + left_c_, seps_.end (), sibling_->m_keys_.begin ());
+        sibling_->m_count_ = right_c_;
+
+        sep_        = std::move (seps_[left_c_ - 1]);
+        right_      = sibling_i_;
+        left_size_  = s_size_of_ (parent_);
+        right_size_ = s_size_of_ (sibling_);
+    }
+
+    /* The root was split too. */
+    auto root_            = m_inner_ (new_inners_[next_new_]);
+    root_->m_children_[0] = m_root_;
+    root_->m_children_[1] = right_;
+    root_->m_sizes_[0]    = static_cast<count_type> (left_size_);
+    root_->m_sizes_[1]    = static_cast<count_type> (right_size_);
+    root_->m_keys_[0]     = sep_;
+    root_->m_count_       = 2;
+    m_root_               = new_inners_[next_new_];
+    m_height_++;
+
+    return {res_, true};
+}
+
+template <typename Key_, typename Comp_, typename Alloc_>
+typename order_btree_<Key_, Comp_, Alloc_>::size_type
+order_btree_<Key_, Comp_, Alloc_>::erase (const value_type &key_)
+{
+    if ( !m_root_ )
+        return 0;
+
+    path_ path_;
+    auto leaf_i_ = m_descend_ (key_, path_);
+    auto leaf_   = m_leaf_ (leaf_i_);
+    auto pos_    = btree_count_before_<false> (leaf_->m_keys_, leaf_->m_count_, key_,
+                                               m_compare_struct_.m_key_compare_);
+
+    if ( pos_ == leaf_->m_count_ || m_less_ (key_, leaf_->m_keys_[pos_]) )
+        return 0;
+
+    for ( std::size_t depth_ = 0; depth_ < m_height_; depth_++ )
+        path_.m_nodes_[depth_]->m_sizes_[path_.m_children_[depth_]]--;
+    m_size_--;
+
+    std::move (leaf_->m_keys_.begin () + pos_ + 1, leaf_->m_keys_.begin () + leaf_->m_count_,
+               leaf_->m_keys_.begin () + pos_);
+    leaf_->m_count_--;
+
+    if ( !m_height_ )
+    {
+        if ( !leaf_->m_count_ )
+        {
+            m_leaf_pool_.m_destroy_ (leaf_i_);
+            m_reset_ ();
+        }
+        return 1;
+    }
+
+    /* Fix underflows from the leaf up, the root may only lose its children. */
+    if ( leaf_->m_count_ >= s_min_leaf_ )
+        return 1;
+
+    auto depth_ = m_height_ - 1;
+    m_fix_leaves_ (path_.m_nodes_[depth_], path_.m_children_[depth_]);
+
+    while ( depth_ > 0 && path_.m_nodes_[depth_]->m_count_ < s_min_inner_ )
+    {
+        depth_--;
+        m_fix_inners_ (path_.m_nodes_[depth_], path_.m_children_[depth_]);
+    }
+
+    if ( auto root_i_ = m_root_; m_inner_ (root_i_)->m_count_ == 1 )
+    {
+        m_root_ = m_inner_ (root_i_)->m_children_[0];
+        m_height_--;
+        m_inner_pool_.m_destroy_ (root_i_);
+    }
+
+    return 1;
+}
+
+template <typename Key_, typename Comp_, typename Alloc_>
+void order_btree_<Key_, Comp_, Alloc_>::m_fix_leaves_ (inner_node_ *parent_, count_type c_)
+{
+    /* Pair the child with its left sibling if any, with the right one otherwise. */
+    if ( c_ > 0 )
+        c_--;
+
+    auto left_i_  = parent_->m_children_[c_];
+    auto right_i_ = parent_->m_children_[c_ + 1];
+    auto left_    = m_leaf_ (left_i_);
+    auto right_   = m_leaf_ (right_i_);
+    auto total_   = left_->m_count_ + right_->m_count_;
+
+    if ( total_ <= s_leaf_capacity_ )
+    {
+        std::move (right_->m_keys_.begin (), right_->m_keys_.begin () + right_->m_count_,
+                   left_->m_keys_.begin () + left_->m_count_);
+        left_->m_count_ = total_;
+
+        left_->m_next_ = right_->m_next_;
+        (right_->m_next_ ? m_leaf_ (right_->m_next_)->m_prev_ : m_last_) = left_i_;
+        m_leaf_pool_.m_destroy_ (right_i_);
+
+        s_erase_child_ (parent_, c_ + 1);
+        parent_->m_sizes_[c_] = total_;
+        return;
+    }
+
+    count_type left_n_ = total_ / 2;
+    if ( left_->m_count_ > left_n_ )
+    {
+        auto moved_ = left_->m_count_ - left_n_;
+        std::move_backward (right_->m_keys_.begin (), right_->m_keys_.begin () + right_->m_count_,
+                            right_->m_keys_.begin () + right_->m_count_ + moved_);
+        std::move (left_->m_keys_.begin () + left_n_, left_->m_keys_.begin () + left_->m_count_,
+                   right_->m_keys_.begin ());
+    }
+    else
+    {
+        auto moved_ = left_n_ - left_->m_count_;
+        std::move (right_->m_keys_.begin (), right_->m_keys_.begin () + moved_,
+                   left_->m_keys_.begin () + left_->m_count_);
+        std::move (right_->m_keys_.begin () + moved_, right_->m_keys_.begin () + right_->m_count_,
+                   right_->m_keys_.begin ());
+    }
+
+    left_->m_count_  = left_n_;
+    right_->m_count_ = total_ - left_n_;
+
+    parent_->m_keys_[c_]      = right_->m_keys_[0];
+    parent_->m_sizes_[c_]     = left_->m_count_;
+    parent_->m_sizes_[c_ + 1] = right_->m_count_;
+}
+
+template <typename Key_, typename Comp_, typename Alloc_>
+void order_btree_<Key_, Comp_, Alloc_>::m_fix_inners_ (inner_node_ *parent_, count_type c_)
+{
+    if ( c_ > 0 )
+        c_--;
+
+    auto right_i_ = parent_->m_children_[c_ + 1];
+    auto left_    = m_inner_ (parent_->m_children_[c_]);
+    auto right_   = m_inner_ (right_i_);
+    auto total_   = left_->m_count_ + right_->m_count_;
+
+    /* Gather children of both nodes with the separator from the parent between them. */
+    std::array<node_index_, 2 * s_fanout_> children_;
+    std::array<count_type, 2 * s_fanout_> sizes_;
+    std::array<value_type, 2 * s_fanout_> seps_;
+
+    auto n_ = left_->m_count_;
+    std::copy (left_->m_children_.begin (), left_->m_children_.begin () + n_, children_.begin ());
+    std::copy (left_->m_sizes_.begin (), left_->m_sizes_.begin () + n_, sizes_.begin ());
+    std::move (left_->m_keys_.begin (), left_->m_keys_.begin () + n_ - 1, seps_.begin ());
+    seps_[n_ - 1] = std::move (parent_->m_keys_[c_]);
+
+    std::copy (right_->m_children_.begin (), right_->m_children_.begin () + right_->m_count_,
+               children_.begin () + n_);
+    std::copy (right_->m_sizes_.begin (), right_->m_sizes_.begin () + right_->m_count_,
+               sizes_.begin () + n_);
+    std::move (right_->m_keys_.begin (), right_->m_keys_.begin () + right_->m_count_ - 1,
+               seps_.begin () + n_);
+
+    auto fill_ = [&] (inner_node_ *node_, count_type from_, count_type to_) {
+        std::copy (children_.begin () + from_, children_.begin () + to_,
+                   node_->m_children_.begin ());
+        std::copy (sizes_.begin () + from_, sizes_.begin () + to_, node_->m_sizes_.begin ());
+        std::move (seps_.begin () + from_, seps_.begin () + to_ - 1, node_->m_keys_.begin ());
+        std::fill (node_->m_children_.begin () + (to_ - from_), node_->m_children_.end (), s_null_);
+        std::fill (node_->m_sizes_.begin () + (to_ - from_), node_->m_sizes_.end (), 0);
+        node_->m_count_ = to_ - from_;
+    };
+
+    if ( total_ <= s_fanout_ )
+    {
+        fill_ (left_, 0, total_);
+        m_inner_pool_.m_destroy_ (right_i_);
+
+        s_erase_child_ (parent_, c_ + 1);
+        parent_->m_sizes_[c_] = static_cast<count_type> (s_size_of_ (left_));
+        return;
+    }
+
+    count_type left_n_ = total_ / 2;
+    fill_ (left_, 0, left_n_);
+    fill_ (right_, left_n_, total_);
+
+    parent_->m_keys_[c_]      = std::move (seps_[left_n_ - 1]);
+    parent_->m_sizes_[c_]     = static_cast<count_type> (s_size_of_ (left_));
+    parent_->m_sizes_[c_ + 1] = static_cast<count_type> (s_size_of_ (right_));
+}
+
+template <typename Key_, typename Comp_, typename Alloc_>
+void order_btree_<Key_, Comp_, Alloc_>::m_destroy_subtree_ (node_index_ node_,
+                                                             std::size_t height_) noexcept
+{
+    /* Trivial keys leave nothing to destroy, so the whole tree is dropped with its slabs. */
+    if constexpr ( !std::is_trivially_destructible_v<value_type> )
+    {
+        if ( !height_ )
+        {
+            m_leaf_pool_.m_destroy_ (node_);
+            return;
+        }
+
+        auto inner_ = m_inner_ (node_);
+        for ( count_type c_ = 0; c_ < inner_->m_count_; c_++ )
+            m_destroy_subtree_ (inner_->m_children_[c_], height_ - 1);
+        m_inner_pool_.m_destroy_ (node_);
+    }
+}
+
+template <typename Key_, typename Comp_, typename Alloc_>
+template <typename It_>
+void order_btree_<Key_, Comp_, Alloc_>::m_build_ (It_ first_, size_type n_)
+{
+    if ( !n_ )
+        return;
+
+    if ( n_ > std::numeric_limits<count_type>::max () )
+        throw std::length_error ("Too many keys for 32-bit subtree sizes.");
+
+    /* Level of the tree being built: nodes with their sizes and smallest keys. */
+    struct entry_
+    {
+        node_index_ m_node_;
+        size_type m_size_;
+        const value_type *m_min_;
+    };
+    std::vector<entry_> level_, upper_;
+    std::vector<node_index_> inners_; /* to clean up the unfinished levels on failure */
+
+    /* Spread the keys evenly, so every node is at least half full. */
+    auto split_ = [] (size_type n_, size_type capacity_, auto emit_) {
+        size_type nodes_ = (n_ + capacity_ - 1) / capacity_;
+        for ( size_type i_ = 0, done_ = 0; i_ < nodes_; i_++ )
+        {
+            size_type next_ = n_ * (i_ + 1) / nodes_;
+            emit_ (done_, next_ - done_);
+            done_ = next_;
+        }
+    };
+
+    try
+    {
+        node_index_ prev_ = s_null_;
+        level_.reserve ((n_ + s_leaf_capacity_ - 1) / s_leaf_capacity_);
+        split_ (n_, s_leaf_capacity_, [&] (size_type, size_type count_) {
+            auto leaf_i_   = m_leaf_pool_.m_create_ ();
+            auto leaf_     = m_leaf_ (leaf_i_);
+            leaf_->m_prev_ = prev_;
+            (prev_ ? m_leaf_ (prev_)->m_next_ : m_first_) = leaf_i_;
+            prev_                                          = leaf_i_;
+            level_.push_back ({leaf_i_, count_, &leaf_->m_keys_[0]});
+
+            for ( size_type i_ = 0; i_ < count_; i_++, ++first_ )
+                leaf_->m_keys_[i_] = *first_;
+            leaf_->m_count_ = static_cast<count_type> (count_);
+        });
+        m_last_ = prev_;
+
+        for ( ; level_.size () > 1; m_height_++ )
+        {
+            upper_.clear ();
+            split_ (level_.size (), s_fanout_, [&] (size_type from_, size_type count_) {
+                inners_.reserve (inners_.size () + 1);
+                auto inner_i_ = m_inner_pool_.m_create_ ();
+                auto inner_   = m_inner_ (inner_i_);
+                inners_.push_back (inner_i_);
+                upper_.push_back ({inner_i_, 0, level_[from_].m_min_});
+
+                for ( size_type c_ = 0; c_ < count_; c_++ )
+                {
+                    auto &child_            = level_[from_ + c_];
+                    inner_->m_children_[c_] = child_.m_node_;
+                    inner_->m_sizes_[c_]    = static_cast<count_type> (child_.m_size_);
+                    if ( c_ )
+                        inner_->m_keys_[c_ - 1] = *child_.m_min_;
+                    upper_.back ().m_size_ += child_.m_size_;
+                }
+                inner_->m_count_ = static_cast<count_type> (count_);
+            });
+            level_.swap (upper_);
+        }
+    }
+    catch ( ... )
+    {
+        /* Nodes are not linked into a tree yet, so they are destroyed one by one. */
+        if constexpr ( !std::is_trivially_destructible_v<value_type> )
+        {
+            for ( auto leaf_ = m_first_; leaf_; )
+            {
+                auto next_ = m_leaf_ (leaf_)->m_next_;
+                m_leaf_pool_.m_destroy_ (leaf_);
+                leaf_ = next_;
+            }
+            for ( auto inner_ : inners_ )
+                m_inner_pool_.m_destroy_ (inner_);
+        }
+        m_reset_ ();
+        m_leaf_pool_.m_release_ ();
+        m_inner_pool_.m_release_ ();
+        throw;
+    }
+
+    m_root_ = level_.front ().m_node_;
+    m_size_ = n_;
+}
+
+}   // namespace rethinking_stl
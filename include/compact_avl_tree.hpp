@@ -0,0 +1,1035 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <alex.rom23@mail.ru> wrote this file.  As long as you retain this notice you
+ * can do whatever you want with this stuff. If we meet some day, and you think
+ * this stuff is worth it, you can buy me a beer in return.   Alex Romanov
+ * ----------------------------------------------------------------------------
+ */
+
+// compact index based avl tree implementation header
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <initializer_list>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "avl_tree.hpp"
+
+namespace rethinking_stl
+{
+
+//===============================compact_avl_tree_node_===============================
+/*
+ * Node living in the contiguous pool of the tree and addressed by 32-bit index.
+ * Balance factors are kept aside in a byte array: lookups, select and rank never read them.
+ */
+template <typename Val_> struct compact_avl_tree_node_
+{
+    using value_type = Val_;
+    using index_type = std::uint32_t;
+    using size_type  = std::uint32_t;
+
+    value_type m_key_ {};
+    index_type m_left_  = 0;
+    index_type m_right_ = 0;
+    size_type m_size_   = 0;
+};
+
+//=================================compact_order_avl_tree_=======================================
+template <typename Key_, class Compare_ = std::less<Key_>, class Allocator_ = std::allocator<Key_>>
+struct compact_order_avl_tree_
+{
+    using key_compare_ = do_avl_tree_key_compare_<Compare_>;
+    using self_        = compact_order_avl_tree_<Key_, Compare_, Allocator_>;
+
+    using node_         = compact_avl_tree_node_<Key_>;
+    using index_type    = typename node_::index_type;
+    using height_diff_t = std::int8_t;
+
+    using alloc_traits_ = std::allocator_traits<Allocator_>;
+    using node_alloc_   = typename alloc_traits_::template rebind_alloc<node_>;
+    using bf_alloc_     = typename alloc_traits_::template rebind_alloc<height_diff_t>;
+
+    /* Index 0 is the null sentinel. Its size is zero, so empty subtrees need no branch. */
+    static constexpr index_type s_null_ = 0;
+
+    /* AVL tree of 2^32 nodes is less then 1.45 * 32 levels high. */
+    static constexpr std::size_t s_max_height_ = 64;
+
+    key_compare_ m_compare_struct_;
+    std::vector<node_, node_alloc_> m_nodes_;
+    std::vector<height_diff_t, bf_alloc_> m_bf_;
+    index_type m_root_ = s_null_;
+    index_type m_free_ = s_null_; /* free list threaded through m_left_ */
+
+    /* Path of a descent: visited nodes and directions (bit d is set if went right at depth d). */
+    struct path_
+    {
+        std::array<index_type, s_max_height_> m_nodes_;
+        std::uint64_t m_dirs_ = 0;
+        std::size_t m_depth_  = 0;
+
+        void push (index_type node_, bool right_)
+        {
+            m_dirs_ |= (std::uint64_t (right_) << m_depth_);
+            m_nodes_[m_depth_++] = node_;
+        }
+
+        bool went_right (std::size_t depth_) const { return (m_dirs_ >> depth_) & 1; }
+    };
+
+    struct compact_avl_tree_iterator_
+    {
+        using value_type = Key_;
+        using reference  = const Key_ &;
+        using pointer    = const Key_ *;
+
+        using iterator_category = std::bidirectional_iterator_tag;
+        using difference_type   = std::ptrdiff_t;
+
+        using self_ = compact_avl_tree_iterator_;
+
+        compact_avl_tree_iterator_ () noexcept : m_node_ (s_null_), m_tree_ (nullptr) {}
+
+        compact_avl_tree_iterator_ (index_type x_, const compact_order_avl_tree_ *tree_) noexcept
+            : m_node_ (x_), m_tree_ (tree_)
+        {
+        }
+
+        reference operator* () const { return m_tree_->m_nodes_[m_node_].m_key_; }
+
+        pointer operator->() const { return &m_tree_->m_nodes_[m_node_].m_key_; }
+
+        self_ &operator++ () noexcept   // pre-increment
+        {
+            m_node_ = m_tree_->m_successor_ (m_node_);
+            return *this;
+        }
+
+        self_ operator++ (int) noexcept   // post-increment
+        {
+            self_ tmp_ = *this;
+            m_node_    = m_tree_->m_successor_ (m_node_);
+            return tmp_;
+        }
+
+        self_ &operator-- () noexcept   // pre-decrement
+        {
+            m_node_ = m_tree_->m_predecessor_ (m_node_);
+            return *this;
+        }
+
+        self_ operator-- (int) noexcept   // post-decrement
+        {
+            self_ tmp_ = *this;
+            m_node_    = m_tree_->m_predecessor_ (m_node_);
+            return tmp_;
+        }
+
+        bool operator== (const self_ &other_) const noexcept { return m_node_ == other_.m_node_; }
+
+        bool operator!= (const self_ &other_) const noexcept { return m_node_ != other_.m_node_; }
+
+        index_type m_node_;
+        const compact_order_avl_tree_ *m_tree_;
+    };
+
+  public:
+    using value_type = Key_;
+    using pointer    = value_type *;
+    using reference  = value_type &;
+
+    using iterator         = compact_avl_tree_iterator_;
+    using reverse_iterator = std::reverse_iterator<iterator>;
+    using allocator_type   = Allocator_;
+
+    using size_type = std::size_t;
+
+  private:
+    bool m_less_ (const value_type &k1_, const value_type &k2_) const
+    {
+        return m_compare_struct_.m_key_compare_ (k1_, k2_);
+    }
+
+    node_ &m_node_ (index_type x_) noexcept { return m_nodes_[x_]; }
+    const node_ &m_node_ (index_type x_) const noexcept { return m_nodes_[x_]; }
+
+    index_type m_create_node_ (const value_type &key_);
+    void m_free_node_ (index_type x_) noexcept;
+
+    // Hang subtree x_ on the place of the node at depth_ of path.
+    void m_replace_child_ (const path_ &path_, std::size_t depth_, index_type x_) noexcept
+    {
+        if ( !depth_ )
+            m_root_ = x_;
+        else if ( path_.went_right (depth_ - 1) )
+            m_node_ (path_.m_nodes_[depth_ - 1]).m_right_ = x_;
+        else
+            m_node_ (path_.m_nodes_[depth_ - 1]).m_left_ = x_;
+    }
+
+    void m_update_size_ (index_type x_) noexcept
+    {
+        auto &node_   = m_node_ (x_);
+        node_.m_size_ = m_node_ (node_.m_left_).m_size_ + m_node_ (node_.m_right_).m_size_ + 1;
+    }
+
+    index_type m_rotate_left_ (index_type x_) noexcept;
+    index_type m_rotate_right_ (index_type x_) noexcept;
+
+    // Set balance factors of children of the new root after double rotation.
+    void m_fix_after_double_rotation_ (index_type x_, height_diff_t old_bf_) noexcept;
+
+    // Fix imbalances. Return the new root of subtree.
+    index_type m_fix_left_imbalance_insert_ (index_type x_) noexcept;
+    index_type m_fix_right_imbalance_insert_ (index_type x_) noexcept;
+    index_type m_fix_left_imbalance_erase_ (index_type x_) noexcept;
+    index_type m_fix_right_imbalance_erase_ (index_type x_) noexcept;
+
+    index_type m_minimum_ (index_type x_) const noexcept
+    {
+        if ( x_ != s_null_ )
+            while ( m_node_ (x_).m_left_ != s_null_ )
+                x_ = m_node_ (x_).m_left_;
+        return x_;
+    }
+
+    index_type m_maximum_ (index_type x_) const noexcept
+    {
+        if ( x_ != s_null_ )
+            while ( m_node_ (x_).m_right_ != s_null_ )
+                x_ = m_node_ (x_).m_right_;
+        return x_;
+    }
+
+    index_type m_lower_bound_ (const value_type &k_) const;
+    index_type m_upper_bound_ (const value_type &k_) const;
+
+    // Greatest node with the key less then the given one.
+    index_type m_prev_bound_ (const value_type &k_) const;
+
+    /* No parent links, so neighbours are found by one more descent from the root. */
+    index_type m_successor_ (index_type x_) const
+    {
+        if ( m_node_ (x_).m_right_ != s_null_ )
+            return m_minimum_ (m_node_ (x_).m_right_);
+        return m_upper_bound_ (m_node_ (x_).m_key_);
+    }
+
+    index_type m_predecessor_ (index_type x_) const
+    {
+        if ( x_ == s_null_ )
+            return m_maximum_ (m_root_);
+        if ( m_node_ (x_).m_left_ != s_null_ )
+            return m_maximum_ (m_node_ (x_).m_left_);
+        return m_prev_bound_ (m_node_ (x_).m_key_);
+    }
+
+    // Build perfectly balanced subtree of n_ strictly increasing keys starting from first_.
+    template <typename It_> index_type m_build_subtree_ (It_ &first_, size_type n_);
+
+    // Replace the contents of empty tree with n_ strictly increasing keys.
+    template <typename It_> void m_build_ (It_ first_, size_type n_)
+    {
+        if ( n_ >= std::numeric_limits<index_type>::max () )
+            throw std::length_error ("Too many nodes for 32-bit indices.");
+
+        m_nodes_.reserve (n_ + 1);
+        m_bf_.reserve (n_ + 1);
+        auto old_size_ = m_nodes_.size ();
+        try
+        {
+            m_root_ = m_build_subtree_ (first_, n_);
+        }
+        catch ( ... )
+        {
+            /* Nodes are pushed in order to the empty pool, so the built part is its tail. */
+            m_nodes_.resize (old_size_);
+            m_bf_.resize (old_size_);
+            throw;
+        }
+    }
+
+    void m_reset_ ()
+    {
+        decltype (m_nodes_) (m_nodes_.get_allocator ()).swap (m_nodes_);
+        decltype (m_bf_) (m_bf_.get_allocator ()).swap (m_bf_);
+        /* The null sentinel. */
+        m_nodes_.emplace_back ();
+        m_bf_.push_back (0);
+        m_root_ = s_null_;
+        m_free_ = s_null_;
+    }
+
+  public:
+    compact_order_avl_tree_ () : compact_order_avl_tree_ (Compare_ {}) {}
+
+    compact_order_avl_tree_ (const Compare_ &comp_, const Allocator_ &alloc_ = Allocator_ ())
+        : m_compare_struct_ (comp_), m_nodes_ (node_alloc_ (alloc_)), m_bf_ (bf_alloc_ (alloc_))
+    {
+        m_reset_ ();
+    }
+
+    explicit compact_order_avl_tree_ (const Allocator_ &alloc_)
+        : compact_order_avl_tree_ (Compare_ {}, alloc_)
+    {
+    }
+
+    template <std::input_iterator It_>
+    compact_order_avl_tree_ (It_ first_, It_ last_, const Compare_ &comp_ = Compare_ (),
+                             const Allocator_ &alloc_ = Allocator_ ())
+        : compact_order_avl_tree_ (comp_, alloc_)
+    {
+        assign (first_, last_);
+    }
+
+    compact_order_avl_tree_ (std::initializer_list<value_type> keys_,
+                             const Compare_ &comp_ = Compare_ (),
+                             const Allocator_ &alloc_ = Allocator_ ())
+        : compact_order_avl_tree_ (keys_.begin (), keys_.end (), comp_, alloc_)
+    {
+    }
+
+    compact_order_avl_tree_ (const self_ &other) = delete;
+    self_ &operator= (const self_ &other)        = delete;
+
+    compact_order_avl_tree_ (self_ &&other) noexcept
+        : m_compare_struct_ (std::move (other.m_compare_struct_.m_key_compare_)),
+          m_nodes_ (std::move (other.m_nodes_)), m_bf_ (std::move (other.m_bf_)),
+          m_root_ (std::exchange (other.m_root_, s_null_)),
+          m_free_ (std::exchange (other.m_free_, s_null_))
+    {
+        other.m_reset_ ();
+    }
+
+    self_ &operator= (self_ &&other) noexcept
+    {
+        std::swap (m_compare_struct_.m_key_compare_, other.m_compare_struct_.m_key_compare_);
+        m_nodes_.swap (other.m_nodes_);
+        m_bf_.swap (other.m_bf_);
+        std::swap (m_root_, other.m_root_);
+        std::swap (m_free_, other.m_free_);
+        return *this;
+    }
+
+    allocator_type get_allocator () const noexcept
+    {
+        return allocator_type (m_nodes_.get_allocator ());
+    }
+
+    // Read only copy of the set for query heavy phases. Needs frozen_set.hpp.
+    frozen_order_statistic_set<Key_, Compare_, Allocator_> freeze () const
+    {
+        return frozen_order_statistic_set<Key_, Compare_, Allocator_> (
+            begin (), end (), m_compare_struct_.m_key_compare_, get_allocator ());
+    }
+
+    // Accessors.
+
+    iterator begin () const noexcept { return iterator (m_minimum_ (m_root_), this); }
+
+    iterator end () const noexcept { return iterator (s_null_, this); }
+
+    reverse_iterator rbegin () const noexcept { return reverse_iterator (end ()); }
+
+    reverse_iterator rend () const noexcept { return reverse_iterator (begin ()); }
+
+    size_type size () const noexcept { return m_node_ (m_root_).m_size_; }
+
+    bool empty () const noexcept { return (m_root_ == s_null_); }
+
+    // Number of node slots in the pool including freed ones and the sentinel.
+    size_type capacity () const noexcept { return m_nodes_.size (); }
+
+    // Insert/erase.
+
+    // Return the position of the key and false if it's already inserted.
+    std::pair<iterator, bool> insert (const value_type &key_);
+
+    // Return number of erased elements.
+    size_type erase (const value_type &key_);
+
+    void erase (iterator pos_)
+    {
+        if ( pos_ != end () )
+            erase (*pos_);
+    }
+
+    // Replace the contents with the keys of the range in linear time if it's sorted.
+    template <typename It_> void assign (It_ first_, It_ last_)
+    {
+        clear ();
+        with_sorted_unique_range_<value_type> (
+            first_, last_, m_compare_struct_.m_key_compare_,
+            [this] (auto sorted_, size_type n_) { m_build_ (sorted_, n_); });
+    }
+
+    void clear () { m_reset_ (); }
+
+    // Set operations.
+
+    iterator find (const value_type &key_) const
+    {
+        auto pos_ = m_lower_bound_ (key_);
+        if ( pos_ == s_null_ || m_less_ (key_, m_node_ (pos_).m_key_) )
+            return end ();
+        return iterator (pos_, this);
+    }
+
+    iterator lower_bound (const value_type &k_) const
+    {
+        return iterator (m_lower_bound_ (k_), this);
+    }
+
+    iterator upper_bound (const value_type &k_) const
+    {
+        return iterator (m_upper_bound_ (k_), this);
+    }
+
+    // return key value of ith smallest element in AVL-tree
+    value_type m_os_select_ (size_type i) const;
+
+    // Number of keys less then key_ (not greater if Inclusive_) by one descent from the root.
+    template <bool Inclusive_> size_type m_count_before_ (const value_type &key_) const;
+
+    // Answer select queries [first_, last_) of the batch sorted by rank in subtree of x_.
+    // Ranks of the subtree start after offset_.
+    void m_select_batch_ (index_type x_, const size_type *first_, const size_type *last_,
+                          size_type offset_, std::span<const size_type> ranks_,
+                          std::span<value_type> keys_) const;
+
+    // Answer rank queries [first_, last_) of the batch sorted by key in subtree of x_.
+    // less_ keys of the tree are less then all keys of the subtree.
+    void m_rank_batch_ (index_type x_, const size_type *first_, const size_type *last_,
+                        size_type less_, std::span<const value_type> keys_,
+                        std::span<size_type> ranks_) const;
+
+    // Return number of elements with the key less then the given one.
+    size_type m_get_number_less_then_ (const value_type &key_) const
+    {
+        return m_count_before_<false> (key_);
+    }
+
+    bool operator== (const compact_order_avl_tree_ &other_) const
+    {
+        return size () == other_.size () && std::equal (begin (), end (), other_.begin ());
+    }
+
+    bool operator!= (const compact_order_avl_tree_ &other_) const { return !(*this == other_); }
+
+    value_type os_select (size_type i) const { return m_os_select_ (i); }
+
+    size_type get_number_less_then (const value_type &key_) const
+    {
+        return m_get_number_less_then_ (key_);
+    }
+
+    /*
+     * keys_[i] = os_select (ranks_[i]) for the whole batch. The batch is sorted and answered in
+     * one walk, so the upper levels shared by the queries are visited once. All ranks are
+     * checked before anything is written.
+     */
+    void os_select_batch (std::span<const size_type> ranks_, std::span<value_type> keys_) const
+    {
+        if ( ranks_.size () != keys_.size () )
+            throw std::invalid_argument ("Sizes of queries and answers differ.");
+
+        for ( auto i : ranks_ )
+            if ( i > size () || !i )
+                throw std::out_of_range ("i is greater then the size of the tree or zero.");
+
+        auto by_rank_ = [&ranks_] (size_type a_, size_type b_) { return ranks_[a_] < ranks_[b_]; };
+        auto order_   = sorted_batch_order_ (ranks_.size (), by_rank_);
+        m_select_batch_ (m_root_, order_.data (), order_.data () + order_.size (), 0, ranks_,
+                         keys_);
+    }
+
+    // ranks_[i] = rank (keys_[i]) for the whole batch in one walk like os_select_batch.
+    void rank_batch (std::span<const value_type> keys_, std::span<size_type> ranks_) const
+    {
+        if ( ranks_.size () != keys_.size () )
+            throw std::invalid_argument ("Sizes of queries and answers differ.");
+
+        auto by_key_ = [this, &keys_] (size_type a_, size_type b_) {
+            return m_less_ (keys_[a_], keys_[b_]);
+        };
+        auto order_ = sorted_batch_order_ (keys_.size (), by_key_);
+        m_rank_batch_ (m_root_, order_.data (), order_.data () + order_.size (), 0, keys_, ranks_);
+    }
+
+    // Number of keys less then key_, that is the 0-based position key_ would have in the set.
+    size_type rank (const value_type &key_) const { return m_count_before_<false> (key_); }
+
+    size_type count_less (const value_type &key_) const { return m_count_before_<false> (key_); }
+
+    size_type count_less_equal (const value_type &key_) const
+    {
+        return m_count_before_<true> (key_);
+    }
+
+    // Number of keys in the closed range [lo_, hi_], zero if hi_ is less then lo_.
+    size_type count_in_range (const value_type &lo_, const value_type &hi_) const
+    {
+        if ( m_less_ (hi_, lo_) )
+            return 0;
+        return m_count_before_<true> (hi_) - m_count_before_<false> (lo_);
+    }
+
+    // Return k_th smallest key among the keys not less then key_, so select_from (key_, 1) is
+    // the lower bound of key_. Throws std::out_of_range if there are less then k_ such keys.
+    value_type select_from (const value_type &key_, size_type k_) const
+    {
+        if ( !k_ )
+            throw std::out_of_range ("k is zero.");
+        return m_os_select_ (m_count_before_<false> (key_) + k_);
+    }
+};
+
+template <typename Key_, typename Comp_, typename Alloc_>
+typename compact_order_avl_tree_<Key_, Comp_, Alloc_>::index_type
+compact_order_avl_tree_<Key_, Comp_, Alloc_>::m_create_node_ (const value_type &key_)
+{
+    index_type x_ = m_free_;
+
+    if ( x_ != s_null_ )
+    {
+        /* Copy the key first, a throwing copy leaves the free list as it was. */
+        auto next_   = m_node_ (x_).m_left_;
+        m_node_ (x_) = node_ {key_, s_null_, s_null_, 1};
+        m_free_      = next_;
+        m_bf_[x_]    = 0;
+        return x_;
+    }
+
+    if ( m_nodes_.size () > std::numeric_limits<index_type>::max () )
+        throw std::length_error ("Too many nodes for 32-bit indices.");
+
+    /*
+     * Grow both arrays before the first push_back, so the second one can't throw and leave
+     * them of different sizes.
+     */
+    if ( m_nodes_.size () == m_nodes_.capacity () || m_bf_.size () == m_bf_.capacity () )
+    {
+        auto capacity_ = std::max<size_type> (2 * m_nodes_.size (), 16);
+        m_nodes_.reserve (capacity_);
+        m_bf_.reserve (capacity_);
+    }
+
+    x_ = static_cast<index_type> (m_nodes_.size ());
+    m_nodes_.push_back (node_ {key_, s_null_, s_null_, 1});
+    m_bf_.push_back (0);
+    return x_;
+}
+
+template <typename Key_, typename Comp_, typename Alloc_>
+template <typename It_>
+typename compact_order_avl_tree_<Key_, Comp_, Alloc_>::index_type
+compact_order_avl_tree_<Key_, Comp_, Alloc_>::m_build_subtree_ (It_ &first_, size_type n_)
+{
+    if ( !n_ )
+        return s_null_;
+
+    /* Nodes are pushed in order, so the pool is sorted by keys. */
+    size_type left_size_  = (n_ - 1) / 2;
+    size_type right_size_ = n_ - 1 - left_size_;
+
+    auto left_ = m_build_subtree_ (first_, left_size_);
+    auto x_    = m_create_node_ (*first_);
+    ++first_;
+    auto right_ = m_build_subtree_ (first_, right_size_);
+
+    auto &node_    = m_node_ (x_);
+    node_.m_left_  = left_;
+    node_.m_right_ = right_;
+    node_.m_size_  = static_cast<std::uint32_t> (n_);
+    m_bf_[x_]      = perfect_tree_height_ (right_size_) - perfect_tree_height_ (left_size_);
+
+    return x_;
+}
+
+template <typename Key_, typename Comp_, typename Alloc_>
+void compact_order_avl_tree_<Key_, Comp_, Alloc_>::m_free_node_ (index_type x_) noexcept
+{
+    auto &node_    = m_node_ (x_);
+    node_.m_key_   = value_type {};
+    node_.m_right_ = s_null_;
+    node_.m_size_  = 0;
+    node_.m_left_  = m_free_;
+    m_free_        = x_;
+}
+
+template <typename Key_, typename Comp_, typename Alloc_>
+typename compact_order_avl_tree_<Key_, Comp_, Alloc_>::index_type
+compact_order_avl_tree_<Key_, Comp_, Alloc_>::m_rotate_left_ (index_type x_) noexcept
+{
+    auto y_ = m_node_ (x_).m_right_;
+
+    m_node_ (x_).m_right_ = m_node_ (y_).m_left_;
+    m_node_ (y_).m_left_  = x_;
+
+    /* update y's and x's sizes (the only sizes changed) */
+    m_node_ (y_).m_size_ = m_node_ (x_).m_size_;
+    m_update_size_ (x_);
+
+    return y_;
+}
+
+template <typename Key_, typename Comp_, typename Alloc_>
+typename compact_order_avl_tree_<Key_, Comp_, Alloc_>::index_type
+compact_order_avl_tree_<Key_, Comp_, Alloc_>::m_rotate_right_ (index_type x_) noexcept
+{
+    auto y_ = m_node_ (x_).m_left_;
+
+    m_node_ (x_).m_left_  = m_node_ (y_).m_right_;
+    m_node_ (y_).m_right_ = x_;
+
+    /* update y's and x's sizes (the only sizes changed) */
+    m_node_ (y_).m_size_ = m_node_ (x_).m_size_;
+    m_update_size_ (x_);
+
+    return y_;
+}
+
+template <typename Key_, typename Comp_, typename Alloc_>
+void compact_order_avl_tree_<Key_, Comp_, Alloc_>::m_fix_after_double_rotation_ (
+    index_type x_, height_diff_t old_bf_) noexcept
+{
+    m_bf_[x_] = 0;
+
+    auto left_  = m_node_ (x_).m_left_;
+    auto right_ = m_node_ (x_).m_right_;
+
+    m_bf_[left_]  = (old_bf_ == 1 ? -1 : 0);
+    m_bf_[right_] = (old_bf_ == -1 ? 1 : 0);
+}
+
+template <typename Key_, typename Comp_, typename Alloc_>
+typename compact_order_avl_tree_<Key_, Comp_, Alloc_>::index_type
+compact_order_avl_tree_<Key_, Comp_, Alloc_>::m_fix_left_imbalance_insert_ (index_type x_) noexcept
+{
+    auto left_ = m_node_ (x_).m_left_;
+
+    if ( m_bf_[left_] == -1 )
+    {
+        auto root_   = m_rotate_right_ (x_);
+        m_bf_[root_] = 0;
+        m_bf_[x_]    = 0;
+        return root_;
+    }
+
+    auto old_bf_         = m_bf_[m_node_ (left_).m_right_];
+    m_node_ (x_).m_left_ = m_rotate_left_ (left_);
+    auto root_           = m_rotate_right_ (x_);
+    m_fix_after_double_rotation_ (root_, old_bf_);
+    return root_;
+}
+
+template <typename Key_, typename Comp_, typename Alloc_>
+typename compact_order_avl_tree_<Key_, Comp_, Alloc_>::index_type
+compact_order_avl_tree_<Key_, Comp_, Alloc_>::m_fix_right_imbalance_insert_ (index_type x_) noexcept
+{
+    auto right_ = m_node_ (x_).m_right_;
+
+    if ( m_bf_[right_] == 1 )
+    {
+        auto root_   = m_rotate_left_ (x_);
+        m_bf_[root_] = 0;
+        m_bf_[x_]    = 0;
+        return root_;
+    }
+
+    auto old_bf_          = m_bf_[m_node_ (right_).m_left_];
+    m_node_ (x_).m_right_ = m_rotate_right_ (right_);
+    auto root_            = m_rotate_left_ (x_);
+    m_fix_after_double_rotation_ (root_, old_bf_);
+    return root_;
+}
+
+template <typename Key_, typename Comp_, typename Alloc_>
+typename compact_order_avl_tree_<Key_, Comp_, Alloc_>::index_type
+compact_order_avl_tree_<Key_, Comp_, Alloc_>::m_fix_left_imbalance_erase_ (index_type x_) noexcept
+{
+    auto left_    = m_node_ (x_).m_left_;
+    auto left_bf_ = m_bf_[left_];
+
+    if ( left_bf_ != 1 )
+    {
+        auto root_ = m_rotate_right_ (x_);
+
+        /* Balanced left child keeps the height of subtree. */
+        m_bf_[root_] = (left_bf_ == 0 ? 1 : 0);
+        m_bf_[x_]    = (left_bf_ == 0 ? -1 : 0);
+        return root_;
+    }
+
+    auto old_bf_         = m_bf_[m_node_ (left_).m_right_];
+    m_node_ (x_).m_left_ = m_rotate_left_ (left_);
+    auto root_           = m_rotate_right_ (x_);
+    m_fix_after_double_rotation_ (root_, old_bf_);
+    return root_;
+}
+
+template <typename Key_, typename Comp_, typename Alloc_>
+typename compact_order_avl_tree_<Key_, Comp_, Alloc_>::index_type
+compact_order_avl_tree_<Key_, Comp_, Alloc_>::m_fix_right_imbalance_erase_ (index_type x_) noexcept
+{
+    auto right_    = m_node_ (x_).m_right_;
+    auto right_bf_ = m_bf_[right_];
+
+    if ( right_bf_ != -1 )
+    {
+        auto root_ = m_rotate_left_ (x_);
+
+        /* Balanced right child keeps the height of subtree. */
+        m_bf_[root_] = (right_bf_ == 0 ? -1 : 0);
+        m_bf_[x_]    = (right_bf_ == 0 ? 1 : 0);
+        return root_;
+    }
+
+    auto old_bf_          = m_bf_[m_node_ (right_).m_left_];
+    m_node_ (x_).m_right_ = m_rotate_right_ (right_);
+    auto root_            = m_rotate_left_ (x_);
+    m_fix_after_double_rotation_ (root_, old_bf_);
+    return root_;
+}
+
+template <typename Key_, typename Comp_, typename Alloc_>
+std::pair<typename compact_order_avl_tree_<Key_, Comp_, Alloc_>::iterator, bool>
+compact_order_avl_tree_<Key_, Comp_, Alloc_>::insert (const value_type &key_)
+{
+    path_ path_;
+
+    /* Nothing is changed until the key is known to be absent. */
+    for ( auto curr_ = m_root_; curr_ != s_null_; )
+    {
+        auto &node_ = m_node_ (curr_);
+        if ( m_less_ (key_, node_.m_key_) )
+        {
+            path_.push (curr_, false);
+            curr_ = node_.m_left_;
+        }
+        else if ( m_less_ (node_.m_key_, key_) )
+        {
+            path_.push (curr_, true);
+            curr_ = node_.m_right_;
+        }
+        else
+            return {iterator (curr_, this), false};
+    }
+
+    auto new_ = m_create_node_ (key_);
+    m_replace_child_ (path_, path_.m_depth_, new_);
+
+    /*
+     * Backtracking algo:
+     * 1. update size and the balance factor of parent node;
+     * 2. rebalance if the balance factor of parent node temporarily becomes +2 or -2;
+     * 3. only sizes are updated after the height of parent subtree remains unchanged.
+     */
+    bool grown_ = true;
+    for ( auto depth_ = path_.m_depth_; depth_-- > 0; )
+    {
+        auto parent_ = path_.m_nodes_[depth_];
+        m_node_ (parent_).m_size_++;
+
+        if ( !grown_ )
+            continue;
+
+        auto &bf_ = m_bf_[parent_];
+        if ( !path_.went_right (depth_) ) /* The height of left subtree increases */
+        {
+            if ( bf_ == 1 )
+            {
+                bf_    = 0;
+                grown_ = false;
+            }
+            else if ( bf_ == 0 )
+                bf_ = -1;
+            else
+            {
+                m_replace_child_ (path_, depth_, m_fix_left_imbalance_insert_ (parent_));
+                grown_ = false;
+            }
+        }
+        else /* The height of right subtree increases */
+        {
+            if ( bf_ == -1 )
+            {
+                bf_    = 0;
+                grown_ = false;
+            }
+            else if ( bf_ == 0 )
+                bf_ = 1;
+            else
+            {
+                m_replace_child_ (path_, depth_, m_fix_right_imbalance_insert_ (parent_));
+                grown_ = false;
+            }
+        }
+    }
+
+    return {iterator (new_, this), true};
+}
+
+template <typename Key_, typename Comp_, typename Alloc_>
+typename compact_order_avl_tree_<Key_, Comp_, Alloc_>::size_type
+compact_order_avl_tree_<Key_, Comp_, Alloc_>::erase (const value_type &key_)
+{
+    path_ path_;
+    auto curr_ = m_root_;
+
+    while ( curr_ != s_null_ )
+    {
+        auto &node_ = m_node_ (curr_);
+        if ( m_less_ (key_, node_.m_key_) )
+        {
+            path_.push (curr_, false);
+            curr_ = node_.m_left_;
+        }
+        else if ( m_less_ (node_.m_key_, key_) )
+        {
+            path_.push (curr_, true);
+            curr_ = node_.m_right_;
+        }
+        else
+            break;
+    }
+
+    if ( curr_ == s_null_ )
+        return 0;
+
+    auto target_ = curr_;
+
+    /* choose node's in-order successor if it has two children */
+    if ( m_node_ (curr_).m_left_ != s_null_ && m_node_ (curr_).m_right_ != s_null_ )
+    {
+        path_.push (curr_, true);
+        target_ = m_node_ (curr_).m_right_;
+        while ( m_node_ (target_).m_left_ != s_null_ )
+        {
+            path_.push (target_, false);
+            target_ = m_node_ (target_).m_left_;
+        }
+        std::swap (m_node_ (curr_).m_key_, m_node_ (target_).m_key_);
+    }
+
+    auto &target_node_ = m_node_ (target_);
+    auto child_ =
+        (target_node_.m_left_ != s_null_ ? target_node_.m_left_ : target_node_.m_right_);
+    m_replace_child_ (path_, path_.m_depth_, child_);
+    m_free_node_ (target_);
+
+    /* The same backtracking as for insert, but the height decreases. */
+    bool shrunk_ = true;
+    for ( auto depth_ = path_.m_depth_; depth_-- > 0; )
+    {
+        auto parent_ = path_.m_nodes_[depth_];
+        m_node_ (parent_).m_size_--;
+
+        if ( !shrunk_ )
+            continue;
+
+        auto &bf_ = m_bf_[parent_];
+        if ( !path_.went_right (depth_) ) /* The height of left subtree decreases. */
+        {
+            if ( bf_ == -1 )
+                bf_ = 0;
+            else if ( bf_ == 0 )
+            {
+                bf_     = 1;
+                shrunk_ = false;
+            }
+            else
+            {
+                auto root_ = m_fix_right_imbalance_erase_ (parent_);
+                m_replace_child_ (path_, depth_, root_);
+                shrunk_ = (m_bf_[root_] == 0);
+            }
+        }
+        else /* The height of right subtree decreases. */
+        {
+            if ( bf_ == 1 )
+                bf_ = 0;
+            else if ( bf_ == 0 )
+            {
+                bf_     = -1;
+                shrunk_ = false;
+            }
+            else
+            {
+                auto root_ = m_fix_left_imbalance_erase_ (parent_);
+                m_replace_child_ (path_, depth_, root_);
+                shrunk_ = (m_bf_[root_] == 0);
+            }
+        }
+    }
+
+    return 1;
+}
+
+// Accessors.
+template <typename Key_, typename Comp_, typename Alloc_>
+typename compact_order_avl_tree_<Key_, Comp_, Alloc_>::index_type
+compact_order_avl_tree_<Key_, Comp_, Alloc_>::m_lower_bound_ (const value_type &k_) const
+{
+    index_type res_ = s_null_;
+    for ( auto x_ = m_root_; x_ != s_null_; )
+    {
+        if ( !m_less_ (m_node_ (x_).m_key_, k_) )
+        {
+            res_ = x_;
+            x_   = m_node_ (x_).m_left_;
+        }
+        else
+            x_ = m_node_ (x_).m_right_;
+    }
+    return res_;
+}
+
+template <typename Key_, typename Comp_, typename Alloc_>
+typename compact_order_avl_tree_<Key_, Comp_, Alloc_>::index_type
+compact_order_avl_tree_<Key_, Comp_, Alloc_>::m_upper_bound_ (const value_type &k_) const
+{
+    index_type res_ = s_null_;
+    for ( auto x_ = m_root_; x_ != s_null_; )
+    {
+        if ( m_less_ (k_, m_node_ (x_).m_key_) )
+        {
+            res_ = x_;
+            x_   = m_node_ (x_).m_left_;
+        }
+        else
+            x_ = m_node_ (x_).m_right_;
+    }
+    return res_;
+}
+
+template <typename Key_, typename Comp_, typename Alloc_>
+typename compact_order_avl_tree_<Key_, Comp_, Alloc_>::index_type
+compact_order_avl_tree_<Key_, Comp_, Alloc_>::m_prev_bound_ (const value_type &k_) const
+{
+    index_type res_ = s_null_;
+    for ( auto x_ = m_root_; x_ != s_null_; )
+    {
+        if ( m_less_ (m_node_ (x_).m_key_, k_) )
+        {
+            res_ = x_;
+            x_   = m_node_ (x_).m_right_;
+        }
+        else
+            x_ = m_node_ (x_).m_left_;
+    }
+    return res_;
+}
+
+template <typename Key_, typename Comp_, typename Alloc_>
+typename compact_order_avl_tree_<Key_, Comp_, Alloc_>::value_type
+compact_order_avl_tree_<Key_, Comp_, Alloc_>::m_os_select_ (size_type i) const
+{
+    if ( i > size () || !i )
+        throw std::out_of_range ("i is greater then the size of the tree or zero.");
+
+    auto curr_ = m_root_;
+
+    while ( true )
+    {
+        /* The rank of node is the size of left subtree plus 1. */
+        size_type rank_ = m_node_ (m_node_ (curr_).m_left_).m_size_ + 1;
+
+        if ( i == rank_ )
+            return m_node_ (curr_).m_key_;
+
+        if ( i < rank_ )
+            curr_ = m_node_ (curr_).m_left_;
+        else
+        {
+            /* Reduce i, cause we've already passed rank_ smallest nodes. */
+            i -= rank_;
+            curr_ = m_node_ (curr_).m_right_;
+        }
+    }
+}
+
+template <typename Key_, typename Comp_, typename Alloc_>
+void compact_order_avl_tree_<Key_, Comp_, Alloc_>::m_select_batch_ (
+    index_type x_, const size_type *first_, const size_type *last_, size_type offset_,
+    std::span<const size_type> ranks_, std::span<value_type> keys_) const
+{
+    /* Ranks are valid, so the node exists while there are queries. Right part is a loop. */
+    while ( first_ != last_ )
+    {
+        auto &node_     = m_node_ (x_);
+        size_type rank_ = offset_ + m_node_ (node_.m_left_).m_size_ + 1;
+
+        auto before_ = [&ranks_, rank_] (size_type q_) { return ranks_[q_] < rank_; };
+        auto middle_ = std::partition_point (first_, last_, before_);
+        if ( first_ != middle_ )
+            m_select_batch_ (node_.m_left_, first_, middle_, offset_, ranks_, keys_);
+
+        for ( first_ = middle_; first_ != last_ && ranks_[*first_] == rank_; ++first_ )
+            keys_[*first_] = node_.m_key_;
+
+        x_      = node_.m_right_;
+        offset_ = rank_;
+    }
+}
+
+template <typename Key_, typename Comp_, typename Alloc_>
+void compact_order_avl_tree_<Key_, Comp_, Alloc_>::m_rank_batch_ (
+    index_type x_, const size_type *first_, const size_type *last_, size_type less_,
+    std::span<const value_type> keys_, std::span<size_type> ranks_) const
+{
+    for ( ; x_ != s_null_ && first_ != last_; x_ = m_node_ (x_).m_right_ )
+    {
+        auto &node_ = m_node_ (x_);
+
+        /* Keys not greater then the key of the node go left, the rest go right. */
+        auto middle_ = std::partition_point (first_, last_, [this, &keys_, &node_] (size_type q_) {
+            return !m_less_ (node_.m_key_, keys_[q_]);
+        });
+        if ( first_ != middle_ )
+            m_rank_batch_ (node_.m_left_, first_, middle_, less_, keys_, ranks_);
+
+        less_ += m_node_ (node_.m_left_).m_size_ + 1;
+        first_ = middle_;
+    }
+
+    for ( ; first_ != last_; ++first_ )
+        ranks_[*first_] = less_;
+}
+
+template <typename Key_, typename Comp_, typename Alloc_>
+template <bool Inclusive_>
+typename compact_order_avl_tree_<Key_, Comp_, Alloc_>::size_type
+compact_order_avl_tree_<Key_, Comp_, Alloc_>::m_count_before_ (const value_type &key_) const
+{
+    size_type less_ = 0;
+
+    /* Every time we go right the left subtree and the node itself are counted. */
+    for ( auto x_ = m_root_; x_ != s_null_; )
+    {
+        auto &node_   = m_node_ (x_);
+        bool counted_ = (Inclusive_ ? !m_less_ (key_, node_.m_key_) : m_less_ (node_.m_key_, key_));
+        if ( counted_ )
+        {
+            less_ += m_node_ (node_.m_left_).m_size_ + 1;
+            x_ = node_.m_right_;
+        }
+        else
+            x_ = node_.m_left_;
+    }
+
+    return less_;
+}
+
+}   // namespace rethinking_stl
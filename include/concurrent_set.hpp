@@ -0,0 +1,354 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <alex.rom23@mail.ru> wrote this file.  As long as you retain this notice you
+ * can do whatever you want with this stuff. If we meet some day, and you think
+ * this stuff is worth it, you can buy me a beer in return.   Alex Romanov
+ * ----------------------------------------------------------------------------
+ */
+
+// order statistic set with lock-free readers implementation header
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "epoch_domain.hpp"
+#include "node_pool.hpp"
+#include "path_copy_avl.hpp"
+
+namespace rethinking_stl
+{
+
+template <typename Key_> struct concurrent_set_node_
+{
+    const concurrent_set_node_ *m_left_;
+    const concurrent_set_node_ *m_right_;
+    std::size_t m_size_;
+    int m_height_;
+    std::uint64_t m_version_; /* update which created the node */
+    Key_ m_key_;
+};
+
+//=========================concurrent_order_statistic_set=========================
+/*
+ * Order statistic set for many readers and one writer at a time. The tree is persistent:
+ * published nodes never change, an update copies the path to the changed node together with
+ * the rotated nodes and publishes the new root with one atomic store. Readers take a view,
+ * which pins the current version, and run select, rank, find and iteration on it without
+ * locks or retries. Writers are serialized by a mutex, replaced nodes are reclaimed when no
+ * view that could see them is left.
+ */
+template <typename Key_, typename Compare_ = std::less<Key_>,
+          typename Allocator_ = std::allocator<Key_>>
+class concurrent_order_statistic_set
+    : private path_copy_avl_<concurrent_order_statistic_set<Key_, Compare_, Allocator_>,
+                             concurrent_set_node_<Key_>, Key_, Compare_>
+{
+  public:
+    using value_type     = Key_;
+    using size_type      = std::size_t;
+    using key_compare    = Compare_;
+    using allocator_type = Allocator_;
+
+  private:
+    using version_node_ = concurrent_set_node_<Key_>;
+    using node_ptr_     = const version_node_ *;
+    using node_pool_    = rethinking_stl::node_pool_<version_node_, Allocator_>;
+    using tree_ = path_copy_avl_<concurrent_order_statistic_set, version_node_, Key_, Compare_>;
+
+    friend tree_;
+
+    using tree_::m_comp_;
+    using tree_::m_created_;
+    using tree_::m_dropped_;
+    using tree_::s_size_;
+    using tree_::s_height_;
+    using tree_::s_update_bound_;
+    using tree_::m_insert_;
+    using tree_::m_erase_;
+    using tree_::m_update_;
+
+    /* Retired nodes are checked against the readers once there are at least this many. */
+    static constexpr size_type s_reclaim_batch_ = 256;
+
+    struct retired_
+    {
+        node_ptr_ m_node_;
+        std::uint64_t m_epoch_;
+    };
+
+    std::atomic<node_ptr_> m_root_ {nullptr};
+    std::atomic<size_type> m_size_ {0};
+    mutable epoch_domain_ m_epochs_;
+
+    /* Writer state, guarded by the mutex. */
+    std::mutex m_writer_;
+    node_pool_ m_node_pool_;
+    std::uint64_t m_version_ = 0;
+    std::vector<node_ptr_> m_replaced_; /* published nodes unlinked by the update */
+    std::vector<retired_> m_retired_;
+    size_type m_reclaim_at_ = s_reclaim_batch_;
+
+    node_ptr_ m_make_ (node_ptr_ left_, const value_type &key_, node_ptr_ right_)
+    {
+        auto res_ = m_node_pool_.m_create_ (
+            version_node_ {left_, right_, s_size_ (left_) + s_size_ (right_) + 1,
+                           std::max (s_height_ (left_), s_height_ (right_)) + 1, m_version_, key_});
+        m_created_.push_back (res_);
+        return res_;
+    }
+
+    // The node is not a part of the new version.
+    void m_replace_ (node_ptr_ node_)
+    {
+        (node_->m_version_ == m_version_ ? m_dropped_ : m_replaced_).push_back (node_);
+    }
+
+    // Run the update, publish its root and retire the replaced nodes. The tree is left as is
+    // if the update throws.
+    template <typename Update_> void m_commit_ (Update_ update_);
+
+    // Free retired nodes which no reader can see any more.
+    void m_reclaim_ ();
+
+    void m_destroy_ (node_ptr_ node_) noexcept
+    {
+        m_node_pool_.m_destroy_ (const_cast<version_node_ *> (node_));
+    }
+
+    void m_destroy_tree_ (node_ptr_ node_) noexcept
+    {
+        if ( !node_ )
+            return;
+        m_destroy_tree_ (node_->m_left_);
+        m_destroy_tree_ (node_->m_right_);
+        m_destroy_ (node_);
+    }
+
+  public:
+    // Forward iterator over a view. Nodes shared by the versions have no parent links.
+    using iterator = path_tree_iterator_<version_node_, Key_>;
+
+    //=====================================view=====================================
+    /*
+     * Pinned version of the set. Everything read through the view is the state of one moment,
+     * later updates are not seen. Nodes of the version are kept alive while the view exists,
+     * so long lived views hold back the reclamation of the replaced nodes.
+     */
+    class view
+    {
+        const concurrent_order_statistic_set *m_set_;
+        epoch_domain_::record_ *m_slot_;
+        node_ptr_ m_root_;
+
+        template <bool Inclusive_> size_type m_count_before_ (const value_type &key_) const
+        {
+            return path_tree_count_before_<Inclusive_> (m_root_, key_, m_set_->m_comp_);
+        }
+
+      public:
+        explicit view (const concurrent_order_statistic_set &set_)
+            : m_set_ (&set_), m_slot_ (set_.m_epochs_.m_acquire_ ())
+        {
+            set_.m_epochs_.m_enter_ (m_slot_);
+            m_root_ = set_.m_root_.load ();
+        }
+
+        view (const view &)            = delete;
+        view &operator= (const view &) = delete;
+
+        ~view ()
+        {
+            m_set_->m_epochs_.m_leave_ (m_slot_);
+            m_set_->m_epochs_.m_release_ (m_slot_);
+        }
+
+        size_type size () const noexcept { return s_size_ (m_root_); }
+
+        bool empty () const noexcept { return !m_root_; }
+
+        // Return i-th smallest key, throw std::out_of_range if there is no such key.
+        value_type os_select (size_type i) const { return path_tree_select_ (m_root_, i); }
+
+        size_type get_number_less_then (const value_type &key_) const
+        {
+            return m_count_before_<false> (key_);
+        }
+
+        size_type rank (const value_type &key_) const { return m_count_before_<false> (key_); }
+
+        size_type count_less_equal (const value_type &key_) const
+        {
+            return m_count_before_<true> (key_);
+        }
+
+        bool contains (const value_type &key_) const
+        {
+            return path_tree_find_ (m_root_, key_, m_set_->m_comp_);
+        }
+
+        iterator find (const value_type &key_) const
+        {
+            auto pos_ = lower_bound (key_);
+            return (pos_ != end () && !m_set_->m_comp_ (key_, *pos_) ? pos_ : end ());
+        }
+
+        iterator lower_bound (const value_type &key_) const
+        {
+            return iterator::s_lower_bound_ (m_root_, key_, m_set_->m_comp_);
+        }
+
+        iterator begin () const { return iterator::s_begin_ (m_root_); }
+
+        iterator end () const noexcept { return iterator (); }
+    };
+
+    concurrent_order_statistic_set () : concurrent_order_statistic_set (Compare_ ()) {}
+
+    explicit concurrent_order_statistic_set (const Compare_ &comp_,
+                                             const Allocator_ &alloc_ = Allocator_ ())
+        : tree_ (comp_), m_node_pool_ (alloc_)
+    {
+    }
+
+    concurrent_order_statistic_set (std::initializer_list<value_type> keys_,
+                                    const Compare_ &comp_ = Compare_ (),
+                                    const Allocator_ &alloc_ = Allocator_ ())
+        : concurrent_order_statistic_set (comp_, alloc_)
+    {
+        for ( auto &key_ : keys_ )
+            insert (key_);
+    }
+
+    concurrent_order_statistic_set (const concurrent_order_statistic_set &)            = delete;
+    concurrent_order_statistic_set &operator= (const concurrent_order_statistic_set &) = delete;
+
+    // No views may outlive the set.
+    ~concurrent_order_statistic_set ()
+    {
+        for ( auto &retired_ : m_retired_ )
+            m_destroy_ (retired_.m_node_);
+        m_destroy_tree_ (m_root_.load ());
+    }
+
+    allocator_type get_allocator () const noexcept
+    {
+        return allocator_type (m_node_pool_.get_allocator ());
+    }
+
+    // Pin the current version for a batch of queries.
+    view read () const { return view (*this); }
+
+    size_type size () const noexcept { return m_size_.load (std::memory_order_acquire); }
+
+    bool empty () const noexcept { return !size (); }
+
+    // Single queries, each one pins the current version for its duration.
+    value_type os_select (size_type i) const { return read ().os_select (i); }
+
+    size_type get_number_less_then (const value_type &key_) const
+    {
+        return read ().get_number_less_then (key_);
+    }
+
+    bool contains (const value_type &key_) const { return read ().contains (key_); }
+
+    // Return false if the key is already inserted.
+    bool insert (const value_type &key_)
+    {
+        bool inserted_ = false;
+        m_commit_ ([this, &key_, &inserted_] (node_ptr_ root_) {
+            return m_insert_ (root_, key_, inserted_);
+        });
+        return inserted_;
+    }
+
+    // Return number of erased elements.
+    size_type erase (const value_type &key_)
+    {
+        bool erased_ = false;
+        m_commit_ ([this, &key_, &erased_] (node_ptr_ root_) {
+            return m_erase_ (root_, key_, erased_);
+        });
+        return erased_;
+    }
+
+    // Number of replaced nodes waiting for the readers, for the tests and monitoring.
+    size_type retired ()
+    {
+        std::lock_guard lock_ (m_writer_);
+        return m_retired_.size ();
+    }
+
+    // Free replaced nodes no view can see right away instead of at one of the next updates.
+    void reclaim ()
+    {
+        std::lock_guard lock_ (m_writer_);
+        m_reclaim_ ();
+    }
+};
+
+template <typename Key_, typename Comp_, typename Alloc_>
+template <typename Update_>
+void concurrent_order_statistic_set<Key_, Comp_, Alloc_>::m_commit_ (Update_ update_)
+{
+    std::lock_guard lock_ (m_writer_);
+    auto root_ = m_root_.load (std::memory_order_relaxed);
+
+    /* Published nodes listed by an update which threw are still in the tree. */
+    auto bound_ = s_update_bound_ (root_);
+    m_replaced_.clear ();
+    m_replaced_.reserve (bound_);
+    if ( m_retired_.capacity () < m_retired_.size () + bound_ )
+        m_retired_.reserve (std::max (2 * m_retired_.capacity (), m_retired_.size () + bound_));
+    m_version_++;
+
+    auto new_root_ = m_update_ (root_, update_);
+
+    /* Never published nodes go right away. */
+    for ( auto node_ : m_dropped_ )
+        m_destroy_ (node_);
+
+    if ( new_root_ != root_ )
+    {
+        m_root_.store (new_root_);
+        m_size_.store (s_size_ (new_root_), std::memory_order_release);
+
+        auto epoch_ = m_epochs_.m_advance_ ();
+        for ( auto node_ : m_replaced_ )
+            m_retired_.push_back ({node_, epoch_});
+    }
+
+    m_created_.clear ();
+    m_dropped_.clear ();
+    m_replaced_.clear ();
+
+    if ( m_retired_.size () >= m_reclaim_at_ )
+        m_reclaim_ ();
+}
+
+template <typename Key_, typename Comp_, typename Alloc_>
+void concurrent_order_statistic_set<Key_, Comp_, Alloc_>::m_reclaim_ ()
+{
+    auto min_active_ = m_epochs_.m_min_active_ ();
+
+    /* Nodes are retired in the order of epochs, so the ones to free are at the front. */
+    auto visible_    = [min_active_] (const retired_ &r_) { return r_.m_epoch_ >= min_active_; };
+    auto first_kept_ = std::find_if (m_retired_.begin (), m_retired_.end (), visible_);
+    for ( auto it_ = m_retired_.begin (); it_ != first_kept_; ++it_ )
+        m_destroy_ (it_->m_node_);
+    m_retired_.erase (m_retired_.begin (), first_kept_);
+
+    /* Nodes held by a long lived view are not rescanned after every update. */
+    m_reclaim_at_ = std::max (s_reclaim_batch_, 2 * m_retired_.size ());
+}
+
+}   // namespace rethinking_stl
@@ -0,0 +1,128 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <alex.rom23@mail.ru> wrote this file.  As long as you retain this notice you
+ * can do whatever you want with this stuff. If we meet some day, and you think
+ * this stuff is worth it, you can buy me a beer in return.   Alex Romanov
+ * ----------------------------------------------------------------------------
+ */
+
+// epoch based reclamation of the concurrent containers
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <utility>
+
+namespace rethinking_stl
+{
+
+//==================================epoch_domain_=================================
+/*
+ * Epoch based reclamation. A reader announces the global epoch in its slot before it loads
+ * the root and clears the slot when it's done. The writer retires unlinked nodes with the
+ * epoch of the moment they were unlinked and advances the epoch, a node retired at epoch e_
+ * is freed once no slot announces an epoch not greater than e_. Announcements and the scan
+ * are sequentially consistent, so a reader missed by the scan loads the newer root.
+ */
+class epoch_domain_
+{
+  public:
+    struct alignas (64) record_
+    {
+        std::atomic<std::uint64_t> m_epoch_;
+        std::atomic<bool> m_used_ {true};
+        record_ *m_next_ = nullptr;
+    };
+
+    static constexpr std::uint64_t s_idle_ = std::numeric_limits<std::uint64_t>::max ();
+
+  private:
+    std::atomic<std::uint64_t> m_epoch_ {1};
+    std::atomic<record_ *> m_slots_ {nullptr}; /* slots are only added, freed by the destructor */
+
+  public:
+    epoch_domain_ () = default;
+
+    epoch_domain_ (const epoch_domain_ &)            = delete;
+    epoch_domain_ &operator= (const epoch_domain_ &) = delete;
+
+    ~epoch_domain_ ()
+    {
+        for ( auto slot_ = m_slots_.load (); slot_; )
+            delete std::exchange (slot_, slot_->m_next_);
+    }
+
+    // Take a free slot or add a new one. Lock-free, slots are reused by the next readers.
+    record_ *m_acquire_ ()
+    {
+        for ( auto slot_ = m_slots_.load (std::memory_order_acquire); slot_;
+              slot_      = slot_->m_next_ )
+        {
+            bool free_ = false;
+            if ( !slot_->m_used_.load (std::memory_order_relaxed) &&
+                 slot_->m_used_.compare_exchange_strong (free_, true, std::memory_order_acquire) )
+                return slot_;
+        }
+
+        auto slot_ = new record_ {s_idle_};
+        slot_->m_next_ = m_slots_.load (std::memory_order_relaxed);
+        while ( !m_slots_.compare_exchange_weak (slot_->m_next_, slot_, std::memory_order_release,
+                                                 std::memory_order_relaxed) )
+            ;
+        return slot_;
+    }
+
+    void m_release_ (record_ *slot_) noexcept
+    {
+        slot_->m_used_.store (false, std::memory_order_release);
+    }
+
+    void m_enter_ (record_ *slot_) noexcept { slot_->m_epoch_.store (m_epoch_.load ()); }
+
+    void m_leave_ (record_ *slot_) noexcept
+    {
+        slot_->m_epoch_.store (s_idle_, std::memory_order_release);
+    }
+
+    // Close the current epoch and return it, nodes unlinked before are retired with it.
+    std::uint64_t m_advance_ () noexcept { return m_epoch_.fetch_add (1); }
+
+    // Smallest announced epoch, s_idle_ if there are no readers.
+    std::uint64_t m_min_active_ () const noexcept
+    {
+        auto res_ = s_idle_;
+        for ( auto slot_ = m_slots_.load (std::memory_order_acquire); slot_;
+              slot_      = slot_->m_next_ )
+            res_ = std::min (res_, slot_->m_epoch_.load ());
+        return res_;
+    }
+};
+
+// Announces the epoch for the scope of one operation.
+class epoch_guard_
+{
+    epoch_domain_ *m_domain_;
+    epoch_domain_::record_ *m_slot_;
+
+  public:
+    explicit epoch_guard_ (epoch_domain_ &domain_)
+        : m_domain_ (&domain_), m_slot_ (domain_.m_acquire_ ())
+    {
+        domain_.m_enter_ (m_slot_);
+    }
+
+    epoch_guard_ (const epoch_guard_ &)            = delete;
+    epoch_guard_ &operator= (const epoch_guard_ &) = delete;
+
+    ~epoch_guard_ ()
+    {
+        m_domain_->m_leave_ (m_slot_);
+        m_domain_->m_release_ (m_slot_);
+    }
+};
+
+}   // namespace rethinking_stl
@@ -0,0 +1,230 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <alex.rom23@mail.ru> wrote this file.  As long as you retain this notice you
+ * can do whatever you want with this stuff. If we meet some day, and you think
+ * this stuff is worth it, you can buy me a beer in return.   Alex Romanov
+ * ----------------------------------------------------------------------------
+ */
+
+// frozen read only set in eytzinger layout implementation header
+
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include "avl_tree.hpp"
+
+namespace rethinking_stl
+{
+
+//===========================frozen_order_statistic_set===========================
+/*
+ * Read only snapshot of the set for the build once, query many times workloads.
+ * Keys are stored twice: in sorted order for iteration and O(1) select, and in the implicit
+ * Eytzinger (BFS) layout, where the children of slot k are 2k and 2k + 1, for the searches.
+ * The descent has no branches on the keys and prefetches the keys a few levels below, so it
+ * is bound by memory bandwidth instead of latency. Each slot also remembers its rank.
+ */
+template <typename Key_, typename Compare_ = std::less<Key_>,
+          typename Allocator_ = std::allocator<Key_>>
+class frozen_order_statistic_set
+{
+  public:
+    using value_type     = Key_;
+    using size_type      = std::size_t;
+    using key_compare    = Compare_;
+    using allocator_type = Allocator_;
+
+  private:
+    using alloc_traits_ = std::allocator_traits<Allocator_>;
+    using ranks_alloc_  = typename alloc_traits_::template rebind_alloc<size_type>;
+    using keys_         = std::vector<value_type, Allocator_>;
+    using ranks_        = std::vector<size_type, ranks_alloc_>;
+
+  public:
+    using iterator         = typename keys_::const_iterator;
+    using reverse_iterator = std::reverse_iterator<iterator>;
+
+  private:
+    /* Slots of a subtree four levels down (for 4-byte keys) share one cache line. */
+    static constexpr size_type s_line_size_ = 64;
+    static constexpr size_type s_prefetch_stride_ =
+        std::bit_floor (std::max<size_type> (1, s_line_size_ / sizeof (value_type)));
+
+    Compare_ m_comp_;
+    keys_ m_sorted_;
+    keys_ m_layout_; /* slot 0 is unused */
+    ranks_ m_ranks_; /* position of the key of the slot in m_sorted_ */
+
+    void m_layout_subtree_ (size_type &rank_, size_type k_)
+    {
+        if ( k_ > size () )
+            return;
+
+        m_layout_subtree_ (rank_, 2 * k_);
+        m_layout_[k_] = m_sorted_[rank_];
+        m_ranks_[k_]  = rank_++;
+        m_layout_subtree_ (rank_, 2 * k_ + 1);
+    }
+
+    void m_build_layout_ ()
+    {
+        if ( m_sorted_.empty () )
+            return;
+
+        m_layout_.assign (size () + 1, m_sorted_.front ());
+        m_ranks_.assign (size () + 1, 0);
+
+        size_type rank_ = 0;
+        m_layout_subtree_ (rank_, 1);
+    }
+
+    // Slot of the first key not less then key_ (greater if Upper_), 0 if there is no such key.
+    template <bool Upper_> size_type m_search_ (const value_type &key_) const
+    {
+        auto layout_ = m_layout_.data ();
+        auto n_      = size ();
+
+        size_type k_ = 1;
+        while ( k_ <= n_ )
+        {
+#if defined(__GNUC__) || defined(__clang__)
+            /* The address may be past the end, prefetch doesn't fault on it. */
+            auto ahead_ = reinterpret_cast<std::uintptr_t> (layout_) +
+                          k_ * s_prefetch_stride_ * sizeof (value_type);
+            __builtin_prefetch (reinterpret_cast<const void *> (ahead_));
+#endif
+            bool right_ = (Upper_ ? !m_comp_ (key_, layout_[k_]) : m_comp_ (layout_[k_], key_));
+            k_          = 2 * k_ + right_;
+        }
+
+        /* Undo the right turns made after the last left one, which stopped at the answer. */
+        return k_ >> (std::countr_one (k_) + 1);
+    }
+
+    template <bool Upper_> size_type m_count_before_ (const value_type &key_) const
+    {
+        auto k_ = m_search_<Upper_> (key_);
+        return (k_ ? m_ranks_[k_] : size ());
+    }
+
+  public:
+    frozen_order_statistic_set () : frozen_order_statistic_set (Compare_ ()) {}
+
+    explicit frozen_order_statistic_set (const Compare_ &comp_,
+                                         const Allocator_ &alloc_ = Allocator_ ())
+        : m_comp_ (comp_), m_sorted_ (alloc_), m_layout_ (alloc_), m_ranks_ (ranks_alloc_ (alloc_))
+    {
+    }
+
+    template <std::input_iterator It_>
+    frozen_order_statistic_set (It_ first_, It_ last_, const Compare_ &comp_ = Compare_ (),
+                                const Allocator_ &alloc_ = Allocator_ ())
+        : frozen_order_statistic_set (comp_, alloc_)
+    {
+        with_sorted_unique_range_<value_type> (
+            first_, last_, m_comp_, [this] (auto sorted_, size_type n_) {
+                m_sorted_.reserve (n_);
+                for ( ; n_; n_--, ++sorted_ )
+                    m_sorted_.push_back (*sorted_);
+            });
+        m_build_layout_ ();
+    }
+
+    frozen_order_statistic_set (std::initializer_list<value_type> keys_,
+                                const Compare_ &comp_ = Compare_ (),
+                                const Allocator_ &alloc_ = Allocator_ ())
+        : frozen_order_statistic_set (keys_.begin (), keys_.end (), comp_, alloc_)
+    {
+    }
+
+    allocator_type get_allocator () const noexcept { return m_sorted_.get_allocator (); }
+
+    key_compare key_comp () const { return m_comp_; }
+
+    iterator begin () const noexcept { return m_sorted_.begin (); }
+
+    iterator end () const noexcept { return m_sorted_.end (); }
+
+    reverse_iterator rbegin () const noexcept { return reverse_iterator (end ()); }
+
+    reverse_iterator rend () const noexcept { return reverse_iterator (begin ()); }
+
+    size_type size () const noexcept { return m_sorted_.size (); }
+
+    bool empty () const noexcept { return m_sorted_.empty (); }
+
+    iterator lower_bound (const value_type &key_) const
+    {
+        return begin () + m_count_before_<false> (key_);
+    }
+
+    iterator upper_bound (const value_type &key_) const
+    {
+        return begin () + m_count_before_<true> (key_);
+    }
+
+    iterator find (const value_type &key_) const
+    {
+        auto pos_ = lower_bound (key_);
+        return (pos_ == end () || m_comp_ (key_, *pos_) ? end () : pos_);
+    }
+
+    bool contains (const value_type &key_) const { return find (key_) != end (); }
+
+    // Return ith smallest key, i starts from 1 like in the tree.
+    value_type os_select (size_type i) const
+    {
+        if ( i > size () || !i )
+            throw std::out_of_range ("i is greater then the size of the set or zero.");
+        return m_sorted_[i - 1];
+    }
+
+    size_type get_number_less_then (const value_type &key_) const
+    {
+        return m_count_before_<false> (key_);
+    }
+
+    size_type rank (const value_type &key_) const { return m_count_before_<false> (key_); }
+
+    size_type count_less (const value_type &key_) const { return m_count_before_<false> (key_); }
+
+    size_type count_less_equal (const value_type &key_) const
+    {
+        return m_count_before_<true> (key_);
+    }
+
+    // Number of keys in the closed range [lo_, hi_], zero if hi_ is less then lo_.
+    size_type count_in_range (const value_type &lo_, const value_type &hi_) const
+    {
+        if ( m_comp_ (hi_, lo_) )
+            return 0;
+        return m_count_before_<true> (hi_) - m_count_before_<false> (lo_);
+    }
+
+    // Return k_th smallest key among the keys not less then key_.
+    value_type select_from (const value_type &key_, size_type k_) const
+    {
+        if ( !k_ )
+            throw std::out_of_range ("k is zero.");
+        return os_select (m_count_before_<false> (key_) + k_);
+    }
+
+    bool operator== (const frozen_order_statistic_set &other_) const
+    {
+        return m_sorted_ == other_.m_sorted_;
+    }
+
+    bool operator!= (const frozen_order_statistic_set &other_) const { return !(*this == other_); }
+};
+
+}   // namespace rethinking_stl
@@ -0,0 +1,377 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <alex.rom23@mail.ru> wrote this file.  As long as you retain this notice you
+ * can do whatever you want with this stuff. If we meet some day, and you think
+ * this stuff is worth it, you can buy me a beer in return.   Alex Romanov
+ * ----------------------------------------------------------------------------
+ */
+
+// order statistic multiset with per-node multiplicities implementation header
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+#include "node_pool.hpp"
+#include "path_tree.hpp"
+
+namespace rethinking_stl
+{
+
+//============================order_statistic_multiset============================
+/*
+ * Order statistic multiset. Every distinct key is kept in one node of an AVL tree together
+ * with the number of its copies, and the size of a node is the total multiplicity of its
+ * subtree. So inserting a key which is already present is one descent without allocation,
+ * while os_select and get_number_less_then count every copy:
+ *
+ *     multiset<int> times {20, 10, 20, 30};
+ *     times.os_select (3);              // 20
+ *     times.get_number_less_then (30);  // 3
+ *
+ * Iterators visit every copy, they are invalidated by the updates.
+ */
+template <typename Key_, typename Compare_ = std::less<Key_>,
+          typename Allocator_ = std::allocator<Key_>>
+class order_statistic_multiset
+{
+  public:
+    using value_type     = Key_;
+    using size_type      = std::size_t;
+    using key_compare    = Compare_;
+    using allocator_type = Allocator_;
+
+  private:
+    struct counted_node_
+    {
+        counted_node_ *m_left_  = nullptr;
+        counted_node_ *m_right_ = nullptr;
+        size_type m_size_; /* copies of all keys of the subtree */
+        size_type m_count_;
+        int m_height_ = 1;
+        value_type m_key_;
+
+        counted_node_ (const value_type &key_, size_type count_)
+            : m_size_ (count_), m_count_ (count_), m_key_ (key_)
+        {
+        }
+    };
+
+    using node_ptr_  = counted_node_ *;
+    using node_pool_ = rethinking_stl::node_pool_<counted_node_, Allocator_>;
+
+    Compare_ m_comp_;
+    node_pool_ m_node_pool_;
+    node_ptr_ m_root_ = nullptr;
+
+    static size_type s_size_ (node_ptr_ node_) noexcept { return path_tree_size_ (node_); }
+
+    static int s_height_ (node_ptr_ node_) noexcept { return (node_ ? node_->m_height_ : 0); }
+
+    static void s_update_ (node_ptr_ node_) noexcept
+    {
+        node_->m_size_   = s_size_ (node_->m_left_) + s_size_ (node_->m_right_) + node_->m_count_;
+        node_->m_height_ = std::max (s_height_ (node_->m_left_), s_height_ (node_->m_right_)) + 1;
+    }
+
+    static node_ptr_ s_rotate_left_ (node_ptr_ node_) noexcept
+    {
+        auto right_     = node_->m_right_;
+        node_->m_right_ = right_->m_left_;
+        right_->m_left_ = node_;
+        s_update_ (node_);
+        s_update_ (right_);
+        return right_;
+    }
+
+    static node_ptr_ s_rotate_right_ (node_ptr_ node_) noexcept
+    {
+        auto left_      = node_->m_left_;
+        node_->m_left_  = left_->m_right_;
+        left_->m_right_ = node_;
+        s_update_ (node_);
+        s_update_ (left_);
+        return left_;
+    }
+
+    // Recount the node, which children heights differ at most by two, and rotate it if they
+    // differ by two. Return the new root of the subtree.
+    static node_ptr_ s_balance_ (node_ptr_ node_) noexcept;
+
+    // Add count_ copies of key_ and set copies_ to the number of copies of key_ now. Nodes are
+    // changed on the way back, so the tree is left as is if the creation of the new node throws.
+    node_ptr_ m_insert_ (node_ptr_ node_, const value_type &key_, size_type count_,
+                         size_type &copies_);
+
+    // Erase at most count_ copies of key_ and add their number to erased_.
+    node_ptr_ m_erase_ (node_ptr_ node_, const value_type &key_, size_type count_,
+                        size_type &erased_);
+
+    // Unlink the node with the least key of the subtree into min_.
+    static node_ptr_ s_unlink_min_ (node_ptr_ node_, node_ptr_ &min_) noexcept;
+
+    void m_destroy_subtree_ (node_ptr_ node_) noexcept;
+
+  public:
+    // Forward iterator visiting every copy of the keys. The nodes have no parent links.
+    using iterator = path_tree_iterator_<counted_node_, Key_>;
+
+    order_statistic_multiset () : order_statistic_multiset (Compare_ ()) {}
+
+    explicit order_statistic_multiset (const Compare_ &comp_,
+                                       const Allocator_ &alloc_ = Allocator_ ())
+        : m_comp_ (comp_), m_node_pool_ (alloc_)
+    {
+    }
+
+    order_statistic_multiset (std::initializer_list<value_type> keys_,
+                              const Compare_ &comp_   = Compare_ (),
+                              const Allocator_ &alloc_ = Allocator_ ())
+        : order_statistic_multiset (comp_, alloc_)
+    {
+        for ( auto &key_ : keys_ )
+            insert (key_);
+    }
+
+    template <std::input_iterator It_>
+    order_statistic_multiset (It_ first_, It_ last_, const Compare_ &comp_ = Compare_ (),
+                              const Allocator_ &alloc_ = Allocator_ ())
+        : order_statistic_multiset (comp_, alloc_)
+    {
+        for ( ; first_ != last_; ++first_ )
+            insert (*first_);
+    }
+
+    order_statistic_multiset (const order_statistic_multiset &)            = delete;
+    order_statistic_multiset &operator= (const order_statistic_multiset &) = delete;
+
+    order_statistic_multiset (order_statistic_multiset &&other_) noexcept
+        : m_comp_ (std::move (other_.m_comp_)), m_node_pool_ (std::move (other_.m_node_pool_)),
+          m_root_ (std::exchange (other_.m_root_, nullptr))
+    {
+    }
+
+    order_statistic_multiset &operator= (order_statistic_multiset &&other_) noexcept
+    {
+        swap (other_);
+        return *this;
+    }
+
+    ~order_statistic_multiset () { m_destroy_subtree_ (m_root_); }
+
+    void swap (order_statistic_multiset &other_) noexcept
+    {
+        using std::swap;
+        swap (m_comp_, other_.m_comp_);
+        m_node_pool_.swap (other_.m_node_pool_);
+        swap (m_root_, other_.m_root_);
+    }
+
+    allocator_type get_allocator () const noexcept
+    {
+        return allocator_type (m_node_pool_.get_allocator ());
+    }
+
+    // Number of keys counting every copy.
+    size_type size () const noexcept { return s_size_ (m_root_); }
+
+    // Number of distinct keys.
+    size_type unique_size () const noexcept { return m_node_pool_.allocated (); }
+
+    bool empty () const noexcept { return !m_root_; }
+
+    // Return i-th smallest key counting every copy, throw std::out_of_range if there is no such
+    // key.
+    value_type os_select (size_type i) const { return path_tree_select_ (m_root_, i); }
+
+    // Number of copies of the keys less then key_.
+    size_type get_number_less_then (const value_type &key_) const
+    {
+        return path_tree_count_before_<false> (m_root_, key_, m_comp_);
+    }
+
+    size_type count_less_equal (const value_type &key_) const
+    {
+        return path_tree_count_before_<true> (m_root_, key_, m_comp_);
+    }
+
+    // Number of copies of key_.
+    size_type count (const value_type &key_) const
+    {
+        auto node_ = path_tree_find_ (m_root_, key_, m_comp_);
+        return (node_ ? node_->m_count_ : 0);
+    }
+
+    bool contains (const value_type &key_) const
+    {
+        return path_tree_find_ (m_root_, key_, m_comp_);
+    }
+
+    iterator lower_bound (const value_type &key_) const
+    {
+        return iterator::s_lower_bound_ (m_root_, key_, m_comp_);
+    }
+
+    iterator begin () const { return iterator::s_begin_ (m_root_); }
+
+    iterator end () const noexcept { return iterator (); }
+
+    // Add count_ copies of key_. Return the number of copies of key_ in the multiset.
+    size_type insert (const value_type &key_, size_type count_ = 1)
+    {
+        if ( !count_ )
+            return count (key_);
+
+        size_type copies_ = 0;
+        m_root_           = m_insert_ (m_root_, key_, count_, copies_);
+        return copies_;
+    }
+
+    // Erase one copy of key_. Return false if there is no such key.
+    bool erase_one (const value_type &key_)
+    {
+        size_type erased_ = 0;
+        m_root_           = m_erase_ (m_root_, key_, 1, erased_);
+        return erased_;
+    }
+
+    // Erase all copies of key_. Return number of erased copies.
+    size_type erase (const value_type &key_)
+    {
+        size_type erased_ = 0;
+        m_root_           = m_erase_ (m_root_, key_, size (), erased_);
+        return erased_;
+    }
+
+    void clear () noexcept
+    {
+        m_destroy_subtree_ (std::exchange (m_root_, nullptr));
+        /* Whole slabs go back to the allocator at once. */
+        m_node_pool_.m_release_ ();
+    }
+};
+
+template <typename Key_, typename Comp_, typename Alloc_>
+typename order_statistic_multiset<Key_, Comp_, Alloc_>::node_ptr_
+order_statistic_multiset<Key_, Comp_, Alloc_>::s_balance_ (node_ptr_ node_) noexcept
+{
+    auto diff_ = s_height_ (node_->m_right_) - s_height_ (node_->m_left_);
+    if ( diff_ < -1 )
+    {
+        auto left_ = node_->m_left_;
+        if ( s_height_ (left_->m_right_) > s_height_ (left_->m_left_) )
+            node_->m_left_ = s_rotate_left_ (left_);
+        return s_rotate_right_ (node_);
+    }
+
+    if ( diff_ > 1 )
+    {
+        auto right_ = node_->m_right_;
+        if ( s_height_ (right_->m_left_) > s_height_ (right_->m_right_) )
+            node_->m_right_ = s_rotate_right_ (right_);
+        return s_rotate_left_ (node_);
+    }
+
+    s_update_ (node_);
+    return node_;
+}
+
+template <typename Key_, typename Comp_, typename Alloc_>
+typename order_statistic_multiset<Key_, Comp_, Alloc_>::node_ptr_
+order_statistic_multiset<Key_, Comp_, Alloc_>::m_insert_ (node_ptr_ node_, const value_type &key_,
+                                                          size_type count_, size_type &copies_)
+{
+    if ( !node_ )
+    {
+        copies_ = count_;
+        return m_node_pool_.m_create_ (key_, count_);
+    }
+
+    if ( m_comp_ (key_, node_->m_key_) )
+        node_->m_left_ = m_insert_ (node_->m_left_, key_, count_, copies_);
+    else if ( m_comp_ (node_->m_key_, key_) )
+        node_->m_right_ = m_insert_ (node_->m_right_, key_, count_, copies_);
+    else
+    {
+        /* One more copy changes the sizes on the path only, no heights. */
+        node_->m_count_ += count_;
+        node_->m_size_  += count_;
+        copies_          = node_->m_count_;
+        return node_;
+    }
+    return s_balance_ (node_);
+}
+
+template <typename Key_, typename Comp_, typename Alloc_>
+typename order_statistic_multiset<Key_, Comp_, Alloc_>::node_ptr_
+order_statistic_multiset<Key_, Comp_, Alloc_>::s_unlink_min_ (node_ptr_ node_,
+                                                              node_ptr_ &min_) noexcept
+{
+    if ( !node_->m_left_ )
+    {
+        min_ = node_;
+        return node_->m_right_;
+    }
+
+    node_->m_left_ = s_unlink_min_ (node_->m_left_, min_);
+    return s_balance_ (node_);
+}
+
+template <typename Key_, typename Comp_, typename Alloc_>
+typename order_statistic_multiset<Key_, Comp_, Alloc_>::node_ptr_
+order_statistic_multiset<Key_, Comp_, Alloc_>::m_erase_ (node_ptr_ node_, const value_type &key_,
+                                                         size_type count_, size_type &erased_)
+{
+    if ( !node_ )
+        return nullptr;
+
+    if ( m_comp_ (key_, node_->m_key_) )
+        node_->m_left_ = m_erase_ (node_->m_left_, key_, count_, erased_);
+    else if ( m_comp_ (node_->m_key_, key_) )
+        node_->m_right_ = m_erase_ (node_->m_right_, key_, count_, erased_);
+    else if ( node_->m_count_ > count_ )
+    {
+        erased_          = count_;
+        node_->m_count_ -= count_;
+        node_->m_size_  -= count_;
+        return node_;
+    }
+    else
+    {
+        erased_     = node_->m_count_;
+        auto left_  = node_->m_left_;
+        auto right_ = node_->m_right_;
+        m_node_pool_.m_destroy_ (node_);
+        if ( !left_ || !right_ )
+            return (left_ ? left_ : right_);
+
+        /* The successor node takes the place of the erased one, keys are not moved. */
+        node_ptr_ min_ = nullptr;
+        right_         = s_unlink_min_ (right_, min_);
+        min_->m_left_  = left_;
+        min_->m_right_ = right_;
+        return s_balance_ (min_);
+    }
+
+    if ( !erased_ )
+        return node_;
+    /* Both the size and possibly the height of the path changed. */
+    return s_balance_ (node_);
+}
+
+template <typename Key_, typename Comp_, typename Alloc_>
+void order_statistic_multiset<Key_, Comp_, Alloc_>::m_destroy_subtree_ (node_ptr_ node_) noexcept
+{
+    /* Trivial keys leave nothing to destroy, the nodes are dropped with their slabs. */
+    if constexpr ( !std::is_trivially_destructible_v<value_type> )
+        free_subtree_ (m_node_pool_, node_);
+}
+
+}   // namespace rethinking_stl
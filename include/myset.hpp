@@ -12,10 +12,69 @@
 #pragma once
 
 #include "avl_tree.hpp"
+#include "btree.hpp"
+#include "compact_avl_tree.hpp"
+#include "frozen_set.hpp"
+#include "multiset.hpp"
 namespace rethinking_stl
 {
 
-template <typename Key_, typename Compare_ = std::less<Key_>>
-using set = dynamic_order_avl_tree_<Key_, Compare_>;
+// Storage engines of the set.
 
-}   // namespace rethinking_stl
\ No newline at end of file
+// Pointer based nodes from the slab pool.
+struct avl_tree_engine
+{
+};
+
+// Nodes in one contiguous pool addressed by 32-bit indices.
+struct compact_avl_tree_engine
+{
+};
+
+// Pointer based avl tree counting its comparisons, rotations and backtracks, see stats ().
+struct instrumented_avl_tree_engine
+{
+};
+
+// B+ tree with per-child subtree sizes and SIMD search inside the nodes.
+struct btree_engine
+{
+};
+
+template <typename Engine_, typename Key_, typename Compare_, typename Allocator_>
+struct set_engine_;
+
+template <typename Key_, typename Compare_, typename Allocator_>
+struct set_engine_<avl_tree_engine, Key_, Compare_, Allocator_>
+{
+    using type = dynamic_order_avl_tree_<Key_, Compare_, Allocator_>;
+};
+
+template <typename Key_, typename Compare_, typename Allocator_>
+struct set_engine_<instrumented_avl_tree_engine, Key_, Compare_, Allocator_>
+{
+    using type = dynamic_order_avl_tree_<Key_, Compare_, Allocator_, tree_stats>;
+};
+
+template <typename Key_, typename Compare_, typename Allocator_>
+struct set_engine_<compact_avl_tree_engine, Key_, Compare_, Allocator_>
+{
+    using type = compact_order_avl_tree_<Key_, Compare_, Allocator_>;
+};
+
+template <typename Key_, typename Compare_, typename Allocator_>
+struct set_engine_<btree_engine, Key_, Compare_, Allocator_>
+{
+    using type = order_btree_<Key_, Compare_, Allocator_>;
+};
+
+template <typename Key_, typename Compare_ = std::less<Key_>,
+          typename Allocator_ = std::allocator<Key_>, typename Engine_ = avl_tree_engine>
+using set = typename set_engine_<Engine_, Key_, Compare_, Allocator_>::type;
+
+// Multiset keeping the number of copies of every key in its node.
+template <typename Key_, typename Compare_ = std::less<Key_>,
+          typename Allocator_ = std::allocator<Key_>>
+using multiset = order_statistic_multiset<Key_, Compare_, Allocator_>;
+
+}   // namespace rethinking_stl
@@ -0,0 +1,589 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <alex.rom23@mail.ru> wrote this file.  As long as you retain this notice you
+ * can do whatever you want with this stuff. If we meet some day, and you think
+ * this stuff is worth it, you can buy me a beer in return.   Alex Romanov
+ * ----------------------------------------------------------------------------
+ */
+
+// slab node pool implementation header
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace rethinking_stl
+{
+
+//===================================node_pool_===================================
+/*
+ * Arena of nodes carved out of big slabs requested from the upstream allocator.
+ * Freed nodes are kept in an intrusive free list and reused by the next allocation,
+ * slabs are returned to the upstream allocator only all at once by m_release_ ().
+ *
+ * A tree split in two leaves nodes of both halves in the same slabs, a joined tree brings its
+ * slabs along. So the slabs belong to an arena of the family of pools which exchanged nodes
+ * by m_share_ () and m_adopt_ (), and are returned to the upstream allocator with the last pool
+ * of the family. Pools give their free nodes and the unused rest of their slab back to the
+ * arena when they split, join or are released, and take them from there before a new slab is
+ * allocated, so the family reuses its memory whichever tree frees and allocates the nodes.
+ */
+template <typename Node_, typename Allocator_ = std::allocator<Node_>> class node_pool_
+{
+  public:
+    using node_type      = Node_;
+    using node_ptr_      = Node_ *;
+    using size_type      = std::size_t;
+    using allocator_type = typename std::allocator_traits<Allocator_>::template rebind_alloc<Node_>;
+
+  private:
+    using alloc_traits_ = std::allocator_traits<allocator_type>;
+
+    struct free_node_
+    {
+        free_node_ *m_next_;
+    };
+
+    static_assert (sizeof (Node_) >= sizeof (free_node_), "Node is too small for the free list.");
+
+    struct slab_
+    {
+        node_ptr_ m_nodes_;
+        size_type m_capacity_;
+    };
+
+    template <typename T_>
+    using rebind_ = typename std::allocator_traits<Allocator_>::template rebind_alloc<T_>;
+
+    // Slabs of a family of pools. Pools of one family may be used by different threads, but
+    // they take the lock only when they run out of their own free nodes.
+    struct family_arena_
+    {
+        allocator_type m_alloc_;
+        std::mutex m_mutex_;
+        std::vector<slab_, rebind_<slab_>> m_slabs_;
+        std::vector<slab_, rebind_<slab_>> m_unused_;             /* never used rests of slabs */
+        std::vector<free_node_ *, rebind_<free_node_ *>> m_freed_; /* free lists of the pools */
+        std::shared_ptr<family_arena_> m_merged_into_; /* arena which took the slabs of this one */
+
+        explicit family_arena_ (const allocator_type &alloc_)
+            : m_alloc_ (alloc_), m_slabs_ (m_alloc_), m_unused_ (m_alloc_), m_freed_ (m_alloc_)
+        {
+        }
+
+        family_arena_ (const family_arena_ &)            = delete;
+        family_arena_ &operator= (const family_arena_ &) = delete;
+
+        ~family_arena_ ()
+        {
+            for ( auto &slab_ : m_slabs_ )
+                alloc_traits_::deallocate (m_alloc_, slab_.m_nodes_, slab_.m_capacity_);
+        }
+    };
+
+    using arena_ptr_ = std::shared_ptr<family_arena_>;
+
+    static constexpr size_type s_first_slab_ = 64;
+    static constexpr size_type s_max_slab_   = 1 << 16;
+
+    allocator_type m_alloc_;
+    arena_ptr_ m_arena_; /* created with the first slab */
+    free_node_ *m_free_     = nullptr;
+    node_ptr_ m_bump_       = nullptr; /* next never used node of the current slab */
+    node_ptr_ m_bump_end_   = nullptr;
+    size_type m_next_slab_  = s_first_slab_;
+    size_type m_allocated_  = 0; /* number of live nodes */
+
+    // Lock the arena of the family, following the arenas merged into others.
+    static std::unique_lock<std::mutex> s_lock_ (arena_ptr_ &arena_)
+    {
+        for ( ;; )
+        {
+            std::unique_lock lock_ (arena_->m_mutex_);
+            if ( !arena_->m_merged_into_ )
+                return lock_;
+            auto next_ = arena_->m_merged_into_;
+            lock_.unlock ();
+            arena_ = std::move (next_);
+        }
+    }
+
+    static void s_resolve_ (arena_ptr_ &arena_) { s_lock_ (arena_).unlock (); }
+
+    // Hand the free nodes and the rest of the slab over to the locked arena. Strong exception
+    // guarantee.
+    void m_give_back_ (family_arena_ &arena_)
+    {
+        arena_.m_freed_.reserve (arena_.m_freed_.size () + 1);
+        arena_.m_unused_.reserve (arena_.m_unused_.size () + 1);
+
+        if ( m_free_ )
+            arena_.m_freed_.push_back (std::exchange (m_free_, nullptr));
+        if ( m_bump_ != m_bump_end_ )
+            arena_.m_unused_.push_back ({m_bump_, static_cast<size_type> (m_bump_end_ - m_bump_)});
+        m_bump_     = nullptr;
+        m_bump_end_ = nullptr;
+    }
+
+    void m_make_arena_ ()
+    {
+        if ( !m_arena_ )
+            m_arena_ =
+                std::allocate_shared<family_arena_> (rebind_<family_arena_> (m_alloc_), m_alloc_);
+    }
+
+    // Take nodes freed by the family, or the rest of a slab, or a new slab.
+    void m_refill_ ()
+    {
+        m_make_arena_ ();
+
+        auto lock_   = s_lock_ (m_arena_);
+        auto &arena_ = *m_arena_;
+        if ( !arena_.m_freed_.empty () )
+        {
+            m_free_ = arena_.m_freed_.back ();
+            arena_.m_freed_.pop_back ();
+            return;
+        }
+
+        slab_ rest_;
+        if ( !arena_.m_unused_.empty () )
+        {
+            rest_ = arena_.m_unused_.back ();
+            arena_.m_unused_.pop_back ();
+        }
+        else
+        {
+            /* Grow slabs geometrically, so number of upstream allocations is logarithmic. */
+            arena_.m_slabs_.reserve (arena_.m_slabs_.size () + 1);
+            rest_ = {alloc_traits_::allocate (m_alloc_, m_next_slab_), m_next_slab_};
+            arena_.m_slabs_.push_back (rest_);
+            m_next_slab_ = std::min (m_next_slab_ * 2, s_max_slab_);
+        }
+        m_bump_     = rest_.m_nodes_;
+        m_bump_end_ = rest_.m_nodes_ + rest_.m_capacity_;
+    }
+
+    void *m_get_storage_ ()
+    {
+        if ( !m_free_ && m_bump_ == m_bump_end_ )
+            m_refill_ ();
+
+        if ( m_free_ )
+        {
+            auto storage_ = m_free_;
+            m_free_       = m_free_->m_next_;
+            return storage_;
+        }
+        return m_bump_++;
+    }
+
+    // Slabs of the family, f_ is called for each of them.
+    template <typename F_> void m_for_each_slab_ (F_ f_) const
+    {
+        if ( !m_arena_ )
+            return;
+        auto arena_ = m_arena_;
+        auto lock_  = s_lock_ (arena_);
+        for ( auto &slab_ : arena_->m_slabs_ )
+            f_ (slab_);
+    }
+
+  public:
+    node_pool_ () : node_pool_ (Allocator_ ()) {}
+
+    explicit node_pool_ (const Allocator_ &alloc_) : m_alloc_ (alloc_) {}
+
+    node_pool_ (const node_pool_ &)            = delete;
+    node_pool_ &operator= (const node_pool_ &) = delete;
+
+    node_pool_ (node_pool_ &&other_) noexcept
+        : m_alloc_ (std::move (other_.m_alloc_)), m_arena_ (std::move (other_.m_arena_)),
+          m_free_ (std::exchange (other_.m_free_, nullptr)),
+          m_bump_ (std::exchange (other_.m_bump_, nullptr)),
+          m_bump_end_ (std::exchange (other_.m_bump_end_, nullptr)),
+          m_next_slab_ (std::exchange (other_.m_next_slab_, s_first_slab_)),
+          m_allocated_ (std::exchange (other_.m_allocated_, 0))
+    {
+    }
+
+    node_pool_ &operator= (node_pool_ &&other_) noexcept
+    {
+        swap (other_);
+        return *this;
+    }
+
+    ~node_pool_ () { m_release_ (); }
+
+    void swap (node_pool_ &other_) noexcept
+    {
+        using std::swap;
+        swap (m_alloc_, other_.m_alloc_);
+        swap (m_arena_, other_.m_arena_);
+        swap (m_free_, other_.m_free_);
+        swap (m_bump_, other_.m_bump_);
+        swap (m_bump_end_, other_.m_bump_end_);
+        swap (m_next_slab_, other_.m_next_slab_);
+        swap (m_allocated_, other_.m_allocated_);
+    }
+
+    template <typename... Args_> node_ptr_ m_create_ (Args_ &&...args_)
+    {
+        auto storage_ = m_get_storage_ ();
+        node_ptr_ node_;
+        try
+        {
+            node_ = ::new (storage_) Node_ (std::forward<Args_> (args_)...);
+        }
+        catch ( ... )
+        {
+            auto free_     = static_cast<free_node_ *> (storage_);
+            free_->m_next_ = m_free_;
+            m_free_        = free_;
+            throw;
+        }
+        m_allocated_++;
+        return node_;
+    }
+
+    void m_destroy_ (node_ptr_ node_) noexcept
+    {
+        node_->~Node_ ();
+        auto free_     = ::new (static_cast<void *> (node_)) free_node_;
+        free_->m_next_ = m_free_;
+        m_free_        = free_;
+        m_allocated_--;
+    }
+
+    // Whether other pools keep nodes in the slabs of this one. Their owners have to destroy
+    // the nodes one by one before m_release_ (), so that the family can reuse them.
+    bool shared () noexcept
+    {
+        if ( !m_arena_ )
+            return false;
+        s_resolve_ (m_arena_);
+        return m_arena_.use_count () > 1;
+    }
+
+    /*
+     * Give all slabs back to the upstream allocator, the ones of a family once no other pool
+     * of it is left. Destructors of live nodes are not called, it's up to the owner to destroy
+     * them first if they are not trivially destructible.
+     */
+    void m_release_ () noexcept
+    {
+        if ( m_arena_ )
+        {
+            try
+            {
+                auto lock_ = s_lock_ (m_arena_);
+                /* If the arena can't take them, they are freed together with it. */
+                if ( m_arena_.use_count () > 1 )
+                    m_give_back_ (*m_arena_);
+            }
+            catch ( ... )
+            {
+            }
+            m_arena_.reset ();
+        }
+        m_free_      = nullptr;
+        m_bump_      = nullptr;
+        m_bump_end_  = nullptr;
+        m_next_slab_ = s_first_slab_;
+        m_allocated_ = 0;
+    }
+
+    /*
+     * Share the slabs with the empty pool other_, which takes moved_ of the live nodes. The
+     * free nodes of this pool go to the arena for the one of the two which needs them first.
+     * Pools have to use equal allocators. Strong exception guarantee.
+     */
+    void m_share_ (node_pool_ &other_, size_type moved_)
+    {
+        m_make_arena_ ();
+        {
+            auto lock_ = s_lock_ (m_arena_);
+            m_give_back_ (*m_arena_);
+        }
+
+        other_.m_arena_     = m_arena_;
+        other_.m_next_slab_ = m_next_slab_;
+        m_allocated_ -= moved_;
+        other_.m_allocated_ += moved_;
+    }
+
+    /*
+     * Take the slabs and live nodes of other_ after its nodes are moved here, other_ is left
+     * empty. Free nodes of other_ go to the arena of this pool, which takes the arena of
+     * other_ if they differ. Pools have to use equal allocators. Strong exception guarantee.
+     */
+    void m_adopt_ (node_pool_ &other_)
+    {
+        if ( other_.m_arena_ )
+        {
+            if ( !m_arena_ )
+                m_arena_ = other_.m_arena_;
+
+            for ( ;; )
+            {
+                s_resolve_ (m_arena_);
+                s_resolve_ (other_.m_arena_);
+                auto &arena_  = *m_arena_;
+                auto &others_ = *other_.m_arena_;
+
+                if ( &arena_ == &others_ )
+                {
+                    std::lock_guard lock_ (arena_.m_mutex_);
+                    if ( arena_.m_merged_into_ )
+                        continue;
+                    other_.m_give_back_ (arena_);
+                    break;
+                }
+
+                std::scoped_lock lock_ (arena_.m_mutex_, others_.m_mutex_);
+                if ( arena_.m_merged_into_ || others_.m_merged_into_ )
+                    continue;
+
+                arena_.m_slabs_.reserve (arena_.m_slabs_.size () + others_.m_slabs_.size ());
+                arena_.m_unused_.reserve (arena_.m_unused_.size () + others_.m_unused_.size () + 1);
+                arena_.m_freed_.reserve (arena_.m_freed_.size () + others_.m_freed_.size () + 1);
+
+                /* Nothing throws from here on. Pools of the other arena follow it here. */
+                auto append_ = [] (auto &to_, auto &from_) {
+                    to_.insert (to_.end (), from_.begin (), from_.end ());
+                    from_.clear ();
+                };
+                append_ (arena_.m_slabs_, others_.m_slabs_);
+                append_ (arena_.m_unused_, others_.m_unused_);
+                append_ (arena_.m_freed_, others_.m_freed_);
+                others_.m_merged_into_ = m_arena_;
+                other_.m_give_back_ (arena_);
+                break;
+            }
+        }
+
+        m_allocated_ += other_.m_allocated_;
+        other_.m_release_ ();
+    }
+
+    size_type allocated () const noexcept { return m_allocated_; }
+
+    // Slabs of the whole family of the pool.
+    size_type slab_count () const
+    {
+        size_type res_ = 0;
+        m_for_each_slab_ ([&res_] (const slab_ &) { res_++; });
+        return res_;
+    }
+
+    size_type capacity () const
+    {
+        size_type res_ = 0;
+        m_for_each_slab_ ([&res_] (const slab_ &slab_) { res_ += slab_.m_capacity_; });
+        return res_;
+    }
+
+    allocator_type get_allocator () const noexcept { return m_alloc_; }
+};
+
+//===============================indexed_node_pool_===============================
+/*
+ * Pool of nodes addressed by 32-bit indices, for nodes which keep many links to each other.
+ * Slabs grow like in node_pool_ up to 2^16 nodes and never move: the high half of an index is
+ * the number of the slab and the low half is the node in it, so a node is found by one load
+ * from the small slab table. Index 0 is never given out and stands for no node. Freed nodes
+ * are kept in a free list of indices, slabs go back to the upstream allocator all at once.
+ * Pools don't share slabs, unlike node_pool_.
+ */
+template <typename Node_, typename Allocator_ = std::allocator<Node_>> class indexed_node_pool_
+{
+  public:
+    using node_type      = Node_;
+    using node_ptr_      = Node_ *;
+    using index_type     = std::uint32_t;
+    using size_type      = std::size_t;
+    using allocator_type = typename std::allocator_traits<Allocator_>::template rebind_alloc<Node_>;
+
+    static constexpr index_type s_null_ = 0;
+
+  private:
+    using alloc_traits_ = std::allocator_traits<allocator_type>;
+    using slabs_        = std::vector<node_ptr_, typename std::allocator_traits<
+                                                     Allocator_>::template rebind_alloc<node_ptr_>>;
+
+    static_assert (sizeof (Node_) >= sizeof (index_type), "Node is too small for the free list.");
+
+    static constexpr unsigned s_slab_bits_     = 16;
+    static constexpr size_type s_first_slab_   = 64;
+    static constexpr size_type s_max_slab_     = size_type {1} << s_slab_bits_;
+    static constexpr index_type s_offset_mask_ = (index_type {1} << s_slab_bits_) - 1;
+
+    /* So that the last index still fits in 32 bits. */
+    static constexpr size_type s_max_slabs_ = (size_type {1} << s_slab_bits_) - 1;
+
+    allocator_type m_alloc_;
+    slabs_ m_slabs_;
+    index_type m_free_     = s_null_;
+    index_type m_bump_     = s_null_; /* next never used node of the last slab */
+    index_type m_bump_end_ = s_null_;
+    size_type m_allocated_ = 0; /* number of live nodes */
+
+    static size_type s_slab_size_ (size_type slab_) noexcept
+    {
+        return (slab_ < s_slab_bits_ ? std::min (s_first_slab_ << slab_, s_max_slab_)
+                                     : s_max_slab_);
+    }
+
+    // Storage of a free node keeps the index of the next free one.
+    index_type &m_next_free_ (index_type x_) noexcept
+    {
+        return *reinterpret_cast<index_type *> (m_at_ (x_));
+    }
+
+    void m_add_slab_ ()
+    {
+        auto slab_ = m_slabs_.size ();
+        if ( slab_ == s_max_slabs_ )
+            throw std::length_error ("Too many nodes for 32-bit indices.");
+
+        m_slabs_.reserve (slab_ + 1);
+        m_slabs_.push_back (alloc_traits_::allocate (m_alloc_, s_slab_size_ (slab_)));
+
+        /* The first node of the first slab would get the null index. */
+        m_bump_     = static_cast<index_type> (slab_ << s_slab_bits_) + (slab_ ? 0 : 1);
+        m_bump_end_ = static_cast<index_type> ((slab_ << s_slab_bits_) + s_slab_size_ (slab_));
+    }
+
+    index_type m_get_storage_ ()
+    {
+        if ( m_free_ )
+            return std::exchange (m_free_, m_next_free_ (m_free_));
+        if ( m_bump_ == m_bump_end_ )
+            m_add_slab_ ();
+        return m_bump_++;
+    }
+
+    void m_put_storage_ (index_type x_) noexcept
+    {
+        ::new (static_cast<void *> (m_at_ (x_))) index_type (m_free_);
+        m_free_ = x_;
+    }
+
+  public:
+    indexed_node_pool_ () : indexed_node_pool_ (Allocator_ ()) {}
+
+    explicit indexed_node_pool_ (const Allocator_ &alloc_) : m_alloc_ (alloc_), m_slabs_ (alloc_)
+    {
+    }
+
+    indexed_node_pool_ (const indexed_node_pool_ &)            = delete;
+    indexed_node_pool_ &operator= (const indexed_node_pool_ &) = delete;
+
+    indexed_node_pool_ (indexed_node_pool_ &&other_) noexcept
+        : m_alloc_ (other_.m_alloc_), m_slabs_ (std::move (other_.m_slabs_)),
+          m_free_ (std::exchange (other_.m_free_, s_null_)),
+          m_bump_ (std::exchange (other_.m_bump_, s_null_)),
+          m_bump_end_ (std::exchange (other_.m_bump_end_, s_null_)),
+          m_allocated_ (std::exchange (other_.m_allocated_, 0))
+    {
+        other_.m_slabs_.clear ();
+    }
+
+    indexed_node_pool_ &operator= (indexed_node_pool_ &&other_) noexcept
+    {
+        swap (other_);
+        return *this;
+    }
+
+    ~indexed_node_pool_ () { m_release_ (); }
+
+    void swap (indexed_node_pool_ &other_) noexcept
+    {
+        using std::swap;
+        swap (m_alloc_, other_.m_alloc_);
+        swap (m_slabs_, other_.m_slabs_);
+        swap (m_free_, other_.m_free_);
+        swap (m_bump_, other_.m_bump_);
+        swap (m_bump_end_, other_.m_bump_end_);
+        swap (m_allocated_, other_.m_allocated_);
+    }
+
+    node_ptr_ m_at_ (index_type x_) const noexcept
+    {
+        return m_slabs_[x_ >> s_slab_bits_] + (x_ & s_offset_mask_);
+    }
+
+    template <typename... Args_> index_type m_create_ (Args_ &&...args_)
+    {
+        auto x_ = m_get_storage_ ();
+        try
+        {
+            ::new (static_cast<void *> (m_at_ (x_))) Node_ (std::forward<Args_> (args_)...);
+        }
+        catch ( ... )
+        {
+            m_put_storage_ (x_);
+            throw;
+        }
+        m_allocated_++;
+        return x_;
+    }
+
+    void m_destroy_ (index_type x_) noexcept
+    {
+        m_at_ (x_)->~Node_ ();
+        m_put_storage_ (x_);
+        m_allocated_--;
+    }
+
+    // Give all slabs back to the upstream allocator. Destructors of live nodes are not called.
+    void m_release_ () noexcept
+    {
+        for ( size_type slab_ = 0; slab_ < m_slabs_.size (); slab_++ )
+            alloc_traits_::deallocate (m_alloc_, m_slabs_[slab_], s_slab_size_ (slab_));
+        m_slabs_.clear ();
+        m_free_      = s_null_;
+        m_bump_      = s_null_;
+        m_bump_end_  = s_null_;
+        m_allocated_ = 0;
+    }
+
+    size_type allocated () const noexcept { return m_allocated_; }
+
+    size_type slab_count () const noexcept { return m_slabs_.size (); }
+
+    allocator_type get_allocator () const noexcept { return m_alloc_; }
+};
+
+// Destroy all nodes of a binary tree and give them back to the pool one by one. Left children
+// are rotated up to avoid recursion and extra memory.
+template <typename Pool_, typename Node_> void free_subtree_ (Pool_ &pool_, Node_ *node_) noexcept
+{
+    while ( node_ )
+    {
+        if ( node_->m_left_ )
+        {
+            auto left_      = node_->m_left_;
+            node_->m_left_  = left_->m_right_;
+            left_->m_right_ = node_;
+            node_           = left_;
+        }
+        else
+        {
+            auto right_ = node_->m_right_;
+            pool_.m_destroy_ (node_);
+            node_ = right_;
+        }
+    }
+}
+
+}   // namespace rethinking_stl
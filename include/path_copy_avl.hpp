@@ -0,0 +1,229 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <alex.rom23@mail.ru> wrote this file.  As long as you retain this notice you
+ * can do whatever you want with this stuff. If we meet some day, and you think
+ * this stuff is worth it, you can buy me a beer in return.   Alex Romanov
+ * ----------------------------------------------------------------------------
+ */
+
+// path copying avl tree implementation header
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+#include "path_tree.hpp"
+
+namespace rethinking_stl
+{
+
+//==================================path_copy_avl_==================================
+/*
+ * Functional AVL tree. Nodes never change once created: insert and erase copy the path from
+ * the root to the changed node together with the rotated nodes and share the rest of the tree
+ * with the previous version. Nodes have m_left_, m_right_, m_size_, m_height_ and m_key_.
+ *
+ * Derived_ owns the nodes and provides
+ *  - m_make_ (left_, key_, right_), which creates a node and adds it to m_created_;
+ *  - m_replace_ (node_), called for every node which is not a part of the new version;
+ *  - m_destroy_ (node_), which frees a node of a failed update.
+ */
+template <typename Derived_, typename Node_, typename Key_, typename Compare_> class path_copy_avl_
+{
+  protected:
+    using node_ptr_ = const Node_ *;
+    using size_type = std::size_t;
+
+    Compare_ m_comp_;
+    std::vector<node_ptr_> m_created_; /* nodes of the update in progress */
+    std::vector<node_ptr_> m_dropped_; /* created by the update, but already replaced */
+
+    explicit path_copy_avl_ (const Compare_ &comp_) : m_comp_ (comp_) {}
+
+    static size_type s_size_ (node_ptr_ node_) noexcept { return path_tree_size_ (node_); }
+
+    static int s_height_ (node_ptr_ node_) noexcept { return (node_ ? node_->m_height_ : 0); }
+
+    // An update touches at most a few nodes per level, so lists of this size don't grow in the
+    // middle of it and the only thing which may throw is the creation of nodes.
+    static size_type s_update_bound_ (node_ptr_ root_) noexcept
+    {
+        return 4 * static_cast<size_type> (s_height_ (root_)) + 8;
+    }
+
+    // New node with key_ over left_ and right_, which heights differ at most by two. Rotated
+    // children are replaced by the new nodes.
+    node_ptr_ m_balance_ (node_ptr_ left_, const Key_ &key_, node_ptr_ right_);
+
+    node_ptr_ m_insert_ (node_ptr_ node_, const Key_ &key_, bool &inserted_);
+    node_ptr_ m_erase_ (node_ptr_ node_, const Key_ &key_, bool &erased_);
+    node_ptr_ m_erase_min_ (node_ptr_ node_, node_ptr_ &min_);
+
+    // Return the root of the new version built by update_ from root_. If the update throws,
+    // the nodes it created are destroyed and the lists are left empty.
+    template <typename Update_> node_ptr_ m_update_ (node_ptr_ root_, Update_ update_);
+
+  private:
+    Derived_ &m_derived_ () noexcept { return static_cast<Derived_ &> (*this); }
+
+    node_ptr_ m_make_ (node_ptr_ left_, const Key_ &key_, node_ptr_ right_)
+    {
+        return m_derived_ ().m_make_ (left_, key_, right_);
+    }
+
+    void m_replace_ (node_ptr_ node_) { m_derived_ ().m_replace_ (node_); }
+};
+
+template <typename Derived_, typename Node_, typename Key_, typename Compare_>
+typename path_copy_avl_<Derived_, Node_, Key_, Compare_>::node_ptr_
+path_copy_avl_<Derived_, Node_, Key_, Compare_>::m_balance_ (node_ptr_ left_, const Key_ &key_,
+                                                            node_ptr_ right_)
+{
+    /* The rotations of the mutable tree, with the rotated nodes copied. */
+    if ( s_height_ (left_) > s_height_ (right_) + 1 )
+    {
+        node_ptr_ res_;
+        auto ll_ = left_->m_left_;
+        auto lr_ = left_->m_right_;
+        if ( s_height_ (ll_) >= s_height_ (lr_) )
+            res_ = m_make_ (ll_, left_->m_key_, m_make_ (lr_, key_, right_));
+        else
+        {
+            res_ = m_make_ (m_make_ (ll_, left_->m_key_, lr_->m_left_), lr_->m_key_,
+                            m_make_ (lr_->m_right_, key_, right_));
+            m_replace_ (lr_);
+        }
+        m_replace_ (left_);
+        return res_;
+    }
+
+    if ( s_height_ (right_) > s_height_ (left_) + 1 )
+    {
+        node_ptr_ res_;
+        auto rl_ = right_->m_left_;
+        auto rr_ = right_->m_right_;
+        if ( s_height_ (rr_) >= s_height_ (rl_) )
+            res_ = m_make_ (m_make_ (left_, key_, rl_), right_->m_key_, rr_);
+        else
+        {
+            res_ = m_make_ (m_make_ (left_, key_, rl_->m_left_), rl_->m_key_,
+                            m_make_ (rl_->m_right_, right_->m_key_, rr_));
+            m_replace_ (rl_);
+        }
+        m_replace_ (right_);
+        return res_;
+    }
+
+    return m_make_ (left_, key_, right_);
+}
+
+template <typename Derived_, typename Node_, typename Key_, typename Compare_>
+typename path_copy_avl_<Derived_, Node_, Key_, Compare_>::node_ptr_
+path_copy_avl_<Derived_, Node_, Key_, Compare_>::m_insert_ (node_ptr_ node_, const Key_ &key_,
+                                                           bool &inserted_)
+{
+    if ( !node_ )
+    {
+        inserted_ = true;
+        return m_make_ (nullptr, key_, nullptr);
+    }
+
+    /* Unchanged subtrees are shared with the previous version. */
+    node_ptr_ res_ = node_;
+    if ( m_comp_ (key_, node_->m_key_) )
+    {
+        auto left_ = m_insert_ (node_->m_left_, key_, inserted_);
+        if ( inserted_ )
+            res_ = m_balance_ (left_, node_->m_key_, node_->m_right_);
+    }
+    else if ( m_comp_ (node_->m_key_, key_) )
+    {
+        auto right_ = m_insert_ (node_->m_right_, key_, inserted_);
+        if ( inserted_ )
+            res_ = m_balance_ (node_->m_left_, node_->m_key_, right_);
+    }
+
+    if ( res_ != node_ )
+        m_replace_ (node_);
+    return res_;
+}
+
+template <typename Derived_, typename Node_, typename Key_, typename Compare_>
+typename path_copy_avl_<Derived_, Node_, Key_, Compare_>::node_ptr_
+path_copy_avl_<Derived_, Node_, Key_, Compare_>::m_erase_min_ (node_ptr_ node_, node_ptr_ &min_)
+{
+    m_replace_ (node_);
+    if ( !node_->m_left_ )
+    {
+        min_ = node_;
+        return node_->m_right_;
+    }
+
+    auto left_ = m_erase_min_ (node_->m_left_, min_);
+    return m_balance_ (left_, node_->m_key_, node_->m_right_);
+}
+
+template <typename Derived_, typename Node_, typename Key_, typename Compare_>
+typename path_copy_avl_<Derived_, Node_, Key_, Compare_>::node_ptr_
+path_copy_avl_<Derived_, Node_, Key_, Compare_>::m_erase_ (node_ptr_ node_, const Key_ &key_,
+                                                          bool &erased_)
+{
+    if ( !node_ )
+        return nullptr;
+
+    if ( m_comp_ (key_, node_->m_key_) )
+    {
+        auto left_ = m_erase_ (node_->m_left_, key_, erased_);
+        if ( !erased_ )
+            return node_;
+        m_replace_ (node_);
+        return m_balance_ (left_, node_->m_key_, node_->m_right_);
+    }
+
+    if ( m_comp_ (node_->m_key_, key_) )
+    {
+        auto right_ = m_erase_ (node_->m_right_, key_, erased_);
+        if ( !erased_ )
+            return node_;
+        m_replace_ (node_);
+        return m_balance_ (node_->m_left_, node_->m_key_, right_);
+    }
+
+    erased_ = true;
+    m_replace_ (node_);
+    if ( !node_->m_left_ || !node_->m_right_ )
+        return (node_->m_left_ ? node_->m_left_ : node_->m_right_);
+
+    /* The successor takes the place of the node. */
+    node_ptr_ min_ = nullptr;
+    auto right_    = m_erase_min_ (node_->m_right_, min_);
+    return m_balance_ (node_->m_left_, min_->m_key_, right_);
+}
+
+template <typename Derived_, typename Node_, typename Key_, typename Compare_>
+template <typename Update_>
+typename path_copy_avl_<Derived_, Node_, Key_, Compare_>::node_ptr_
+path_copy_avl_<Derived_, Node_, Key_, Compare_>::m_update_ (node_ptr_ root_, Update_ update_)
+{
+    auto bound_ = s_update_bound_ (root_);
+    m_created_.reserve (bound_);
+    m_dropped_.reserve (bound_);
+
+    try
+    {
+        return update_ (root_);
+    }
+    catch ( ... )
+    {
+        for ( auto node_ : m_created_ )
+            m_derived_ ().m_destroy_ (node_);
+        m_created_.clear ();
+        m_dropped_.clear ();
+        throw;
+    }
+}
+
+}   // namespace rethinking_stl
@@ -0,0 +1,183 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <alex.rom23@mail.ru> wrote this file.  As long as you retain this notice you
+ * can do whatever you want with this stuff. If we meet some day, and you think
+ * this stuff is worth it, you can buy me a beer in return.   Alex Romanov
+ * ----------------------------------------------------------------------------
+ */
+
+// walks of trees without parent links implementation header
+
+#pragma once
+
+#include <cstddef>
+#include <iterator>
+#include <stdexcept>
+#include <vector>
+
+namespace rethinking_stl
+{
+
+/*
+ * Nodes have m_left_, m_right_, m_key_ and m_size_, the number of keys of the subtree. A node
+ * with m_count_ keeps that many copies of its key, which are counted by m_size_ too.
+ */
+template <typename Node_> std::size_t path_tree_size_ (const Node_ *node_) noexcept
+{
+    return (node_ ? node_->m_size_ : 0);
+}
+
+template <typename Node_> std::size_t path_tree_count_ (const Node_ *node_) noexcept
+{
+    if constexpr ( requires { node_->m_count_; } )
+        return node_->m_count_;
+    else
+        return 1;
+}
+
+//===============================path_tree_iterator_==============================
+// Forward iterator visiting every copy of the keys. The path to the current node is kept on a
+// stack of the ancestors the walk returns to, current on top.
+template <typename Node_, typename Key_> class path_tree_iterator_
+{
+    using node_ptr_ = const Node_ *;
+
+    std::vector<node_ptr_> m_path_;
+    std::size_t m_copy_ = 0; /* copies of the current key visited before */
+
+    void m_push_left_ (node_ptr_ node_)
+    {
+        for ( ; node_; node_ = node_->m_left_ )
+            m_path_.push_back (node_);
+    }
+
+  public:
+    using value_type        = Key_;
+    using reference         = const Key_ &;
+    using pointer           = const Key_ *;
+    using iterator_category = std::forward_iterator_tag;
+    using difference_type   = std::ptrdiff_t;
+
+    static path_tree_iterator_ s_begin_ (node_ptr_ root_)
+    {
+        path_tree_iterator_ res_;
+        res_.m_push_left_ (root_);
+        return res_;
+    }
+
+    // First key not less then key_.
+    template <typename Compare_>
+    static path_tree_iterator_ s_lower_bound_ (node_ptr_ x_, const Key_ &key_,
+                                               const Compare_ &comp_)
+    {
+        path_tree_iterator_ res_;
+        while ( x_ )
+        {
+            if ( !comp_ (x_->m_key_, key_) )
+            {
+                res_.m_path_.push_back (x_);
+                x_ = x_->m_left_;
+            }
+            else
+                x_ = x_->m_right_;
+        }
+        return res_;
+    }
+
+    reference operator* () const { return m_path_.back ()->m_key_; }
+
+    pointer operator->() const { return &m_path_.back ()->m_key_; }
+
+    path_tree_iterator_ &operator++ ()
+    {
+        auto node_ = m_path_.back ();
+        if ( ++m_copy_ < path_tree_count_ (node_) )
+            return *this;
+
+        m_copy_ = 0;
+        m_path_.pop_back ();
+        m_push_left_ (node_->m_right_);
+        return *this;
+    }
+
+    path_tree_iterator_ operator++ (int)
+    {
+        auto tmp_ = *this;
+        ++*this;
+        return tmp_;
+    }
+
+    bool operator== (const path_tree_iterator_ &other_) const noexcept
+    {
+        return (m_path_.empty () ? other_.m_path_.empty ()
+                                 : !other_.m_path_.empty () &&
+                                       m_path_.back () == other_.m_path_.back () &&
+                                       m_copy_ == other_.m_copy_);
+    }
+
+    bool operator!= (const path_tree_iterator_ &other_) const noexcept
+    {
+        return !(*this == other_);
+    }
+};
+
+//=================================path tree descents=================================
+// Return i-th smallest key counting every copy, throw std::out_of_range if there is no such
+// key.
+template <typename Node_> const auto &path_tree_select_ (const Node_ *x_, std::size_t i)
+{
+    if ( i > path_tree_size_ (x_) || !i )
+        throw std::out_of_range ("i is greater then the size of the tree or zero.");
+
+    for ( ;; )
+    {
+        auto left_size_ = path_tree_size_ (x_->m_left_);
+        if ( i <= left_size_ )
+            x_ = x_->m_left_;
+        else if ( i <= left_size_ + path_tree_count_ (x_) )
+            return x_->m_key_;
+        else
+        {
+            i -= left_size_ + path_tree_count_ (x_);
+            x_ = x_->m_right_;
+        }
+    }
+}
+
+// Number of copies of the keys less then key_ (not greater if Inclusive_).
+template <bool Inclusive_, typename Node_, typename Key_, typename Compare_>
+std::size_t path_tree_count_before_ (const Node_ *x_, const Key_ &key_, const Compare_ &comp_)
+{
+    std::size_t less_ = 0;
+    while ( x_ )
+    {
+        bool counted_ = (Inclusive_ ? !comp_ (key_, x_->m_key_) : comp_ (x_->m_key_, key_));
+        if ( counted_ )
+        {
+            less_ += path_tree_size_ (x_->m_left_) + path_tree_count_ (x_);
+            x_ = x_->m_right_;
+        }
+        else
+            x_ = x_->m_left_;
+    }
+    return less_;
+}
+
+// Node with key_ or nullptr.
+template <typename Node_, typename Key_, typename Compare_>
+const Node_ *path_tree_find_ (const Node_ *x_, const Key_ &key_, const Compare_ &comp_)
+{
+    while ( x_ )
+    {
+        if ( comp_ (key_, x_->m_key_) )
+            x_ = x_->m_left_;
+        else if ( comp_ (x_->m_key_, key_) )
+            x_ = x_->m_right_;
+        else
+            break;
+    }
+    return x_;
+}
+
+}   // namespace rethinking_stl
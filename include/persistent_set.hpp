@@ -0,0 +1,376 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <alex.rom23@mail.ru> wrote this file.  As long as you retain this notice you
+ * can do whatever you want with this stuff. If we meet some day, and you think
+ * this stuff is worth it, you can buy me a beer in return.   Alex Romanov
+ * ----------------------------------------------------------------------------
+ */
+
+// persistent order statistic set with O(1) snapshots implementation header
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <initializer_list>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "node_pool.hpp"
+#include "path_copy_avl.hpp"
+
+namespace rethinking_stl
+{
+
+template <typename Key_> struct persistent_set_node_
+{
+    const persistent_set_node_ *m_left_;
+    const persistent_set_node_ *m_right_;
+    std::size_t m_size_;
+    mutable std::size_t m_refs_; /* parents, the set and versions, touched by the set only */
+    int m_height_;
+    Key_ m_key_;
+};
+
+//=========================persistent_order_statistic_set=========================
+/*
+ * Order statistic set with point-in-time snapshots. The AVL tree is functional: insert and
+ * erase copy the path from the root to the changed node together with the rotated nodes and
+ * share the rest of the tree with the previous version. Nodes count the references from their
+ * parents, the set and the taken versions, so snapshot () is O(1) and a version is freed as
+ * soon as nothing refers to it. A version keeps only the nodes the set has replaced since it
+ * was taken, that is O(log n) nodes per update.
+ *
+ * The set itself is used from one thread at a time like the other containers. A version is
+ * immutable and may be read and destroyed on any thread while the set is updated.
+ */
+template <typename Key_, typename Compare_ = std::less<Key_>,
+          typename Allocator_ = std::allocator<Key_>>
+class persistent_order_statistic_set
+    : private path_copy_avl_<persistent_order_statistic_set<Key_, Compare_, Allocator_>,
+                             persistent_set_node_<Key_>, Key_, Compare_>
+{
+  public:
+    using value_type     = Key_;
+    using size_type      = std::size_t;
+    using key_compare    = Compare_;
+    using allocator_type = Allocator_;
+
+  private:
+    using shared_node_ = persistent_set_node_<Key_>;
+    using node_ptr_    = const shared_node_ *;
+    using node_pool_   = rethinking_stl::node_pool_<shared_node_, Allocator_>;
+    using tree_ = path_copy_avl_<persistent_order_statistic_set, shared_node_, Key_, Compare_>;
+
+    friend tree_;
+
+    using tree_::m_comp_;
+    using tree_::m_created_;
+    using tree_::m_dropped_;
+    using tree_::s_size_;
+    using tree_::s_height_;
+    using tree_::m_insert_;
+    using tree_::m_erase_;
+    using tree_::m_update_;
+
+    /* Reference count of the nodes created and replaced by the same update. */
+    static constexpr size_type s_dropped_ = std::numeric_limits<size_type>::max ();
+
+    mutable node_pool_ m_node_pool_;
+    node_ptr_ m_root_ = nullptr;
+
+    /* Roots of the destroyed versions, released by the set at its next update. Both lists have
+     * room for the roots of all live versions, so a version never allocates on destruction. */
+    mutable std::mutex m_orphans_mutex_;
+    mutable std::vector<node_ptr_> m_orphans_;
+    mutable std::vector<node_ptr_> m_released_;
+    mutable size_type m_versions_ = 0; /* live versions which will orphan a root */
+    mutable std::atomic<bool> m_orphaned_ {false};
+
+    node_ptr_ m_make_ (node_ptr_ left_, const value_type &key_, node_ptr_ right_)
+    {
+        auto res_ = m_node_pool_.m_create_ (
+            shared_node_ {left_, right_, s_size_ (left_) + s_size_ (right_) + 1, 0,
+                          std::max (s_height_ (left_), s_height_ (right_)) + 1, key_});
+        m_created_.push_back (res_);
+        return res_;
+    }
+
+    // The node is not a part of the new version. Nodes of the older versions are released
+    // together with their root, the ones created by this update are dropped.
+    void m_replace_ (node_ptr_ node_)
+    {
+        if ( node_->m_refs_ )
+            return;
+        node_->m_refs_ = s_dropped_;
+        m_dropped_.push_back (node_);
+    }
+
+    // Run the update, count the references of its nodes and release the replaced version. The
+    // set is left as is if the update throws.
+    template <typename Update_> void m_commit_ (Update_ update_);
+
+    static void s_retain_ (node_ptr_ node_) noexcept
+    {
+        if ( node_ )
+            node_->m_refs_++;
+    }
+
+    // Drop one reference, free the node and release its children if it was the last one.
+    void m_release_ (node_ptr_ node_) const noexcept
+    {
+        while ( node_ && !--node_->m_refs_ )
+        {
+            m_release_ (node_->m_left_);
+            auto right_ = node_->m_right_;
+            m_destroy_ (node_);
+            node_ = right_;
+        }
+    }
+
+    void m_destroy_ (node_ptr_ node_) const noexcept
+    {
+        m_node_pool_.m_destroy_ (const_cast<shared_node_ *> (node_));
+    }
+
+    // Called by the versions, possibly on other threads. The room is reserved by snapshot ().
+    void m_orphan_ (node_ptr_ root_) const noexcept
+    {
+        std::lock_guard lock_ (m_orphans_mutex_);
+        m_orphans_.push_back (root_);
+        m_versions_--;
+        m_orphaned_.store (true, std::memory_order_release);
+    }
+
+    // Release the roots of the destroyed versions.
+    void m_adopt_orphans_ () const noexcept
+    {
+        if ( !m_orphaned_.load (std::memory_order_acquire) )
+            return;
+        {
+            std::lock_guard lock_ (m_orphans_mutex_);
+            m_released_.swap (m_orphans_);
+            m_orphaned_.store (false, std::memory_order_relaxed);
+        }
+        for ( auto root_ : m_released_ )
+            m_release_ (root_);
+        m_released_.clear ();
+    }
+
+  public:
+    // Forward iterator over a version. Nodes shared by the versions have no parent links.
+    using iterator = path_tree_iterator_<shared_node_, Key_>;
+
+  public:
+    //===================================version====================================
+    /*
+     * Immutable version of the set taken by snapshot (). It holds one reference to
+     * the root of the version, so the nodes replaced by the later updates stay alive until it
+     * is destroyed. Versions may not outlive the set.
+     */
+    class version
+    {
+        friend class persistent_order_statistic_set;
+
+        const persistent_order_statistic_set *m_set_;
+        node_ptr_ m_root_;
+
+        explicit version (const persistent_order_statistic_set &set_)
+            : m_set_ (&set_), m_root_ (set_.m_root_)
+        {
+            s_retain_ (m_root_);
+        }
+
+        void m_drop_ () noexcept
+        {
+            if ( m_root_ )
+                m_set_->m_orphan_ (std::exchange (m_root_, nullptr));
+        }
+
+      public:
+        version (version &&other_) noexcept
+            : m_set_ (other_.m_set_), m_root_ (std::exchange (other_.m_root_, nullptr))
+        {
+        }
+
+        version &operator= (version &&other_) noexcept
+        {
+            if ( this != &other_ )
+            {
+                m_drop_ ();
+                m_set_  = other_.m_set_;
+                m_root_ = std::exchange (other_.m_root_, nullptr);
+            }
+            return *this;
+        }
+
+        ~version () { m_drop_ (); }
+
+        size_type size () const noexcept { return s_size_ (m_root_); }
+
+        bool empty () const noexcept { return !m_root_; }
+
+        // Return i-th smallest key, throw std::out_of_range if there is no such key.
+        value_type os_select (size_type i) const { return path_tree_select_ (m_root_, i); }
+
+        size_type get_number_less_then (const value_type &key_) const
+        {
+            return path_tree_count_before_<false> (m_root_, key_, m_set_->m_comp_);
+        }
+
+        size_type rank (const value_type &key_) const { return get_number_less_then (key_); }
+
+        size_type count_less_equal (const value_type &key_) const
+        {
+            return path_tree_count_before_<true> (m_root_, key_, m_set_->m_comp_);
+        }
+
+        bool contains (const value_type &key_) const
+        {
+            return path_tree_find_ (m_root_, key_, m_set_->m_comp_);
+        }
+
+        iterator lower_bound (const value_type &key_) const
+        {
+            return iterator::s_lower_bound_ (m_root_, key_, m_set_->m_comp_);
+        }
+
+        iterator begin () const { return iterator::s_begin_ (m_root_); }
+
+        iterator end () const noexcept { return iterator (); }
+    };
+
+    persistent_order_statistic_set () : persistent_order_statistic_set (Compare_ ()) {}
+
+    explicit persistent_order_statistic_set (const Compare_ &comp_,
+                                             const Allocator_ &alloc_ = Allocator_ ())
+        : tree_ (comp_), m_node_pool_ (alloc_)
+    {
+    }
+
+    persistent_order_statistic_set (std::initializer_list<value_type> keys_,
+                                    const Compare_ &comp_ = Compare_ (),
+                                    const Allocator_ &alloc_ = Allocator_ ())
+        : persistent_order_statistic_set (comp_, alloc_)
+    {
+        for ( auto &key_ : keys_ )
+            insert (key_);
+    }
+
+    persistent_order_statistic_set (const persistent_order_statistic_set &)            = delete;
+    persistent_order_statistic_set &operator= (const persistent_order_statistic_set &) = delete;
+
+    // No versions may outlive the set.
+    ~persistent_order_statistic_set ()
+    {
+        m_adopt_orphans_ ();
+        m_release_ (m_root_);
+    }
+
+    allocator_type get_allocator () const noexcept
+    {
+        return allocator_type (m_node_pool_.get_allocator ());
+    }
+
+    // O(1) immutable view of the current version. Take it on the thread which updates the set,
+    // then read it anywhere.
+    version snapshot () const
+    {
+        m_adopt_orphans_ ();
+        if ( m_root_ )
+        {
+            std::lock_guard lock_ (m_orphans_mutex_);
+            auto room_ = m_orphans_.size () + m_versions_ + 1;
+            m_orphans_.reserve (room_);
+            m_released_.reserve (room_);
+            m_versions_++;
+        }
+        return version (*this);
+    }
+
+    size_type size () const noexcept { return s_size_ (m_root_); }
+
+    bool empty () const noexcept { return !m_root_; }
+
+    value_type os_select (size_type i) const { return path_tree_select_ (m_root_, i); }
+
+    size_type get_number_less_then (const value_type &key_) const
+    {
+        return path_tree_count_before_<false> (m_root_, key_, m_comp_);
+    }
+
+    bool contains (const value_type &key_) const
+    {
+        return path_tree_find_ (m_root_, key_, m_comp_);
+    }
+
+    iterator lower_bound (const value_type &key_) const
+    {
+        return iterator::s_lower_bound_ (m_root_, key_, m_comp_);
+    }
+
+    iterator begin () const { return iterator::s_begin_ (m_root_); }
+
+    iterator end () const noexcept { return iterator (); }
+
+    // Return false if the key is already inserted.
+    bool insert (const value_type &key_)
+    {
+        bool inserted_ = false;
+        m_commit_ ([this, &key_, &inserted_] (node_ptr_ root_) {
+            return m_insert_ (root_, key_, inserted_);
+        });
+        return inserted_;
+    }
+
+    // Return number of erased elements.
+    size_type erase (const value_type &key_)
+    {
+        bool erased_ = false;
+        m_commit_ ([this, &key_, &erased_] (node_ptr_ root_) {
+            return m_erase_ (root_, key_, erased_);
+        });
+        return erased_;
+    }
+
+    // Nodes of the current version and of the live versions, for the tests and monitoring.
+    size_type nodes () const
+    {
+        m_adopt_orphans_ ();
+        return m_node_pool_.allocated ();
+    }
+};
+
+template <typename Key_, typename Comp_, typename Alloc_>
+template <typename Update_>
+void persistent_order_statistic_set<Key_, Comp_, Alloc_>::m_commit_ (Update_ update_)
+{
+    m_adopt_orphans_ ();
+    auto new_root_ = m_update_ (m_root_, update_);
+
+    /* New nodes hold their children before the old root lets its path go, so the shared
+     * subtrees never drop to zero references. */
+    for ( auto node_ : m_created_ )
+        if ( node_->m_refs_ != s_dropped_ )
+        {
+            s_retain_ (node_->m_left_);
+            s_retain_ (node_->m_right_);
+        }
+    for ( auto node_ : m_dropped_ )
+        m_destroy_ (node_);
+    m_created_.clear ();
+    m_dropped_.clear ();
+
+    if ( new_root_ != m_root_ )
+    {
+        s_retain_ (new_root_);
+        m_release_ (std::exchange (m_root_, new_root_));
+    }
+}
+
+}   // namespace rethinking_stl
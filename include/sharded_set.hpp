@@ -0,0 +1,451 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <alex.rom23@mail.ru> wrote this file.  As long as you retain this notice you
+ * can do whatever you want with this stuff. If we meet some day, and you think
+ * this stuff is worth it, you can buy me a beer in return.   Alex Romanov
+ * ----------------------------------------------------------------------------
+ */
+
+// key range sharded order statistic set implementation header
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "avl_tree.hpp"
+#include "epoch_domain.hpp"
+
+namespace rethinking_stl
+{
+
+//==========================sharded_order_statistic_set===========================
+/*
+ * Order statistic set for concurrent writers. The key space is cut into ranges, every range
+ * is kept by its own avl tree under its own mutex, so updates of different ranges don't wait
+ * for each other. Every shard keeps its size in an atomic beside the tree, select and rank sum
+ * the sizes of the shards before the answer and ask one shard.
+ *
+ * A shard twice as big as the capacity is split in halves, a shard which drops below a quarter
+ * of it is merged with a neighbour if they fit into the capacity together, an empty one is
+ * dropped. Splits and merges relink the trees in O(log n). The bounds and the shards are an
+ * immutable layout behind an atomic pointer, a split or a merge publishes a new one and frees
+ * the old one after a grace period of the epoch domain. They run one at a time with the
+ * changed shards locked, and make the layout version odd for their time. Every other call reads
+ * the version before the layout and checks it again with its shard locked, or after the sizes
+ * are summed, and starts over if it changed. So an update touches only its own shard mutex,
+ * and a global query never sees a shard half split.
+ *
+ * Global queries are exact when no update runs at the same time. Otherwise every shard is seen
+ * at some moment during the call, but not all of them at the same one.
+ */
+template <typename Key_, typename Compare_ = std::less<Key_>,
+          typename Allocator_ = std::allocator<Key_>>
+class sharded_order_statistic_set
+{
+  public:
+    using value_type     = Key_;
+    using size_type      = std::size_t;
+    using key_compare    = Compare_;
+    using allocator_type = Allocator_;
+
+    static constexpr size_type s_default_capacity_ = size_type {1} << 16;
+
+  private:
+    using shard_tree_ = dynamic_order_avl_tree_<Key_, Compare_, Allocator_>;
+
+    /* Sizes of neighbouring shards are updated by different writers, one cache line each. */
+    struct alignas (64) range_shard_
+    {
+        mutable std::mutex m_mutex_;
+        std::atomic<size_type> m_size_ {0};
+        shard_tree_ m_tree_;
+
+        range_shard_ (const Compare_ &comp_, const Allocator_ &alloc_) : m_tree_ (comp_, alloc_) {}
+    };
+
+    struct shard_layout_
+    {
+        std::vector<std::shared_ptr<range_shard_>> m_shards_;
+        std::vector<value_type> m_bounds_; /* m_bounds_[i] is the least key of shard i + 1 */
+        std::uint64_t m_retired_epoch_ = 0;
+    };
+
+    Compare_ m_comp_;
+    Allocator_ m_alloc_;
+    size_type m_capacity_;
+
+    std::atomic<shard_layout_ *> m_layout_;
+    std::atomic<std::uint64_t> m_version_ {0}; /* odd while a split or a merge runs */
+    mutable epoch_domain_ m_epochs_;
+
+    /* Splits and merges, one at a time. */
+    std::mutex m_resize_;
+    std::vector<std::unique_ptr<shard_layout_>> m_retired_;
+
+    // Index of the shard which keeps key_.
+    size_type m_shard_of_ (const shard_layout_ &layout_, const value_type &key_) const
+    {
+        return static_cast<size_type> (std::upper_bound (layout_.m_bounds_.begin (),
+                                                         layout_.m_bounds_.end (), key_, m_comp_) -
+                                       layout_.m_bounds_.begin ());
+    }
+
+    static size_type s_size_of_ (const shard_layout_ &layout_, size_type shard_) noexcept
+    {
+        return layout_.m_shards_[shard_]->m_size_.load (std::memory_order_acquire);
+    }
+
+    static void s_store_size_ (range_shard_ &shard_) noexcept
+    {
+        shard_.m_size_.store (shard_.m_tree_.size (), std::memory_order_release);
+    }
+
+    std::shared_ptr<range_shard_> m_make_shard_ () const
+    {
+        return std::make_shared<range_shard_> (m_comp_, m_alloc_);
+    }
+
+    // Read the version of the layout, wait while it's odd.
+    std::uint64_t m_stable_version_ () const noexcept
+    {
+        auto version_ = m_version_.load (std::memory_order_acquire);
+        while ( version_ & 1 )
+        {
+            std::this_thread::yield ();
+            version_ = m_version_.load (std::memory_order_acquire);
+        }
+        return version_;
+    }
+
+    // Call op_ (layout_, shard_) with the shard of key_ locked, once no split or merge is seen
+    // since the layout was read.
+    template <typename Op_> decltype (auto) m_with_shard_ (const value_type &key_, Op_ op_) const
+    {
+        epoch_guard_ guard_ (m_epochs_);
+        for ( ;; )
+        {
+            auto version_ = m_stable_version_ ();
+            auto &layout_ = *m_layout_.load (std::memory_order_acquire);
+            auto &shard_  = *layout_.m_shards_[m_shard_of_ (layout_, key_)];
+
+            std::lock_guard lock_ (shard_.m_mutex_);
+            if ( m_version_.load (std::memory_order_relaxed) == version_ )
+                return op_ (layout_, shard_);
+        }
+    }
+
+    // Start and finish a split or a merge, called with the resize mutex and the changed shards
+    // locked. Sizes and trees of the shards are changed in between, a reader which sees a new
+    // size sees the odd version then, as the sizes are stored with release.
+    void m_begin_resize_ () noexcept
+    {
+        m_version_.store (m_version_.load (std::memory_order_relaxed) + 1,
+                          std::memory_order_relaxed);
+    }
+
+    void m_end_resize_ (std::unique_ptr<shard_layout_> next_) noexcept
+    {
+        std::unique_ptr<shard_layout_> prev_ (m_layout_.exchange (next_.release ()));
+        m_version_.store (m_version_.load (std::memory_order_relaxed) + 1,
+                          std::memory_order_release);
+
+        /* The vector has room for it, see m_reclaim_. */
+        prev_->m_retired_epoch_ = m_epochs_.m_advance_ ();
+        m_retired_.push_back (std::move (prev_));
+    }
+
+    // Free the layouts no reader can see and make room for the next retired one, before the
+    // layout changes.
+    void m_reclaim_ ()
+    {
+        auto min_active_ = m_epochs_.m_min_active_ ();
+        std::erase_if (m_retired_, [min_active_] (const std::unique_ptr<shard_layout_> &layout_) {
+            return layout_->m_retired_epoch_ < min_active_;
+        });
+        m_retired_.reserve (m_retired_.size () + 1);
+    }
+
+    // Split the shard of key_ in halves if it's bigger then twice the capacity.
+    void m_split_ (const value_type &key_);
+
+    // Merge the shard of key_ with its smaller neighbour if they fit into the capacity, drop
+    // it if it's empty.
+    void m_merge_ (const value_type &key_);
+
+  public:
+    explicit sharded_order_statistic_set (size_type capacity_ = s_default_capacity_,
+                                          const Compare_ &comp_ = Compare_ (),
+                                          const Allocator_ &alloc_ = Allocator_ ())
+        : sharded_order_statistic_set (std::vector<value_type> {}, capacity_, comp_, alloc_)
+    {
+    }
+
+    // Start with a shard per range between the bounds, so the first inserts are spread over
+    // the shards before any of them is split. Erases merge small shards as usual.
+    sharded_order_statistic_set (std::vector<value_type> bounds_,
+                                 size_type capacity_ = s_default_capacity_,
+                                 const Compare_ &comp_ = Compare_ (),
+                                 const Allocator_ &alloc_ = Allocator_ ())
+        : m_comp_ (comp_), m_alloc_ (alloc_), m_capacity_ (std::max (capacity_, size_type {2}))
+    {
+        auto layout_       = std::make_unique<shard_layout_> ();
+        layout_->m_bounds_ = std::move (bounds_);
+
+        auto &keys_ = layout_->m_bounds_;
+        std::sort (keys_.begin (), keys_.end (), m_comp_);
+        keys_.erase (std::unique (keys_.begin (), keys_.end (),
+                                  [this] (const value_type &a_, const value_type &b_) {
+                                      return !m_comp_ (a_, b_) && !m_comp_ (b_, a_);
+                                  }),
+                     keys_.end ());
+
+        for ( size_type i = 0; i <= keys_.size (); i++ )
+            layout_->m_shards_.push_back (m_make_shard_ ());
+        m_layout_.store (layout_.release ());
+    }
+
+    sharded_order_statistic_set (const sharded_order_statistic_set &)            = delete;
+    sharded_order_statistic_set &operator= (const sharded_order_statistic_set &) = delete;
+
+    ~sharded_order_statistic_set () { delete m_layout_.load (); }
+
+    allocator_type get_allocator () const noexcept { return m_alloc_; }
+
+    size_type capacity () const noexcept { return m_capacity_; }
+
+    size_type shards () const
+    {
+        epoch_guard_ guard_ (m_epochs_);
+        return m_layout_.load (std::memory_order_acquire)->m_shards_.size ();
+    }
+
+    size_type size () const
+    {
+        epoch_guard_ guard_ (m_epochs_);
+        for ( ;; )
+        {
+            auto version_ = m_stable_version_ ();
+            auto &layout_ = *m_layout_.load (std::memory_order_acquire);
+            size_type res_ = 0;
+            for ( size_type i = 0; i < layout_.m_shards_.size (); i++ )
+                res_ += s_size_of_ (layout_, i);
+
+            if ( m_version_.load (std::memory_order_relaxed) == version_ )
+                return res_;
+        }
+    }
+
+    bool empty () const { return !size (); }
+
+    // Return false if the key is already inserted.
+    bool insert (const value_type &key_)
+    {
+        bool split_    = false;
+        bool inserted_ = m_with_shard_ (key_, [&] (auto &, range_shard_ &shard_) {
+            bool res_ = shard_.m_tree_.insert (key_).second;
+            if ( res_ )
+                s_store_size_ (shard_);
+            split_ = shard_.m_tree_.size () > 2 * m_capacity_;
+            return res_;
+        });
+
+        if ( split_ )
+            m_split_ (key_);
+        return inserted_;
+    }
+
+    // Return number of erased elements.
+    size_type erase (const value_type &key_)
+    {
+        bool merge_       = false;
+        size_type erased_ = m_with_shard_ (key_, [&] (auto &layout_, range_shard_ &shard_) {
+            auto res_ = shard_.m_tree_.erase (key_);
+            if ( res_ )
+                s_store_size_ (shard_);
+            merge_ = res_ && layout_.m_shards_.size () > 1 &&
+                     shard_.m_tree_.size () < m_capacity_ / 4;
+            return res_;
+        });
+
+        if ( merge_ )
+            m_merge_ (key_);
+        return erased_;
+    }
+
+    bool contains (const value_type &key_) const
+    {
+        return m_with_shard_ (key_, [&key_] (auto &, range_shard_ &shard_) {
+            return shard_.m_tree_.find (key_) != shard_.m_tree_.end ();
+        });
+    }
+
+    // Key of rank i (from 1) by the prefix sums of the shard sizes and one shard query.
+    value_type os_select (size_type i) const;
+
+    size_type get_number_less_then (const value_type &key_) const
+    {
+        epoch_guard_ guard_ (m_epochs_);
+        for ( ;; )
+        {
+            auto version_ = m_stable_version_ ();
+            auto &layout_ = *m_layout_.load (std::memory_order_acquire);
+            auto shard_i_ = m_shard_of_ (layout_, key_);
+
+            size_type res_ = 0;
+            for ( size_type i = 0; i < shard_i_; i++ )
+                res_ += s_size_of_ (layout_, i);
+
+            auto &shard_ = *layout_.m_shards_[shard_i_];
+            std::lock_guard lock_ (shard_.m_mutex_);
+            if ( m_version_.load (std::memory_order_relaxed) == version_ )
+                return res_ + shard_.m_tree_.get_number_less_then (key_);
+        }
+    }
+
+    // Keys of all shards in order. Shards are locked one by one.
+    std::vector<value_type> keys () const
+    {
+        epoch_guard_ guard_ (m_epochs_);
+        for ( ;; )
+        {
+            auto version_ = m_stable_version_ ();
+            auto &layout_ = *m_layout_.load (std::memory_order_acquire);
+            std::vector<value_type> res_;
+            for ( auto &shard_ : layout_.m_shards_ )
+            {
+                std::lock_guard lock_ (shard_->m_mutex_);
+                res_.insert (res_.end (), shard_->m_tree_.begin (), shard_->m_tree_.end ());
+            }
+
+            if ( m_version_.load (std::memory_order_acquire) == version_ )
+                return res_;
+        }
+    }
+};
+
+template <typename Key_, typename Comp_, typename Alloc_>
+Key_ sharded_order_statistic_set<Key_, Comp_, Alloc_>::os_select (size_type i) const
+{
+    epoch_guard_ guard_ (m_epochs_);
+    for ( ;; )
+    {
+        auto version_ = m_stable_version_ ();
+        auto &layout_ = *m_layout_.load (std::memory_order_acquire);
+
+        /* Rank i falls into the first shard where the prefix sum reaches it. */
+        size_type shard_i_ = 0, before_ = 0;
+        for ( ; shard_i_ < layout_.m_shards_.size (); shard_i_++ )
+        {
+            auto size_ = s_size_of_ (layout_, shard_i_);
+            if ( before_ + size_ >= i )
+                break;
+            before_ += size_;
+        }
+
+        if ( m_version_.load (std::memory_order_relaxed) != version_ )
+            continue;
+        if ( shard_i_ == layout_.m_shards_.size () || !i )
+            throw std::out_of_range ("i is greater then the size of the tree or zero.");
+
+        /* The shard could shrink since its size was read, then the sums are taken again. */
+        auto &shard_ = *layout_.m_shards_[shard_i_];
+        std::lock_guard lock_ (shard_.m_mutex_);
+        if ( m_version_.load (std::memory_order_relaxed) == version_ &&
+             i - before_ <= shard_.m_tree_.size () )
+            return shard_.m_tree_.os_select (i - before_);
+    }
+}
+
+template <typename Key_, typename Comp_, typename Alloc_>
+void sharded_order_statistic_set<Key_, Comp_, Alloc_>::m_split_ (const value_type &key_)
+{
+    std::lock_guard resize_ (m_resize_);
+    m_reclaim_ ();
+    auto &layout_ = *m_layout_.load (std::memory_order_relaxed);
+    auto i        = m_shard_of_ (layout_, key_);
+    auto &shard_  = *layout_.m_shards_[i];
+
+    /* Another writer could split the shard first. */
+    std::lock_guard lock_ (shard_.m_mutex_);
+    auto &full_ = shard_.m_tree_;
+    if ( full_.size () <= 2 * m_capacity_ )
+        return;
+
+    /* Everything is allocated before the shard is cut, a throw leaves the layout as it was. */
+    auto half_  = full_.size () / 2;
+    auto right_ = m_make_shard_ ();
+    auto next_  = std::make_unique<shard_layout_> (layout_);
+    next_->m_bounds_.insert (next_->m_bounds_.begin () + static_cast<std::ptrdiff_t> (i),
+                             full_.os_select (half_ + 1));
+    next_->m_shards_.insert (next_->m_shards_.begin () + static_cast<std::ptrdiff_t> (i) + 1,
+                             right_);
+
+    /* The upper half is cut off in O(log n), both shards keep the slabs of the nodes. */
+    m_begin_resize_ ();
+    right_->m_tree_ = full_.split_at_rank (half_);
+    s_store_size_ (shard_);
+    s_store_size_ (*right_);
+    m_end_resize_ (std::move (next_));
+}
+
+template <typename Key_, typename Comp_, typename Alloc_>
+void sharded_order_statistic_set<Key_, Comp_, Alloc_>::m_merge_ (const value_type &key_)
+{
+    std::lock_guard resize_ (m_resize_);
+    m_reclaim_ ();
+    auto &layout_ = *m_layout_.load (std::memory_order_relaxed);
+    auto &shards_ = layout_.m_shards_;
+    if ( shards_.size () < 2 )
+        return;
+
+    auto i = m_shard_of_ (layout_, key_);
+    std::unique_lock lock_ (shards_[i]->m_mutex_);
+    if ( shards_[i]->m_tree_.size () >= m_capacity_ / 4 )
+        return;
+
+    /* An empty shard goes away even if the neighbours are full, one of them takes its range. */
+    auto next_ = std::make_unique<shard_layout_> (layout_);
+    if ( shards_[i]->m_tree_.empty () )
+    {
+        next_->m_bounds_.erase (next_->m_bounds_.begin () +
+                                static_cast<std::ptrdiff_t> (i ? i - 1 : 0));
+        next_->m_shards_.erase (next_->m_shards_.begin () + static_cast<std::ptrdiff_t> (i));
+        m_begin_resize_ ();
+        m_end_resize_ (std::move (next_));
+        return;
+    }
+    lock_.unlock ();
+
+    /* Merge into the left one of the pair: the right shard and its bound go away. */
+    auto left_i_ = i;
+    if ( i + 1 == shards_.size () ||
+         (i && s_size_of_ (layout_, i - 1) < s_size_of_ (layout_, i + 1)) )
+        left_i_ = i - 1;
+
+    /* Sizes could change since they were read, they are checked again with the pair locked. */
+    auto &left_  = *shards_[left_i_];
+    auto &right_ = *shards_[left_i_ + 1];
+    std::scoped_lock pair_ (left_.m_mutex_, right_.m_mutex_);
+    if ( left_.m_tree_.size () + right_.m_tree_.size () > m_capacity_ )
+        return;
+
+    next_->m_bounds_.erase (next_->m_bounds_.begin () + static_cast<std::ptrdiff_t> (left_i_));
+    next_->m_shards_.erase (next_->m_shards_.begin () + static_cast<std::ptrdiff_t> (left_i_) + 1);
+
+    /* Keys of the right shard are all greater, the join appends them in O(log n). */
+    m_begin_resize_ ();
+    left_.m_tree_.join (right_.m_tree_);
+    s_store_size_ (left_);
+    s_store_size_ (right_);
+    m_end_resize_ (std::move (next_));
+}
+
+}   // namespace rethinking_stl
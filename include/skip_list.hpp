@@ -0,0 +1,741 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <alex.rom23@mail.ru> wrote this file.  As long as you retain this notice you
+ * can do whatever you want with this stuff. If we meet some day, and you think
+ * this stuff is worth it, you can buy me a beer in return.   Alex Romanov
+ * ----------------------------------------------------------------------------
+ */
+
+// lock-free indexable skip list implementation header
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <vector>
+
+#include "epoch_domain.hpp"
+
+namespace rethinking_stl
+{
+
+//==============================indexable_skip_list===============================
+/*
+ * Lock-free skip list with span widths. Keys are linked and unlinked with CAS on marked
+ * pointers (Herlihy and Shavit): an erase marks the links of the node from the top level
+ * down, the thread which marks level 0 erases the key, and every search unlinks the marked
+ * nodes on its way.
+ *
+ * The width of the link from a node at level l is the node itself plus the number of nodes
+ * below level l up to the next node at level l. Instead of a number on the link every lower
+ * node keeps a pointer to the node at level l which counts it (its owner at that level), and
+ * a node counts the nodes it owns. Moving a node between owners is one CAS of the pointer,
+ * after which the counts are adjusted and the owner is checked against the list. A new node
+ * takes over the nodes behind it at its levels, an erased one hands its nodes to the one
+ * before it, and every node which finds its owner out of date looks for the right one.
+ *
+ * Runs of nodes move only while a tower at their level is linked or unlinked. A new tower
+ * takes over its nodes, up to the next settled tower which is not erased, before it's marked
+ * settled at the level, and an erased one is unlinked only after its nodes are handed back,
+ * which every search unlinking it helps with. A rank search crosses a link only to a settled
+ * tower, and only if the link is the same and the tower is not erased after the count of the
+ * tower it leaves is read, otherwise it goes down a level.
+ * So no run is counted twice or missed, and ranks are off only by the nodes which settle
+ * at their own upper levels meanwhile, a few per running update. When the updates are over
+ * all widths are exact again, and select and rank answer like the tree.
+ *
+ * Every owner slot holds a reference to its tower, which is taken only while the tower is not
+ * retired, so a tower is retired only once no node points at it. A pointer read from an owner
+ * slot stays valid for the rest of the operation then, and erased nodes are freed after one
+ * grace period of the epoch domain.
+ */
+template <typename Key_, typename Compare_ = std::less<Key_>,
+          typename Allocator_ = std::allocator<Key_>>
+class indexable_skip_list
+{
+  public:
+    using value_type     = Key_;
+    using size_type      = std::size_t;
+    using key_compare    = Compare_;
+    using allocator_type = Allocator_;
+
+    /* Every next level keeps a quarter of the nodes of the one below. */
+    static constexpr int s_max_height_ = 12;
+
+  private:
+    /*
+     * The node is followed by its links of levels [0, height), the counts of the nodes it owns
+     * at the same levels and its owners at levels [height, s_max_height_).
+     */
+    struct skip_node_
+    {
+        int m_height_;
+        std::atomic<int> m_linked_ {0};  /* levels linked by the insert so far */
+        std::atomic<int> m_settled_ {0}; /* levels where it took over the nodes behind it */
+        std::atomic<int> m_refs_ {2};   /* insert, erase and owner slots, the last retires it */
+        skip_node_ *m_retired_next_ = nullptr;
+        std::uint64_t m_retired_epoch_ = 0;
+        alignas (value_type) unsigned char m_key_[sizeof (value_type)];
+    };
+
+    using node_ptr_     = skip_node_ *;
+    using link_         = std::atomic<std::uintptr_t>; /* pointer, the low bit marks erased nodes */
+    using count_        = std::atomic<std::int64_t>;
+    using owner_        = std::atomic<node_ptr_>;
+    using alloc_traits_ = std::allocator_traits<Allocator_>;
+    using node_alloc_   = typename alloc_traits_::template rebind_alloc<skip_node_>;
+    using node_traits_  = std::allocator_traits<node_alloc_>;
+
+    /* Retired nodes are checked against the readers once there are at least this many. */
+    static constexpr size_type s_reclaim_batch_ = 256;
+
+    Compare_ m_comp_;
+    node_alloc_ m_alloc_;
+    node_ptr_ m_head_;
+    std::atomic<size_type> m_size_ {0};
+    mutable epoch_domain_ m_epochs_;
+    std::atomic<node_ptr_> m_retired_ {nullptr};
+    std::atomic<size_type> m_retired_count_ {0};
+
+    static link_ *s_next_ (node_ptr_ node_) noexcept
+    {
+        return reinterpret_cast<link_ *> (node_ + 1);
+    }
+
+    static count_ *s_count_ (node_ptr_ node_) noexcept
+    {
+        return reinterpret_cast<count_ *> (s_next_ (node_) + node_->m_height_);
+    }
+
+    static owner_ &s_owner_ (node_ptr_ node_, int level_) noexcept
+    {
+        auto owners_ = reinterpret_cast<owner_ *> (s_count_ (node_) + node_->m_height_);
+        return owners_[level_ - node_->m_height_];
+    }
+
+    static const value_type &s_key_ (node_ptr_ node_) noexcept
+    {
+        return *std::launder (reinterpret_cast<const value_type *> (node_->m_key_));
+    }
+
+    static node_ptr_ s_ptr_ (std::uintptr_t word_) noexcept
+    {
+        return reinterpret_cast<node_ptr_> (word_ & ~std::uintptr_t {1});
+    }
+
+    static std::uintptr_t s_word_ (node_ptr_ node_) noexcept
+    {
+        return reinterpret_cast<std::uintptr_t> (node_);
+    }
+
+    static bool s_marked_ (std::uintptr_t word_) noexcept { return word_ & 1; }
+
+    // Owner of the erased nodes, they are not counted anywhere.
+    static node_ptr_ s_erased_ () noexcept
+    {
+        return reinterpret_cast<node_ptr_> (std::uintptr_t {1});
+    }
+
+    static size_type s_units_ (int height_) noexcept
+    {
+        auto bytes_ = static_cast<size_type> (height_ + s_max_height_) * sizeof (std::uint64_t);
+        return 1 + (bytes_ + sizeof (skip_node_) - 1) / sizeof (skip_node_);
+    }
+
+    static int s_random_height_ () noexcept
+    {
+        thread_local std::uint64_t state_ =
+            0x9e3779b97f4a7c15 ^ reinterpret_cast<std::uintptr_t> (&state_);
+        state_ ^= state_ << 13;
+        state_ ^= state_ >> 7;
+        state_ ^= state_ << 17;
+        /* Two zero bits per level, the guard bit caps the height. */
+        auto bits_ = state_ | (std::uint64_t {1} << (2 * (s_max_height_ - 1)));
+        return 1 + std::countr_zero (bits_) / 2;
+    }
+
+    // Node without a key, which is what the head is.
+    node_ptr_ m_allocate_ (int height_);
+    node_ptr_ m_create_ (const value_type &key_, int height_);
+    void m_destroy_ (node_ptr_ node_) noexcept;
+
+    // Node counts itself in the ranks unless it's the head or erased.
+    std::int64_t m_self_ (node_ptr_ node_) const noexcept
+    {
+        return node_ != m_head_ && !s_marked_ (s_next_ (node_)[0].load ());
+    }
+
+    // Nodes of level 0 from node_ up to the node of the link word_ read from node_ at level_,
+    // which a search crossing the link adds to the rank. Return -1 if the link can't be
+    // crossed now and the search has to go down.
+    std::int64_t m_width_ (node_ptr_ node_, std::uintptr_t word_, int level_) const noexcept;
+
+    // Fill the nodes before and after key_ at every level, unlinking the marked ones on the
+    // way. Return true if key_ is found at level 0.
+    bool m_find_ (const value_type &key_, node_ptr_ *preds_, node_ptr_ *succs_);
+
+    // Last node before key_ at level_, marked nodes are skipped but not unlinked.
+    node_ptr_ m_tower_before_ (const value_type &key_, int level_) const;
+
+    // First not erased node after node_ at level_.
+    static node_ptr_ s_live_next_ (node_ptr_ node_, int level_) noexcept;
+
+    // tower_ is the node at level_ which has to count node_.
+    bool m_owns_ (node_ptr_ tower_, node_ptr_ node_, int level_) const noexcept;
+
+    // Reference of an owner slot to tower_. Return false if the tower is retired already. The
+    // head is never retired and its references are not counted.
+    bool m_hold_ (node_ptr_ tower_) const noexcept;
+    void m_drop_ (node_ptr_ tower_);
+
+    // Move node_ to its owner at level_, starting with the guess tower_.
+    void m_settle_ (node_ptr_ node_, int level_, node_ptr_ tower_);
+
+    // Settle the nodes of level 0 after from_ up to the next node linked at level_.
+    void m_settle_after_ (node_ptr_ from_, int level_, node_ptr_ tower_);
+
+    // Link the upper levels of the inserted node and take over the nodes behind it.
+    void m_link_tower_ (node_ptr_ node_, node_ptr_ *preds_, node_ptr_ *succs_);
+
+    void m_release_ (node_ptr_ node_);
+    void m_reclaim_ ();
+
+  public:
+    indexable_skip_list () : indexable_skip_list (Compare_ ()) {}
+
+    explicit indexable_skip_list (const Compare_ &comp_, const Allocator_ &alloc_ = Allocator_ ())
+        : m_comp_ (comp_), m_alloc_ (alloc_), m_head_ (m_allocate_ (s_max_height_))
+    {
+        m_head_->m_linked_.store (s_max_height_);
+        m_head_->m_settled_.store (s_max_height_);
+    }
+
+    indexable_skip_list (std::initializer_list<value_type> keys_,
+                         const Compare_ &comp_ = Compare_ (),
+                         const Allocator_ &alloc_ = Allocator_ ())
+        : indexable_skip_list (comp_, alloc_)
+    {
+        for ( auto &key_ : keys_ )
+            insert (key_);
+    }
+
+    indexable_skip_list (const indexable_skip_list &)            = delete;
+    indexable_skip_list &operator= (const indexable_skip_list &) = delete;
+
+    // No operations may run during the destruction.
+    ~indexable_skip_list ();
+
+    allocator_type get_allocator () const noexcept { return allocator_type (m_alloc_); }
+
+    size_type size () const noexcept { return m_size_.load (std::memory_order_acquire); }
+
+    bool empty () const noexcept { return !size (); }
+
+    // Return false if the key is already inserted.
+    bool insert (const value_type &key_);
+
+    // Return number of erased elements.
+    size_type erase (const value_type &key_);
+
+    bool contains (const value_type &key_) const;
+
+    // Key of rank i (from 1) by the widths of the links.
+    value_type os_select (size_type i) const;
+
+    size_type get_number_less_then (const value_type &key_) const;
+
+    // Keys in order, erased ones are skipped.
+    std::vector<value_type> keys () const;
+
+    // Check the erased nodes against the running operations now instead of after the next
+    // batch of erases.
+    void reclaim () { m_reclaim_ (); }
+};
+
+template <typename Key_, typename Comp_, typename Alloc_>
+typename indexable_skip_list<Key_, Comp_, Alloc_>::node_ptr_
+indexable_skip_list<Key_, Comp_, Alloc_>::m_allocate_ (int height_)
+{
+    auto node_       = node_traits_::allocate (m_alloc_, s_units_ (height_));
+    node_            = ::new (static_cast<void *> (node_)) skip_node_;
+    node_->m_height_ = height_;
+    for ( int i = 0; i < height_; i++ )
+    {
+        ::new (static_cast<void *> (s_next_ (node_) + i)) link_ (0);
+        ::new (static_cast<void *> (s_count_ (node_) + i)) count_ (0);
+    }
+    for ( int i = height_; i < s_max_height_; i++ )
+        ::new (static_cast<void *> (&s_owner_ (node_, i))) owner_ (nullptr);
+    return node_;
+}
+
+template <typename Key_, typename Comp_, typename Alloc_>
+typename indexable_skip_list<Key_, Comp_, Alloc_>::node_ptr_
+indexable_skip_list<Key_, Comp_, Alloc_>::m_create_ (const value_type &key_, int height_)
+{
+    auto node_ = m_allocate_ (height_);
+    try
+    {
+        ::new (static_cast<void *> (node_->m_key_)) value_type (key_);
+    }
+    catch ( ... )
+    {
+        node_traits_::deallocate (m_alloc_, node_, s_units_ (height_));
+        throw;
+    }
+    return node_;
+}
+
+template <typename Key_, typename Comp_, typename Alloc_>
+void indexable_skip_list<Key_, Comp_, Alloc_>::m_destroy_ (node_ptr_ node_) noexcept
+{
+    /* Atomics and the header are trivially destructible. */
+    if ( node_ != m_head_ )
+        std::destroy_at (std::launder (reinterpret_cast<value_type *> (node_->m_key_)));
+    node_traits_::deallocate (m_alloc_, node_, s_units_ (node_->m_height_));
+}
+
+template <typename Key_, typename Comp_, typename Alloc_>
+indexable_skip_list<Key_, Comp_, Alloc_>::~indexable_skip_list ()
+{
+    for ( auto node_ = s_ptr_ (s_next_ (m_head_)[0].load ()); node_; )
+    {
+        auto next_ = s_ptr_ (s_next_ (node_)[0].load ());
+        m_destroy_ (node_);
+        node_ = next_;
+    }
+
+    for ( auto node_ = m_retired_.load (); node_; )
+    {
+        auto next_ = node_->m_retired_next_;
+        m_destroy_ (node_);
+        node_ = next_;
+    }
+    m_destroy_ (m_head_);
+}
+
+template <typename Key_, typename Comp_, typename Alloc_>
+bool indexable_skip_list<Key_, Comp_, Alloc_>::m_find_ (const value_type &key_, node_ptr_ *preds_,
+                                                         node_ptr_ *succs_)
+{
+    for ( bool restart_ = true; restart_; )
+    {
+        restart_   = false;
+        auto pred_ = m_head_;
+        for ( int level_ = s_max_height_ - 1; level_ >= 0 && !restart_; level_-- )
+        {
+            auto curr_ = s_ptr_ (s_next_ (pred_)[level_].load ());
+            while ( curr_ )
+            {
+                auto succ_ = s_next_ (curr_)[level_].load ();
+                if ( s_marked_ (succ_) )
+                {
+                    /* Nodes counted by the erased one go to the node before it first. */
+                    if ( level_ )
+                        m_settle_after_ (curr_, level_, pred_);
+
+                    /* The predecessor could be erased too, then the search starts over. */
+                    auto expected_ = s_word_ (curr_);
+                    auto unlinked_ = s_word_ (s_ptr_ (succ_));
+                    if ( !s_next_ (pred_)[level_].compare_exchange_strong (expected_, unlinked_) )
+                    {
+                        restart_ = true;
+                        break;
+                    }
+                    curr_ = s_ptr_ (succ_);
+                    continue;
+                }
+
+                if ( !m_comp_ (s_key_ (curr_), key_) )
+                    break;
+                pred_ = curr_;
+                curr_ = s_ptr_ (succ_);
+            }
+            preds_[level_] = pred_;
+            succs_[level_] = curr_;
+        }
+    }
+    return succs_[0] && !m_comp_ (key_, s_key_ (succs_[0]));
+}
+
+template <typename Key_, typename Comp_, typename Alloc_>
+typename indexable_skip_list<Key_, Comp_, Alloc_>::node_ptr_
+indexable_skip_list<Key_, Comp_, Alloc_>::s_live_next_ (node_ptr_ node_, int level_) noexcept
+{
+    auto next_ = s_ptr_ (s_next_ (node_)[level_].load ());
+    while ( next_ && s_marked_ (s_next_ (next_)[level_].load ()) )
+        next_ = s_ptr_ (s_next_ (next_)[level_].load ());
+    return next_;
+}
+
+template <typename Key_, typename Comp_, typename Alloc_>
+typename indexable_skip_list<Key_, Comp_, Alloc_>::node_ptr_
+indexable_skip_list<Key_, Comp_, Alloc_>::m_tower_before_ (const value_type &key_,
+                                                            int level_) const
+{
+    auto pred_ = m_head_;
+    for ( int i = s_max_height_ - 1; i >= level_; i-- )
+        for ( auto next_ = s_live_next_ (pred_, i); next_ && m_comp_ (s_key_ (next_), key_);
+              next_      = s_live_next_ (pred_, i) )
+            pred_ = next_;
+    return pred_;
+}
+
+template <typename Key_, typename Comp_, typename Alloc_>
+bool indexable_skip_list<Key_, Comp_, Alloc_>::m_owns_ (node_ptr_ tower_, node_ptr_ node_,
+                                                         int level_) const noexcept
+{
+    if ( tower_ != m_head_ )
+    {
+        /* The tower has to be linked at the level, not erased and in front of the node. */
+        if ( tower_->m_linked_.load () <= level_ || s_marked_ (s_next_ (tower_)[level_].load ()) ||
+             !m_comp_ (s_key_ (tower_), s_key_ (node_)) )
+            return false;
+    }
+
+    auto next_ = s_live_next_ (tower_, level_);
+    return !next_ || m_comp_ (s_key_ (node_), s_key_ (next_));
+}
+
+template <typename Key_, typename Comp_, typename Alloc_>
+bool indexable_skip_list<Key_, Comp_, Alloc_>::m_hold_ (node_ptr_ tower_) const noexcept
+{
+    if ( tower_ == m_head_ )
+        return true;
+
+    auto refs_ = tower_->m_refs_.load ();
+    while ( refs_ && !tower_->m_refs_.compare_exchange_weak (refs_, refs_ + 1) )
+        ;
+    return refs_;
+}
+
+template <typename Key_, typename Comp_, typename Alloc_>
+void indexable_skip_list<Key_, Comp_, Alloc_>::m_drop_ (node_ptr_ tower_)
+{
+    if ( tower_ != m_head_ )
+        m_release_ (tower_);
+}
+
+template <typename Key_, typename Comp_, typename Alloc_>
+void indexable_skip_list<Key_, Comp_, Alloc_>::m_settle_ (node_ptr_ node_, int level_,
+                                                           node_ptr_ tower_)
+{
+    auto &owner_ = s_owner_ (node_, level_);
+    for ( ;; tower_ = m_tower_before_ (s_key_ (node_), level_) )
+    {
+        auto curr_ = owner_.load ();
+        if ( curr_ == s_erased_ () )
+            return;
+
+        if ( curr_ != tower_ )
+        {
+            /* A retired tower is erased, the lookup below finds another one. */
+            if ( !m_hold_ (tower_) )
+                continue;
+            while ( curr_ != tower_ && curr_ != s_erased_ () &&
+                    !owner_.compare_exchange_weak (curr_, tower_) )
+                ;
+
+            /* The reference of the slot moves with the node, or isn't needed. */
+            if ( curr_ == tower_ || curr_ == s_erased_ () )
+                m_drop_ (tower_);
+            else
+            {
+                if ( curr_ )
+                {
+                    s_count_ (curr_)[level_].fetch_sub (1);
+                    m_drop_ (curr_);
+                }
+                s_count_ (tower_)[level_].fetch_add (1);
+            }
+            if ( curr_ == s_erased_ () )
+                return;
+        }
+
+        /* Otherwise the layout changed since the guess, the owner is looked up again. */
+        if ( m_owns_ (tower_, node_, level_) )
+            return;
+    }
+}
+
+template <typename Key_, typename Comp_, typename Alloc_>
+void indexable_skip_list<Key_, Comp_, Alloc_>::m_settle_after_ (node_ptr_ from_, int level_,
+                                                                 node_ptr_ tower_)
+{
+    for ( auto node_ = s_ptr_ (s_next_ (from_)[0].load ()); node_;
+          node_      = s_ptr_ (s_next_ (node_)[0].load ()) )
+    {
+        if ( node_->m_height_ <= level_ )
+            m_settle_ (node_, level_, tower_);
+        else if ( node_->m_settled_.load () > level_ &&
+                  !s_marked_ (s_next_ (node_)[level_].load ()) )
+            break;
+        /* Until a higher node takes over the nodes behind it, and after it's erased, they can
+         * still be counted by a tower before this one. */
+    }
+}
+
+template <typename Key_, typename Comp_, typename Alloc_>
+void indexable_skip_list<Key_, Comp_, Alloc_>::m_link_tower_ (node_ptr_ node_, node_ptr_ *preds_,
+                                                               node_ptr_ *succs_)
+{
+    for ( int level_ = 1; level_ < node_->m_height_; level_++ )
+    {
+        for ( ;; )
+        {
+            /* An erase marks the links, the node is not linked any higher then. */
+            auto word_ = s_next_ (node_)[level_].load ();
+            if ( s_marked_ (word_) )
+                return;
+            auto succ_ = s_word_ (succs_[level_]);
+            if ( s_ptr_ (word_) != succs_[level_] &&
+                 !s_next_ (node_)[level_].compare_exchange_strong (word_, succ_) )
+                return;
+
+            if ( s_next_ (preds_[level_])[level_].compare_exchange_strong (succ_, s_word_ (node_)) )
+                break;
+            m_find_ (s_key_ (node_), preds_, succs_);
+        }
+
+        node_->m_linked_.store (level_ + 1);
+        m_settle_after_ (node_, level_, node_);
+        node_->m_settled_.store (level_ + 1);
+    }
+}
+
+template <typename Key_, typename Comp_, typename Alloc_>
+bool indexable_skip_list<Key_, Comp_, Alloc_>::insert (const value_type &key_)
+{
+    epoch_guard_ guard_ (m_epochs_);
+    node_ptr_ preds_[s_max_height_], succs_[s_max_height_];
+    node_ptr_ node_ = nullptr;
+
+    for ( ;; )
+    {
+        if ( m_find_ (key_, preds_, succs_) )
+        {
+            if ( node_ )
+                m_destroy_ (node_);
+            return false;
+        }
+
+        if ( !node_ )
+            node_ = m_create_ (key_, s_random_height_ ());
+        for ( int i = 0; i < node_->m_height_; i++ )
+            s_next_ (node_)[i].store (s_word_ (succs_[i]), std::memory_order_relaxed);
+
+        /* The key is in the set once it's linked at level 0. */
+        auto expected_ = s_word_ (succs_[0]);
+        if ( s_next_ (preds_[0])[0].compare_exchange_strong (expected_, s_word_ (node_)) )
+            break;
+    }
+
+    m_size_.fetch_add (1, std::memory_order_release);
+    node_->m_linked_.store (1);
+    node_->m_settled_.store (1);
+    m_link_tower_ (node_, preds_, succs_);
+
+    /* The search of the last linked level found the owners above the node. */
+    for ( int level_ = node_->m_height_; level_ < s_max_height_; level_++ )
+        m_settle_ (node_, level_, preds_[level_]);
+
+    /* An erase could mark the node before the last link, which the erase didn't unlink. */
+    if ( s_marked_ (s_next_ (node_)[0].load ()) )
+        m_find_ (key_, preds_, succs_);
+    m_release_ (node_);
+    return true;
+}
+
+template <typename Key_, typename Comp_, typename Alloc_>
+typename indexable_skip_list<Key_, Comp_, Alloc_>::size_type
+indexable_skip_list<Key_, Comp_, Alloc_>::erase (const value_type &key_)
+{
+    epoch_guard_ guard_ (m_epochs_);
+    node_ptr_ preds_[s_max_height_], succs_[s_max_height_];
+    if ( !m_find_ (key_, preds_, succs_) )
+        return 0;
+
+    auto node_ = succs_[0];
+    for ( int level_ = node_->m_height_ - 1; level_ > 0; level_-- )
+    {
+        auto word_ = s_next_ (node_)[level_].load ();
+        while ( !s_marked_ (word_) &&
+                !s_next_ (node_)[level_].compare_exchange_weak (word_, word_ | 1) )
+            ;
+    }
+
+    /* The one who marks level 0 erases the key. */
+    auto word_ = s_next_ (node_)[0].load ();
+    do
+    {
+        if ( s_marked_ (word_) )
+            return 0;
+    } while ( !s_next_ (node_)[0].compare_exchange_weak (word_, word_ | 1) );
+    m_size_.fetch_sub (1, std::memory_order_release);
+
+    /* The search hands the nodes counted by this one back and unlinks it at every level. */
+    m_find_ (key_, preds_, succs_);
+
+    for ( int level_ = node_->m_height_; level_ < s_max_height_; level_++ )
+        if ( auto owner_ = s_owner_ (node_, level_).exchange (s_erased_ ()); owner_ )
+        {
+            s_count_ (owner_)[level_].fetch_sub (1);
+            m_drop_ (owner_);
+        }
+
+    m_release_ (node_);
+    return 1;
+}
+
+template <typename Key_, typename Comp_, typename Alloc_>
+void indexable_skip_list<Key_, Comp_, Alloc_>::m_release_ (node_ptr_ node_)
+{
+    if ( node_->m_refs_.fetch_sub (1) != 1 )
+        return;
+
+    node_->m_retired_epoch_ = m_epochs_.m_advance_ ();
+    node_->m_retired_next_  = m_retired_.load ();
+    while ( !m_retired_.compare_exchange_weak (node_->m_retired_next_, node_) )
+        ;
+
+    if ( m_retired_count_.fetch_add (1) + 1 >= s_reclaim_batch_ )
+        m_reclaim_ ();
+}
+
+template <typename Key_, typename Comp_, typename Alloc_>
+void indexable_skip_list<Key_, Comp_, Alloc_>::m_reclaim_ ()
+{
+    /* The list is taken whole, concurrent reclaims get the nodes retired after. */
+    m_retired_count_.store (0);
+    auto node_       = m_retired_.exchange (nullptr);
+    auto min_active_ = m_epochs_.m_min_active_ ();
+
+    node_ptr_ kept_ = nullptr, kept_last_ = nullptr;
+    size_type kept_count_ = 0;
+    while ( node_ )
+    {
+        auto next_ = node_->m_retired_next_;
+        if ( node_->m_retired_epoch_ < min_active_ )
+            m_destroy_ (node_);
+        else
+        {
+            node_->m_retired_next_ = kept_;
+            kept_                  = node_;
+            kept_last_             = (kept_last_ ? kept_last_ : node_);
+            kept_count_++;
+        }
+        node_ = next_;
+    }
+
+    if ( !kept_ )
+        return;
+
+    kept_last_->m_retired_next_ = m_retired_.load ();
+    while ( !m_retired_.compare_exchange_weak (kept_last_->m_retired_next_, kept_) )
+        ;
+    m_retired_count_.fetch_add (kept_count_);
+}
+
+template <typename Key_, typename Comp_, typename Alloc_>
+std::int64_t indexable_skip_list<Key_, Comp_, Alloc_>::m_width_ (node_ptr_ node_,
+                                                                  std::uintptr_t word_,
+                                                                  int level_) const noexcept
+{
+    if ( !level_ )
+        return m_self_ (node_);
+
+    /* Nodes are moving between the two towers, the lower levels count them as they are. */
+    auto next_ = s_ptr_ (word_);
+    if ( s_marked_ (word_) || next_->m_settled_.load () <= level_ )
+        return -1;
+
+    /* A tower linked after the link was read could take over some of the counted nodes, and an
+     * erased next one hands its nodes to this one after it's marked. */
+    auto width_ = m_self_ (node_) + s_count_ (node_)[level_].load ();
+    if ( s_next_ (node_)[level_].load () != word_ || s_marked_ (s_next_ (next_)[level_].load ()) )
+        return -1;
+    return width_;
+}
+
+template <typename Key_, typename Comp_, typename Alloc_>
+bool indexable_skip_list<Key_, Comp_, Alloc_>::contains (const value_type &key_) const
+{
+    epoch_guard_ guard_ (m_epochs_);
+    auto next_ = s_live_next_ (m_tower_before_ (key_, 0), 0);
+    return next_ && !m_comp_ (key_, s_key_ (next_));
+}
+
+template <typename Key_, typename Comp_, typename Alloc_>
+Key_ indexable_skip_list<Key_, Comp_, Alloc_>::os_select (size_type i) const
+{
+    if ( i > size () || !i )
+        throw std::out_of_range ("i is greater then the size of the tree or zero.");
+
+    epoch_guard_ guard_ (m_epochs_);
+    auto rank_           = static_cast<std::int64_t> (i);
+    std::int64_t before_ = 0; /* nodes in front of node_ */
+    auto node_           = m_head_;
+
+    for ( int level_ = s_max_height_ - 1; level_ >= 0; level_-- )
+        for ( auto word_ = s_next_ (node_)[level_].load (); s_ptr_ (word_);
+              word_      = s_next_ (node_)[level_].load () )
+        {
+            /* The rank of the next node is one more then the nodes in front of it. */
+            auto width_ = m_width_ (node_, word_, level_);
+            if ( width_ < 0 || before_ + width_ + 1 > rank_ )
+                break;
+            before_ += width_;
+            node_ = s_ptr_ (word_);
+        }
+
+    /* The widths can be behind the updates which run at the same time. */
+    if ( node_ == m_head_ )
+        node_ = s_live_next_ (m_head_, 0);
+    if ( !node_ )
+        throw std::out_of_range ("i is greater then the size of the tree or zero.");
+    return s_key_ (node_);
+}
+
+template <typename Key_, typename Comp_, typename Alloc_>
+typename indexable_skip_list<Key_, Comp_, Alloc_>::size_type
+indexable_skip_list<Key_, Comp_, Alloc_>::get_number_less_then (const value_type &key_) const
+{
+    epoch_guard_ guard_ (m_epochs_);
+    std::int64_t before_ = 0;
+    auto node_           = m_head_;
+
+    for ( int level_ = s_max_height_ - 1; level_ >= 0; level_-- )
+        for ( auto word_ = s_next_ (node_)[level_].load ();
+              s_ptr_ (word_) && m_comp_ (s_key_ (s_ptr_ (word_)), key_);
+              word_ = s_next_ (node_)[level_].load () )
+        {
+            auto width_ = m_width_ (node_, word_, level_);
+            if ( width_ < 0 )
+                break;
+            before_ += width_;
+            node_ = s_ptr_ (word_);
+        }
+
+    /* The last node passed is less then the key too. */
+    before_ += m_self_ (node_);
+    return static_cast<size_type> (std::max<std::int64_t> (before_, 0));
+}
+
+template <typename Key_, typename Comp_, typename Alloc_>
+std::vector<Key_> indexable_skip_list<Key_, Comp_, Alloc_>::keys () const
+{
+    epoch_guard_ guard_ (m_epochs_);
+    std::vector<value_type> res_;
+    for ( auto node_ = s_live_next_ (m_head_, 0); node_; node_ = s_live_next_ (node_, 0) )
+        res_.push_back (s_key_ (node_));
+    return res_;
+}
+
+}   // namespace rethinking_stl
@@ -0,0 +1,185 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <alex.rom23@mail.ru> wrote this file.  As long as you retain this notice you
+ * can do whatever you want with this stuff. If we meet some day, and you think
+ * this stuff is worth it, you can buy me a beer in return.   Alex Romanov
+ * ----------------------------------------------------------------------------
+ */
+
+// Statistics policies of the avl tree
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace rethinking_stl
+{
+
+// Snapshot of the counters returned by stats () of the instrumented tree.
+struct avl_tree_stats
+{
+    std::uint64_t comparisons      = 0;
+    std::uint64_t descents         = 0; /* lookups, inserts, erases, selects and ranks */
+    std::uint64_t nodes_visited    = 0; /* by all descents */
+    std::uint64_t single_rotations = 0;
+    std::uint64_t double_rotations = 0;
+    std::uint64_t backtracks       = 0; /* rebalancing walks after insert and erase */
+    std::uint64_t backtrack_steps  = 0; /* levels climbed by all of them */
+    std::uint64_t max_backtrack    = 0;
+    int height                     = 0;
+    double average_depth           = 0; /* of the nodes, the root is at depth 0 */
+};
+
+// Default policy, every hook is empty and the tree compiles to the uninstrumented code.
+struct no_tree_stats
+{
+    static constexpr bool enabled = false;
+
+    struct descent_counts_
+    {
+        void m_visit_ () noexcept {}
+        void m_compare_ (std::uint64_t = 1) noexcept {}
+    };
+
+    descent_counts_ m_descent_ () noexcept { return {}; }
+    void m_rotation_ (bool) noexcept {}
+    void m_backtrack_ (std::uint64_t) noexcept {}
+    void m_add_sizes_ (std::int64_t) noexcept {}
+    void m_reset_sizes_ () noexcept {}
+    void m_forget_sizes_ () noexcept {}
+};
+
+/*
+ * Counters of the hot paths. Besides the events it keeps the sum of subtree sizes of all
+ * nodes, which is the sum of depths plus the number of nodes, so the average depth is known
+ * without a walk over the tree. A rebuilt tree has its sum counted again by the next snapshot
+ * only. Counters are relaxed atomics, as const queries running in several threads update
+ * them too, and a descent adds to them once.
+ */
+struct tree_stats
+{
+    static constexpr bool enabled = true;
+
+    using counter_ = std::atomic<std::uint64_t>;
+
+    counter_ m_comparisons_ {0};
+    counter_ m_descents_ {0};
+    counter_ m_nodes_visited_ {0};
+    counter_ m_single_rotations_ {0};
+    counter_ m_double_rotations_ {0};
+    counter_ m_backtracks_ {0};
+    counter_ m_backtrack_steps_ {0};
+    counter_ m_max_backtrack_ {0};
+    counter_ m_size_sum_ {0};
+    std::atomic<bool> m_sizes_known_ {true};
+
+    tree_stats () = default;
+    tree_stats (const tree_stats &other_) noexcept { *this = other_; }
+
+    tree_stats &operator= (const tree_stats &other_) noexcept
+    {
+        for ( auto member_ :
+              {&tree_stats::m_comparisons_, &tree_stats::m_descents_, &tree_stats::m_nodes_visited_,
+               &tree_stats::m_single_rotations_, &tree_stats::m_double_rotations_,
+               &tree_stats::m_backtracks_, &tree_stats::m_backtrack_steps_,
+               &tree_stats::m_max_backtrack_, &tree_stats::m_size_sum_} )
+            s_set_ (this->*member_, s_get_ (other_.*member_));
+        m_sizes_known_.store (other_.m_sizes_known_.load (std::memory_order_relaxed),
+                              std::memory_order_relaxed);
+        return *this;
+    }
+
+    static std::uint64_t s_get_ (const counter_ &counter_) noexcept
+    {
+        return counter_.load (std::memory_order_relaxed);
+    }
+
+    static void s_set_ (counter_ &counter_, std::uint64_t value_) noexcept
+    {
+        counter_.store (value_, std::memory_order_relaxed);
+    }
+
+    static void s_add_ (counter_ &counter_, std::uint64_t n_) noexcept
+    {
+        counter_.fetch_add (n_, std::memory_order_relaxed);
+    }
+
+    // Visits and comparisons of one descent, added to the counters at once when it's over.
+    struct descent_counts_
+    {
+        tree_stats &m_stats_;
+        std::uint64_t m_visits_      = 0;
+        std::uint64_t m_comparisons_ = 0;
+
+        void m_visit_ () noexcept { m_visits_++; }
+        void m_compare_ (std::uint64_t n_ = 1) noexcept { m_comparisons_ += n_; }
+
+        ~descent_counts_ ()
+        {
+            s_add_ (m_stats_.m_descents_, 1);
+            s_add_ (m_stats_.m_nodes_visited_, m_visits_);
+            s_add_ (m_stats_.m_comparisons_, m_comparisons_);
+        }
+    };
+
+    descent_counts_ m_descent_ () noexcept { return {*this}; }
+
+    void m_rotation_ (bool double_) noexcept
+    {
+        s_add_ (double_ ? m_double_rotations_ : m_single_rotations_, 1);
+    }
+
+    /* Only updates backtrack, they don't run concurrently with each other. */
+    void m_backtrack_ (std::uint64_t steps_) noexcept
+    {
+        s_add_ (m_backtracks_, 1);
+        s_add_ (m_backtrack_steps_, steps_);
+        s_set_ (m_max_backtrack_, std::max (s_get_ (m_max_backtrack_), steps_));
+    }
+
+    void m_add_sizes_ (std::int64_t delta_) noexcept
+    {
+        s_add_ (m_size_sum_, static_cast<std::uint64_t> (delta_));
+    }
+
+    // The tree is empty.
+    void m_reset_sizes_ () noexcept
+    {
+        s_set_ (m_size_sum_, 0);
+        m_sizes_known_.store (true, std::memory_order_relaxed);
+    }
+
+    // The tree is rebuilt, the sum is counted again by the next snapshot.
+    void m_forget_sizes_ () noexcept { m_sizes_known_.store (false, std::memory_order_relaxed); }
+
+    // recount_ () returns the sum of subtree sizes of the tree, it's called only after a rebuild.
+    template <typename Recount_>
+    avl_tree_stats m_snapshot_ (std::size_t size_, int height_, Recount_ recount_) noexcept
+    {
+        if ( !m_sizes_known_.load (std::memory_order_acquire) )
+        {
+            s_set_ (m_size_sum_, recount_ ());
+            m_sizes_known_.store (true, std::memory_order_release);
+        }
+
+        avl_tree_stats res_;
+        res_.comparisons      = s_get_ (m_comparisons_);
+        res_.descents         = s_get_ (m_descents_);
+        res_.nodes_visited    = s_get_ (m_nodes_visited_);
+        res_.single_rotations = s_get_ (m_single_rotations_);
+        res_.double_rotations = s_get_ (m_double_rotations_);
+        res_.backtracks       = s_get_ (m_backtracks_);
+        res_.backtrack_steps  = s_get_ (m_backtrack_steps_);
+        res_.max_backtrack    = s_get_ (m_max_backtrack_);
+        res_.height           = height_;
+        if ( size_ )
+            res_.average_depth = static_cast<double> (s_get_ (m_size_sum_) - size_) / size_;
+        return res_;
+    }
+};
+
+}   // namespace rethinking_stl
@@ -1,28 +1,39 @@
 #!/bin/bash
 
-base_folder="resources"
+# Time the end2end drivers of the set ($1) and of std::set ($2) on every test and write the
+# times to compared.json in the layout of the benchmark results.
 
-red=`tput setaf 1`
-green=`tput setaf 2`
-reset=`tput sgr0`
+base_folder="resources"
 
 current_folder=${3:-./}
-passed=true
-
-exec 3>${current_folder}/compared.dat
-exec 2>&3
-exec 1>&3
-
-
-for file in ${current_folder}/${base_folder}/test*.dat; do
-    echo -n -e "Testing ${file} ... \n\n"
-    echo "MY:"
-    { time $1 < $file; }
-    echo -e "\nSTD:"
-    { time $2 < $file; }
-    echo "------"
-
-    # Compare inputs
-done
-
-exit 0
\ No newline at end of file
+output=${current_folder}/compared.json
+
+# Wall time of the driver on the test in seconds.
+measure () {
+    local TIMEFORMAT=%R
+    { time $1 < $2 > /dev/null 2>&1; } 2>&1
+}
+
+# One entry of the benchmarks array.
+entry () {
+    echo -n "    {\"name\": \"$1\", \"run_type\": \"iteration\", \"real_time\": $2, \"time_unit\": \"s\"}"
+}
+
+{
+    echo "{"
+    echo "  \"benchmarks\": ["
+    separator=""
+    for file in ${current_folder}/${base_folder}/test*.dat; do
+        name=$(basename ${file} .dat)
+        echo -n -e "${separator}"
+        entry "my/${name}" $(measure $1 ${file})
+        echo -e ","
+        entry "std/${name}" $(measure $2 ${file})
+        separator=",\n"
+    done
+    echo ""
+    echo "  ]"
+    echo "}"
+} > ${output}
+
+exit 0
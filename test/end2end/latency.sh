@@ -0,0 +1,39 @@
+#!/bin/bash
+
+base_folder="resources"
+
+red=`tput setaf 1`
+green=`tput setaf 2`
+reset=`tput sgr0`
+
+current_folder=${3:-./}
+file=${current_folder}/${base_folder}/test0.dat
+trace=${current_folder}/${base_folder}/temp.bin
+passed=true
+
+$2 < ${file} > ${trace}
+
+for engine in avl compact btree skiplist; do
+    echo -n "Latencies of ${green}${engine}${reset} ... "
+
+    # Text and trace replays have to report every operation of the queries
+    text=`$1 --engine ${engine} < ${file}` &&
+    replay=`$1 --engine ${engine} --replay ${trace}`
+
+    if [ $? -eq 0 ] && echo "${text}" | grep -q "^insert" && \
+       [ "`echo "${text}" | awk 'NR > 2 {print $1, $2}'`" == "`echo "${replay}" | awk 'NR > 2 {print $1, $2}'`" ]; then
+        echo "${green}Passed${reset}"
+    else
+        echo "${red}Failed${reset}"
+        passed=false
+    fi
+done
+
+rm -f ${trace}
+
+if ${passed}
+then
+    exit 0
+else
+    exit 666
+fi
@@ -0,0 +1,38 @@
+#!/bin/bash
+
+base_folder="resources"
+
+red=`tput setaf 1`
+green=`tput setaf 2`
+reset=`tput sgr0`
+
+current_folder=${3:-./}
+trace=${current_folder}/${base_folder}/temp.bin
+passed=true
+
+for file in ${current_folder}/${base_folder}/test*.dat; do
+    for encoding in "" "--fixed"; do
+
+        echo -n "Replaying ${green}${file}${reset} ${encoding} ... "
+
+        # Convert the text queries to the binary trace and replay it
+        $2 ${encoding} < $file > ${trace}
+        $1 --replay ${trace} > ${current_folder}/$base_folder/temp.dat
+
+        if diff -Z ${file}.ans ${current_folder}/${base_folder}/temp.dat; then
+            echo "${green}Passed${reset}"
+        else
+            echo "${red}Failed${reset}"
+            passed=false
+        fi
+    done
+done
+
+rm -f ${trace}
+
+if ${passed}
+then
+    exit 0
+else
+    exit 666
+fi
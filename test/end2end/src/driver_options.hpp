@@ -0,0 +1,101 @@
+// Options, engine selection and input of the end2end drivers
+
+#pragma once
+
+#include "myset.hpp"
+#include "query_io.hpp"
+#include "skip_list.hpp"
+#include "trace_format.hpp"
+#include <iostream>
+#include <stdexcept>
+#include <string_view>
+#include <type_traits>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace end2end
+{
+
+template <typename Engine_>
+using engine_set = rethinking_stl::set<int, std::less<int>, std::allocator<int>, Engine_>;
+
+// Call run_ (std::type_identity<Set_> {}, input_, name_) with the set of the engine named
+// engine_. Return false if there is no such engine.
+template <typename Input_, typename Run_>
+bool run_engine (Input_ &input_, std::string_view engine_, Run_ run_)
+{
+    if ( engine_ == "avl" )
+        run_ (std::type_identity<engine_set<rethinking_stl::avl_tree_engine>> {}, input_, "avl");
+    else if ( engine_ == "compact" )
+        run_ (std::type_identity<engine_set<rethinking_stl::compact_avl_tree_engine>> {}, input_,
+              "compact");
+    else if ( engine_ == "btree" )
+        run_ (std::type_identity<engine_set<rethinking_stl::btree_engine>> {}, input_, "btree");
+    else if ( engine_ == "skiplist" )
+        run_ (std::type_identity<rethinking_stl::indexable_skip_list<int>> {}, input_, "skiplist");
+    else
+        return false;
+    return true;
+}
+
+// Main of a driver taking [--engine avl|compact|btree|skiplist] [--replay trace.bin]. Queries
+// are read from the trace or as text from stdin and passed to run_ as by run_engine. Return
+// the exit status.
+template <typename Run_> int driver_main (int argc, char **argv, Run_ run_)
+{
+    std::string_view engine_ = "avl";
+    const char *trace_       = nullptr;
+
+    for ( int i = 1; i < argc; i++ )
+    {
+        if ( std::string_view (argv[i]) == "--engine" && i + 1 < argc )
+            engine_ = argv[++i];
+        else if ( std::string_view (argv[i]) == "--replay" && i + 1 < argc )
+            trace_ = argv[++i];
+        else
+        {
+            std::cerr << "Usage: " << argv[0]
+                      << " [--engine avl|compact|btree|skiplist] [--replay trace.bin]"
+                      << std::endl;
+            return 1;
+        }
+    }
+
+    bool known_engine_ = true;
+    if ( trace_ )
+    {
+        int fd = ::open (trace_, O_RDONLY);
+        if ( fd < 0 )
+        {
+            std::cerr << "Can't open " << trace_ << "." << std::endl;
+            return 1;
+        }
+
+        try
+        {
+            trace_input input_ (fd);
+            ::close (fd);
+            known_engine_ = run_engine (input_, engine_, run_);
+        }
+        catch ( const std::runtime_error &error )
+        {
+            std::cerr << trace_ << ": " << error.what () << std::endl;
+            return 1;
+        }
+    }
+    else
+    {
+        query_input input_;
+        known_engine_ = run_engine (input_, engine_, run_);
+    }
+
+    if ( !known_engine_ )
+    {
+        std::cerr << "Unknown engine " << engine_ << "." << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+}   // namespace end2end
@@ -0,0 +1,249 @@
+// Minimal JSON reader for the configs of the end2end tools
+
+#pragma once
+
+#include <cctype>
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace end2end
+{
+
+//===================================json_value===================================
+class json_value
+{
+  public:
+    enum class kind
+    {
+        null,
+        boolean,
+        number,
+        string,
+        array,
+        object,
+    };
+
+    using array_type  = std::vector<json_value>;
+    using object_type = std::map<std::string, json_value>;
+
+  private:
+    kind m_kind_     = kind::null;
+    bool m_bool_     = false;
+    double m_number_ = 0;
+    std::string m_string_;
+    std::shared_ptr<array_type> m_array_;
+    std::shared_ptr<object_type> m_object_;
+
+    struct parser
+    {
+        const std::string &m_text_;
+        std::size_t m_pos_ = 0;
+
+        [[noreturn]] void m_fail_ (const char *what_) const
+        {
+            throw std::runtime_error (std::string ("JSON: ") + what_ + " at offset " +
+                                      std::to_string (m_pos_) + ".");
+        }
+
+        void m_skip_ ()
+        {
+            while ( m_pos_ < m_text_.size () &&
+                    std::isspace (static_cast<unsigned char> (m_text_[m_pos_])) )
+                m_pos_++;
+        }
+
+        bool m_eat_ (char c_)
+        {
+            m_skip_ ();
+            if ( m_pos_ < m_text_.size () && m_text_[m_pos_] == c_ )
+            {
+                m_pos_++;
+                return true;
+            }
+            return false;
+        }
+
+        void m_expect_ (char c_)
+        {
+            if ( !m_eat_ (c_) )
+                m_fail_ ("unexpected character");
+        }
+
+        bool m_word_ (const char *word_)
+        {
+            auto len_ = std::char_traits<char>::length (word_);
+            if ( m_text_.compare (m_pos_, len_, word_) )
+                return false;
+            m_pos_ += len_;
+            return true;
+        }
+
+        std::string m_string_ ()
+        {
+            m_expect_ ('"');
+            std::string res_;
+            while ( m_pos_ < m_text_.size () && m_text_[m_pos_] != '"' )
+            {
+                char c_ = m_text_[m_pos_++];
+                if ( c_ == '\\' && m_pos_ < m_text_.size () )
+                {
+                    /* Configs need no unicode escapes, only the simple ones are supported. */
+                    switch ( char e_ = m_text_[m_pos_++] )
+                    {
+                    case 'n': c_ = '\n'; break;
+                    case 't': c_ = '\t'; break;
+                    case 'r': c_ = '\r'; break;
+                    case 'b': c_ = '\b'; break;
+                    case 'f': c_ = '\f'; break;
+                    default: c_ = e_;
+                    }
+                }
+                res_ += c_;
+            }
+            m_expect_ ('"');
+            return res_;
+        }
+
+        json_value m_value_ ()
+        {
+            json_value res_;
+            m_skip_ ();
+            if ( m_pos_ == m_text_.size () )
+                m_fail_ ("unexpected end");
+
+            char c_ = m_text_[m_pos_];
+            if ( c_ == '{' )
+            {
+                m_pos_++;
+                res_.m_kind_   = kind::object;
+                res_.m_object_ = std::make_shared<object_type> ();
+                if ( m_eat_ ('}') )
+                    return res_;
+                do
+                {
+                    m_skip_ ();
+                    auto key_ = m_string_ ();
+                    m_expect_ (':');
+                    (*res_.m_object_)[key_] = m_value_ ();
+                } while ( m_eat_ (',') );
+                m_expect_ ('}');
+            }
+            else if ( c_ == '[' )
+            {
+                m_pos_++;
+                res_.m_kind_  = kind::array;
+                res_.m_array_ = std::make_shared<array_type> ();
+                if ( m_eat_ (']') )
+                    return res_;
+                do
+                    res_.m_array_->push_back (m_value_ ());
+                while ( m_eat_ (',') );
+                m_expect_ (']');
+            }
+            else if ( c_ == '"' )
+            {
+                res_.m_kind_   = kind::string;
+                res_.m_string_ = m_string_ ();
+            }
+            else if ( m_word_ ("true") || m_word_ ("false") )
+            {
+                res_.m_kind_ = kind::boolean;
+                res_.m_bool_ = (c_ == 't');
+            }
+            else if ( m_word_ ("null") )
+                res_.m_kind_ = kind::null;
+            else
+            {
+                char *end_;
+                res_.m_kind_   = kind::number;
+                res_.m_number_ = std::strtod (m_text_.c_str () + m_pos_, &end_);
+                if ( end_ == m_text_.c_str () + m_pos_ )
+                    m_fail_ ("bad value");
+                m_pos_ = static_cast<std::size_t> (end_ - m_text_.c_str ());
+            }
+            return res_;
+        }
+    };
+
+  public:
+    // Throws std::runtime_error on malformed input.
+    static json_value parse (const std::string &text_)
+    {
+        parser parser_ {text_};
+        auto res_ = parser_.m_value_ ();
+        parser_.m_skip_ ();
+        if ( parser_.m_pos_ != text_.size () )
+            parser_.m_fail_ ("trailing characters");
+        return res_;
+    }
+
+    kind type () const noexcept { return m_kind_; }
+
+    bool is_null () const noexcept { return m_kind_ == kind::null; }
+
+    bool contains (const std::string &key_) const
+    {
+        return m_kind_ == kind::object && m_object_->count (key_);
+    }
+
+    // Member of the object, null if there is no such member.
+    const json_value &operator[] (const std::string &key_) const
+    {
+        static const json_value null_;
+        if ( !contains (key_) )
+            return null_;
+        return m_object_->at (key_);
+    }
+
+    const array_type &as_array () const
+    {
+        if ( m_kind_ != kind::array )
+            throw std::runtime_error ("JSON: array expected.");
+        return *m_array_;
+    }
+
+    const object_type &as_object () const
+    {
+        if ( m_kind_ != kind::object )
+            throw std::runtime_error ("JSON: object expected.");
+        return *m_object_;
+    }
+
+    bool as_bool () const
+    {
+        if ( m_kind_ != kind::boolean )
+            throw std::runtime_error ("JSON: boolean expected.");
+        return m_bool_;
+    }
+
+    double as_number () const
+    {
+        if ( m_kind_ != kind::number )
+            throw std::runtime_error ("JSON: number expected.");
+        return m_number_;
+    }
+
+    const std::string &as_string () const
+    {
+        if ( m_kind_ != kind::string )
+            throw std::runtime_error ("JSON: string expected.");
+        return m_string_;
+    }
+
+    // Value of the member or the default one if it's missing.
+    double number_or (const std::string &key_, double default_) const
+    {
+        return contains (key_) ? (*this)[key_].as_number () : default_;
+    }
+
+    std::string string_or (const std::string &key_, const std::string &default_) const
+    {
+        return contains (key_) ? (*this)[key_].as_string () : default_;
+    }
+};
+
+}   // namespace end2end
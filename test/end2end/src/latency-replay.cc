@@ -0,0 +1,108 @@
+#include "driver_options.hpp"
+#include "latency_histogram.hpp"
+#include <array>
+#include <cstdio>
+#include <iostream>
+
+namespace
+{
+
+// Histograms are kept in this order: insert, erase, select, rank.
+constexpr std::array<const char *, 4> op_names = {"insert", "erase", "os_select",
+                                                  "get_number_less_then"};
+
+constexpr std::array<double, 4> percentiles            = {50, 90, 99, 99.9};
+constexpr std::array<const char *, 4> percentile_names = {"p50", "p90", "p99", "p99.9"};
+
+/* Smallest difference of two back to back timestamps, it's in every measured latency. */
+std::uint64_t timer_overhead ()
+{
+    auto best_ = ~std::uint64_t {0};
+    for ( int i_ = 0; i_ < 10000; i_++ )
+    {
+        auto start_ = end2end::latency_clock::now ();
+        best_       = std::min (best_, end2end::latency_clock::now () - start_);
+    }
+    return best_;
+}
+
+template <typename Set_, typename Input_> void run (Input_ &input_, const char *engine_name_)
+{
+    Set_ set_ {};
+    std::array<end2end::latency_histogram, op_names.size ()> histograms_;
+    end2end::latency_clock clock_;
+    /* Answers are stored, so the queries are not optimized out. */
+    [[maybe_unused]] volatile int answer_ {};
+    bool not_end = true;
+
+    while ( not_end )
+    {
+        char query_type {};
+        int key;
+
+        if ( !input_.next (query_type, key) )
+            break;
+
+        std::size_t op_ = 0;
+        auto start_     = end2end::latency_clock::now ();
+        switch ( query_type )
+        {
+        case 'k':
+            set_.insert (key);
+            op_ = 0;
+            break;
+        case 'e':
+            set_.erase (key);
+            op_ = 1;
+            break;
+        case 'm':
+            answer_ = set_.os_select (key);
+            op_     = 2;
+            break;
+        case 'n':
+            answer_ = set_.get_number_less_then (key);
+            op_     = 3;
+            break;
+        default:
+            std::cerr << "Invalid query." << std::endl;
+            not_end = false;
+            continue;
+        }
+        histograms_[op_].record (end2end::latency_clock::now () - start_);
+    }
+
+    auto ns_per_tick_ = clock_.ns_per_tick ();
+    auto ns_          = [ns_per_tick_] (std::uint64_t ticks_) {
+        return static_cast<double> (ticks_) * ns_per_tick_;
+    };
+
+    std::printf ("engine %s, timer overhead %.0f ns\n", engine_name_, ns_ (timer_overhead ()));
+    std::printf ("%-22s %10s", "op", "count");
+    for ( auto name_ : percentile_names )
+        std::printf (" %9s", name_);
+    std::printf (" %9s  (ns)\n", "max");
+
+    for ( std::size_t i_ = 0; i_ < op_names.size (); i_++ )
+    {
+        auto &histogram_ = histograms_[i_];
+        if ( !histogram_.count () )
+            continue;
+
+        std::printf ("%-22s %10llu", op_names[i_],
+                     static_cast<unsigned long long> (histogram_.count ()));
+        for ( auto percentile_ : percentiles )
+            std::printf (" %9.0f", ns_ (histogram_.percentile (percentile_)));
+        std::printf (" %9.0f\n", ns_ (histogram_.max ()));
+    }
+}
+
+}   // namespace
+
+// latency_replay [--engine avl|compact|btree|skiplist] < text queries
+// latency_replay [--engine avl|compact|btree|skiplist] --replay trace.bin
+int main (int argc, char **argv)
+{
+    return end2end::driver_main (argc, argv, [] (auto set_type_, auto &input_, const char *name_) {
+        run<typename decltype (set_type_)::type> (input_, name_);
+    });
+}
@@ -0,0 +1,131 @@
+// Per operation latency histograms of the end2end replay
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace end2end
+{
+
+//==================================latency_clock=================================
+/*
+ * Cheap timestamps for the single operations. On x86 it's the time stamp counter, converted
+ * to nanoseconds by the rate measured against steady_clock over the whole replay, so the
+ * calibration costs nothing per operation. Elsewhere it's steady_clock itself
+ * (clock_gettime (CLOCK_MONOTONIC) through the vDSO).
+ */
+class latency_clock
+{
+    using steady_ = std::chrono::steady_clock;
+
+    steady_::time_point m_wall_start_;
+    std::uint64_t m_ticks_start_;
+
+  public:
+    latency_clock () : m_wall_start_ (steady_::now ()), m_ticks_start_ (now ()) {}
+
+    static std::uint64_t now () noexcept
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        /* The fence keeps the operation from being reordered around the timestamp. */
+        _mm_lfence ();
+        auto ticks_ = __rdtsc ();
+        _mm_lfence ();
+        return ticks_;
+#else
+        return static_cast<std::uint64_t> (
+            std::chrono::duration_cast<std::chrono::nanoseconds> (
+                steady_::now ().time_since_epoch ())
+                .count ());
+#endif
+    }
+
+    // Nanoseconds per tick, measured from the construction of the clock.
+    double ns_per_tick () const
+    {
+        auto ticks_ = now () - m_ticks_start_;
+        auto ns_    = std::chrono::duration<double, std::nano> (steady_::now () - m_wall_start_);
+        return ticks_ ? ns_.count () / static_cast<double> (ticks_) : 1.0;
+    }
+};
+
+//================================latency_histogram===============================
+/*
+ * HDR style histogram: values below 2^s_bits_ are counted exactly, larger ones keep their
+ * s_bits_ most significant bits, so every bucket is within 1/2^(s_bits_ - 1) of the values
+ * it holds and the whole 64-bit range takes a few thousand counters. Recording is a shift
+ * and an increment, the maximum is kept exactly.
+ */
+class latency_histogram
+{
+    static constexpr int s_bits_           = 8;
+    static constexpr std::uint64_t s_sub_  = std::uint64_t {1} << s_bits_;
+    static constexpr std::uint64_t s_half_ = s_sub_ / 2;
+
+    std::vector<std::uint64_t> m_counts_;
+    std::uint64_t m_total_ = 0;
+    std::uint64_t m_max_   = 0;
+
+    static std::size_t s_index_ (std::uint64_t value_) noexcept
+    {
+        if ( value_ < s_sub_ )
+            return static_cast<std::size_t> (value_);
+
+        int shift_ = 64 - __builtin_clzll (value_) - s_bits_;
+        return static_cast<std::size_t> (s_sub_ + (shift_ - 1) * s_half_ +
+                                          ((value_ >> shift_) - s_half_));
+    }
+
+    // The largest value that falls into the bucket.
+    static std::uint64_t s_value_ (std::size_t index_) noexcept
+    {
+        if ( index_ < s_sub_ )
+            return index_;
+
+        auto shift_ = (index_ - s_sub_) / s_half_ + 1;
+        auto top_   = (index_ - s_sub_) % s_half_ + s_half_;
+        return ((top_ + 1) << shift_) - 1;
+    }
+
+  public:
+    latency_histogram () : m_counts_ (s_index_ (~std::uint64_t {0}) + 1) {}
+
+    void record (std::uint64_t value_) noexcept
+    {
+        m_counts_[s_index_ (value_)]++;
+        m_total_++;
+        m_max_ = std::max (m_max_, value_);
+    }
+
+    std::uint64_t count () const noexcept { return m_total_; }
+
+    std::uint64_t max () const noexcept { return m_max_; }
+
+    // Value at the percentile from (0, 100], 0 for the empty histogram.
+    std::uint64_t percentile (double percentile_) const noexcept
+    {
+        if ( !m_total_ )
+            return 0;
+
+        auto rank_ = static_cast<std::uint64_t> (percentile_ / 100 * m_total_ + 0.5);
+        rank_      = std::clamp<std::uint64_t> (rank_, 1, m_total_);
+
+        std::uint64_t seen_ = 0;
+        for ( std::size_t i_ = 0; i_ < m_counts_.size (); i_++ )
+        {
+            seen_ += m_counts_[i_];
+            if ( seen_ >= rank_ )
+                return std::min (s_value_ (i_), m_max_);
+        }
+        return m_max_;
+    }
+};
+
+}   // namespace end2end
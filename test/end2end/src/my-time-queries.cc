@@ -1,10 +1,13 @@
 #include "myset.hpp"
+#include "query_io.hpp"
 #include <iostream>
-#include <sstream>
 
 int main ()
 {
     rethinking_stl::set<int> set_ {};
+    end2end::query_input input_;
+    /* Answers are stored, so the queries are not optimized out. */
+    [[maybe_unused]] volatile int answer_ {};
     bool not_end = true;
 
     while ( not_end )
@@ -12,7 +15,7 @@ int main ()
         char query_type {};
         int key;
 
-        if ( !(std::cin >> query_type >> key) )
+        if ( !input_.next (query_type, key) )
             break;
         switch ( query_type )
         {
@@ -20,10 +23,13 @@ int main ()
             set_.insert (key);
             break;
         case 'm':
-            set_.os_select (key);
+            answer_ = set_.os_select (key);
+            break;
+        case 'e':
+            set_.erase (key);
             break;
         case 'n':
-            set_.get_number_less_then (key);
+            answer_ = static_cast<int> (set_.get_number_less_then (key));
             break;
         default:
             std::cerr << "Invalid query." << std::endl;
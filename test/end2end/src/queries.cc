@@ -1,10 +1,11 @@
-#include "myset.hpp"
+#include "driver_options.hpp"
+#include "query_io.hpp"
 #include <iostream>
-#include <sstream>
 
-int main ()
+template <typename Set_, typename Input_> void run (Input_ &input_)
 {
-    rethinking_stl::set<int> set_ {};
+    Set_ set_ {};
+    end2end::answer_output output_;
     bool not_end = true;
 
     while ( not_end )
@@ -12,7 +13,7 @@ int main ()
         char query_type {};
         int key;
 
-        if ( !(std::cin >> query_type >> key) )
+        if ( !input_.next (query_type, key) )
             break;
         switch ( query_type )
         {
@@ -20,10 +21,13 @@ int main ()
             set_.insert (key);
             break;
         case 'm':
-            std::cout << set_.os_select (key) << " ";
+            output_.put (set_.os_select (key));
+            break;
+        case 'e':
+            set_.erase (key);
             break;
         case 'n':
-            std::cout << set_.get_number_less_then (key) << " ";
+            output_.put (set_.get_number_less_then (key));
             break;
         default:
             std::cerr << "Invalid query." << std::endl;
@@ -31,3 +35,12 @@ int main ()
         }
     }
 }
+
+// queries [--engine avl|compact|btree|skiplist] < text queries
+// queries [--engine avl|compact|btree|skiplist] --replay trace.bin
+int main (int argc, char **argv)
+{
+    return end2end::driver_main (argc, argv, [] (auto set_type_, auto &input_, const char *) {
+        run<typename decltype (set_type_)::type> (input_);
+    });
+}
@@ -0,0 +1,192 @@
+// Query stream of the end2end drivers without iostreams
+
+#pragma once
+
+#include <charconv>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace end2end
+{
+
+//===================================input_block===================================
+// Whole input as one block of memory: regular files are mapped, pipes are read in big blocks.
+class input_block
+{
+    static constexpr std::size_t s_block_ = 1 << 20;
+
+    void *m_map_            = MAP_FAILED;
+    std::size_t m_map_size_ = 0;
+    std::vector<char> m_buffer_;
+
+    const char *m_begin_ = nullptr;
+    const char *m_end_   = nullptr;
+
+    void m_read_blocks_ (int fd_)
+    {
+        std::size_t size_ = 0;
+        for ( ;; )
+        {
+            m_buffer_.resize (size_ + s_block_);
+            auto read_ = ::read (fd_, m_buffer_.data () + size_, s_block_);
+            if ( read_ <= 0 )
+                break;
+            size_ += static_cast<std::size_t> (read_);
+        }
+        m_buffer_.resize (size_);
+        m_begin_ = m_buffer_.data ();
+        m_end_   = m_begin_ + size_;
+    }
+
+  public:
+    explicit input_block (int fd_ = STDIN_FILENO)
+    {
+        struct stat stat_;
+        if ( ::fstat (fd_, &stat_) == 0 && S_ISREG (stat_.st_mode) && stat_.st_size > 0 )
+        {
+            m_map_size_ = static_cast<std::size_t> (stat_.st_size);
+            m_map_      = ::mmap (nullptr, m_map_size_, PROT_READ, MAP_PRIVATE, fd_, 0);
+        }
+
+        if ( m_map_ == MAP_FAILED )
+        {
+            m_read_blocks_ (fd_);
+            return;
+        }
+
+        ::madvise (m_map_, m_map_size_, MADV_SEQUENTIAL);
+        m_begin_ = static_cast<const char *> (m_map_);
+        m_end_   = m_begin_ + m_map_size_;
+    }
+
+    input_block (const input_block &)            = delete;
+    input_block &operator= (const input_block &) = delete;
+
+    ~input_block ()
+    {
+        if ( m_map_ != MAP_FAILED )
+            ::munmap (m_map_, m_map_size_);
+    }
+
+    const char *begin () const noexcept { return m_begin_; }
+
+    const char *end () const noexcept { return m_end_; }
+
+    std::size_t size () const noexcept { return static_cast<std::size_t> (m_end_ - m_begin_); }
+};
+
+//===================================query_input===================================
+/*
+ * Text queries of the driver. Records are "<type> <key>" separated by any whitespace,
+ * like for std::cin >> type >> key.
+ */
+class query_input
+{
+    input_block m_block_;
+
+    const char *m_pos_ = m_block_.begin ();
+    const char *m_end_ = m_block_.end ();
+
+    static bool s_space_ (char c_) noexcept
+    {
+        return c_ == ' ' || c_ == '\n' || c_ == '\t' || c_ == '\r' || c_ == '\v' || c_ == '\f';
+    }
+
+    void m_skip_spaces_ () noexcept
+    {
+        while ( m_pos_ != m_end_ && s_space_ (*m_pos_) )
+            m_pos_++;
+    }
+
+  public:
+    explicit query_input (int fd_ = STDIN_FILENO) : m_block_ (fd_) {}
+
+    // Read the next record, return false at the end of the input or on a malformed key.
+    bool next (char &type_, int &key_) noexcept
+    {
+        m_skip_spaces_ ();
+        if ( m_pos_ == m_end_ )
+            return false;
+        type_ = *m_pos_++;
+
+        m_skip_spaces_ ();
+        bool negative_ = (m_pos_ != m_end_ && *m_pos_ == '-');
+        if ( negative_ || (m_pos_ != m_end_ && *m_pos_ == '+') )
+            m_pos_++;
+
+        /* Digits are accumulated in the unsigned type, so INT_MIN doesn't overflow. */
+        auto start_     = m_pos_;
+        unsigned value_ = 0;
+        for ( ; m_pos_ != m_end_ && static_cast<unsigned> (*m_pos_ - '0') < 10; m_pos_++ )
+            value_ = value_ * 10 + static_cast<unsigned> (*m_pos_ - '0');
+
+        if ( m_pos_ == start_ )
+            return false;
+        key_ = static_cast<int> (negative_ ? 0u - value_ : value_);
+        return true;
+    }
+};
+
+//==================================answer_output==================================
+// Answers are collected in one big buffer and written out by a few large writes.
+class answer_output
+{
+    static constexpr std::size_t s_flush_size_ = 1 << 20;
+
+    std::string m_buffer_;
+    int m_fd_;
+
+  public:
+    explicit answer_output (int fd_ = STDOUT_FILENO) : m_fd_ (fd_)
+    {
+        m_buffer_.reserve (s_flush_size_ + 64);
+    }
+
+    answer_output (const answer_output &)            = delete;
+    answer_output &operator= (const answer_output &) = delete;
+
+    ~answer_output () { flush (); }
+
+    // Append the number followed by a space.
+    template <typename Int_> void put (Int_ value_)
+    {
+        char digits_[24];
+        auto res_ = std::to_chars (digits_, digits_ + sizeof (digits_) - 1, value_);
+        *res_.ptr++ = ' ';
+        m_buffer_.append (digits_, res_.ptr);
+
+        if ( m_buffer_.size () >= s_flush_size_ )
+            flush ();
+    }
+
+    // Append raw bytes.
+    void put_bytes (const char *data_, std::size_t size_)
+    {
+        m_buffer_.append (data_, size_);
+        if ( m_buffer_.size () >= s_flush_size_ )
+            flush ();
+    }
+
+    void flush () noexcept
+    {
+        auto data_ = m_buffer_.data ();
+        auto left_ = m_buffer_.size ();
+        while ( left_ )
+        {
+            auto written_ = ::write (m_fd_, data_, left_);
+            if ( written_ <= 0 )
+                break;
+            data_ += written_;
+            left_ -= static_cast<std::size_t> (written_);
+        }
+        m_buffer_.clear ();
+    }
+};
+
+}   // namespace end2end
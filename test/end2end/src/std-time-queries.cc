@@ -1,10 +1,11 @@
+#include "query_io.hpp"
 #include <set>
 #include <iostream>
 #include <cassert>
 #include <iterator>
 
 
-int os_select (std::set<int> set_, const int &key_)
+int os_select (const std::set<int> &set_, const int &key_)
 {
     assert(key_ > 0);
     auto l_key = key_ - 1;
@@ -12,7 +13,7 @@ int os_select (std::set<int> set_, const int &key_)
     return *(std::next(it, l_key));
 }
 
-int get_number_less_then (std::set<int> set_, const int &key_)
+int get_number_less_then (const std::set<int> &set_, const int &key_)
 {
     auto it = set_.begin();
     int cnt {};
@@ -30,6 +31,9 @@ int get_number_less_then (std::set<int> set_, const int &key_)
 int main ()
 {
     std::set<int> set_ {};
+    end2end::query_input input_;
+    /* Answers are stored, so the queries are not optimized out. */
+    [[maybe_unused]] volatile int answer_ {};
     bool not_end = true;
 
     while ( not_end )
@@ -37,7 +41,7 @@ int main ()
         char query_type {};
         int key;
 
-        if ( !(std::cin >> query_type >> key) )
+        if ( !input_.next (query_type, key) )
             break;
         switch ( query_type )
         {
@@ -45,10 +49,13 @@ int main ()
             set_.insert (key);
             break;
         case 'm':
-            os_select (set_, key);
+            answer_ = os_select (set_, key);
+            break;
+        case 'e':
+            set_.erase (key);
             break;
         case 'n':
-            get_number_less_then (set_, key);
+            answer_ = get_number_less_then (set_, key);
             break;
         default:
             std::cerr << "Invalid query." << std::endl;
@@ -0,0 +1,31 @@
+#include "query_io.hpp"
+#include "trace_format.hpp"
+#include <iostream>
+#include <string_view>
+
+// trace_convert [--fixed] < text queries > trace.bin
+int main (int argc, char **argv)
+{
+    auto encoding = end2end::trace_encoding::varint;
+    if ( argc == 2 && std::string_view (argv[1]) == "--fixed" )
+        encoding = end2end::trace_encoding::fixed;
+    else if ( argc != 1 )
+    {
+        std::cerr << "Usage: " << argv[0] << " [--fixed] < queries > trace" << std::endl;
+        return 1;
+    }
+
+    end2end::query_input input_;
+    end2end::trace_output output_ (encoding);
+
+    char query_type {};
+    int key;
+    while ( input_.next (query_type, key) )
+    {
+        if ( !output_.put (query_type, key) )
+        {
+            std::cerr << "Invalid query." << std::endl;
+            return 1;
+        }
+    }
+}
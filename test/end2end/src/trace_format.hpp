@@ -0,0 +1,160 @@
+// Binary query trace format of the end2end drivers
+
+#pragma once
+
+#include "query_io.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+namespace end2end
+{
+
+/*
+ * Trace is an 8-byte header followed by the records. Every record is a one byte op code
+ * and the key, either as zigzag LEB128 varint (1-5 bytes) or as fixed 4-byte little endian.
+ *
+ *   bytes 0-3  magic "OSTR"
+ *   byte  4    version, 1
+ *   byte  5    key encoding, 0 - varint, 1 - fixed
+ *   bytes 6-7  reserved, zero
+ */
+struct trace_header
+{
+    char m_magic_[4];
+    std::uint8_t m_version_;
+    std::uint8_t m_encoding_;
+    std::uint8_t m_reserved_[2];
+};
+
+static_assert (sizeof (trace_header) == 8);
+
+inline constexpr char trace_magic[4]        = {'O', 'S', 'T', 'R'};
+inline constexpr std::uint8_t trace_version = 1;
+
+enum class trace_encoding : std::uint8_t
+{
+    varint = 0,
+    fixed  = 1,
+};
+
+// Op codes in the order of the text query types: insert, select, rank, erase.
+inline constexpr char trace_ops[]       = {'k', 'm', 'n', 'e'};
+inline constexpr std::size_t trace_nops = sizeof (trace_ops);
+
+//==================================trace_output==================================
+class trace_output
+{
+    answer_output m_output_;
+    trace_encoding m_encoding_;
+
+  public:
+    explicit trace_output (trace_encoding encoding_, int fd_ = STDOUT_FILENO)
+        : m_output_ (fd_), m_encoding_ (encoding_)
+    {
+        trace_header header_ {{}, trace_version, static_cast<std::uint8_t> (encoding_), {}};
+        std::memcpy (header_.m_magic_, trace_magic, sizeof (trace_magic));
+        m_output_.put_bytes (reinterpret_cast<const char *> (&header_), sizeof (header_));
+    }
+
+    // Append the record, return false if the query type is unknown.
+    bool put (char type_, int key_)
+    {
+        char record_[6];
+        std::size_t size_ = 0;
+
+        auto op_ = static_cast<std::size_t> (std::find (trace_ops, trace_ops + trace_nops, type_) -
+                                             trace_ops);
+        if ( op_ == trace_nops )
+            return false;
+        record_[size_++] = static_cast<char> (op_);
+
+        auto value_ = static_cast<std::uint32_t> (key_);
+        if ( m_encoding_ == trace_encoding::fixed )
+        {
+            for ( int i_ = 0; i_ < 4; i_++, value_ >>= 8 )
+                record_[size_++] = static_cast<char> (value_ & 0xFF);
+        }
+        else
+        {
+            /* Zigzag keeps small negative keys short. */
+            value_ = (value_ << 1) ^ static_cast<std::uint32_t> (key_ >> 31);
+            for ( ; value_ >= 0x80; value_ >>= 7 )
+                record_[size_++] = static_cast<char> ((value_ & 0x7F) | 0x80);
+            record_[size_++] = static_cast<char> (value_);
+        }
+
+        m_output_.put_bytes (record_, size_);
+        return true;
+    }
+};
+
+//===================================trace_input==================================
+/*
+ * Records of the trace file in the same shape as query_input gives them, so the drivers
+ * run both with one loop. Unknown op codes come out as '?'.
+ */
+class trace_input
+{
+    input_block m_block_;
+
+    const unsigned char *m_pos_;
+    const unsigned char *m_end_;
+    trace_encoding m_encoding_;
+
+  public:
+    // Throws std::runtime_error if the file is not a trace.
+    explicit trace_input (int fd_)
+        : m_block_ (fd_), m_pos_ (reinterpret_cast<const unsigned char *> (m_block_.begin ())),
+          m_end_ (reinterpret_cast<const unsigned char *> (m_block_.end ()))
+    {
+        trace_header header_;
+        if ( m_block_.size () < sizeof (header_) )
+            throw std::runtime_error ("Trace is shorter then its header.");
+
+        std::memcpy (&header_, m_pos_, sizeof (header_));
+        if ( std::memcmp (header_.m_magic_, trace_magic, sizeof (trace_magic)) ||
+             header_.m_version_ != trace_version || header_.m_encoding_ > 1 )
+            throw std::runtime_error ("Unknown trace format.");
+
+        m_encoding_ = static_cast<trace_encoding> (header_.m_encoding_);
+        m_pos_ += sizeof (header_);
+    }
+
+    // Read the next record, return false at the end of the trace or on a truncated record.
+    bool next (char &type_, int &key_) noexcept
+    {
+        if ( m_pos_ == m_end_ )
+            return false;
+
+        auto op_ = *m_pos_++;
+        type_    = (op_ < trace_nops ? trace_ops[op_] : '?');
+
+        std::uint32_t value_ = 0;
+        if ( m_encoding_ == trace_encoding::fixed )
+        {
+            if ( m_end_ - m_pos_ < 4 )
+                return false;
+            for ( int i_ = 0; i_ < 4; i_++ )
+                value_ |= static_cast<std::uint32_t> (m_pos_[i_]) << (8 * i_);
+            m_pos_ += 4;
+            key_ = static_cast<int> (value_);
+            return true;
+        }
+
+        for ( int shift_ = 0;; shift_ += 7 )
+        {
+            if ( m_pos_ == m_end_ || shift_ > 28 )
+                return false;
+            auto byte_ = *m_pos_++;
+            value_ |= static_cast<std::uint32_t> (byte_ & 0x7F) << shift_;
+            if ( !(byte_ & 0x80) )
+                break;
+        }
+        key_ = static_cast<int> ((value_ >> 1) ^ (0u - (value_ & 1)));
+        return true;
+    }
+};
+
+}   // namespace end2end
@@ -0,0 +1,423 @@
+#include "json_reader.hpp"
+#include "query_io.hpp"
+#include "trace_format.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace
+{
+
+using rng = std::mt19937_64;
+
+//==================================fenwick_set===================================
+// Set of keys of the domain [0, n_) with O(log n) insert, erase, rank and select.
+class fenwick_set
+{
+    std::vector<std::uint32_t> m_tree_; /* 1-based */
+    std::vector<bool> m_present_;
+    std::size_t m_size_ = 0;
+    std::size_t m_top_  = 1; /* the highest power of two not greater then the domain */
+
+    void m_add_ (std::size_t i_, std::uint32_t delta_)
+    {
+        for ( i_++; i_ < m_tree_.size (); i_ += i_ & (~i_ + 1) )
+            m_tree_[i_] += delta_;
+    }
+
+  public:
+    explicit fenwick_set (std::size_t n_) : m_tree_ (n_ + 1), m_present_ (n_)
+    {
+        while ( m_top_ * 2 <= n_ )
+            m_top_ *= 2;
+    }
+
+    std::size_t size () const noexcept { return m_size_; }
+
+    bool insert (std::size_t key_)
+    {
+        if ( m_present_[key_] )
+            return false;
+        m_present_[key_] = true;
+        m_size_++;
+        m_add_ (key_, 1);
+        return true;
+    }
+
+    bool erase (std::size_t key_)
+    {
+        if ( !m_present_[key_] )
+            return false;
+        m_present_[key_] = false;
+        m_size_--;
+        m_add_ (key_, static_cast<std::uint32_t> (-1));
+        return true;
+    }
+
+    // Number of keys less then key_.
+    std::size_t count_less (std::size_t key_) const
+    {
+        std::size_t res_ = 0;
+        for ( ; key_; key_ -= key_ & (~key_ + 1) )
+            res_ += m_tree_[key_];
+        return res_;
+    }
+
+    // k_th smallest key, k_ starts from 1 and is not greater then the size.
+    std::size_t select (std::size_t k_) const
+    {
+        std::size_t pos_ = 0;
+        for ( auto step_ = m_top_; step_; step_ /= 2 )
+        {
+            if ( pos_ + step_ < m_tree_.size () && m_tree_[pos_ + step_] < k_ )
+            {
+                pos_ += step_;
+                k_ -= m_tree_[pos_];
+            }
+        }
+        return pos_;
+    }
+};
+
+//================================zipf_distribution================================
+/*
+ * Zipf distribution over [1, n_] with P(k) ~ 1 / k^s_ by rejection-inversion
+ * (W. Hormann, G. Derflinger, 1996), which takes O(1) time and memory for any n_.
+ */
+class zipf_distribution
+{
+    double m_n_, m_s_;
+    double m_h_x1_, m_h_n_, m_threshold_;
+
+    static double s_helper1_ (double x_)
+    {
+        if ( std::abs (x_) > 1e-8 )
+            return std::log1p (x_) / x_;
+        return 1 - x_ * (0.5 - x_ * (1.0 / 3 - 0.25 * x_));
+    }
+
+    static double s_helper2_ (double x_)
+    {
+        if ( std::abs (x_) > 1e-8 )
+            return std::expm1 (x_) / x_;
+        return 1 + x_ * 0.5 * (1 + x_ / 3 * (1 + 0.25 * x_));
+    }
+
+    double m_h_ (double x_) const { return std::exp (-m_s_ * std::log (x_)); }
+
+    double m_h_integral_ (double x_) const
+    {
+        auto log_x_ = std::log (x_);
+        return s_helper2_ ((1 - m_s_) * log_x_) * log_x_;
+    }
+
+    double m_h_integral_inverse_ (double x_) const
+    {
+        auto t_ = std::max (x_ * (1 - m_s_), -1.0);
+        return std::exp (s_helper1_ (t_) * x_);
+    }
+
+  public:
+    zipf_distribution (std::uint64_t n_, double s_)
+        : m_n_ (static_cast<double> (n_)), m_s_ (s_), m_h_x1_ (m_h_integral_ (1.5) - 1),
+          m_h_n_ (m_h_integral_ (m_n_ + 0.5)),
+          m_threshold_ (2 - m_h_integral_inverse_ (m_h_integral_ (2.5) - m_h_ (2)))
+    {
+    }
+
+    std::uint64_t operator() (rng &gen_) const
+    {
+        std::uniform_real_distribution<double> uniform_ (0, 1);
+        for ( ;; )
+        {
+            auto u_ = m_h_n_ + uniform_ (gen_) * (m_h_x1_ - m_h_n_);
+            auto x_ = m_h_integral_inverse_ (u_);
+            auto k_ = std::clamp (std::floor (x_ + 0.5), 1.0, m_n_);
+            if ( k_ - x_ <= m_threshold_ || u_ >= m_h_integral_ (k_ + 0.5) - m_h_ (k_) )
+                return static_cast<std::uint64_t> (k_);
+        }
+    }
+};
+
+//================================key_distribution================================
+// Offsets of the keys in the domain [0, n_) drawn for inserts and rank queries.
+class key_distribution
+{
+    enum class kind
+    {
+        uniform,
+        zipf,
+        sorted,
+        reverse,
+        clustered,
+    };
+
+    kind m_kind_;
+    std::uint64_t m_n_;
+    std::uint64_t m_step_     = 1;
+    std::uint64_t m_counter_  = 0;
+    std::uint64_t m_width_    = 1;
+    std::uint64_t m_scramble_ = 1;
+    std::vector<std::uint64_t> m_centers_;
+    std::unique_ptr<zipf_distribution> m_zipf_;
+
+  public:
+    key_distribution (const end2end::json_value &keys_, std::uint64_t n_, std::uint64_t ops_,
+                      rng &gen_)
+        : m_n_ (n_)
+    {
+        auto name_ = keys_.string_or ("distribution", "uniform");
+        if ( name_ == "uniform" )
+            m_kind_ = kind::uniform;
+        else if ( name_ == "zipf" )
+        {
+            auto s_ = keys_.number_or ("zipf_s", 1.1);
+            if ( !(s_ > 0) )
+                throw std::runtime_error ("Zipf exponent has to be positive.");
+            m_kind_ = kind::zipf;
+            m_zipf_ = std::make_unique<zipf_distribution> (n_, s_);
+
+            /* Hot keys are spread over the domain by a multiplier coprime with its size. */
+            m_scramble_ = 2654435761u % n_;
+            while ( std::gcd (m_scramble_, n_) != 1 )
+                m_scramble_++;
+        }
+        else if ( name_ == "sorted" || name_ == "reverse" )
+        {
+            m_kind_ = (name_ == "sorted" ? kind::sorted : kind::reverse);
+            m_step_ = std::max<std::uint64_t> (1, n_ / std::max<std::uint64_t> (1, ops_));
+        }
+        else if ( name_ == "clustered" )
+        {
+            m_kind_ = kind::clustered;
+            auto clusters_ = static_cast<std::uint64_t> (keys_.number_or ("clusters", 64));
+            m_width_       = std::clamp<std::uint64_t> (
+                static_cast<std::uint64_t> (keys_.number_or ("cluster_width", 1024)), 1, n_);
+
+            std::uniform_int_distribution<std::uint64_t> center_ (0, n_ - m_width_);
+            for ( std::uint64_t i_ = 0; i_ < std::max<std::uint64_t> (1, clusters_); i_++ )
+                m_centers_.push_back (center_ (gen_));
+        }
+        else
+            throw std::runtime_error ("Unknown key distribution \"" + name_ + "\".");
+    }
+
+    std::uint64_t operator() (rng &gen_)
+    {
+        switch ( m_kind_ )
+        {
+        case kind::uniform:
+            return std::uniform_int_distribution<std::uint64_t> (0, m_n_ - 1) (gen_);
+        case kind::zipf:
+            return ((*m_zipf_) (gen_) - 1) * m_scramble_ % m_n_;
+        case kind::sorted:
+            return m_counter_++ * m_step_ % m_n_;
+        case kind::reverse:
+            return m_n_ - 1 - m_counter_++ * m_step_ % m_n_;
+        case kind::clustered: {
+            std::uniform_int_distribution<std::size_t> pick_ (0, m_centers_.size () - 1);
+            std::uniform_int_distribution<std::uint64_t> offset_ (0, m_width_ - 1);
+            return m_centers_[pick_ (gen_)] + offset_ (gen_);
+        }
+        }
+        return 0;
+    }
+};
+
+//=====================================writers=====================================
+class text_writer
+{
+    end2end::answer_output m_output_;
+
+  public:
+    explicit text_writer (int fd_) : m_output_ (fd_) {}
+
+    void put (char type_, int key_)
+    {
+        char prefix_[2] = {type_, ' '};
+        m_output_.put_bytes (prefix_, sizeof (prefix_));
+        m_output_.put (key_);
+    }
+};
+
+class binary_writer
+{
+    end2end::trace_output m_output_;
+
+  public:
+    binary_writer (end2end::trace_encoding encoding_, int fd_) : m_output_ (encoding_, fd_) {}
+
+    void put (char type_, int key_) { m_output_.put (type_, key_); }
+};
+
+int open_output (const std::string &path_)
+{
+    int fd_ = ::open (path_.c_str (), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if ( fd_ < 0 )
+        throw std::runtime_error ("Can't open " + path_ + ".");
+    return fd_;
+}
+
+//====================================generation===================================
+/*
+ * Every phase draws its ops by the weights of the mix. Inserts and ranks take keys from the
+ * distribution, selects and erases pick a uniformly random key of the current set, so erases
+ * always hit. Selects and erases on an empty set become inserts.
+ */
+template <typename Writer_>
+void generate (const end2end::json_value &config_, Writer_ &queries_,
+               end2end::answer_output &answers_)
+{
+    auto &keys_ = config_["keys"];
+    auto min_   = static_cast<std::int64_t> (keys_.number_or ("min", 0));
+    auto max_   = static_cast<std::int64_t> (keys_.number_or ("max", 1 << 20));
+
+    if ( min_ < std::numeric_limits<int>::min () || max_ - 1 > std::numeric_limits<int>::max () ||
+         max_ <= min_ || max_ - min_ > (std::int64_t {1} << 30) )
+        throw std::runtime_error ("Keys have to be ints and the domain has to be at most 2^30.");
+    auto n_ = static_cast<std::uint64_t> (max_ - min_);
+
+    std::uint64_t total_ops_ = 0;
+    for ( auto &phase_ : config_["phases"].as_array () )
+        total_ops_ += static_cast<std::uint64_t> (phase_.number_or ("ops", 0));
+
+    rng gen_ {static_cast<std::uint64_t> (config_.number_or ("seed", 42))};
+    key_distribution dist_ (keys_, n_, total_ops_, gen_);
+    fenwick_set set_ (n_);
+
+    for ( auto &phase_ : config_["phases"].as_array () )
+    {
+        /* Weights in the order of the op codes. */
+        auto &mix_ = phase_["mix"];
+        std::vector<double> weights_;
+        for ( auto op_name_ : {"insert", "select", "rank", "erase"} )
+            weights_.push_back (mix_.number_or (op_name_, 0));
+        if ( std::accumulate (weights_.begin (), weights_.end (), 0.0) <= 0 )
+            throw std::runtime_error ("Mix of a phase has no positive weights.");
+        std::discrete_distribution<int> op_ (weights_.begin (), weights_.end ());
+
+        auto ops_ = static_cast<std::uint64_t> (phase_.number_or ("ops", 0));
+        for ( std::uint64_t i_ = 0; i_ < ops_; i_++ )
+        {
+            auto type_ = end2end::trace_ops[op_ (gen_)];
+            if ( (type_ == 'm' || type_ == 'e') && !set_.size () )
+                type_ = 'k';
+
+            std::uint64_t key_ = 0;
+            switch ( type_ )
+            {
+            case 'k':
+                key_ = dist_ (gen_);
+                set_.insert (key_);
+                break;
+            case 'n':
+                key_ = dist_ (gen_);
+                answers_.put (set_.count_less (key_));
+                break;
+            case 'm': {
+                auto rank_ = std::uniform_int_distribution<std::size_t> (1, set_.size ()) (gen_);
+                queries_.put (type_, static_cast<int> (rank_));
+                answers_.put (static_cast<std::int64_t> (set_.select (rank_)) + min_);
+                continue;
+            }
+            case 'e':
+                key_ = set_.select (
+                    std::uniform_int_distribution<std::size_t> (1, set_.size ()) (gen_));
+                set_.erase (key_);
+                break;
+            }
+            queries_.put (type_, static_cast<int> (static_cast<std::int64_t> (key_) + min_));
+        }
+    }
+}
+
+void generate_workload (const end2end::json_value &config_, const std::string &output_path_)
+{
+    auto name_     = config_["name"].as_string ();
+    auto format_   = config_.string_or ("format", "text");
+    auto encoding_ = config_.string_or ("encoding", "varint");
+
+    if ( format_ != "text" && format_ != "binary" )
+        throw std::runtime_error ("Unknown format \"" + format_ + "\".");
+    if ( encoding_ != "varint" && encoding_ != "fixed" )
+        throw std::runtime_error ("Unknown key encoding \"" + encoding_ + "\".");
+
+    auto path_ = output_path_ + "/" + name_ + (format_ == "text" ? ".dat" : ".bin");
+    int queries_fd_ = open_output (path_);
+    int answers_fd_ = open_output (path_ + ".ans");
+
+    {
+        end2end::answer_output answers_ (answers_fd_);
+        if ( format_ == "text" )
+        {
+            text_writer queries_ (queries_fd_);
+            generate (config_, queries_, answers_);
+        }
+        else
+        {
+            binary_writer queries_ (encoding_ == "fixed" ? end2end::trace_encoding::fixed
+                                                         : end2end::trace_encoding::varint,
+                                    queries_fd_);
+            generate (config_, queries_, answers_);
+        }
+    }
+
+    ::close (queries_fd_);
+    ::close (answers_fd_);
+    std::cout << "Generated " << path_ << std::endl;
+}
+
+}   // namespace
+
+// workgen --config_path config.json [--output_path dir]
+int main (int argc, char **argv)
+{
+    std::string config_path;
+    std::string output_path;
+    for ( int i = 1; i + 1 < argc; i += 2 )
+    {
+        if ( std::string_view (argv[i]) == "--config_path" )
+            config_path = argv[i + 1];
+        else if ( std::string_view (argv[i]) == "--output_path" )
+            output_path = argv[i + 1];
+    }
+
+    if ( config_path.empty () )
+    {
+        std::cerr << "Usage: " << argv[0] << " --config_path config.json [--output_path dir]"
+                  << std::endl;
+        return 1;
+    }
+
+    try
+    {
+        std::ifstream config_file (config_path);
+        if ( !config_file )
+            throw std::runtime_error ("Wrong config file path.");
+        std::stringstream text;
+        text << config_file.rdbuf ();
+
+        auto config = end2end::json_value::parse (text.str ());
+        if ( output_path.empty () )
+            output_path = config.string_or ("output_path", ".");
+
+        for ( auto &workload : config["workloads"].as_array () )
+            generate_workload (workload, output_path);
+    }
+    catch ( const std::runtime_error &error )
+    {
+        std::cerr << error.what () << std::endl;
+        return 1;
+    }
+}
@@ -7,6 +7,8 @@ green=`tput setaf 2`
 reset=`tput sgr0`
 
 current_folder=${2:-./}
+# Optional storage engine of the queries binary
+engine=${3:+--engine $3}
 passed=true
 
 for file in ${current_folder}/${base_folder}/test*.dat; do
@@ -17,7 +19,7 @@ for file in ${current_folder}/${base_folder}/test*.dat; do
     if [ -z "$1" ]; then
         bin/queries < $file > ${current_folder}/$base_folder/temp.dat
     else
-        $1 < $file > ${current_folder}/$base_folder/temp.dat
+        $1 ${engine} < $file > ${current_folder}/$base_folder/temp.dat
     fi
 
     # Compare inputs
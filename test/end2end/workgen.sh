@@ -0,0 +1,43 @@
+#!/bin/bash
+
+red=`tput setaf 1`
+green=`tput setaf 2`
+reset=`tput sgr0`
+
+current_folder=${3:-./}
+output=`mktemp -d`
+passed=true
+
+# Generate the workloads of the config into a temporary folder
+if ! $2 --config_path ${current_folder}/config.json --output_path ${output}; then
+    rm -rf ${output}
+    exit 666
+fi
+
+for file in ${output}/*.dat ${output}/*.bin; do
+    [ -e "${file}" ] || continue
+
+    echo -n "Testing ${green}${file}${reset} ... "
+
+    if [[ ${file} == *.bin ]]; then
+        $1 --replay ${file} > ${output}/temp.out
+    else
+        $1 < ${file} > ${output}/temp.out
+    fi
+
+    if diff -Z ${file}.ans ${output}/temp.out > /dev/null; then
+        echo "${green}Passed${reset}"
+    else
+        echo "${red}Failed${reset}"
+        passed=false
+    fi
+done
+
+rm -rf ${output}
+
+if ${passed}
+then
+    exit 0
+else
+    exit 666
+fi
@@ -11,17 +11,16 @@
 #include "myset.hpp"
 #include <gtest/gtest.h>
 
-using set         = typename rethinking_stl::set<int>;
-using owning_ptr_ = typename set::owning_ptr_;
-using node_ptr_   = typename set::node_ptr_;
+using set       = typename rethinking_stl::set<int>;
+using node_ptr_ = typename set::node_ptr_;
 
 TEST (Test_do_avl_tree_node, Test_m_maximum_)
 {
     auto head = new rethinking_stl::do_avl_tree_node_<int> {0};
 
-    head->m_left_            = owning_ptr_ (new rethinking_stl::do_avl_tree_node_<int> (-1));
-    head->m_right_           = owning_ptr_ (new rethinking_stl::do_avl_tree_node_<int> (1));
-    head->m_right_->m_right_ = owning_ptr_ (new rethinking_stl::do_avl_tree_node_<int> (2));
+    head->m_left_            = new rethinking_stl::do_avl_tree_node_<int> (-1);
+    head->m_right_           = new rethinking_stl::do_avl_tree_node_<int> (1);
+    head->m_right_->m_right_ = new rethinking_stl::do_avl_tree_node_<int> (2);
 
     auto max = head->m_maximum_ ();
     EXPECT_EQ (max->m_key_, 2);
@@ -31,9 +30,9 @@ TEST (Test_do_avl_tree_node, Test_m_minimum_)
 {
     auto head = new rethinking_stl::do_avl_tree_node_<int> {0};
 
-    head->m_right_         = owning_ptr_ (new rethinking_stl::do_avl_tree_node_<int> (1));
-    head->m_left_          = owning_ptr_ (new rethinking_stl::do_avl_tree_node_<int> (-1));
-    head->m_left_->m_left_ = owning_ptr_ (new rethinking_stl::do_avl_tree_node_<int> (-2));
+    head->m_right_         = new rethinking_stl::do_avl_tree_node_<int> (1);
+    head->m_left_          = new rethinking_stl::do_avl_tree_node_<int> (-1);
+    head->m_left_->m_left_ = new rethinking_stl::do_avl_tree_node_<int> (-2);
 
     auto max = head->m_minimum_ ();
     EXPECT_EQ (max->m_key_, -2);
@@ -69,7 +68,7 @@ TEST (Test_do_avl_tree_iterator_, TestPostIncrement)
     head->m_parent_ = head;
 
     auto new_node             = new rethinking_stl::do_avl_tree_node_<int> (1);
-    head->m_right_            = owning_ptr_ (new_node);
+    head->m_right_            = new_node;
     head->m_right_->m_parent_ = head;
 
     rethinking_stl::set<int>::do_avl_tree_iterator_ head_pos (head);
@@ -87,7 +86,7 @@ TEST (Test_do_avl_tree_iterator_, TestPreIncrement)
     head->m_parent_ = head;
 
     auto new_node             = new rethinking_stl::do_avl_tree_node_<int> (1);
-    head->m_right_            = owning_ptr_ (new_node);
+    head->m_right_            = new_node;
     head->m_right_->m_parent_ = head;
 
     rethinking_stl::set<int>::do_avl_tree_iterator_ head_pos (head);
@@ -105,7 +104,7 @@ TEST (Test_do_avl_tree_iterator_, TestPreDecrement)
     head->m_parent_ = head;
 
     auto new_node            = new rethinking_stl::do_avl_tree_node_<int> (-1);
-    head->m_left_            = owning_ptr_ (new_node);
+    head->m_left_            = new_node;
     head->m_left_->m_parent_ = head;
 
     rethinking_stl::set<int>::do_avl_tree_iterator_ head_pos (head);
@@ -253,7 +252,9 @@ TEST (Test_set, TestDoubleInsert)
 
     for ( int i = 0; i < 10; i++ )
     {
-        EXPECT_THROW (tree.insert (i), std::out_of_range);
+        auto [pos, inserted] = tree.insert (i);
+        EXPECT_FALSE (inserted);
+        EXPECT_EQ (*pos, i);
         EXPECT_EQ (tree.size (), old_size);
     }
 }
@@ -273,6 +274,21 @@ TEST (Test_set, TestDeleteWrong)
     }
 }
 
+TEST (Test_set, TestEraseMissing)
+{
+    rethinking_stl::set<int> tree;
+    for ( int i = 0; i < 10; i++ )
+        tree.insert (i);
+
+    for ( int i = 10; i < 20; i++ )
+    {
+        EXPECT_EQ (tree.erase (i), 0);
+        EXPECT_EQ (tree.size (), 10);
+    }
+
+    EXPECT_EQ (tree.m_os_select_ (10), 9);
+}
+
 TEST (Test_set, TestDeleteAll)
 {
     rethinking_stl::set<int> tree;
@@ -281,7 +297,7 @@ TEST (Test_set, TestDeleteAll)
         tree.insert (i);
 
     for ( int i = 0; i < 10; i++ )
-        EXPECT_NO_THROW (tree.erase (i));
+        EXPECT_EQ (tree.erase (i), 1);
 
     EXPECT_EQ (tree.size (), 0);
     EXPECT_TRUE (tree.empty ());
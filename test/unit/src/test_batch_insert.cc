@@ -0,0 +1,102 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <alex.rom23@mail.ru> wrote this file.  As long as you retain this notice you
+ * can do whatever you want with this stuff. If we meet some day, and you think
+ * this stuff is worth it, you can buy me a beer in return.   Alex Romanov
+ * ----------------------------------------------------------------------------
+ */
+
+#include "myset.hpp"
+#include "test_helpers.hpp"
+#include <gtest/gtest.h>
+#include <set>
+#include <vector>
+
+using test_helpers::check_tree;
+
+TEST (Test_batch_insert, TestIntoEmpty)
+{
+    rethinking_stl::set<int> tree;
+    std::vector<int> keys {1, 2, 3, 4, 5, 6, 7};
+
+    EXPECT_EQ (tree.insert_sorted_batch (keys.begin (), keys.end ()), 7);
+    check_tree (tree, {keys.begin (), keys.end ()});
+
+    EXPECT_EQ (tree.insert_sorted_batch (keys.end (), keys.end ()), 0);
+    check_tree (tree, {keys.begin (), keys.end ()});
+}
+
+TEST (Test_batch_insert, TestInterleaved)
+{
+    std::vector<int> evens, odds;
+    for ( int i = 0; i < 500; i++ )
+    {
+        evens.push_back (2 * i);
+        odds.push_back (2 * i + 1);
+    }
+
+    rethinking_stl::set<int> tree (evens.begin (), evens.end ());
+    EXPECT_EQ (tree.insert_sorted_batch (odds.begin (), odds.end ()), odds.size ());
+
+    std::set<int> expected (evens.begin (), evens.end ());
+    expected.insert (odds.begin (), odds.end ());
+    check_tree (tree, expected);
+
+    EXPECT_EQ (tree.os_select (1), 0);
+    EXPECT_EQ (tree.os_select (1000), 999);
+    EXPECT_EQ (tree.get_number_less_then (500), 500);
+}
+
+TEST (Test_batch_insert, TestDuplicatesKeepNodes)
+{
+    rethinking_stl::set<int> tree {10, 20, 30, 40, 50};
+    auto pos = tree.find (30);
+
+    std::vector<int> batch {5, 20, 30, 35, 60};
+    EXPECT_EQ (tree.insert_sorted_batch (batch.begin (), batch.end ()), 3);
+
+    check_tree (tree, {5, 10, 20, 30, 35, 40, 50, 60});
+    EXPECT_EQ (tree.find (30), pos);
+    EXPECT_EQ (*pos, 30);
+}
+
+TEST (Test_batch_insert, TestUnsortedBatch)
+{
+    rethinking_stl::set<int> tree {1, 5, 9};
+    std::vector<int> batch {8, 2, 8, 5, 0};
+
+    EXPECT_EQ (tree.insert_sorted_batch (batch.begin (), batch.end ()), 3);
+    check_tree (tree, {0, 1, 2, 5, 8, 9});
+}
+
+TEST (Test_batch_insert, TestRandomAgainstStd)
+{
+    test_helpers::lcg next (12345);
+
+    rethinking_stl::set<int> tree;
+    std::set<int> expected;
+
+    /* Batches both much smaller and much bigger then the tree. */
+    for ( std::size_t batch_size : {1, 3, 1000, 10, 5000, 2, 100, 20000, 7} )
+    {
+        std::set<int> batch;
+        while ( batch.size () < batch_size )
+            batch.insert (static_cast<int> (next (100000)));
+
+        auto old_size = expected.size ();
+        expected.insert (batch.begin (), batch.end ());
+
+        EXPECT_EQ (tree.insert_sorted_batch (batch.begin (), batch.end ()),
+                   expected.size () - old_size);
+        check_tree (tree, expected);
+
+        /* Tree stays usable for the ordinary operations. */
+        for ( int i = 0; i < 50; i++ )
+        {
+            auto key = static_cast<int> (next (100000));
+            EXPECT_EQ (tree.erase (key), expected.erase (key));
+        }
+        check_tree (tree, expected);
+    }
+}
@@ -0,0 +1,88 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <alex.rom23@mail.ru> wrote this file.  As long as you retain this notice you
+ * can do whatever you want with this stuff. If we meet some day, and you think
+ * this stuff is worth it, you can buy me a beer in return.   Alex Romanov
+ * ----------------------------------------------------------------------------
+ */
+
+#include "myset.hpp"
+#include "test_helpers.hpp"
+#include <gtest/gtest.h>
+#include <vector>
+
+using compact_set = typename rethinking_stl::set<int, std::less<int>, std::allocator<int>,
+                                                 rethinking_stl::compact_avl_tree_engine>;
+
+namespace
+{
+
+template <typename Set> void check_small ()
+{
+    Set set {10, 20, 30, 40, 50};
+
+    /* Unsorted with repeats, answers come back in the order of queries. */
+    std::vector<std::size_t> ranks {3, 1, 5, 3, 2};
+    std::vector<int> keys (ranks.size ());
+    set.os_select_batch (ranks, keys);
+    EXPECT_EQ (keys, (std::vector<int> {30, 10, 50, 30, 20}));
+
+    std::vector<int> queries {45, 10, 0, 60, 10, 11};
+    std::vector<std::size_t> answers (queries.size ());
+    set.rank_batch (queries, answers);
+    EXPECT_EQ (answers, (std::vector<std::size_t> {4, 0, 0, 5, 0, 1}));
+
+    std::vector<std::size_t> bad_ranks {1, 6};
+    std::vector<int> untouched {-1, -1};
+    EXPECT_THROW (set.os_select_batch (bad_ranks, untouched), std::out_of_range);
+    EXPECT_EQ (untouched, (std::vector<int> {-1, -1}));
+
+    std::vector<int> short_keys (1);
+    EXPECT_THROW (set.os_select_batch (ranks, short_keys), std::invalid_argument);
+    EXPECT_THROW (set.rank_batch (queries, ranks), std::invalid_argument);
+
+    Set empty;
+    empty.os_select_batch ({}, {});
+    empty.rank_batch (queries, answers);
+    EXPECT_EQ (answers, std::vector<std::size_t> (queries.size (), 0));
+}
+
+template <typename Set> void check_random ()
+{
+    test_helpers::lcg next (4242);
+
+    Set set;
+    for ( int i = 0; i < 3000; i++ )
+        set.insert (static_cast<int> (next (10000)));
+
+    std::vector<std::size_t> ranks;
+    std::vector<int> queries;
+    for ( int i = 0; i < 2000; i++ )
+    {
+        ranks.push_back (next (10000) % set.size () + 1);
+        queries.push_back (static_cast<int> (next (10000)));
+    }
+
+    std::vector<int> keys (ranks.size ());
+    set.os_select_batch (ranks, keys);
+
+    std::vector<std::size_t> answers (queries.size ());
+    set.rank_batch (queries, answers);
+
+    for ( std::size_t i = 0; i < ranks.size (); i++ )
+    {
+        EXPECT_EQ (keys[i], set.os_select (ranks[i]));
+        EXPECT_EQ (answers[i], set.get_number_less_then (queries[i]));
+    }
+}
+
+}   // namespace
+
+TEST (Test_batch_queries, TestSmall) { check_small<rethinking_stl::set<int>> (); }
+
+TEST (Test_batch_queries, TestRandom) { check_random<rethinking_stl::set<int>> (); }
+
+TEST (Test_batch_queries, TestCompactSmall) { check_small<compact_set> (); }
+
+TEST (Test_batch_queries, TestCompactRandom) { check_random<compact_set> (); }
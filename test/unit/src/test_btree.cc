@@ -0,0 +1,234 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <alex.rom23@mail.ru> wrote this file.  As long as you retain this notice you
+ * can do whatever you want with this stuff. If we meet some day, and you think
+ * this stuff is worth it, you can buy me a beer in return.   Alex Romanov
+ * ----------------------------------------------------------------------------
+ */
+
+#include "myset.hpp"
+#include "test_helpers.hpp"
+#include <gtest/gtest.h>
+#include <cstddef>
+#include <functional>
+#include <set>
+#include <string>
+#include <vector>
+
+using btree_set = typename rethinking_stl::set<int, std::less<int>, std::allocator<int>,
+                                               rethinking_stl::btree_engine>;
+
+/* Check sizes, separators, occupancy and depth of the subtree, return its size. */
+template <typename Tree_>
+std::size_t check_btree_node (const Tree_ &tree, typename Tree_::node_index_ node,
+                              std::size_t height, bool root,
+                              std::vector<typename Tree_::node_index_> &leaves)
+{
+    auto &less = tree.m_compare_struct_.m_key_compare_;
+
+    if ( !height )
+    {
+        auto leaf = tree.m_leaf_ (node);
+        EXPECT_TRUE (root || leaf->m_count_ >= Tree_::s_min_leaf_);
+        EXPECT_EQ (std::adjacent_find (leaf->m_keys_.begin (),
+                                       leaf->m_keys_.begin () + leaf->m_count_,
+                                       [&less] (auto &a, auto &b) { return !less (a, b); }),
+                   leaf->m_keys_.begin () + leaf->m_count_);
+        leaves.push_back (node);
+        return leaf->m_count_;
+    }
+
+    auto inner = tree.m_inner_ (node);
+    EXPECT_TRUE (root ? inner->m_count_ >= 2 : inner->m_count_ >= Tree_::s_min_inner_);
+
+    std::size_t total = 0;
+    for ( std::uint32_t c = 0; c < inner->m_count_; c++ )
+    {
+        std::vector<typename Tree_::node_index_> sub;
+        auto size = check_btree_node (tree, inner->m_children_[c], height - 1, false, sub);
+        EXPECT_EQ (inner->m_sizes_[c], size);
+        total += size;
+
+        /* Keys of child c are in [m_keys_[c - 1], m_keys_[c]). */
+        auto first = tree.m_leaf_ (sub.front ());
+        auto last  = tree.m_leaf_ (sub.back ());
+        if ( c )
+        {
+            EXPECT_FALSE (less (first->m_keys_[0], inner->m_keys_[c - 1]));
+        }
+        if ( c + 1 < inner->m_count_ )
+        {
+            EXPECT_TRUE (less (last->m_keys_[last->m_count_ - 1], inner->m_keys_[c]));
+        }
+        leaves.insert (leaves.end (), sub.begin (), sub.end ());
+    }
+    for ( std::uint32_t c = inner->m_count_; c < Tree_::s_fanout_; c++ )
+    {
+        EXPECT_EQ (inner->m_sizes_[c], 0);
+        EXPECT_EQ (inner->m_children_[c], Tree_::s_null_);
+    }
+
+    return total;
+}
+
+template <typename Tree_> void check_btree (const Tree_ &tree)
+{
+    if ( !tree.m_root_ )
+    {
+        EXPECT_EQ (tree.size (), 0);
+        EXPECT_EQ (tree.begin (), tree.end ());
+        return;
+    }
+
+    std::vector<typename Tree_::node_index_> leaves;
+    EXPECT_EQ (check_btree_node (tree, tree.m_root_, tree.m_height_, true, leaves), tree.size ());
+
+    /* Leaves are linked in order both ways. */
+    EXPECT_EQ (tree.m_first_, leaves.front ());
+    EXPECT_EQ (tree.m_last_, leaves.back ());
+    for ( std::size_t i = 0; i < leaves.size (); i++ )
+    {
+        auto leaf = tree.m_leaf_ (leaves[i]);
+        EXPECT_EQ (leaf->m_prev_, i ? leaves[i - 1] : Tree_::s_null_);
+        EXPECT_EQ (leaf->m_next_, i + 1 < leaves.size () ? leaves[i + 1] : Tree_::s_null_);
+    }
+}
+
+TEST (Test_btree, TestSmall)
+{
+    btree_set tree {30, 10, 50, 20, 40, 10};
+
+    EXPECT_EQ (tree.size (), 5);
+    EXPECT_FALSE (tree.insert (20).second);
+    EXPECT_TRUE (tree.insert (25).second);
+    EXPECT_EQ (tree.os_select (3), 25);
+    EXPECT_THROW (tree.os_select (0), std::out_of_range);
+    EXPECT_THROW (tree.os_select (7), std::out_of_range);
+
+    EXPECT_EQ (tree.get_number_less_then (5), 0);
+    EXPECT_EQ (tree.get_number_less_then (30), 3);
+    EXPECT_EQ (tree.get_number_less_then (99), 6);
+    EXPECT_EQ (tree.count_in_range (20, 40), 4);
+    EXPECT_EQ (tree.select_from (21, 2), 30);
+
+    EXPECT_EQ (*tree.lower_bound (20), 20);
+    EXPECT_EQ (*tree.upper_bound (20), 25);
+    EXPECT_EQ (tree.upper_bound (50), tree.end ());
+    EXPECT_EQ (*--tree.end (), 50);
+    EXPECT_EQ (*tree.rbegin (), 50);
+
+    EXPECT_EQ (tree.erase (25), 1);
+    EXPECT_EQ (tree.erase (25), 0);
+    EXPECT_EQ (tree, btree_set ({10, 20, 30, 40, 50}));
+    check_btree (tree);
+}
+
+TEST (Test_btree, TestNodeLayout)
+{
+    /* A leaf is one cache line, an inner node has its keys, sizes and children in one line
+     * each, so a lookup touches two lines per level. */
+    using leaf_node  = btree_set::leaf_node_;
+    using inner_node = btree_set::inner_node_;
+    static_assert (alignof (leaf_node) == 64 && sizeof (leaf_node) == 64);
+    static_assert (alignof (inner_node) == 64 && sizeof (inner_node) == 192);
+    static_assert (offsetof (inner_node, m_count_) == 60);
+    static_assert (offsetof (inner_node, m_sizes_) == 64);
+    static_assert (offsetof (inner_node, m_children_) == 128);
+    static_assert (btree_set::s_fanout_ == 16);
+}
+
+TEST (Test_btree, TestRandomAgainstStdSet)
+{
+    btree_set tree;
+    std::set<int> expected;
+
+    test_helpers::lcg next (7);
+
+    /* Grow the tree a few levels high, then shrink it back to nothing. */
+    for ( int phase = 0; phase < 2; phase++ )
+    {
+        for ( int i = 0; i < 60000; i++ )
+        {
+            auto key = static_cast<int> (next (100000));
+            if ( next (4) < (phase ? 1u : 3u) )
+                EXPECT_EQ (tree.insert (key).second, expected.insert (key).second);
+            else
+                EXPECT_EQ (tree.erase (key), expected.erase (key));
+
+            if ( i % 4096 == 0 )
+                check_btree (tree);
+        }
+
+        ASSERT_EQ (tree.size (), expected.size ());
+        EXPECT_TRUE (std::equal (expected.begin (), expected.end (), tree.begin ()));
+        EXPECT_TRUE (std::equal (expected.rbegin (), expected.rend (), tree.rbegin ()));
+
+        std::size_t rank = 1;
+        for ( auto key : expected )
+        {
+            if ( rank % 13 == 0 )
+            {
+                EXPECT_EQ (tree.os_select (rank), key);
+                EXPECT_EQ (tree.get_number_less_then (key), rank - 1);
+                auto after = std::distance (expected.upper_bound (key + 1), expected.end ());
+                EXPECT_EQ (tree.count_less_equal (key + 1), expected.size () - after);
+            }
+            rank++;
+        }
+    }
+    check_btree (tree);
+
+    for ( auto key : std::vector<int> (expected.begin (), expected.end ()) )
+        EXPECT_EQ (tree.erase (key), 1);
+    EXPECT_TRUE (tree.empty ());
+    check_btree (tree);
+}
+
+TEST (Test_btree, TestBuildFromRange)
+{
+    for ( int n : {0, 1, 15, 16, 17, 255, 256, 257, 5000} )
+    {
+        std::vector<int> keys;
+        for ( int i = n - 1; i >= 0; i-- )
+            keys.push_back (i * 3);
+
+        btree_set tree (keys.begin (), keys.end ());
+        ASSERT_EQ (tree.size (), n);
+        check_btree (tree);
+
+        for ( int i = 0; i < n; i++ )
+        {
+            EXPECT_EQ (tree.os_select (i + 1), i * 3);
+            EXPECT_EQ (tree.rank (i * 3 + 1), i + 1);
+            EXPECT_EQ (*tree.find (i * 3), i * 3);
+        }
+
+        tree.insert (-1);
+        tree.erase (0);
+        check_btree (tree);
+    }
+}
+
+TEST (Test_btree, TestComparatorAndStrings)
+{
+    rethinking_stl::set<std::string, std::greater<std::string>, std::allocator<std::string>,
+                        rethinking_stl::btree_engine>
+        tree;
+
+    for ( int i = 0; i < 1000; i++ )
+        tree.insert (std::to_string (i));
+    for ( int i = 0; i < 1000; i += 2 )
+        tree.erase (std::to_string (i));
+    check_btree (tree);
+
+    EXPECT_EQ (tree.size (), 500);
+    EXPECT_EQ (tree.os_select (1), "999");
+    EXPECT_EQ (tree.rank ("99"), 5);
+    EXPECT_EQ (*tree.lower_bound ("990"), "99");
+    EXPECT_EQ (tree.freeze ().os_select (500), "1");
+
+    auto moved = std::move (tree);
+    EXPECT_TRUE (tree.empty ());
+    EXPECT_EQ (moved.size (), 500);
+}
@@ -0,0 +1,169 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <alex.rom23@mail.ru> wrote this file.  As long as you retain this notice you
+ * can do whatever you want with this stuff. If we meet some day, and you think
+ * this stuff is worth it, you can buy me a beer in return.   Alex Romanov
+ * ----------------------------------------------------------------------------
+ */
+
+#include "myset.hpp"
+#include "test_helpers.hpp"
+#include <gtest/gtest.h>
+#include <list>
+#include <sstream>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+using test_helpers::check_subtree;
+
+using compact_set = typename rethinking_stl::set<int, std::less<int>, std::allocator<int>,
+                                                 rethinking_stl::compact_avl_tree_engine>;
+
+namespace
+{
+
+// Key which throws from the copy constructor once the budget of copies runs out.
+struct throwing_key
+{
+    static inline int live        = 0;
+    static inline int copies_left = -1;
+
+    int value;
+
+    throwing_key (int value_ = 0) : value (value_) { live++; }
+
+    throwing_key (const throwing_key &other) : value (other.value)
+    {
+        if ( copies_left == 0 )
+            throw std::runtime_error ("No more copies.");
+        if ( copies_left > 0 )
+            copies_left--;
+        live++;
+    }
+
+    throwing_key &operator= (const throwing_key &other) = default;
+
+    ~throwing_key () { live--; }
+
+    bool operator< (const throwing_key &other) const { return value < other.value; }
+};
+
+template <typename Set> void check_build_throws ()
+{
+    {
+        std::vector<throwing_key> keys;
+        for ( int i = 0; i < 100; i++ )
+            keys.emplace_back (i);
+
+        throwing_key::copies_left = 50;
+        EXPECT_THROW (Set (keys.begin (), keys.end ()), std::runtime_error);
+        throwing_key::copies_left = -1;
+
+        /* Only the keys of the vector are left. */
+        EXPECT_EQ (throwing_key::live, 100);
+    }
+    EXPECT_EQ (throwing_key::live, 0);
+}
+
+}   // namespace
+
+TEST (Test_bulk_build, TestSortedRange)
+{
+    std::vector<int> keys;
+    for ( int i = 0; i < 1000; i++ )
+        keys.push_back (2 * i);
+
+    rethinking_stl::set<int> tree (keys.begin (), keys.end ());
+
+    EXPECT_EQ (tree.size (), keys.size ());
+    EXPECT_TRUE (std::equal (keys.begin (), keys.end (), tree.begin ()));
+    EXPECT_EQ (*tree.begin (), 0);
+    EXPECT_EQ (*std::prev (tree.end ()), 1998);
+    EXPECT_EQ (tree.os_select (500), 998);
+    EXPECT_EQ (tree.get_number_less_then (999), 500);
+
+    auto header = tree.m_header_struct_.m_header_.get ();
+    EXPECT_EQ (check_subtree (header->m_left_, header), 10);
+}
+
+TEST (Test_bulk_build, TestUnsortedWithDuplicates)
+{
+    std::list<int> keys {5, 3, 9, 3, 1, 5, 7, 9, 1};
+
+    rethinking_stl::set<int> tree (keys.begin (), keys.end ());
+    std::vector<int> expected {1, 3, 5, 7, 9};
+
+    EXPECT_EQ (tree.size (), expected.size ());
+    EXPECT_TRUE (std::equal (expected.begin (), expected.end (), tree.begin ()));
+
+    auto header = tree.m_header_struct_.m_header_.get ();
+    check_subtree (header->m_left_, header);
+}
+
+TEST (Test_bulk_build, TestInputIterators)
+{
+    std::istringstream ss {"4 2 8 6 2"};
+    rethinking_stl::set<int> tree (std::istream_iterator<int> {ss}, std::istream_iterator<int> {});
+
+    EXPECT_EQ (tree.size (), 4);
+    EXPECT_EQ (tree.os_select (1), 2);
+    EXPECT_EQ (tree.os_select (4), 8);
+}
+
+TEST (Test_bulk_build, TestAssignThenModify)
+{
+    rethinking_stl::set<int> tree {1, 2, 3};
+
+    std::vector<int> keys;
+    for ( int i = 100; i > 0; i-- )
+        keys.push_back (i);
+    tree.assign (keys.begin (), keys.end ());
+
+    EXPECT_EQ (tree.size (), 100);
+    for ( int i = 101; i <= 200; i++ )
+        tree.insert (i);
+    for ( int i = 1; i <= 200; i += 2 )
+        tree.erase (i);
+
+    EXPECT_EQ (tree.size (), 100);
+    EXPECT_EQ (tree.os_select (1), 2);
+    EXPECT_EQ (*std::prev (tree.end ()), 200);
+
+    auto header = tree.m_header_struct_.m_header_.get ();
+    check_subtree (header->m_left_, header);
+}
+
+TEST (Test_bulk_build, TestCompact)
+{
+    std::vector<int> keys {9, 1, 5, 3, 7, 5};
+    compact_set set (keys.begin (), keys.end ());
+
+    EXPECT_EQ (set.size (), 5);
+    EXPECT_EQ (set.os_select (3), 5);
+    EXPECT_EQ (set.get_number_less_then (8), 4);
+
+    set.insert (4);
+    set.erase (9);
+    EXPECT_EQ (set.os_select (5), 7);
+
+    compact_set empty (keys.end (), keys.end ());
+    EXPECT_TRUE (empty.empty ());
+}
+
+TEST (Test_bulk_build, TestThrowingKeyCopy)
+{
+    check_build_throws<rethinking_stl::set<throwing_key>> ();
+    check_build_throws<rethinking_stl::set<throwing_key, std::less<throwing_key>,
+                                           std::allocator<throwing_key>,
+                                           rethinking_stl::compact_avl_tree_engine>> ();
+}
+
+TEST (Test_bulk_build, TestRangeConstructorTakesIterators)
+{
+    /* Two ints are a key and a comparator, not a range. */
+    static_assert (!std::is_constructible_v<rethinking_stl::set<int>, int, int>);
+    static_assert (!std::is_constructible_v<compact_set, int, int>);
+    static_assert (std::is_constructible_v<rethinking_stl::set<int>, int *, int *>);
+}
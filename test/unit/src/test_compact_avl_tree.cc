@@ -0,0 +1,141 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <alex.rom23@mail.ru> wrote this file.  As long as you retain this notice you
+ * can do whatever you want with this stuff. If we meet some day, and you think
+ * this stuff is worth it, you can buy me a beer in return.   Alex Romanov
+ * ----------------------------------------------------------------------------
+ */
+
+#include "myset.hpp"
+#include "test_helpers.hpp"
+#include <gtest/gtest.h>
+#include <set>
+#include <vector>
+
+using compact_set = typename rethinking_stl::set<int, std::less<int>, std::allocator<int>,
+                                                 rethinking_stl::compact_avl_tree_engine>;
+
+TEST (Test_compact_set, TestNodeSize)
+{
+    EXPECT_EQ (sizeof (rethinking_stl::compact_avl_tree_node_<int>), 16);
+}
+
+TEST (Test_compact_set, TestInsert)
+{
+    compact_set set;
+    std::vector<int> v {10, 9, 8, 7, 6, 5, 4, 3, 2, 1};
+
+    for ( auto &i : v )
+        set.insert (i);
+
+    EXPECT_EQ (set.size (), v.size ());
+
+    for ( auto &i : set )
+    {
+        EXPECT_EQ (i, v.back ());
+        v.pop_back ();
+    }
+}
+
+TEST (Test_compact_set, TestDoubleInsert)
+{
+    compact_set set;
+    for ( int i = 0; i < 10; i++ )
+        set.insert (i);
+
+    for ( int i = 0; i < 10; i++ )
+    {
+        auto [pos, inserted] = set.insert (i);
+        EXPECT_FALSE (inserted);
+        EXPECT_EQ (*pos, i);
+        EXPECT_EQ (set.size (), 10);
+    }
+}
+
+TEST (Test_compact_set, TestEraseReusesSlots)
+{
+    compact_set set;
+    for ( int i = 0; i < 100; i++ )
+        set.insert (i);
+
+    auto capacity = set.capacity ();
+    for ( int i = 0; i < 100; i += 2 )
+        set.erase (i);
+    for ( int i = 1000; i < 1050; i++ )
+        set.insert (i);
+
+    EXPECT_EQ (set.size (), 100);
+    EXPECT_EQ (set.capacity (), capacity);
+    EXPECT_EQ (set.erase (0), 0);
+    EXPECT_EQ (set.erase (1), 1);
+}
+
+TEST (Test_compact_set, Test_select_and_number_less_then)
+{
+    compact_set set;
+
+    for ( int i = 1; i <= 10; i++ )
+        set.insert (i);
+
+    set.erase (1);
+    set.erase (7);
+    set.erase (4);
+
+    EXPECT_EQ (set.os_select (1), 2);
+    EXPECT_EQ (set.os_select (4), 6);
+    EXPECT_EQ (set.os_select (7), 10);
+    EXPECT_THROW (set.os_select (0), std::out_of_range);
+    EXPECT_THROW (set.os_select (8), std::out_of_range);
+
+    EXPECT_EQ (set.get_number_less_then (11), 7);
+    EXPECT_EQ (set.get_number_less_then (4), 2);
+    EXPECT_EQ (set.get_number_less_then (-4), 0);
+}
+
+TEST (Test_compact_set, TestIterators)
+{
+    compact_set set;
+
+    for ( int i = 1; i <= 10; i++ )
+        set.insert (i);
+
+    set.erase (7);
+
+    EXPECT_EQ (*(--set.find (8)), 6);
+    EXPECT_EQ (*(++set.find (6)), 8);
+    EXPECT_EQ (*(--set.end ()), 10);
+    EXPECT_EQ (set.find (7), set.end ());
+    EXPECT_EQ (*set.lower_bound (7), 8);
+    EXPECT_EQ (*set.upper_bound (8), 9);
+}
+
+TEST (Test_compact_set, TestRandomAgainstStd)
+{
+    compact_set set;
+    std::set<int> ref;
+
+    test_helpers::lcg random (1);
+    for ( int i = 0; i < 20000; i++ )
+    {
+        auto state = random.step ();
+        int key    = (state >> 8) % 1000;
+        if ( (state >> 20) & 1 )
+        {
+            if ( ref.insert (key).second )
+                set.insert (key);
+        }
+        else if ( ref.erase (key) )
+            set.erase (key);
+    }
+
+    ASSERT_EQ (set.size (), ref.size ());
+    EXPECT_TRUE (std::equal (ref.begin (), ref.end (), set.begin ()));
+
+    std::size_t rank = 0;
+    for ( auto key : ref )
+    {
+        EXPECT_EQ (set.get_number_less_then (key), rank);
+        EXPECT_EQ (set.os_select (++rank), key);
+    }
+}
@@ -0,0 +1,151 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <alex.rom23@mail.ru> wrote this file.  As long as you retain this notice you
+ * can do whatever you want with this stuff. If we meet some day, and you think
+ * this stuff is worth it, you can buy me a beer in return.   Alex Romanov
+ * ----------------------------------------------------------------------------
+ */
+
+#include "concurrent_set.hpp"
+#include "test_helpers.hpp"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+using concurrent_set = rethinking_stl::concurrent_order_statistic_set<int>;
+
+TEST (Test_concurrent_set, TestSmall)
+{
+    concurrent_set set {30, 10, 50, 20, 40, 10};
+
+    EXPECT_EQ (set.size (), 5);
+    EXPECT_FALSE (set.insert (20));
+    EXPECT_TRUE (set.insert (25));
+    EXPECT_EQ (set.os_select (3), 25);
+    EXPECT_THROW (set.os_select (0), std::out_of_range);
+    EXPECT_THROW (set.os_select (7), std::out_of_range);
+    EXPECT_EQ (set.get_number_less_then (30), 3);
+    EXPECT_TRUE (set.contains (40));
+    EXPECT_FALSE (set.contains (45));
+
+    auto view = set.read ();
+    EXPECT_EQ (set.erase (25), 1);
+    EXPECT_EQ (set.erase (25), 0);
+
+    /* The view still sees the version it was taken of. */
+    EXPECT_EQ (std::vector<int> (view.begin (), view.end ()),
+               std::vector<int> ({10, 20, 25, 30, 40, 50}));
+    EXPECT_EQ (*view.lower_bound (21), 25);
+    EXPECT_EQ (*view.find (50), 50);
+    EXPECT_EQ (view.find (51), view.end ());
+    EXPECT_EQ (view.count_less_equal (25), 3);
+    EXPECT_EQ (set.read ().size (), 5);
+}
+
+TEST (Test_concurrent_set, TestRandomAgainstStdSet)
+{
+    rethinking_stl::concurrent_order_statistic_set<std::string, std::greater<std::string>> set;
+    std::set<std::string, std::greater<std::string>> expected;
+
+    test_helpers::lcg next (5);
+
+    for ( int i = 0; i < 20000; i++ )
+    {
+        auto key = std::to_string (next (3000));
+        if ( next (3) )
+            EXPECT_EQ (set.insert (key), expected.insert (key).second);
+        else
+            EXPECT_EQ (set.erase (key), expected.erase (key));
+    }
+
+    auto view = set.read ();
+    ASSERT_EQ (view.size (), expected.size ());
+    EXPECT_TRUE (std::equal (expected.begin (), expected.end (), view.begin (), view.end ()));
+
+    std::size_t rank = 1;
+    for ( auto &key : expected )
+    {
+        EXPECT_EQ (view.os_select (rank), key);
+        EXPECT_EQ (view.rank (key), rank - 1);
+        rank++;
+    }
+}
+
+TEST (Test_concurrent_set, TestReadersDuringUpdates)
+{
+    concurrent_set set;
+    constexpr int range = 4096;
+
+    /* The writer keeps only even keys, so every version is easy to check. */
+    std::atomic<bool> done {false};
+    std::thread writer ([&set, &done] {
+        test_helpers::lcg next (3);
+        for ( int i = 0; i < 100000; i++ )
+        {
+            int key = 2 * static_cast<int> (next (range / 2));
+            if ( i % 3 )
+                set.insert (key);
+            else
+                set.erase (key);
+        }
+        done = true;
+    });
+
+    std::vector<std::thread> readers;
+    std::atomic<int> failures {0};
+    for ( int r = 0; r < 4; r++ )
+        readers.emplace_back ([&set, &done, &failures] {
+            do
+            {
+                auto view = set.read ();
+                std::vector<int> keys (view.begin (), view.end ());
+
+                bool ok = keys.size () == view.size ();
+                for ( std::size_t i = 0; ok && i < keys.size (); i++ )
+                    ok = keys[i] % 2 == 0 && (!i || keys[i - 1] < keys[i]);
+                for ( std::size_t i = 0; ok && i < keys.size (); i += 97 )
+                    ok = view.os_select (i + 1) == keys[i] && view.rank (keys[i]) == i &&
+                         view.contains (keys[i]) && !view.contains (keys[i] + 1);
+
+                /* Nothing changes under the view. */
+                ok = ok && std::equal (keys.begin (), keys.end (), view.begin (), view.end ());
+                if ( !ok )
+                    failures++;
+            } while ( !done );
+        });
+
+    writer.join ();
+    for ( auto &reader : readers )
+        reader.join ();
+
+    EXPECT_EQ (failures, 0);
+    set.reclaim ();
+    EXPECT_EQ (set.retired (), 0);
+}
+
+TEST (Test_concurrent_set, TestViewHoldsNodes)
+{
+    concurrent_set set;
+    for ( int i = 0; i < 1000; i++ )
+        set.insert (i);
+
+    {
+        auto view = set.read ();
+        for ( int i = 0; i < 1000; i++ )
+            set.erase (i);
+
+        /* Nodes of the version the view sees are all retired and kept. */
+        EXPECT_GE (set.retired (), 1000);
+        EXPECT_EQ (view.size (), 1000);
+        EXPECT_EQ (view.os_select (1000), 999);
+    }
+
+    for ( int i = 0; i < 1000; i++ )
+        set.insert (i);
+    EXPECT_LT (set.retired (), 256);
+    EXPECT_EQ (set.size (), 1000);
+}
@@ -0,0 +1,106 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <alex.rom23@mail.ru> wrote this file.  As long as you retain this notice you
+ * can do whatever you want with this stuff. If we meet some day, and you think
+ * this stuff is worth it, you can buy me a beer in return.   Alex Romanov
+ * ----------------------------------------------------------------------------
+ */
+
+#include "myset.hpp"
+#include "test_helpers.hpp"
+#include <gtest/gtest.h>
+#include <functional>
+#include <set>
+#include <string>
+#include <type_traits>
+
+using compact_set = typename rethinking_stl::set<int, std::less<int>, std::allocator<int>,
+                                                 rethinking_stl::compact_avl_tree_engine>;
+
+TEST (Test_frozen_set, TestSmall)
+{
+    rethinking_stl::frozen_order_statistic_set<int> frozen {30, 10, 50, 20, 40, 10};
+
+    EXPECT_EQ (frozen.size (), 5);
+    EXPECT_TRUE (std::is_sorted (frozen.begin (), frozen.end ()));
+
+    EXPECT_EQ (frozen.os_select (1), 10);
+    EXPECT_EQ (frozen.os_select (5), 50);
+    EXPECT_THROW (frozen.os_select (0), std::out_of_range);
+    EXPECT_THROW (frozen.os_select (6), std::out_of_range);
+
+    EXPECT_EQ (frozen.get_number_less_then (5), 0);
+    EXPECT_EQ (frozen.get_number_less_then (10), 0);
+    EXPECT_EQ (frozen.get_number_less_then (35), 3);
+    EXPECT_EQ (frozen.get_number_less_then (99), 5);
+    EXPECT_EQ (frozen.count_less_equal (50), 5);
+    EXPECT_EQ (frozen.count_in_range (20, 40), 3);
+    EXPECT_EQ (frozen.select_from (21, 2), 40);
+
+    EXPECT_EQ (*frozen.lower_bound (20), 20);
+    EXPECT_EQ (*frozen.upper_bound (20), 30);
+    EXPECT_EQ (frozen.upper_bound (50), frozen.end ());
+    EXPECT_TRUE (frozen.contains (40));
+    EXPECT_FALSE (frozen.contains (41));
+    EXPECT_EQ (frozen.find (0), frozen.end ());
+}
+
+TEST (Test_frozen_set, TestEmpty)
+{
+    rethinking_stl::frozen_order_statistic_set<int> frozen;
+
+    EXPECT_TRUE (frozen.empty ());
+    EXPECT_EQ (frozen.rank (1), 0);
+    EXPECT_EQ (frozen.find (1), frozen.end ());
+    EXPECT_THROW (frozen.os_select (1), std::out_of_range);
+
+    /* Two keys are not a range. */
+    using frozen_set = rethinking_stl::frozen_order_statistic_set<int>;
+    static_assert (!std::is_constructible_v<frozen_set, int, int>);
+    static_assert (std::is_constructible_v<frozen_set, int *, int *>);
+}
+
+TEST (Test_frozen_set, TestFreezeAgainstTree)
+{
+    rethinking_stl::set<int> tree;
+    compact_set compact;
+    std::set<int> expected;
+
+    test_helpers::lcg next (99);
+
+    /* All sizes from 0 to a few full levels of the layout. */
+    for ( int i = 0; i < 300; i++ )
+    {
+        auto frozen = tree.freeze ();
+        ASSERT_EQ (frozen.size (), expected.size ());
+        EXPECT_TRUE (std::equal (expected.begin (), expected.end (), frozen.begin ()));
+        EXPECT_EQ (compact.freeze (), frozen);
+
+        for ( int j = 0; j < 20; j++ )
+        {
+            auto key = static_cast<int> (next (20000));
+            EXPECT_EQ (frozen.rank (key), tree.rank (key));
+            EXPECT_EQ (frozen.count_less_equal (key), tree.count_less_equal (key));
+            EXPECT_EQ (frozen.contains (key), expected.count (key) == 1);
+        }
+        for ( std::size_t r = 1; r <= frozen.size (); r += 7 )
+            EXPECT_EQ (frozen.os_select (r), tree.os_select (r));
+
+        auto key = static_cast<int> (next (20000));
+        tree.insert (key);
+        compact.insert (key);
+        expected.insert (key);
+    }
+}
+
+TEST (Test_frozen_set, TestComparatorAndStrings)
+{
+    rethinking_stl::frozen_order_statistic_set<std::string, std::greater<std::string>> frozen {
+        "b", "d", "a", "c"};
+
+    EXPECT_EQ (frozen.os_select (1), "d");
+    EXPECT_EQ (frozen.rank ("c"), 1);
+    EXPECT_EQ (frozen.rank ("bb"), 2);
+    EXPECT_EQ (*frozen.lower_bound ("bb"), "b");
+}
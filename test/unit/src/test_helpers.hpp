@@ -0,0 +1,75 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <alex.rom23@mail.ru> wrote this file.  As long as you retain this notice you
+ * can do whatever you want with this stuff. If we meet some day, and you think
+ * this stuff is worth it, you can buy me a beer in return.   Alex Romanov
+ * ----------------------------------------------------------------------------
+ */
+
+// helpers shared by the unit tests
+
+#pragma once
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cstdlib>
+#include <iterator>
+#include <set>
+
+namespace test_helpers
+{
+
+// Linear congruential generator, so every run of a test sees the same keys.
+class lcg
+{
+    unsigned state;
+
+  public:
+    explicit lcg (unsigned seed) : state (seed) {}
+
+    // Next raw state, for the tests which take several values out of one step.
+    unsigned step ()
+    {
+        state = state * 1103515245 + 12345;
+        return state;
+    }
+
+    // Next number in [0, mod).
+    unsigned operator() (unsigned mod) { return (step () >> 8) % mod; }
+};
+
+// Check sizes, balance factors and parent links of the pointer based AVL tree. Return height
+// of subtree.
+template <typename Node> int check_subtree (Node *node, Node *parent)
+{
+    if ( !node )
+        return 0;
+
+    EXPECT_EQ (node->m_parent_, parent);
+
+    auto left_height  = check_subtree (node->m_left_, node);
+    auto right_height = check_subtree (node->m_right_, node);
+
+    EXPECT_EQ (node->m_bf_, right_height - left_height);
+    EXPECT_LE (std::abs (node->m_bf_), 1);
+    EXPECT_EQ (node->m_size_, Node::size (node->m_left_) + Node::size (node->m_right_) + 1);
+
+    return std::max (left_height, right_height) + 1;
+}
+
+// Check the structure of the tree and that it keeps the expected keys in both directions.
+template <typename Tree, typename Keys = std::set<int>>
+void check_tree (const Tree &tree, const Keys &expected)
+{
+    auto header = tree.m_header_struct_.m_header_.get ();
+    check_subtree (header->m_left_, header);
+
+    EXPECT_EQ (tree.size (), expected.size ());
+    EXPECT_TRUE (std::equal (expected.begin (), expected.end (), tree.begin (), tree.end ()));
+    EXPECT_TRUE (std::equal (expected.rbegin (), expected.rend (),
+                             std::make_reverse_iterator (tree.end ()),
+                             std::make_reverse_iterator (tree.begin ())));
+}
+
+}   // namespace test_helpers
@@ -0,0 +1,109 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <alex.rom23@mail.ru> wrote this file.  As long as you retain this notice you
+ * can do whatever you want with this stuff. If we meet some day, and you think
+ * this stuff is worth it, you can buy me a beer in return.   Alex Romanov
+ * ----------------------------------------------------------------------------
+ */
+
+#include "myset.hpp"
+#include "test_helpers.hpp"
+#include <gtest/gtest.h>
+#include <vector>
+
+namespace
+{
+
+using tree_type = rethinking_stl::set<int>;
+
+template <std::size_t Group> void check_against_single (tree_type &tree, unsigned seed)
+{
+    test_helpers::lcg next (seed);
+
+    std::vector<int> keys;
+    std::vector<std::size_t> ranks;
+    for ( int i = 0; i < 777; i++ )
+    {
+        keys.push_back (static_cast<int> (next (5000)));
+        ranks.push_back (next (5000) % tree.size () + 1);
+    }
+
+    std::vector<tree_type::iterator> bounds (keys.size ()), found (keys.size ());
+    std::vector<std::size_t> key_ranks (keys.size ());
+    std::vector<int> selected (ranks.size ());
+
+    tree.lower_bound_interleaved<Group> (keys, bounds);
+    tree.find_interleaved<Group> (keys, found);
+    tree.rank_interleaved<Group> (keys, key_ranks);
+    tree.os_select_interleaved<Group> (ranks, selected);
+
+    for ( std::size_t i = 0; i < keys.size (); i++ )
+    {
+        EXPECT_EQ (bounds[i], tree.lower_bound (keys[i]));
+        EXPECT_EQ (found[i], tree.find (keys[i]));
+        EXPECT_EQ (key_ranks[i], tree.rank (keys[i]));
+        EXPECT_EQ (selected[i], tree.os_select (ranks[i]));
+    }
+}
+
+}   // namespace
+
+TEST (Test_interleaved, TestSmall)
+{
+    tree_type tree {10, 20, 30};
+
+    std::vector<int> keys {25, 10, 31, 5};
+    std::vector<tree_type::iterator> positions (keys.size ());
+
+    tree.lower_bound_interleaved<2> (keys, positions);
+    EXPECT_EQ (*positions[0], 30);
+    EXPECT_EQ (*positions[1], 10);
+    EXPECT_EQ (positions[2], tree.end ());
+    EXPECT_EQ (*positions[3], 10);
+
+    tree.find_interleaved<2> (keys, positions);
+    EXPECT_EQ (positions[0], tree.end ());
+    EXPECT_EQ (*positions[1], 10);
+    EXPECT_EQ (positions[2], tree.end ());
+    EXPECT_EQ (positions[3], tree.end ());
+
+    std::vector<std::size_t> ranks {3, 1};
+    std::vector<int> selected (2);
+    tree.os_select_interleaved (ranks, selected);
+    EXPECT_EQ (selected, (std::vector<int> {30, 10}));
+
+    ranks[0] = 4;
+    EXPECT_THROW (tree.os_select_interleaved (ranks, selected), std::out_of_range);
+    EXPECT_THROW (tree.rank_interleaved (keys, ranks), std::invalid_argument);
+}
+
+TEST (Test_interleaved, TestEmpty)
+{
+    tree_type tree;
+
+    std::vector<int> keys {1, 2};
+    std::vector<tree_type::iterator> positions (keys.size ());
+    std::vector<std::size_t> ranks {7, 7};
+
+    tree.find_interleaved (keys, positions);
+    EXPECT_EQ (positions[0], tree.end ());
+    EXPECT_EQ (positions[1], tree.end ());
+
+    tree.rank_interleaved (keys, ranks);
+    EXPECT_EQ (ranks, (std::vector<std::size_t> {0, 0}));
+
+    tree.os_select_interleaved ({}, {});
+}
+
+TEST (Test_interleaved, TestRandomGroups)
+{
+    tree_type tree;
+    for ( int i = 0; i < 3000; i++ )
+        tree.insert ((i * 7919) % 4999);
+
+    check_against_single<1> (tree, 1);
+    check_against_single<3> (tree, 2);
+    check_against_single<16> (tree, 3);
+    check_against_single<1024> (tree, 4);
+}
@@ -0,0 +1,107 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <alex.rom23@mail.ru> wrote this file.  As long as you retain this notice you
+ * can do whatever you want with this stuff. If we meet some day, and you think
+ * this stuff is worth it, you can buy me a beer in return.   Alex Romanov
+ * ----------------------------------------------------------------------------
+ */
+
+#include "myset.hpp"
+#include "test_helpers.hpp"
+#include <gtest/gtest.h>
+#include <set>
+#include <string>
+#include <vector>
+
+TEST (Test_multiset, TestSmall)
+{
+    rethinking_stl::multiset<int> times {20, 10, 20, 30, 20};
+
+    EXPECT_EQ (times.size (), 5);
+    EXPECT_EQ (times.unique_size (), 3);
+    EXPECT_EQ (times.count (20), 3);
+    EXPECT_EQ (times.count (25), 0);
+    EXPECT_EQ (std::vector<int> (times.begin (), times.end ()),
+               std::vector<int> ({10, 20, 20, 20, 30}));
+
+    EXPECT_EQ (times.os_select (1), 10);
+    EXPECT_EQ (times.os_select (2), 20);
+    EXPECT_EQ (times.os_select (4), 20);
+    EXPECT_EQ (times.os_select (5), 30);
+    EXPECT_THROW (times.os_select (0), std::out_of_range);
+    EXPECT_THROW (times.os_select (6), std::out_of_range);
+    EXPECT_EQ (times.get_number_less_then (20), 1);
+    EXPECT_EQ (times.get_number_less_then (30), 4);
+    EXPECT_EQ (times.count_less_equal (20), 4);
+    EXPECT_EQ (*times.lower_bound (15), 20);
+
+    /* Repeated keys take no new nodes. */
+    EXPECT_EQ (times.insert (30, 4), 5);
+    EXPECT_EQ (times.unique_size (), 3);
+    EXPECT_EQ (times.size (), 9);
+
+    EXPECT_TRUE (times.erase_one (20));
+    EXPECT_EQ (times.count (20), 2);
+    EXPECT_FALSE (times.erase_one (25));
+    EXPECT_EQ (times.erase (30), 5);
+    EXPECT_FALSE (times.contains (30));
+    EXPECT_TRUE (times.erase_one (10));
+    EXPECT_EQ (times.unique_size (), 1);
+    EXPECT_EQ (std::vector<int> (times.begin (), times.end ()), std::vector<int> ({20, 20}));
+
+    times.clear ();
+    EXPECT_TRUE (times.empty ());
+    EXPECT_EQ (times.begin (), times.end ());
+}
+
+TEST (Test_multiset, TestRandomAgainstStdMultiset)
+{
+    rethinking_stl::multiset<std::string, std::greater<std::string>> tree;
+    std::multiset<std::string, std::greater<std::string>> expected;
+
+    test_helpers::lcg next (13);
+
+    for ( int i = 0; i < 30000; i++ )
+    {
+        auto key = std::to_string (next (500));
+        switch ( next (5) )
+        {
+        case 0:
+            ASSERT_EQ (tree.erase_one (key), expected.count (key) > 0);
+            if ( expected.count (key) )
+                expected.erase (expected.find (key));
+            break;
+        case 1:
+            if ( !next (10) )
+            {
+                ASSERT_EQ (tree.erase (key), expected.erase (key));
+            }
+            break;
+        default:
+            expected.insert (key);
+            ASSERT_EQ (tree.insert (key), expected.count (key));
+        }
+
+        if ( i % 1000 == 0 )
+        {
+            ASSERT_EQ (tree.size (), expected.size ());
+            ASSERT_TRUE (
+                std::equal (expected.begin (), expected.end (), tree.begin (), tree.end ()));
+
+            std::set<std::string, std::greater<std::string>> unique (expected.begin (),
+                                                                     expected.end ());
+            ASSERT_EQ (tree.unique_size (), unique.size ());
+
+            std::vector<std::string> keys (expected.begin (), expected.end ());
+            for ( std::size_t k = 0; k < keys.size (); k += 7 )
+            {
+                EXPECT_EQ (tree.os_select (k + 1), keys[k]);
+                auto less = static_cast<std::size_t> (
+                    std::distance (expected.begin (), expected.lower_bound (keys[k])));
+                EXPECT_EQ (tree.get_number_less_then (keys[k]), less);
+                EXPECT_EQ (tree.count (keys[k]), expected.count (keys[k]));
+            }
+        }
+    }
+}
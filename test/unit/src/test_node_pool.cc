@@ -0,0 +1,231 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <alex.rom23@mail.ru> wrote this file.  As long as you retain this notice you
+ * can do whatever you want with this stuff. If we meet some day, and you think
+ * this stuff is worth it, you can buy me a beer in return.   Alex Romanov
+ * ----------------------------------------------------------------------------
+ */
+
+#include "myset.hpp"
+#include "sharded_set.hpp"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+struct alloc_stats
+{
+    std::size_t allocations   = 0;
+    std::size_t deallocations = 0;
+    std::size_t live_bytes    = 0;
+};
+
+template <typename T> struct counting_allocator
+{
+    using value_type = T;
+
+    alloc_stats *stats;
+
+    counting_allocator (alloc_stats *stats_) : stats (stats_) {}
+
+    template <typename U>
+    counting_allocator (const counting_allocator<U> &other) : stats (other.stats)
+    {
+    }
+
+    T *allocate (std::size_t n)
+    {
+        stats->allocations++;
+        stats->live_bytes += n * sizeof (T);
+        return std::allocator<T> {}.allocate (n);
+    }
+
+    void deallocate (T *p, std::size_t n)
+    {
+        stats->deallocations++;
+        stats->live_bytes -= n * sizeof (T);
+        std::allocator<T> {}.deallocate (p, n);
+    }
+
+    template <typename U> bool operator== (const counting_allocator<U> &other) const
+    {
+        return stats == other.stats;
+    }
+
+    template <typename U> bool operator!= (const counting_allocator<U> &other) const
+    {
+        return stats != other.stats;
+    }
+};
+
+}   // namespace
+
+TEST (Test_node_pool, TestReuseFreed)
+{
+    rethinking_stl::node_pool_<rethinking_stl::do_avl_tree_node_<int>> pool;
+
+    auto first = pool.m_create_ (1);
+    pool.m_create_ (2);
+    EXPECT_EQ (pool.allocated (), 2);
+
+    pool.m_destroy_ (first);
+    EXPECT_EQ (pool.allocated (), 1);
+
+    auto again = pool.m_create_ (3);
+    EXPECT_EQ (again, first);
+    EXPECT_EQ (again->m_key_, 3);
+    EXPECT_EQ (pool.slab_count (), 1);
+}
+
+TEST (Test_node_pool, TestSlabsGrow)
+{
+    rethinking_stl::node_pool_<rethinking_stl::do_avl_tree_node_<int>> pool;
+
+    for ( int i = 0; i < 100000; i++ )
+        pool.m_create_ (i);
+
+    EXPECT_EQ (pool.allocated (), 100000);
+    EXPECT_GE (pool.capacity (), 100000);
+    EXPECT_LT (pool.slab_count (), 20);
+
+    pool.m_release_ ();
+    EXPECT_EQ (pool.slab_count (), 0);
+    EXPECT_EQ (pool.allocated (), 0);
+}
+
+TEST (Test_node_pool, TestIndexedReuseFreed)
+{
+    rethinking_stl::indexed_node_pool_<std::array<int, 4>> pool;
+
+    auto first = pool.m_create_ (std::array<int, 4> {1, 2, 3, 4});
+    auto other = pool.m_create_ ();
+    EXPECT_NE (first, pool.s_null_);
+    EXPECT_NE (other, first);
+    EXPECT_EQ (pool.m_at_ (first)->at (3), 4);
+
+    pool.m_destroy_ (first);
+    EXPECT_EQ (pool.allocated (), 1);
+
+    EXPECT_EQ (pool.m_create_ (), first);
+    EXPECT_EQ (pool.slab_count (), 1);
+}
+
+TEST (Test_node_pool, TestIndexedSlabsGrow)
+{
+    rethinking_stl::indexed_node_pool_<int> pool;
+
+    std::vector<std::uint32_t> indices;
+    for ( int i = 0; i < 300000; i++ )
+        indices.push_back (pool.m_create_ (i));
+
+    /* Nodes don't move while the slabs grow. */
+    for ( int i = 0; i < 300000; i += 997 )
+        EXPECT_EQ (*pool.m_at_ (indices[i]), i);
+    EXPECT_EQ (std::count (indices.begin (), indices.end (), pool.s_null_), 0);
+    EXPECT_LT (pool.slab_count (), 20);
+
+    pool.m_release_ ();
+    EXPECT_EQ (pool.slab_count (), 0);
+    EXPECT_EQ (pool.allocated (), 0);
+}
+
+TEST (Test_set, TestAllocatorFewUpstreamCalls)
+{
+    alloc_stats stats;
+    {
+        using alloc_t = counting_allocator<int>;
+        rethinking_stl::set<int, std::less<int>, alloc_t> tree {alloc_t {&stats}};
+
+        for ( int i = 0; i < 10000; i++ )
+            tree.insert (i);
+
+        EXPECT_LT (stats.allocations, 64);
+        EXPECT_EQ (tree.size (), 10000);
+    }
+    EXPECT_EQ (stats.allocations, stats.deallocations);
+    EXPECT_EQ (stats.live_bytes, 0);
+}
+
+TEST (Test_set, TestClearReclaims)
+{
+    alloc_stats stats;
+    using alloc_t = counting_allocator<std::string>;
+    rethinking_stl::set<std::string, std::less<std::string>, alloc_t> tree {alloc_t {&stats}};
+
+    for ( int i = 0; i < 1000; i++ )
+        tree.insert (std::to_string (i) + std::string (32, 'x'));
+    for ( int i = 0; i < 500; i++ )
+        tree.erase (std::to_string (i) + std::string (32, 'x'));
+
+    EXPECT_GT (stats.live_bytes, 0);
+    tree.clear ();
+
+    EXPECT_TRUE (tree.empty ());
+    EXPECT_EQ (stats.live_bytes, 0);
+
+    tree.insert ("again");
+    EXPECT_EQ (*tree.begin (), "again");
+}
+
+TEST (Test_set, TestSplitJoinReusesNodes)
+{
+    alloc_stats stats;
+    using alloc_t = counting_allocator<int>;
+    rethinking_stl::set<int, std::less<int>, alloc_t> tree {alloc_t {&stats}};
+
+    /* A window of keys moves right: the split off half takes the new keys, the other one
+     * loses the old ones, so each half needs the nodes the other one freed. */
+    int first = 0, last = 0;
+    for ( ; last < 1000; last++ )
+        tree.insert (last);
+
+    std::size_t bytes = 0;
+    for ( int cycle = 0; cycle < 500; cycle++ )
+    {
+        auto right = tree.split_at_rank (tree.size () / 2);
+        for ( int i = 0; i < 100; i++ )
+        {
+            right.insert (last++);
+            tree.erase (first++);
+        }
+        tree.join (right);
+
+        if ( cycle == 50 )
+            bytes = stats.live_bytes;
+    }
+
+    EXPECT_EQ (tree.size (), 1000);
+    EXPECT_EQ (*tree.begin (), first);
+    EXPECT_LE (stats.live_bytes, bytes);
+}
+
+TEST (Test_sharded_set, TestSlidingWindowReusesNodes)
+{
+    alloc_stats stats;
+    using alloc_t = counting_allocator<int>;
+    {
+        rethinking_stl::sharded_order_statistic_set<int, std::less<int>, alloc_t> set (
+            256, std::less<int> (), alloc_t {&stats});
+
+        /* Shards are split at the head of the window and merged at its tail. */
+        std::size_t bytes = 0;
+        for ( int i = 0; i < 200000; i++ )
+        {
+            set.insert (i);
+            if ( i >= 5000 )
+                set.erase (i - 5000);
+            if ( i == 20000 )
+                bytes = stats.live_bytes;
+        }
+
+        EXPECT_EQ (set.size (), 5000);
+        EXPECT_LE (stats.live_bytes, bytes);
+    }
+    EXPECT_EQ (stats.live_bytes, 0);
+}
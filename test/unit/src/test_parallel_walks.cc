@@ -0,0 +1,100 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <alex.rom23@mail.ru> wrote this file.  As long as you retain this notice you
+ * can do whatever you want with this stuff. If we meet some day, and you think
+ * this stuff is worth it, you can buy me a beer in return.   Alex Romanov
+ * ----------------------------------------------------------------------------
+ */
+
+#include "myset.hpp"
+#include "test_helpers.hpp"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <numeric>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+// First and last key of a range and whether it is sorted. Folding them is associative but not
+// commutative, so the ranges have to be combined in order.
+struct run
+{
+    int first, last;
+    bool sorted;
+};
+
+run join_runs (run left, run right)
+{
+    return {left.first, right.last, left.sorted && right.sorted && left.last < right.first};
+}
+
+}   // namespace
+
+TEST (Test_parallel_walks, TestSmall)
+{
+    rethinking_stl::set<int> tree {5, 1, 4, 2, 3};
+    EXPECT_EQ (tree.to_vector (), std::vector<int> ({1, 2, 3, 4, 5}));
+    EXPECT_EQ (tree.parallel_reduce (0, std::plus<int> (), [] (int key) { return key * key; }),
+               55);
+
+    int count = 0;
+    tree.parallel_for_each ([&count] (int) { count++; }, 1);
+    EXPECT_EQ (count, 5);
+
+    rethinking_stl::set<std::string> empty;
+    EXPECT_TRUE (empty.to_vector ().empty ());
+    EXPECT_EQ (empty.parallel_reduce (std::string ("init"), std::plus<std::string> (),
+                                      [] (const std::string &key) { return key; }),
+               "init");
+}
+
+TEST (Test_parallel_walks, TestRangesAgainstStdSet)
+{
+    test_helpers::lcg next (7);
+
+    for ( int size : {1, 1000, 100000, 300001} )
+    {
+        std::set<int> expected;
+        rethinking_stl::set<int> tree;
+        while ( expected.size () < static_cast<std::size_t> (size) )
+        {
+            auto key = static_cast<int> (next (1u << 30));
+            expected.insert (key);
+            tree.insert (key);
+        }
+        std::vector<int> keys (expected.begin (), expected.end ());
+
+        for ( unsigned threads : {0u, 1u, 3u, 8u} )
+        {
+            EXPECT_EQ (tree.to_vector (threads), keys);
+
+            std::atomic<long long> sum {0};
+            std::atomic<int> count {0};
+            tree.parallel_for_each (
+                [&sum, &count] (int key) {
+                    sum += key;
+                    count++;
+                },
+                threads);
+            EXPECT_EQ (sum, std::accumulate (keys.begin (), keys.end (), 0LL));
+            EXPECT_EQ (count, size);
+
+            auto res = tree.parallel_reduce (
+                run {keys.front (), keys.front (), true}, join_runs,
+                [] (int key) { return run {key, key, true}; }, threads);
+            EXPECT_EQ (res.first, keys.front ());
+            EXPECT_EQ (res.last, keys.back ());
+            /* The initial run is the first key once again. */
+            EXPECT_FALSE (res.sorted);
+
+            res = tree.parallel_reduce (
+                run {keys.front () - 1, keys.front () - 1, true}, join_runs,
+                [] (int key) { return run {key, key, true}; }, threads);
+            EXPECT_TRUE (res.sorted);
+        }
+    }
+}
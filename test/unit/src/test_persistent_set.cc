@@ -0,0 +1,184 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <alex.rom23@mail.ru> wrote this file.  As long as you retain this notice you
+ * can do whatever you want with this stuff. If we meet some day, and you think
+ * this stuff is worth it, you can buy me a beer in return.   Alex Romanov
+ * ----------------------------------------------------------------------------
+ */
+
+#include "persistent_set.hpp"
+#include "test_helpers.hpp"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <set>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+using persistent_set = rethinking_stl::persistent_order_statistic_set<int>;
+
+TEST (Test_persistent_set, TestSmall)
+{
+    persistent_set set {30, 10, 50, 20, 40, 10};
+
+    EXPECT_EQ (set.size (), 5);
+    EXPECT_FALSE (set.insert (20));
+    EXPECT_TRUE (set.insert (25));
+    EXPECT_EQ (set.os_select (3), 25);
+    EXPECT_THROW (set.os_select (0), std::out_of_range);
+    EXPECT_THROW (set.os_select (7), std::out_of_range);
+    EXPECT_EQ (set.get_number_less_then (30), 3);
+    EXPECT_TRUE (set.contains (40));
+    EXPECT_FALSE (set.contains (45));
+
+    auto version = set.snapshot ();
+    EXPECT_EQ (set.erase (25), 1);
+    EXPECT_EQ (set.erase (25), 0);
+    EXPECT_TRUE (set.insert (60));
+
+    /* The version still sees the set as it was taken. */
+    EXPECT_EQ (std::vector<int> (version.begin (), version.end ()),
+               std::vector<int> ({10, 20, 25, 30, 40, 50}));
+    EXPECT_EQ (std::vector<int> (set.begin (), set.end ()),
+               std::vector<int> ({10, 20, 30, 40, 50, 60}));
+    EXPECT_EQ (*version.lower_bound (21), 25);
+    EXPECT_EQ (version.count_less_equal (25), 3);
+    EXPECT_EQ (version.os_select (6), 50);
+    EXPECT_TRUE (version.contains (25));
+    EXPECT_FALSE (version.contains (60));
+
+    auto moved = std::move (version);
+    EXPECT_EQ (moved.size (), 6);
+    version = set.snapshot ();
+    EXPECT_EQ (version.rank (60), 5);
+}
+
+TEST (Test_persistent_set, TestReleaseVersionsOnOtherThread)
+{
+    static_assert (std::is_nothrow_destructible_v<persistent_set::version>);
+    static_assert (std::is_nothrow_move_assignable_v<persistent_set::version>);
+
+    persistent_set set;
+    std::vector<persistent_set::version> versions;
+    for ( int i = 0; i < 1000; i++ )
+    {
+        set.insert (i);
+        versions.push_back (set.snapshot ());
+    }
+
+    /* The set has room for all the roots, the versions don't allocate when they go. */
+    std::thread ([&versions] { versions.clear (); }).join ();
+    EXPECT_EQ (set.nodes (), set.size ());
+
+    auto version = set.snapshot ();
+    version      = set.snapshot ();
+    EXPECT_EQ (version.size (), 1000);
+}
+
+TEST (Test_persistent_set, TestRandomAgainstStdSet)
+{
+    rethinking_stl::persistent_order_statistic_set<std::string, std::greater<std::string>> set;
+    std::set<std::string, std::greater<std::string>> expected;
+
+    test_helpers::lcg next (11);
+
+    /* Versions taken along the way must not change, whatever happens to the set later. */
+    std::vector<decltype (set.snapshot ())> versions;
+    std::vector<std::vector<std::string>> contents;
+    for ( int i = 0; i < 20000; i++ )
+    {
+        auto key = std::to_string (next (3000));
+        if ( next (3) )
+            ASSERT_EQ (set.insert (key), expected.insert (key).second);
+        else
+            ASSERT_EQ (set.erase (key), expected.erase (key));
+
+        if ( i % 2000 == 0 )
+        {
+            versions.push_back (set.snapshot ());
+            contents.emplace_back (expected.begin (), expected.end ());
+        }
+    }
+
+    ASSERT_EQ (set.size (), expected.size ());
+    EXPECT_TRUE (std::equal (expected.begin (), expected.end (), set.begin (), set.end ()));
+
+    for ( std::size_t v = 0; v < versions.size (); v++ )
+    {
+        auto &keys = contents[v];
+        ASSERT_EQ (versions[v].size (), keys.size ());
+        EXPECT_TRUE (std::equal (keys.begin (), keys.end (), versions[v].begin (),
+                                 versions[v].end ()));
+        for ( std::size_t i = 0; i < keys.size (); i += 37 )
+        {
+            EXPECT_EQ (versions[v].os_select (i + 1), keys[i]);
+            EXPECT_EQ (versions[v].get_number_less_then (keys[i]), i);
+        }
+    }
+
+    /* Once the versions are gone, only the current tree is left. */
+    versions.clear ();
+    EXPECT_EQ (set.nodes (), set.size ());
+}
+
+TEST (Test_persistent_set, TestVersionKeepsOnlyChanges)
+{
+    persistent_set set;
+    for ( int i = 0; i < 1 << 14; i++ )
+        set.insert (i);
+    EXPECT_EQ (set.nodes (), set.size ());
+
+    {
+        auto version = set.snapshot ();
+        EXPECT_EQ (set.nodes (), set.size ());
+
+        /* Every update copies one path with the rotated nodes, at most ~20 nodes here. */
+        for ( int i = 0; i < 100; i++ )
+            set.erase (i * 7);
+        EXPECT_LE (set.nodes (), version.size () + 100 * 20);
+        EXPECT_EQ (version.size (), 1 << 14);
+        EXPECT_EQ (version.os_select (8), 7);
+    }
+
+    EXPECT_EQ (set.nodes (), set.size ());
+    EXPECT_EQ (set.os_select (8), 9);
+}
+
+TEST (Test_persistent_set, TestReadersOnOtherThreads)
+{
+    persistent_set set;
+    for ( int i = 0; i < 4096; i += 2 )
+        set.insert (i);
+
+    /* Readers check versions taken by the writer, which goes on updating the set. */
+    std::atomic<int> failures {0};
+    std::vector<std::thread> readers;
+    for ( int r = 0; r < 50; r++ )
+    {
+        for ( int i = 0; i < 200; i++ )
+        {
+            int key = (r * 7919 + i * 104729) % 4096;
+            if ( key % 2 )
+                set.insert (key - 1);
+            else
+                set.erase (key);
+        }
+
+        readers.emplace_back ([&failures] (persistent_set::version version) {
+            std::vector<int> keys (version.begin (), version.end ());
+            bool ok = keys.size () == version.size ();
+            for ( std::size_t i = 0; ok && i < keys.size (); i++ )
+                ok = keys[i] % 2 == 0 && (!i || keys[i - 1] < keys[i]) &&
+                     version.os_select (i + 1) == keys[i] && version.rank (keys[i]) == i;
+            if ( !ok )
+                failures++;
+        }, set.snapshot ());
+    }
+
+    for ( auto &reader : readers )
+        reader.join ();
+    EXPECT_EQ (failures, 0);
+    EXPECT_EQ (set.nodes (), set.size ());
+}
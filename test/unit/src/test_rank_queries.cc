@@ -0,0 +1,102 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <alex.rom23@mail.ru> wrote this file.  As long as you retain this notice you
+ * can do whatever you want with this stuff. If we meet some day, and you think
+ * this stuff is worth it, you can buy me a beer in return.   Alex Romanov
+ * ----------------------------------------------------------------------------
+ */
+
+#include "myset.hpp"
+#include "test_helpers.hpp"
+#include <gtest/gtest.h>
+#include <iterator>
+#include <set>
+
+using compact_set = typename rethinking_stl::set<int, std::less<int>, std::allocator<int>,
+                                                 rethinking_stl::compact_avl_tree_engine>;
+
+namespace
+{
+
+template <typename Set> void check_small ()
+{
+    Set set {10, 20, 30, 40, 50};
+
+    EXPECT_EQ (set.rank (5), 0);
+    EXPECT_EQ (set.rank (10), 0);
+    EXPECT_EQ (set.rank (35), 3);
+    EXPECT_EQ (set.count_less (50), 4);
+    EXPECT_EQ (set.count_less (51), 5);
+
+    EXPECT_EQ (set.count_less_equal (5), 0);
+    EXPECT_EQ (set.count_less_equal (10), 1);
+    EXPECT_EQ (set.count_less_equal (50), 5);
+
+    EXPECT_EQ (set.count_in_range (20, 40), 3);
+    EXPECT_EQ (set.count_in_range (21, 39), 1);
+    EXPECT_EQ (set.count_in_range (30, 30), 1);
+    EXPECT_EQ (set.count_in_range (31, 39), 0);
+    EXPECT_EQ (set.count_in_range (40, 20), 0);
+    EXPECT_EQ (set.count_in_range (0, 100), 5);
+
+    EXPECT_EQ (set.select_from (20, 1), 20);
+    EXPECT_EQ (set.select_from (21, 1), 30);
+    EXPECT_EQ (set.select_from (21, 3), 50);
+    EXPECT_EQ (set.select_from (0, 5), 50);
+    EXPECT_THROW (set.select_from (21, 4), std::out_of_range);
+    EXPECT_THROW (set.select_from (21, 0), std::out_of_range);
+    EXPECT_THROW (set.select_from (60, 1), std::out_of_range);
+
+    Set empty;
+    EXPECT_EQ (empty.rank (1), 0);
+    EXPECT_EQ (empty.count_less_equal (1), 0);
+    EXPECT_EQ (empty.count_in_range (0, 1), 0);
+    EXPECT_THROW (empty.select_from (1, 1), std::out_of_range);
+}
+
+template <typename Set> void check_random ()
+{
+    test_helpers::lcg next (777);
+
+    Set set;
+    std::set<int> expected;
+    for ( int i = 0; i < 1000; i++ )
+    {
+        auto key = static_cast<int> (next (2000));
+        set.insert (key);
+        expected.insert (key);
+    }
+
+    for ( int i = 0; i < 500; i++ )
+    {
+        auto lo = static_cast<int> (next (2000)), hi = static_cast<int> (next (2000));
+
+        auto less       = std::distance (expected.begin (), expected.lower_bound (lo));
+        auto less_equal = std::distance (expected.begin (), expected.upper_bound (lo));
+
+        EXPECT_EQ (set.rank (lo), less);
+        EXPECT_EQ (set.get_number_less_then (lo), less);
+        EXPECT_EQ (set.count_less_equal (lo), less_equal);
+
+        auto in_range = (hi < lo ? 0 : std::distance (expected.lower_bound (lo),
+                                                        expected.upper_bound (hi)));
+        EXPECT_EQ (set.count_in_range (lo, hi), in_range);
+
+        auto k = static_cast<std::size_t> (hi % 10 + 1);
+        if ( static_cast<std::size_t> (less) + k <= expected.size () )
+            EXPECT_EQ (set.select_from (lo, k), *std::next (expected.lower_bound (lo), k - 1));
+        else
+            EXPECT_THROW (set.select_from (lo, k), std::out_of_range);
+    }
+}
+
+}   // namespace
+
+TEST (Test_rank_queries, TestSmall) { check_small<rethinking_stl::set<int>> (); }
+
+TEST (Test_rank_queries, TestRandomAgainstStd) { check_random<rethinking_stl::set<int>> (); }
+
+TEST (Test_rank_queries, TestCompactSmall) { check_small<compact_set> (); }
+
+TEST (Test_rank_queries, TestCompactRandomAgainstStd) { check_random<compact_set> (); }
@@ -0,0 +1,105 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <alex.rom23@mail.ru> wrote this file.  As long as you retain this notice you
+ * can do whatever you want with this stuff. If we meet some day, and you think
+ * this stuff is worth it, you can buy me a beer in return.   Alex Romanov
+ * ----------------------------------------------------------------------------
+ */
+
+#include "myset.hpp"
+#include "test_helpers.hpp"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <iterator>
+#include <set>
+#include <string>
+#include <vector>
+
+using test_helpers::check_tree;
+
+TEST (Test_set_algebra, TestSmall)
+{
+    rethinking_stl::set<int> odd {1, 3, 5, 7, 9}, low {1, 2, 3, 4, 5};
+
+    rethinking_stl::set<int> both {1, 3, 5, 7, 9};
+    both.set_intersection (low);
+    check_tree (both, std::vector<int> {1, 3, 5});
+
+    rethinking_stl::set<int> rest {1, 3, 5, 7, 9};
+    rest.set_difference (low);
+    check_tree (rest, std::vector<int> {7, 9});
+
+    odd.set_union (low);
+    EXPECT_TRUE (low.empty ());
+    check_tree (odd, std::vector<int> {1, 2, 3, 4, 5, 7, 9});
+    EXPECT_EQ (odd.os_select (5), 5);
+
+    /* Empty operands and the tree itself. */
+    rethinking_stl::set<int> empty;
+    odd.set_union (empty);
+    odd.set_difference (empty);
+    odd.set_union (odd);
+    odd.set_intersection (odd);
+    check_tree (odd, std::vector<int> {1, 2, 3, 4, 5, 7, 9});
+    empty.set_union (odd);
+    check_tree (empty, std::vector<int> {1, 2, 3, 4, 5, 7, 9});
+    EXPECT_TRUE (odd.empty ());
+
+    /* The consumed tree keeps working. */
+    EXPECT_TRUE (odd.insert (8).second);
+    check_tree (odd, std::vector<int> {8});
+    empty.set_difference (empty);
+    EXPECT_TRUE (empty.empty ());
+}
+
+TEST (Test_set_algebra, TestRandomAgainstStdAlgorithms)
+{
+    using tree_type = rethinking_stl::set<std::string, std::greater<std::string>>;
+    using set_type  = std::set<std::string, std::greater<std::string>>;
+
+    test_helpers::lcg next (5);
+
+    /* Sizes from a few keys up to well above the grain of the parallel recursion, with one or
+     * several threads. */
+    for ( unsigned threads : {1u, 4u} )
+        for ( int size : {10, 1000, 100000} )
+        {
+            set_type first_keys, second_keys;
+            for ( int i = 0; i < size; i++ )
+                first_keys.insert (std::to_string (next (2 * size)));
+            for ( int i = 0, n = static_cast<int> (next (2 * size)) + 1; i < n; i++ )
+                second_keys.insert (std::to_string (next (2 * size)));
+
+            tree_type first (first_keys.begin (), first_keys.end ());
+            tree_type second (second_keys.begin (), second_keys.end ());
+
+            std::vector<std::string> expected;
+            std::set_intersection (first_keys.begin (), first_keys.end (), second_keys.begin (),
+                                   second_keys.end (), std::back_inserter (expected),
+                                   first_keys.key_comp ());
+            tree_type tree (first_keys.begin (), first_keys.end ());
+            tree.set_intersection (second, threads);
+            ASSERT_NO_FATAL_FAILURE (check_tree (tree, expected));
+
+            expected.clear ();
+            std::set_difference (first_keys.begin (), first_keys.end (), second_keys.begin (),
+                                 second_keys.end (), std::back_inserter (expected),
+                                 first_keys.key_comp ());
+            tree.assign (first_keys.begin (), first_keys.end ());
+            tree.set_difference (second, threads);
+            ASSERT_NO_FATAL_FAILURE (check_tree (tree, expected));
+
+            expected.clear ();
+            std::set_union (first_keys.begin (), first_keys.end (), second_keys.begin (),
+                            second_keys.end (), std::back_inserter (expected),
+                            first_keys.key_comp ());
+            second.set_union (first, threads);
+            ASSERT_NO_FATAL_FAILURE (check_tree (second, expected));
+            EXPECT_TRUE (first.empty ());
+
+            /* The adopted nodes are owned by the result now. */
+            second.erase (second.os_select (second.size ()));
+            EXPECT_EQ (second.size (), expected.size () - 1);
+        }
+}
@@ -0,0 +1,127 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <alex.rom23@mail.ru> wrote this file.  As long as you retain this notice you
+ * can do whatever you want with this stuff. If we meet some day, and you think
+ * this stuff is worth it, you can buy me a beer in return.   Alex Romanov
+ * ----------------------------------------------------------------------------
+ */
+
+#include "sharded_set.hpp"
+#include "test_helpers.hpp"
+#include <gtest/gtest.h>
+#include <iterator>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+using sharded_set = rethinking_stl::sharded_order_statistic_set<int>;
+
+TEST (Test_sharded_set, TestSplitAndMerge)
+{
+    sharded_set set (8);
+    for ( int i = 0; i < 100; i++ )
+        EXPECT_TRUE (set.insert (i));
+    EXPECT_FALSE (set.insert (50));
+
+    /* Shards hold from 8 to 16 keys after the splits. */
+    EXPECT_EQ (set.size (), 100);
+    EXPECT_GE (set.shards (), 100 / 16);
+    EXPECT_LE (set.shards (), 100 / 8);
+    for ( int i = 0; i < 100; i++ )
+    {
+        EXPECT_EQ (set.os_select (i + 1), i);
+        EXPECT_EQ (set.get_number_less_then (i), i);
+    }
+    EXPECT_THROW (set.os_select (0), std::out_of_range);
+    EXPECT_THROW (set.os_select (101), std::out_of_range);
+
+    for ( int i = 0; i < 95; i++ )
+        EXPECT_EQ (set.erase (i), 1);
+    EXPECT_EQ (set.erase (0), 0);
+
+    EXPECT_EQ (set.shards (), 1);
+    EXPECT_EQ (set.keys (), std::vector<int> ({95, 96, 97, 98, 99}));
+    EXPECT_EQ (set.os_select (2), 96);
+    EXPECT_EQ (set.get_number_less_then (1000), 5);
+}
+
+TEST (Test_sharded_set, TestRandomAgainstStdSet)
+{
+    rethinking_stl::sharded_order_statistic_set<std::string, std::greater<std::string>> set (
+        {"3", "6"}, 16);
+    std::set<std::string, std::greater<std::string>> expected;
+    EXPECT_EQ (set.shards (), 3);
+
+    test_helpers::lcg next (7);
+
+    for ( int i = 0; i < 20000; i++ )
+    {
+        auto key = std::to_string (next (1000));
+        /* Inserts win at first, erases later, so shards are split and merged. */
+        if ( next (10) < (i < 10000 ? 7u : 3u) )
+            ASSERT_EQ (set.insert (key), expected.insert (key).second);
+        else
+            ASSERT_EQ (set.erase (key), expected.erase (key));
+
+        if ( i % 100 )
+            continue;
+
+        ASSERT_EQ (set.size (), expected.size ());
+        ASSERT_EQ (set.contains (key), expected.count (key) == 1);
+        auto less = std::distance (expected.begin (), expected.lower_bound (key));
+        ASSERT_EQ (set.get_number_less_then (key), static_cast<std::size_t> (less));
+        if ( !expected.empty () )
+        {
+            auto rank = next (static_cast<unsigned> (expected.size ())) + 1;
+            ASSERT_EQ (set.os_select (rank), *std::next (expected.begin (), rank - 1));
+        }
+    }
+
+    EXPECT_EQ (set.keys (), std::vector<std::string> (expected.begin (), expected.end ()));
+}
+
+TEST (Test_sharded_set, TestConcurrentWriters)
+{
+    constexpr int threads = 4, per_thread = 20000;
+    sharded_set set (256);
+
+    /* Writers insert interleaved keys, then erase the odd ones, splitting and merging shards
+     * under each other. */
+    std::vector<std::thread> writers;
+    for ( int t = 0; t < threads; t++ )
+        writers.emplace_back ([&set, t] {
+            for ( int i = 0; i < per_thread; i++ )
+                set.insert (i * threads + t);
+            for ( int i = 1; i < per_thread; i += 2 )
+                set.erase (i * threads + t);
+        });
+
+    /* Readers see some state between the writes, the answers only have to be in range. */
+    std::thread reader ([&set] {
+        for ( int i = 0; i < 2000; i++ )
+        {
+            auto size = set.size ();
+            if ( size )
+            {
+                EXPECT_LT (set.os_select (1), threads * per_thread);
+            }
+            EXPECT_LE (set.get_number_less_then (i * 10), static_cast<std::size_t> (i * 10));
+        }
+    });
+
+    for ( auto &writer : writers )
+        writer.join ();
+    reader.join ();
+
+    std::vector<int> expected;
+    for ( int i = 0; i < per_thread; i += 2 )
+        for ( int t = 0; t < threads; t++ )
+            expected.push_back (i * threads + t);
+
+    EXPECT_EQ (set.size (), expected.size ());
+    EXPECT_EQ (set.keys (), expected);
+    for ( std::size_t i = 0; i < expected.size (); i += 97 )
+        EXPECT_EQ (set.os_select (i + 1), expected[i]);
+}
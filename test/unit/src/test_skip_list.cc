@@ -0,0 +1,170 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <alex.rom23@mail.ru> wrote this file.  As long as you retain this notice you
+ * can do whatever you want with this stuff. If we meet some day, and you think
+ * this stuff is worth it, you can buy me a beer in return.   Alex Romanov
+ * ----------------------------------------------------------------------------
+ */
+
+#include "skip_list.hpp"
+#include "test_helpers.hpp"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <atomic>
+#include <iterator>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+using skip_list = rethinking_stl::indexable_skip_list<int>;
+
+TEST (Test_skip_list, TestSmall)
+{
+    skip_list list {30, 10, 50, 20, 40, 10};
+
+    EXPECT_EQ (list.size (), 5);
+    EXPECT_FALSE (list.insert (20));
+    EXPECT_TRUE (list.insert (25));
+    EXPECT_EQ (list.os_select (3), 25);
+    EXPECT_THROW (list.os_select (0), std::out_of_range);
+    EXPECT_THROW (list.os_select (7), std::out_of_range);
+    EXPECT_EQ (list.get_number_less_then (30), 3);
+    EXPECT_EQ (list.get_number_less_then (5), 0);
+    EXPECT_EQ (list.get_number_less_then (100), 6);
+    EXPECT_TRUE (list.contains (40));
+    EXPECT_FALSE (list.contains (45));
+
+    EXPECT_EQ (list.erase (25), 1);
+    EXPECT_EQ (list.erase (25), 0);
+    EXPECT_EQ (list.keys (), std::vector<int> ({10, 20, 30, 40, 50}));
+}
+
+TEST (Test_skip_list, TestRandomAgainstStdSet)
+{
+    rethinking_stl::indexable_skip_list<std::string, std::greater<std::string>> list;
+    std::set<std::string, std::greater<std::string>> expected;
+
+    test_helpers::lcg next (3);
+
+    for ( int i = 0; i < 50000; i++ )
+    {
+        auto key = std::to_string (next (3000));
+        if ( next (3) )
+            ASSERT_EQ (list.insert (key), expected.insert (key).second);
+        else
+            ASSERT_EQ (list.erase (key), expected.erase (key));
+
+        if ( i % 250 )
+            continue;
+
+        ASSERT_EQ (list.size (), expected.size ());
+        ASSERT_EQ (list.contains (key), expected.count (key) == 1);
+        auto less = std::distance (expected.begin (), expected.lower_bound (key));
+        ASSERT_EQ (list.get_number_less_then (key), static_cast<std::size_t> (less));
+        if ( !expected.empty () )
+        {
+            auto rank = next (static_cast<unsigned> (expected.size ())) + 1;
+            ASSERT_EQ (list.os_select (rank), *std::next (expected.begin (), rank - 1));
+        }
+    }
+
+    EXPECT_EQ (list.keys (), std::vector<std::string> (expected.begin (), expected.end ()));
+}
+
+TEST (Test_skip_list, TestWidthsAfterConcurrentUpdates)
+{
+    constexpr int threads = 8, updates = 20000;
+    skip_list list;
+
+    /* A small key range, so the threads insert and erase next to each other all the time. */
+    std::vector<std::thread> writers;
+    for ( int t = 0; t < threads; t++ )
+        writers.emplace_back ([&list, t] {
+            test_helpers::lcg random (17 + t);
+            for ( int i = 0; i < updates; i++ )
+            {
+                auto state = random.step ();
+                auto key   = static_cast<int> ((state >> 8) % 2000);
+                if ( (state >> 4) % 3 )
+                    list.insert (key);
+                else
+                    list.erase (key);
+            }
+        });
+
+    for ( auto &writer : writers )
+        writer.join ();
+
+    /* Once the updates are over the widths are exact. */
+    auto keys = list.keys ();
+    ASSERT_EQ (keys.size (), list.size ());
+    for ( std::size_t i = 0; i < keys.size (); i++ )
+    {
+        ASSERT_EQ (list.os_select (i + 1), keys[i]);
+        ASSERT_EQ (list.get_number_less_then (keys[i]), i);
+    }
+    EXPECT_EQ (list.get_number_less_then (2000), keys.size ());
+}
+
+TEST (Test_skip_list, TestRanksDuringUpdates)
+{
+    constexpr int writers = 4, readers = 2, stable = 8192, rounds = 6;
+    skip_list list;
+
+    /* Even keys stay, every writer inserts and erases its own odd keys one at a time, so
+     * at most one key of every writer is in the list besides them. */
+    for ( int i = 0; i < stable; i++ )
+        list.insert (2 * i);
+
+    std::atomic<int> running {writers};
+    std::vector<std::thread> threads;
+    for ( int t = 0; t < writers; t++ )
+        threads.emplace_back ([&list, &running, t] {
+            for ( int round = 0; round < rounds; round++ )
+                for ( int j = t; j < stable; j += writers )
+                {
+                    list.insert (2 * j + 1);
+                    list.erase (2 * j + 1);
+                }
+            running--;
+        });
+
+    /* Off by the nodes which settle at their own upper levels, a few per running update. */
+    constexpr long slack = 2 * writers;
+    std::atomic<long> worst {0};
+    for ( int t = 0; t < readers; t++ )
+        threads.emplace_back ([&list, &running, &worst, t] {
+            test_helpers::lcg next (31 + t);
+            long error = 0;
+            while ( running.load () )
+            {
+                long evens = next (stable);
+
+                /* Keys less then 2 * evens are the evens ones and up to one per writer. */
+                long rank = list.get_number_less_then (2 * evens);
+                error     = std::max ({error, evens - rank, rank - evens - writers});
+
+                /* The key of rank i has the same number of keys in front of it. */
+                auto key    = list.os_select (evens + 1);
+                long before = (key + 1) / 2;
+                error       = std::max ({error, before - evens, evens - writers - before});
+            }
+
+            long seen = worst.load ();
+            while ( seen < error && !worst.compare_exchange_weak (seen, error) )
+                ;
+        });
+
+    for ( auto &thread : threads )
+        thread.join ();
+
+    EXPECT_LE (worst.load (), slack);
+    EXPECT_EQ (list.size (), stable);
+    for ( int i = 0; i < stable; i += 97 )
+    {
+        EXPECT_EQ (list.get_number_less_then (2 * i), i);
+        EXPECT_EQ (list.os_select (i + 1), 2 * i);
+    }
+}
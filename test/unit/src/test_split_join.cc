@@ -0,0 +1,126 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <alex.rom23@mail.ru> wrote this file.  As long as you retain this notice you
+ * can do whatever you want with this stuff. If we meet some day, and you think
+ * this stuff is worth it, you can buy me a beer in return.   Alex Romanov
+ * ----------------------------------------------------------------------------
+ */
+
+#include "myset.hpp"
+#include "test_helpers.hpp"
+#include <gtest/gtest.h>
+#include <set>
+#include <string>
+#include <vector>
+
+using test_helpers::check_tree;
+
+namespace
+{
+
+std::set<int> range (int first, int last)
+{
+    std::set<int> res;
+    for ( int i = first; i < last; i++ )
+        res.insert (i);
+    return res;
+}
+
+}   // namespace
+
+TEST (Test_split_join, TestSplit)
+{
+    auto keys = range (0, 1000);
+    rethinking_stl::set<int> tree (keys.begin (), keys.end ());
+    auto pos = tree.find (700);
+
+    auto right = tree.split (500);
+    check_tree (tree, range (0, 500));
+    check_tree (right, range (500, 1000));
+
+    /* Nodes are not copied, the iterator now walks the right tree. */
+    EXPECT_EQ (*pos, 700);
+    EXPECT_EQ (*++pos, 701);
+
+    /* Keys between and past the ends. */
+    auto empty = tree.split (1000);
+    EXPECT_TRUE (empty.empty ());
+    auto all = right.split (-1);
+    EXPECT_TRUE (right.empty ());
+    check_tree (all, range (500, 1000));
+
+    auto tail = all.split_at_rank (1);
+    check_tree (all, range (500, 501));
+    check_tree (tail, range (501, 1000));
+    EXPECT_EQ (tail.os_select (1), 501);
+    EXPECT_EQ (tail.get_number_less_then (900), 399);
+}
+
+TEST (Test_split_join, TestJoin)
+{
+    auto low_keys = range (0, 300), high_keys = range (300, 2000);
+    rethinking_stl::set<int> low (low_keys.begin (), low_keys.end ());
+    rethinking_stl::set<int> high (high_keys.begin (), high_keys.end ());
+
+    /* Trees of very different heights, in both orders. */
+    low.join (high);
+    EXPECT_TRUE (high.empty ());
+    check_tree (low, range (0, 2000));
+
+    rethinking_stl::set<int> lower {-3, -2, -1};
+    lower.join (low);
+    check_tree (lower, range (-3, 2000));
+
+    rethinking_stl::set<int> overlapping {5, 3000};
+    EXPECT_THROW (lower.join (overlapping), std::invalid_argument);
+    check_tree (lower, range (-3, 2000));
+    EXPECT_EQ (overlapping.size (), 2);
+
+    /* The emptied trees keep working. */
+    EXPECT_TRUE (high.insert (7).second);
+    low.join (high);
+    check_tree (low, range (7, 8));
+}
+
+TEST (Test_split_join, TestRandomSplitsAndJoins)
+{
+    using tree_type = rethinking_stl::set<std::string, std::greater<std::string>>;
+    std::set<std::string, std::greater<std::string>> expected;
+    for ( int i = 0; i < 3000; i++ )
+        expected.insert (std::to_string (i));
+
+    test_helpers::lcg next (3);
+
+    /* Cut the tree into pieces, update the pieces and glue them back starting from a random
+     * piece and joining the neighbours from both sides. */
+    tree_type tree (expected.begin (), expected.end ());
+    for ( int round = 0; round < 20; round++ )
+    {
+        std::vector<tree_type> pieces;
+        while ( tree.size () > 100 )
+        {
+            auto cut = next (static_cast<unsigned> (tree.size ()));
+            auto key = tree.os_select (cut + 1);
+            pieces.push_back (next (2) ? tree.split (key) : tree.split_at_rank (cut));
+        }
+        pieces.push_back (std::move (tree));
+
+        for ( auto &piece : pieces )
+            if ( !piece.empty () )
+            {
+                auto key = piece.os_select (next (static_cast<unsigned> (piece.size ())) + 1);
+                piece.erase (key);
+                if ( next (2) )
+                    piece.insert (key);
+                else
+                    expected.erase (key);
+            }
+
+        auto lo = next (static_cast<unsigned> (pieces.size ())), hi = lo + 1;
+        tree    = std::move (pieces[lo]);
+        while ( lo > 0 || hi < pieces.size () )
+            tree.join (hi == pieces.size () || (lo > 0 && next (2)) ? pieces[--lo] : pieces[hi++]);
+        ASSERT_NO_FATAL_FAILURE (check_tree (tree, expected));
+    }
+}
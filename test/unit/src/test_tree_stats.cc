@@ -0,0 +1,125 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * <alex.rom23@mail.ru> wrote this file.  As long as you retain this notice you
+ * can do whatever you want with this stuff. If we meet some day, and you think
+ * this stuff is worth it, you can buy me a beer in return.   Alex Romanov
+ * ----------------------------------------------------------------------------
+ */
+
+#include "myset.hpp"
+#include "test_helpers.hpp"
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+
+using stats_set = typename rethinking_stl::set<int, std::less<int>, std::allocator<int>,
+                                               rethinking_stl::instrumented_avl_tree_engine>;
+
+template <typename Tree_> concept has_stats = requires (const Tree_ &tree) { tree.stats (); };
+
+static_assert (has_stats<stats_set>);
+static_assert (!has_stats<rethinking_stl::set<int>>);
+
+/* Average depth by the walk over the whole tree. */
+template <typename Tree_> double walk_average_depth (const Tree_ &tree)
+{
+    double depths = 0;
+    for ( auto pos = tree.begin (); pos != tree.end (); ++pos )
+        for ( auto node = pos.m_node_; node->m_parent_->m_parent_; node = node->m_parent_ )
+            depths++;
+    return tree.empty () ? 0 : depths / tree.size ();
+}
+
+TEST (Test_tree_stats, TestSortedInsertRotates)
+{
+    stats_set tree;
+    for ( int i = 0; i < 1023; i++ )
+        tree.insert (i);
+
+    /* Increasing keys rotate left only, every subtree of the result is perfect. */
+    auto stats = tree.stats ();
+    EXPECT_EQ (stats.height, 10);
+    EXPECT_EQ (stats.double_rotations, 0);
+    EXPECT_EQ (stats.single_rotations, 1023 - 10);
+    EXPECT_EQ (stats.backtracks, 1023);
+    EXPECT_EQ (stats.descents, 1023);
+    EXPECT_DOUBLE_EQ (stats.average_depth, walk_average_depth (tree));
+
+    tree.os_select (1);
+    tree.get_number_less_then (500);
+    EXPECT_EQ (tree.stats ().descents, 1025);
+    EXPECT_EQ (tree.stats ().nodes_visited - stats.nodes_visited, 10 + 10);
+    EXPECT_EQ (tree.stats ().comparisons - stats.comparisons, 10);
+}
+
+TEST (Test_tree_stats, TestAverageDepthFollowsUpdates)
+{
+    stats_set tree;
+
+    test_helpers::lcg next (11);
+
+    for ( int i = 0; i < 20000; i++ )
+    {
+        auto key = static_cast<int> (next (5000));
+        if ( next (3) )
+            tree.insert (key);
+        else
+            tree.erase (key);
+
+        if ( i % 1000 == 0 )
+        {
+            ASSERT_DOUBLE_EQ (tree.stats ().average_depth, walk_average_depth (tree));
+        }
+    }
+
+    auto stats = tree.stats ();
+    EXPECT_GT (stats.double_rotations, 0);
+    EXPECT_GE (stats.backtrack_steps, stats.backtracks);
+    EXPECT_LE (stats.max_backtrack, static_cast<std::uint64_t> (stats.height));
+
+    /* Batches rebuild the tree, the depths are counted again. */
+    std::vector<int> batch;
+    for ( int i = 0; i < 3000; i++ )
+        batch.push_back (5000 + 2 * i);
+    tree.insert_sorted_batch (batch.begin (), batch.end ());
+    EXPECT_DOUBLE_EQ (tree.stats ().average_depth, walk_average_depth (tree));
+
+    /* Counters move with the tree. */
+    stats = tree.stats ();
+    stats_set moved (std::move (tree));
+    EXPECT_DOUBLE_EQ (moved.stats ().average_depth, stats.average_depth);
+    EXPECT_EQ (moved.stats ().comparisons, stats.comparisons);
+    EXPECT_EQ (tree.stats ().comparisons, 0);
+
+    moved.clear ();
+    EXPECT_EQ (moved.stats ().average_depth, 0);
+    EXPECT_EQ (moved.stats ().height, 0);
+}
+
+TEST (Test_tree_stats, TestQueriesCountedFromThreads)
+{
+    stats_set tree;
+    for ( int i = 0; i < 1000; i++ )
+        tree.insert (i);
+    auto before = tree.stats ();
+    std::vector<int> batch {2000, 2001, 2002};
+    tree.insert_sorted_batch (batch.begin (), batch.end ());
+
+    /* Const queries count from every thread, and the first stats () after the batch as well. */
+    std::vector<std::thread> threads;
+    for ( int t = 0; t < 4; t++ )
+        threads.emplace_back ([&tree, t] {
+            for ( int i = 0; i < 1000; i++ )
+            {
+                tree.os_select (static_cast<std::size_t> (i + 1));
+                if ( i % 100 == t )
+                    tree.stats ();
+            }
+        });
+    for ( auto &thread : threads )
+        thread.join ();
+
+    EXPECT_EQ (tree.stats ().descents - before.descents, 4000);
+    EXPECT_DOUBLE_EQ (tree.stats ().average_depth, walk_average_depth (tree));
+}